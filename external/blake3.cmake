@@ -0,0 +1,32 @@
+if (TARGET BLAKE3::blake3)
+    log_target_found(BLAKE3)
+    return()
+endif()
+
+find_package(blake3 QUIET)
+if (blake3_FOUND)
+    log_module_found(BLAKE3)
+    return()
+endif()
+
+# Hash large blocks with multiple threads using the TBB task scheduler
+set(BLAKE3_USE_TBB ${TORRENTTOOLS_TBB})
+
+# The CMake project of BLAKE3 lives in a subdirectory
+if(EXISTS ${CMAKE_CURRENT_LIST_DIR}/BLAKE3)
+    log_dir_found(BLAKE3)
+    set(blake3_SOURCE_DIR ${CMAKE_CURRENT_LIST_DIR}/BLAKE3)
+else()
+    log_fetch(BLAKE3)
+    FetchContent_Declare(
+            blake3
+            GIT_REPOSITORY https://github.com/BLAKE3-team/BLAKE3.git
+            GIT_TAG        master
+    )
+    FetchContent_GetProperties(blake3)
+    if (NOT blake3_POPULATED)
+        FetchContent_Populate(blake3)
+    endif()
+endif()
+
+add_subdirectory(${blake3_SOURCE_DIR}/c ${CMAKE_CURRENT_BINARY_DIR}/blake3-build EXCLUDE_FROM_ALL)
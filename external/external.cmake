@@ -33,6 +33,8 @@ include(${CMAKE_CURRENT_LIST_DIR}/ctre.cmake)
 include(${CMAKE_CURRENT_LIST_DIR}/sigslot.cmake)
 # TODO: Replace with C++20 default implementation once available
 include(${CMAKE_CURRENT_LIST_DIR}/date.cmake)
+include(${CMAKE_CURRENT_LIST_DIR}/xxhash.cmake)
+include(${CMAKE_CURRENT_LIST_DIR}/blake3.cmake)
 
 # Make sure to call this before dottorrent.cmake to enable offline builds
 # Set a default if not defined so that string(TOLOWER) doesnt complain
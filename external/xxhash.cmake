@@ -0,0 +1,31 @@
+if (TARGET xxHash::xxhash)
+    log_target_found(xxHash)
+    return()
+endif()
+
+find_package(xxHash QUIET)
+if (xxHash_FOUND)
+    log_module_found(xxHash)
+    return()
+endif()
+
+set(XXHASH_BUILD_XXHSUM OFF)
+
+# The CMake project of xxHash lives in a subdirectory
+if(EXISTS ${CMAKE_CURRENT_LIST_DIR}/xxHash)
+    log_dir_found(xxHash)
+    set(xxhash_SOURCE_DIR ${CMAKE_CURRENT_LIST_DIR}/xxHash)
+else()
+    log_fetch(xxHash)
+    FetchContent_Declare(
+            xxhash
+            GIT_REPOSITORY https://github.com/Cyan4973/xxHash.git
+            GIT_TAG        release
+    )
+    FetchContent_GetProperties(xxhash)
+    if (NOT xxhash_POPULATED)
+        FetchContent_Populate(xxhash)
+    endif()
+endif()
+
+add_subdirectory(${xxhash_SOURCE_DIR}/cmake_unofficial ${CMAKE_CURRENT_BINARY_DIR}/xxhash-build EXCLUDE_FROM_ALL)
@@ -11,7 +11,9 @@
 #include "dottorrent/dht_node.hpp"
 #include "dottorrent/hash_function.hpp"
 #include "dottorrent/info_hash.hpp"
+#include "checksum_algorithm.hpp"
 #include "list_edit_mode.hpp"
+#include "sampling.hpp"
 
 dottorrent::protocol protocol_transformer(const std::vector<std::string>& v, bool allow_hybrid = true);
 
@@ -25,7 +27,7 @@ std::vector<std::vector<std::string>> announce_transformer(const YAML::Node& s);
 
 std::vector<dottorrent::dht_node> dht_node_transformer(const std::vector<std::string>& s);
 
-std::unordered_set<dottorrent::hash_function> checksum_transformer(const std::vector<std::string>& s);
+std::unordered_set<torrenttools::checksum_algorithm> checksum_transformer(const std::vector<std::string>& s);
 
 std::filesystem::path path_transformer(const std::vector<std::string>& v,
                                          bool check_exists = true,
@@ -37,6 +39,8 @@ std::filesystem::path metafile_target_transformer(const std::vector<std::string>
 
 std::optional<std::size_t> parse_commandline_size(std::string_view option, const std::string& v);
 
+torrenttools::sample_size sample_size_transformer(std::string_view option, const std::vector<std::string>& v);
+
 std::vector<std::optional<bool>> parse_commandline_booleans(std::string_view option, const std::vector<std::string>& v);
 
 std::optional<bool> parse_commandline_bool(std::string_view option, const std::vector<std::string>& v);
@@ -0,0 +1,101 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "file_hasher.hpp"
+
+namespace torrenttools {
+
+/// Persistent progress of a create command, used to resume after an interruption.
+///
+/// A checkpoint records the inputs of the run, every regular file with its size and modification time,
+/// the protocol and the piece size, together with the hashes completed so far.
+/// Storages hashed file by file store the hashes of completed files and of completed ranges of large files,
+/// other v1 storages store completed piece hashes.
+/// All member functions are thread-safe.
+class create_checkpoint
+{
+public:
+    /// Create a checkpoint backed by the file at path.
+    explicit create_checkpoint(std::filesystem::path path);
+
+    ~create_checkpoint();
+
+    /// Record storage as the inputs of the run, discarding all previous progress.
+    /// @throws std::filesystem::filesystem_error when a file cannot be queried.
+    void set_inputs(const dt::file_storage& storage, dt::protocol protocol);
+
+    /// Read the checkpoint file.
+    /// @throws std::invalid_argument when the file cannot be read or is not a valid checkpoint.
+    void load();
+
+    /// Check that storage and protocol match the recorded inputs and that no file changed since.
+    /// @throws std::invalid_argument describing the first difference.
+    void check_inputs(const dt::file_storage& storage, dt::protocol protocol) const;
+
+    /// Atomically write the checkpoint file.
+    void save() const;
+
+    /// Save the checkpoint every interval from a background thread, until stopped or destroyed.
+    void save_periodically(std::chrono::seconds interval);
+
+    /// Stop saving periodically.
+    void stop();
+
+    /// Remove the checkpoint file after the run completed.
+    void remove() const;
+
+    std::optional<file_hashes> find_file(std::size_t index) const;
+    /// Add the hashes of a completed file, replacing the hashes of its ranges.
+    void add_file(std::size_t index, const file_hashes& hashes);
+
+    /// Hashes of the range of a file starting at offset, see hash_file_range().
+    std::optional<file_hashes> find_file_range(std::size_t index, std::size_t offset) const;
+    void add_file_range(std::size_t index, std::size_t offset, const file_hashes& hashes);
+
+    std::optional<dt::sha1_hash> find_piece(std::size_t index) const;
+    void add_piece(std::size_t index, const dt::sha1_hash& hash);
+
+    std::size_t piece_size() const noexcept
+    { return piece_size_; }
+
+    /// Number of files and pieces of which the hashes are stored.
+    std::size_t completed_files() const;
+    std::size_t completed_pieces() const;
+
+    const std::filesystem::path& path() const noexcept
+    { return path_; }
+
+private:
+    struct file_record
+    {
+        std::string path;
+        std::uint64_t file_size;
+        std::int64_t mtime_ns;
+    };
+
+    std::filesystem::path path_;
+    dt::protocol protocol_ = dt::protocol::none;
+    std::size_t piece_size_ = 0;
+    std::vector<file_record> files_ {};
+    std::map<std::size_t, file_hashes> file_hashes_ {};
+    /// Hashes of completed ranges of files that are not complete yet, by file index and offset.
+    std::map<std::pair<std::size_t, std::size_t>, file_hashes> range_hashes_ {};
+    std::vector<dt::sha1_hash> pieces_ {};
+    std::vector<bool> piece_done_ {};
+    mutable std::mutex mutex_ {};
+    std::jthread saver_ {};
+};
+
+} // namespace torrenttools
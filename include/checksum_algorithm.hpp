@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include <dottorrent/hash_function.hpp>
+
+namespace torrenttools {
+
+namespace { namespace dt = dottorrent; }
+
+/// Fast per-file checksums computed by torrenttools itself, next to the hash functions of dottorrent.
+enum class fast_checksum
+{
+    /// 128-bit XXH3, stored big endian as in the canonical xxHash representation.
+    xxh3_128,
+    /// CRC-32C (Castagnoli), stored big endian.
+    crc32c,
+    /// 256-bit BLAKE3.
+    blake3,
+};
+
+/// A per-file checksum algorithm: a hash function of dottorrent or a fast checksum.
+using checksum_algorithm = std::variant<dt::hash_function, fast_checksum>;
+
+std::string_view to_string(fast_checksum f) noexcept;
+
+std::string to_string(const checksum_algorithm& algorithm);
+
+/// Return the fast checksum with given name, eg. "xxh3-128".
+std::optional<fast_checksum> make_fast_checksum(std::string_view name);
+
+/// Return the checksum algorithm with given name, looking up the hash functions of dottorrent first.
+std::optional<checksum_algorithm> make_checksum_algorithm(std::string_view name);
+
+/// All fast checksums.
+std::span<const fast_checksum> fast_checksum_algorithms() noexcept;
+
+/// Size in bytes of the checksums of f.
+std::size_t digest_size(fast_checksum f) noexcept;
+
+/// Update a CRC-32C without the initial and final inversion.
+/// Uses the SSE 4.2 CRC32 instruction when the CPU supports it.
+std::uint32_t crc32c_update(std::uint32_t crc, std::span<const std::byte> data) noexcept;
+
+
+/// Incrementally compute the checksum of a file with a single algorithm.
+class checksum_algorithm_hasher
+{
+public:
+    virtual ~checksum_algorithm_hasher() = default;
+
+    virtual void update(std::span<const std::byte> data) = 0;
+
+    /// Size of the checksum in bytes.
+    virtual std::size_t digest_size() const noexcept = 0;
+
+    /// Write the checksum of all data passed to update to out and reset the hasher.
+    virtual void finalize_to(std::span<std::byte> out) = 0;
+};
+
+std::unique_ptr<checksum_algorithm_hasher> make_checksum_hasher(const checksum_algorithm& algorithm);
+
+
+/// Fast checksums of the files of a torrent: for every algorithm the checksums of the regular files by path.
+/// Paths are relative to the root directory of the storage, with '/' as separator.
+using fast_checksum_table = std::map<fast_checksum, std::map<std::string, std::vector<std::byte>>>;
+
+} // namespace torrenttools
@@ -0,0 +1,37 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <dottorrent/general.hpp>
+#include <dottorrent/metafile.hpp>
+
+#include "common.hpp"
+#include "config.hpp"
+
+// forward declarations
+namespace CLI { class App; }
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+
+struct compose_app_options
+{
+    std::vector<std::filesystem::path> metafiles;
+    std::optional<std::filesystem::path> destination;
+    std::string name;
+    std::optional<dt::protocol> protocol_version;
+    std::optional<std::filesystem::path> data_directory;
+};
+
+void configure_compose_app(CLI::App* app, compose_app_options& options);
+
+/// Combine the files of multiple v2 metafiles in a new metafile.
+/// The files of each metafile are placed in a directory named after the metafile.
+dt::metafile compose_metafiles(const std::vector<dt::metafile>& metafiles,
+                               const std::string& name,
+                               dt::protocol protocol,
+                               const std::optional<fs::path>& data_directory = std::nullopt);
+
+void run_compose_app(const main_app_options& main_options, const compose_app_options& options);
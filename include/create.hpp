@@ -12,6 +12,7 @@
 #include <dottorrent/hash.hpp>
 #include <dottorrent/info_hash.hpp>
 
+#include "checksum_algorithm.hpp"
 #include "config.hpp"
 #include "tracker_database.hpp"
 #include "info.hpp"
@@ -23,7 +24,18 @@ namespace dt = dottorrent;
 
 // forward declarations
 namespace CLI { class App; }
-namespace torrenttools { class file_matcher; }
+namespace torrenttools { class file_matcher; class scan_cache; }
+
+/// Additional metafile written by create from the same read of the data.
+/// Options which are not set are taken from the main metafile.
+struct create_output_options
+{
+    std::optional<dottorrent::protocol> protocol_version;
+    std::optional<std::size_t> piece_size;
+    std::vector<std::vector<std::string>> announce_list;
+    std::optional<std::string> source;
+    std::optional<std::filesystem::path> destination;
+};
 
 struct create_app_options
 {
@@ -33,7 +45,7 @@ struct create_app_options
     bool read_from_stdin;
     dottorrent::protocol protocol_version = dt::protocol::v1;
     std::optional<std::size_t> piece_size;
-    std::unordered_set<dottorrent::hash_function> checksums;
+    std::unordered_set<torrenttools::checksum_algorithm> checksums;
     std::vector<std::vector<std::string>> announce_list;
     std::vector<std::string> announce_group_list;
     std::vector<std::string> http_seeds;
@@ -57,10 +69,26 @@ struct create_app_options
     bool simple_progress;
     std::optional<std::string> profile;
     bool enable_cross_seeding = true;
+    std::optional<std::filesystem::path> scan_cache;
+    std::optional<std::filesystem::path> hash_cache;
+    std::optional<std::filesystem::path> based_on;
+    bool record_mtimes = false;
+    std::vector<create_output_options> extra_outputs;
+    bool batch_per_directory = false;
+    bool batch_per_file = false;
+    bool dedup_reflinks = false;
+    std::optional<std::filesystem::path> checkpoint;
+    std::optional<std::filesystem::path> resume;
+    bool fastresume = false;
+    std::optional<std::filesystem::path> hash_index;
 };
 
 void configure_create_app(CLI::App* app, create_app_options& options);
 
+/// Parse an output specification of the form "key=value,key=value".
+/// Valid keys are protocol, piece-size, announce, source and output.
+create_output_options parse_output_spec(std::string_view spec);
+
 void configure_matcher(torrenttools::file_matcher& matcher, const create_app_options& options);
 
 void merge_create_profile(const tt::config& cfg, std::string_view profile_name,
@@ -70,4 +98,13 @@ void postprocess_create_app(const CLI::App* app, const main_app_options& main_op
 
 void run_create_app(const main_app_options& main_options, create_app_options& options);
 
-void set_files_with_progress(dottorrent::metafile& m, const create_app_options& options, std::ostream& os);
\ No newline at end of file
+void set_files_with_progress(dottorrent::metafile& m, const create_app_options& options, std::ostream& os);
+
+/// Select files and add them to the metafile without reporting progress.
+void set_files(dottorrent::metafile& m, const create_app_options& options, torrenttools::scan_cache* cache = nullptr);
+
+void set_metafile_options(dottorrent::metafile& m, const create_app_options& options);
+
+/// Return the subdirectories and/or files directly below the target directory
+/// for which a metafile is created with --batch-per-directory and --batch-per-file.
+std::vector<std::filesystem::path> list_batch_targets(const create_app_options& options);
\ No newline at end of file
@@ -38,6 +38,11 @@ struct edit_app_options
     bool write_to_stdout = false;
     std::optional<std::string> profile;
     bool enable_cross_seeding = true;
+    std::optional<std::filesystem::path> data_directory;
+    std::vector<std::filesystem::path> add_files;
+    std::vector<std::filesystem::path> remove_files;
+    std::vector<std::pair<std::filesystem::path, std::filesystem::path>> renames;
+    std::optional<std::size_t> piece_size;
 };
 
 void configure_edit_app(CLI::App* app, edit_app_options& options);
@@ -61,3 +66,7 @@ void update_dht_nodes(dt::metafile& m, const edit_app_options& options);
 void update_similar_torrents(dt::metafile& m, const edit_app_options& options);
 
 void update_collections(dt::metafile& m, const edit_app_options& options);
+
+void update_files(dt::metafile& m, const edit_app_options& options);
+
+void update_piece_size(dt::metafile& m, const edit_app_options& options);
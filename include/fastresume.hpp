@@ -0,0 +1,39 @@
+#pragma once
+#include <filesystem>
+#include <vector>
+
+#include <bencode/bvalue.hpp>
+#include <dottorrent/metafile.hpp>
+
+namespace torrenttools {
+
+namespace { namespace dt = dottorrent; }
+
+/// Return the path of the resume data written next to a metafile: the metafile path with a .fastresume extension.
+std::filesystem::path fastresume_path(const std::filesystem::path& metafile);
+
+/// Number of pieces of a storage as counted by libtorrent.
+/// For v2 and hybrid storages every file starts on a piece boundary, as if padded.
+std::size_t fastresume_piece_count(const dt::file_storage& storage, dt::protocol protocol);
+
+/// Create libtorrent resume data for a metafile of which the data is stored in the root directory of its storage.
+///
+/// The resume data contains the info hashes, the save path, which is the parent of the root directory
+/// for multi-file torrents, a byte per piece with the lowest bit set
+/// for the pieces in have, and the size and modification time in seconds of every file.
+/// Files that do not exist are recorded with size and modification time zero.
+/// When the root directory of a multi-file torrent is not named after the torrent,
+/// the location of every file relative to the save path is stored in "mapped_files".
+/// @param protocol the protocols of the info hashes to include.
+/// @param have for every piece whether the data of the piece is valid, see fastresume_piece_count().
+///             For v2 and hybrid metafiles these are the pieces of the v2 piece layers, in file order.
+bencode::bvalue make_fastresume(const dt::metafile& m, dt::protocol protocol, const std::vector<bool>& have);
+
+/// Write the resume data created by make_fastresume() to path.
+/// @throws std::runtime_error when the file cannot be written.
+void write_fastresume(const std::filesystem::path& path,
+                      const dt::metafile& m,
+                      dt::protocol protocol,
+                      const std::vector<bool>& have);
+
+} // namespace torrenttools
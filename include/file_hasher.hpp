@@ -0,0 +1,241 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <thread>
+#include <vector>
+
+#include <dottorrent/general.hpp>
+#include <dottorrent/hash.hpp>
+#include <dottorrent/hasher/hasher.hpp>
+
+#include "checksum_algorithm.hpp"
+#include "merkle.hpp"
+
+namespace torrenttools {
+
+namespace { namespace fs = std::filesystem; }
+
+/// Check if a protocol includes v1 hashes.
+constexpr bool has_v1(dt::protocol protocol) noexcept
+{ return (protocol & dt::protocol::v1) == dt::protocol::v1; }
+
+/// Check if a protocol includes v2 hashes.
+constexpr bool has_v2(dt::protocol protocol) noexcept
+{ return (protocol & dt::protocol::v2) == dt::protocol::v2; }
+
+
+/// Per-file checksums by algorithm.
+using file_checksums = std::map<checksum_algorithm, std::vector<std::byte>>;
+
+/// Hashes of a single file.
+/// The v1 piece hashes are only valid for files that start on a piece boundary,
+/// which is the case for single file torrents, v2 and hybrid torrents and torrents with BEP 47 padding.
+struct file_hashes
+{
+    /// Protocols for which hashes are available.
+    dt::protocol protocol = dt::protocol::none;
+    std::size_t piece_size = 0;
+    std::size_t file_size = 0;
+
+    /// v2 merkle root, zero for empty files.
+    dt::sha256_hash pieces_root {};
+    /// v2 piece layer, empty for files not larger than a single piece.
+    std::vector<dt::sha256_hash> piece_layer {};
+
+    /// v1 hashes of all complete pieces of the file.
+    std::vector<dt::sha1_hash> pieces {};
+    /// v1 hash of the incomplete last piece, as used when the file is the last file of the torrent.
+    std::optional<dt::sha1_hash> tail_piece {};
+    /// v1 hash of the incomplete last piece padded with zeros to a full piece,
+    /// as used when the file is followed by a padding file.
+    std::optional<dt::sha1_hash> padded_tail_piece {};
+
+    /// v2 hashes of all 16 KiB blocks of the file, only when requested when hashing.
+    std::vector<dt::sha256_hash> leaves {};
+
+    /// Checksums of the complete file, only when requested when hashing.
+    file_checksums checksums {};
+};
+
+
+/// Incrementally compute the v2 merkle root and piece layer of a file.
+class v2_file_hasher
+{
+public:
+    /// @param keep_leaves whether to also return the hashes of all blocks of the file.
+    explicit v2_file_hasher(std::size_t piece_size, bool keep_leaves = false);
+
+    void update(std::span<const std::byte> data);
+
+    /// Hash count zero bytes, using precomputed hashes for complete blocks and pieces.
+    void update_zeros(std::size_t count);
+
+    /// Complete the merkle tree and store the results in hashes.
+    /// The hasher is reset afterwards.
+    void finalize_to(file_hashes& hashes);
+
+private:
+    void add_leaf(std::span<const std::byte> block);
+    void complete_piece();
+
+    std::unique_ptr<dt::hasher> hasher_;
+    std::size_t piece_size_;
+    std::size_t file_size_ = 0;
+    std::vector<std::byte> block_;
+    std::vector<dt::sha256_hash> leaves_;
+    std::vector<dt::sha256_hash> piece_layer_;
+    bool keep_leaves_;
+    std::vector<dt::sha256_hash> all_leaves_ {};
+};
+
+
+/// Incrementally compute the v1 piece hashes of a file starting at a piece boundary.
+class v1_file_hasher
+{
+public:
+    explicit v1_file_hasher(std::size_t piece_size);
+
+    void update(std::span<const std::byte> data);
+
+    /// Hash count zero bytes, using precomputed hashes for complete pieces.
+    void update_zeros(std::size_t count);
+
+    /// Hash the remaining data and store the results in hashes.
+    /// The hasher is reset afterwards.
+    void finalize_to(file_hashes& hashes);
+
+private:
+    dt::sha1_hash hash_piece(std::span<const std::byte> piece);
+
+    std::unique_ptr<dt::hasher> hasher_;
+    std::size_t piece_size_;
+    std::vector<std::byte> piece_;
+    std::size_t piece_fill_ = 0;
+    std::vector<dt::sha1_hash> pieces_;
+};
+
+
+/// Compute the v1 and/or v2 hashes of a single file in one pass over the data.
+class file_hasher
+{
+public:
+    /// @param keep_leaves whether to also return the v2 hashes of all blocks of the file.
+    file_hasher(dt::protocol protocol, std::size_t piece_size, bool keep_leaves = false);
+
+    void update(std::span<const std::byte> data);
+
+    /// Hash count zero bytes, eg. for a hole in a sparse file, without hashing the data itself.
+    void update_zeros(std::size_t count);
+
+    /// Return the hashes of all data passed to update and reset the hasher.
+    file_hashes finalize();
+
+private:
+    dt::protocol protocol_;
+    std::size_t piece_size_;
+    std::size_t file_size_ = 0;
+    std::optional<v1_file_hasher> v1_hasher_;
+    std::optional<v2_file_hasher> v2_hasher_;
+};
+
+
+/// Compute per-file checksums with one or more algorithms.
+///
+/// When threaded, every algorithm runs on its own thread, so the checksums of a block
+/// are computed on other cores while the caller hashes the same block for the pieces.
+class checksum_hasher
+{
+public:
+    /// @param threaded whether to hash on separate threads.
+    checksum_hasher(std::span<const checksum_algorithm> algorithms, bool threaded);
+
+    checksum_hasher(const checksum_hasher&) = delete;
+    checksum_hasher& operator=(const checksum_hasher&) = delete;
+
+    ~checksum_hasher();
+
+    /// Start hashing data.
+    /// When threaded, this returns immediately and data must remain valid until wait() returns.
+    void update(std::span<const std::byte> data);
+
+    /// Hash count zero bytes.
+    void update_zeros(std::size_t count);
+
+    /// Block until all data passed to update is hashed.
+    void wait();
+
+    /// Return the checksums of all data passed to update and reset the hasher.
+    file_checksums finalize();
+
+private:
+    void run(std::size_t index);
+
+    std::vector<checksum_algorithm> algorithms_;
+    std::vector<std::unique_ptr<checksum_algorithm_hasher>> hashers_ {};
+
+    std::mutex mutex_ {};
+    std::condition_variable cv_ {};
+    std::span<const std::byte> data_ {};
+    /// Incremented for every block handed to the threads.
+    std::size_t generation_ = 0;
+    /// Number of threads still hashing the current block.
+    std::size_t pending_ = 0;
+    bool stop_ = false;
+    std::vector<std::jthread> threads_ {};
+};
+
+
+/// Read a file from storage and compute its hashes.
+/// Holes in sparse files are not read, and all-zero blocks and pieces use precomputed hashes.
+/// @param bytes_done when not null, incremented with the number of bytes hashed while reading.
+/// @param keep_leaves whether to also return the v2 hashes of all blocks of the file.
+/// @param checksums algorithms to compute per-file checksums with, from the same reads as the piece hashes.
+///                  Large files are checksummed on separate threads.
+/// @param io_block_size minimum size of a single read, the default is used when smaller.
+/// @throws std::filesystem::filesystem_error when the file cannot be read.
+file_hashes hash_file(const fs::path& path,
+                      dt::protocol protocol,
+                      std::size_t piece_size,
+                      std::atomic_size_t* bytes_done = nullptr,
+                      bool keep_leaves = false,
+                      std::span<const checksum_algorithm> checksums = {},
+                      std::size_t io_block_size = 0);
+
+/// Read length bytes of a file starting at offset and compute their hashes as if they were a file by itself.
+/// The hashes of consecutive ranges starting on piece boundaries can be combined with merge_file_hashes().
+/// @param bytes_done when not null, incremented with the number of bytes hashed while reading.
+/// @param keep_leaves whether to also return the v2 hashes of all blocks of the range.
+/// @param checksums algorithms to compute checksums of the range with, see hash_file().
+/// @param io_block_size minimum size of a single read, see hash_file().
+/// @throws std::filesystem::filesystem_error when the file cannot be read.
+file_hashes hash_file_range(const fs::path& path,
+                            dt::protocol protocol,
+                            std::size_t piece_size,
+                            std::size_t offset,
+                            std::size_t length,
+                            std::atomic_size_t* bytes_done = nullptr,
+                            bool keep_leaves = false,
+                            std::span<const checksum_algorithm> checksums = {},
+                            std::size_t io_block_size = 0);
+
+/// Size of the ranges large files are split in to hash them with multiple threads.
+constexpr std::size_t default_split_size = 256 * 1024 * 1024;
+
+/// Combine the hashes of consecutive ranges of a file into the hashes of the whole file.
+/// All ranges except the last one must have a size that is a multiple of the piece size.
+/// Checksums cannot be combined and are not included.
+file_hashes merge_file_hashes(std::span<const file_hashes> parts);
+
+/// Read the incomplete last piece of a file and set the tail piece hashes of hashes.
+/// This completes v1 hashes that only contain one of the two tail piece variants.
+/// @throws std::filesystem::filesystem_error when the file cannot be read or its size differs.
+void hash_tail_piece(const fs::path& path, file_hashes& hashes);
+
+} // namespace torrenttools
@@ -10,6 +10,8 @@
 #include <re2/re2.h>
 #include <re2/set.h>
 
+#include "scan_cache.hpp"
+
 
 namespace torrenttools {
 
@@ -127,6 +129,29 @@ public:
         search_root_ = root;
     }
 
+    /// Reuse directory listings from a scan cache.
+    /// Directories that did not change since the previous scan are not read again.
+    void set_scan_cache(scan_cache* cache) noexcept
+    {
+        scan_cache_ = cache;
+    }
+
+    /// Check if path passes the filters. The filters must be compiled.
+    bool matches(const fs::path& path) const
+    {
+        Expects(is_compiled_);
+        auto s = path.string();
+
+        if (file_include_list_empty_) {
+            if (!include_hidden_files_ && is_hidden_file(path)) {
+                return false;
+            }
+        } else if (!file_include_list_.Match(s, nullptr)) {
+            return false;
+        }
+        return file_exclude_list_empty_ || !file_exclude_list_.Match(s, nullptr);
+    }
+
     std::size_t files_processed() const noexcept
     {
         return files_scanned_.load(std::memory_order_relaxed);
@@ -175,34 +200,27 @@ public:
         if (!is_compiled_)
             compile();
 
-        for (auto it = fs::recursive_directory_iterator(search_root_); it != fs::end(it); ++it) {
-            if (stop_token.stop_possible() && stop_token.stop_requested()) {
+        if (scan_cache_ != nullptr) {
+            if (!scan_with_cache(stop_token, out)) {
                 is_running_.store(false, std::memory_order_relaxed);
                 return;
             }
-
-            if (it->is_directory()) {
-                if (directory_exclude_list_.contains(it->path().lexically_relative(search_root_))) {
-                    it.disable_recursion_pending();
+        }
+        else {
+            for (auto it = fs::recursive_directory_iterator(search_root_); it != fs::end(it); ++it) {
+                if (stop_token.stop_possible() && stop_token.stop_requested()) {
+                    is_running_.store(false, std::memory_order_relaxed);
+                    return;
                 }
-            }
-            else if (it->is_regular_file()) {
-                files_scanned_.fetch_add(1, std::memory_order_relaxed);
-                auto s = it->path().string();
-                if (file_include_list_empty_) {
-                    if (!include_hidden_files_ && is_hidden_file(*it)) {
-                        continue;
-                    }
-                    if (file_exclude_list_empty_ || !file_exclude_list_.Match(s, nullptr)) {
-                        *out++ = it->path();
-                        files_included_.fetch_add(1, std::memory_order_relaxed);
-                    }
-                } else if (file_include_list_.Match(s, nullptr)) {
-                    if (file_exclude_list_empty_ || !file_exclude_list_.Match(s, nullptr)) {
-                        *out++ = it->path();
-                        files_included_.fetch_add(1, std::memory_order_relaxed);
+
+                if (it->is_directory()) {
+                    if (directory_exclude_list_.contains(it->path().lexically_relative(search_root_))) {
+                        it.disable_recursion_pending();
                     }
                 }
+                else if (it->is_regular_file()) {
+                    match_file(it->path(), out);
+                }
             }
         }
 
@@ -211,9 +229,50 @@ public:
     };
 
 private:
-    static bool is_hidden_file(const fs::directory_entry& entry)
+    /// Walk the search root using the directory listings of the scan cache.
+    /// @returns false when the scan was cancelled.
+    template <typename OutputIterator>
+    bool scan_with_cache(const std::stop_token& stop_token, OutputIterator out)
+    {
+        std::vector<fs::path> stack { search_root_ };
+
+        while (!stack.empty()) {
+            if (stop_token.stop_possible() && stop_token.stop_requested()) {
+                return false;
+            }
+            auto directory = std::move(stack.back());
+            stack.pop_back();
+
+            const auto& record = scan_cache_->list_directory(directory);
+
+            for (const auto& name : record.files) {
+                match_file(directory / name, out);
+            }
+            for (const auto& name : record.subdirectories) {
+                auto subdirectory = directory / name;
+                if (!directory_exclude_list_.contains(subdirectory.lexically_relative(search_root_))) {
+                    stack.push_back(std::move(subdirectory));
+                }
+            }
+        }
+
+        scan_cache_->prune(search_root_);
+        return true;
+    }
+
+    template <typename OutputIterator>
+    void match_file(const fs::path& path, OutputIterator& out)
+    {
+        files_scanned_.fetch_add(1, std::memory_order_relaxed);
+        if (matches(path)) {
+            *out++ = path;
+            files_included_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    static bool is_hidden_file(const fs::path& path)
     {
-        return entry.path().filename().string().starts_with(".");
+        return path.filename().string().starts_with(".");
     }
 
     static re2::RE2::Options make_default_options()
@@ -235,6 +294,7 @@ private:
 
     fs::path search_root_;
     std::vector<fs::path> results_;
+    scan_cache* scan_cache_ = nullptr;
 
     std::jthread fs_thread_;
     std::atomic_bool is_running_ = false;
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include <compare>
+#include <filesystem>
+#include <vector>
+
+namespace torrenttools {
+
+/// Identity and change markers of a file on disk.
+struct file_stat
+{
+    std::uint64_t device = 0;
+    std::uint64_t inode = 0;
+    std::uint64_t file_size = 0;
+    /// Last modification time in nanoseconds since the epoch.
+    std::int64_t mtime_ns = 0;
+
+    friend bool operator==(const file_stat&, const file_stat&) = default;
+};
+
+/// Query the status of a file, following symbolic links.
+/// Device and inode numbers are left zero on platforms without POSIX stat.
+/// @throws std::filesystem::filesystem_error when the file cannot be queried.
+file_stat stat_file(const std::filesystem::path& path);
+
+/// Range of bytes in a file.
+struct file_range
+{
+    std::uint64_t offset = 0;
+    std::uint64_t length = 0;
+
+    friend bool operator==(const file_range&, const file_range&) = default;
+};
+
+/// Return the holes of a sparse file, in order of their offset.
+/// Holes read as zeros and do not need to be read from disk.
+/// Returns an empty list for files without holes and on platforms without SEEK_HOLE support.
+std::vector<file_range> find_holes(const std::filesystem::path& path);
+
+/// Physical location of a range of a file on disk.
+struct file_extent
+{
+    std::uint64_t logical = 0;
+    std::uint64_t physical = 0;
+    std::uint64_t length = 0;
+
+    friend auto operator<=>(const file_extent&, const file_extent&) = default;
+};
+
+/// Return the extents of a file when all of them are shared with other files, eg. by a reflink copy.
+/// Two files of the same size on the same device with the same shared extents have the same content.
+/// Returns an empty list when the file has extents that are not shared or not yet allocated,
+/// and on platforms or filesystems without FIEMAP support.
+std::vector<file_extent> query_shared_extents(const std::filesystem::path& path);
+
+/// Block device holding a file.
+struct storage_device
+{
+    /// Device number of the filesystem, zero when unknown.
+    std::uint64_t id = 0;
+    /// Whether the device is a rotational disk, which performs best with a single sequential reader.
+    /// False for solid state disks, network filesystems and when unknown.
+    bool rotational = false;
+};
+
+/// Find the device holding path.
+/// The rotational flag is read from sysfs and is only available on Linux.
+storage_device query_storage_device(const std::filesystem::path& path);
+
+} // namespace torrenttools
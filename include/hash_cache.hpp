@@ -0,0 +1,95 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <compare>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <shared_mutex>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "file_hasher.hpp"
+#include "file_stat.hpp"
+
+namespace torrenttools {
+
+/// Persistent database of per-file hashes.
+///
+/// v2 merkle roots and piece layers only depend on the file content and the piece size,
+/// and so do the v1 piece hashes of files aligned to a piece boundary.
+/// Entries are keyed by the identity of a file on disk: device, inode, size,
+/// modification time and the piece size, so any change to a file invalidates its entry
+/// while renamed, moved or hardlinked files are still found.
+class hash_cache
+{
+public:
+    struct key_type
+    {
+        std::uint64_t device;
+        std::uint64_t inode;
+        std::uint64_t file_size;
+        std::int64_t mtime_ns;
+        std::size_t piece_size;
+
+        auto operator<=>(const key_type&) const = default;
+    };
+
+    /// Entries that were not used for this long are removed when saving.
+    static constexpr auto expiry_time = std::chrono::days(90);
+
+    hash_cache() = default;
+
+    /// Create a cache backed by the file at path.
+    /// Call load() to read previous results.
+    explicit hash_cache(std::filesystem::path path);
+
+    /// Read the cache file. A missing or unreadable cache file results in an empty cache.
+    void load();
+
+    /// Atomically write the cache file.
+    void save() const;
+
+    /// Look up the hashes of a file.
+    /// @param padded_tail whether the last v1 piece of the file is followed by padding.
+    /// @returns the cached hashes when they include the hashes for all protocols in protocol.
+    std::optional<file_hashes> find(const file_stat& status,
+                                    std::size_t piece_size,
+                                    dt::protocol protocol,
+                                    bool padded_tail = true);
+
+    /// Add the hashes of a file. Hashes of other protocols already in the cache are kept.
+    void insert(const file_stat& status, const file_hashes& hashes);
+
+    /// Add the hashes of all piece aligned files of a hashed storage.
+    void insert(const dt::file_storage& storage, dt::protocol protocol);
+
+    const std::filesystem::path& path() const noexcept
+    { return path_; }
+
+    std::size_t size() const;
+
+    /// Number of successful lookups.
+    std::size_t hits() const noexcept
+    { return hits_.load(std::memory_order_relaxed); }
+
+    /// Number of failed lookups.
+    std::size_t misses() const noexcept
+    { return misses_.load(std::memory_order_relaxed); }
+
+private:
+    struct entry_type
+    {
+        file_hashes hashes;
+        std::chrono::system_clock::time_point last_used;
+    };
+
+    std::filesystem::path path_;
+    std::map<key_type, entry_type> entries_;
+    mutable std::shared_mutex mutex_;
+    std::atomic_size_t hits_ = 0;
+    std::atomic_size_t misses_ = 0;
+};
+
+} // namespace torrenttools
@@ -0,0 +1,67 @@
+#pragma once
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <bencode/bvalue.hpp>
+
+#include "file_hasher.hpp"
+
+namespace torrenttools {
+
+/// Encode a sha1 or sha256 hash as a binary string.
+template <typename Hash>
+std::string encode_hash(const Hash& h)
+{
+    auto bytes = hash_bytes(h);
+    return std::string(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+}
+
+/// Encode a list of hashes as the concatenation of their binary representations.
+template <typename Hash>
+std::string encode_hashes(const std::vector<Hash>& hashes)
+{
+    std::string out {};
+    out.reserve(hashes.size() * Hash::size_bytes);
+    for (const auto& h : hashes) {
+        auto bytes = hash_bytes(h);
+        out.append(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    }
+    return out;
+}
+
+/// Decode a list of hashes encoded with encode_hashes().
+/// @throws std::invalid_argument when the length of data is not a multiple of the hash size.
+template <typename Hash>
+std::vector<Hash> decode_hashes(std::string_view data)
+{
+    if (data.size() % Hash::size_bytes != 0) {
+        throw std::invalid_argument("invalid hash list length");
+    }
+    std::vector<Hash> hashes {};
+    hashes.reserve(data.size() / Hash::size_bytes);
+    for (std::size_t i = 0; i < data.size(); i += Hash::size_bytes) {
+        hashes.emplace_back(data.substr(i, Hash::size_bytes));
+    }
+    return hashes;
+}
+
+/// Encode flags as a bitfield, the first flag being the most significant bit of the first byte.
+std::string encode_bitfield(const std::vector<bool>& flags);
+
+/// Decode size flags encoded with encode_bitfield().
+/// @throws std::invalid_argument when the length of data does not match size.
+std::vector<bool> decode_bitfield(std::string_view data, std::size_t size);
+
+/// Encode the hashes of a file as a bencoded dict with the keys
+/// "pieces root" and "piece layer" for v2, and "pieces", "tail piece" and "padded tail piece" for v1.
+/// The piece size and file size are not included.
+bencode::bvalue::dict_type encode_file_hashes(const file_hashes& hashes);
+
+/// Decode the hashes of a file encoded with encode_file_hashes().
+/// The number of hashes is checked against file_size and piece_size.
+/// @throws std::out_of_range, std::invalid_argument or bencode::bad_access for invalid data.
+file_hashes decode_file_hashes(const bencode::bvalue::dict_type& dict, std::size_t piece_size, std::size_t file_size);
+
+} // namespace torrenttools
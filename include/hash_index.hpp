@@ -0,0 +1,154 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <vector>
+
+#include <dottorrent/hash.hpp>
+#include <dottorrent/metafile.hpp>
+
+namespace torrenttools {
+
+namespace { namespace dt = dottorrent; }
+
+/// Binary sidecar file with the v1 piece hashes and the complete v2 merkle trees of the files of a torrent.
+///
+/// All integers are unsigned little endian and all sections start at a multiple of 8 bytes,
+/// so the file can be memory-mapped and indexed directly.
+///
+///   offset  size  header
+///        0     8  magic "TTHSHIDX"
+///        8     4  format version, currently 1
+///       12     4  protocol: 1 = v1, 2 = v2, 3 = hybrid
+///       16     8  piece size
+///       24     8  number of files
+///       32     8  number of v1 pieces
+///       40     8  offset of the file table
+///       48     8  offset of the v1 piece hashes
+///       56    32  v2 infohash, zero for v1 torrents
+///       88    20  v1 infohash, zero for v2 torrents
+///      108    20  reserved, zero
+///
+/// The merkle trees follow the header. The file table has an entry of 32 bytes for every file of the torrent,
+/// in the order of the metafile, including padding files:
+///
+///        0     8  file size
+///        8     8  number of leaves: the number of 16 KiB blocks of the file, zero without a tree
+///       16     8  offset of the merkle tree, zero without a tree
+///       24     8  number of nodes of the merkle tree
+///
+/// A merkle tree consists of 32 byte sha256 nodes, layer by layer from the leaves up to the root, see merkle_tree().
+/// Layers are not padded: layer k has ceil(leaves / 2^k) nodes, the last node is the pieces root.
+/// Files with the same data can share a tree.
+/// The v1 piece hashes of 20 bytes each are stored last.
+class hash_index_writer
+{
+public:
+    static constexpr char magic[8] = {'T', 'T', 'H', 'S', 'H', 'I', 'D', 'X'};
+    static constexpr std::uint32_t version = 1;
+    static constexpr std::size_t header_size = 128;
+    static constexpr std::size_t file_entry_size = 32;
+
+    /// Start writing an index for a torrent with file_count files to a temporary file next to path.
+    /// @throws std::invalid_argument when the file cannot be written.
+    hash_index_writer(std::filesystem::path path, std::size_t file_count);
+
+    hash_index_writer(const hash_index_writer&) = delete;
+    hash_index_writer& operator=(const hash_index_writer&) = delete;
+
+    /// Remove the temporary file when the index was not finished.
+    ~hash_index_writer();
+
+    /// Add the merkle tree of a file from the hashes of its 16 KiB blocks.
+    /// Can be called from multiple threads.
+    void add_tree(std::size_t index, std::span<const dt::sha256_hash> leaves);
+
+    /// Use the merkle tree of file source for file index, for files with the same data.
+    void share_tree(std::size_t index, std::size_t source);
+
+    /// Write the file table, the v1 piece hashes of the hashed metafile and the header
+    /// and move the index to its path.
+    void finish(const dt::metafile& m, dt::protocol protocol);
+
+    const std::filesystem::path& path() const noexcept
+    { return path_; }
+
+private:
+    struct tree_entry
+    {
+        std::uint64_t leaf_count = 0;
+        std::uint64_t offset = 0;
+        std::uint64_t node_count = 0;
+    };
+
+    std::filesystem::path path_;
+    std::filesystem::path tmp_path_;
+    std::ofstream ofs_;
+    std::mutex mutex_ {};
+    std::vector<tree_entry> trees_;
+    std::uint64_t next_offset_ = header_size;
+    bool finished_ = false;
+};
+
+
+/// A hash index read from a file written by hash_index_writer.
+class hash_index
+{
+public:
+    /// Read the index at path.
+    /// @throws std::invalid_argument when the file cannot be read or is not a valid hash index.
+    explicit hash_index(const std::filesystem::path& path);
+
+    dt::protocol protocol() const noexcept
+    { return protocol_; }
+
+    std::size_t piece_size() const noexcept
+    { return piece_size_; }
+
+    std::size_t file_count() const noexcept
+    { return files_.size(); }
+
+    std::size_t file_size(std::size_t index) const
+    { return files_.at(index).file_size; }
+
+    std::optional<dt::sha1_hash> info_hash_v1() const noexcept
+    { return info_hash_v1_; }
+
+    std::optional<dt::sha256_hash> info_hash_v2() const noexcept
+    { return info_hash_v2_; }
+
+    /// The v1 piece hashes of the torrent.
+    const std::vector<dt::sha1_hash>& pieces() const noexcept
+    { return pieces_; }
+
+    /// Number of leaves of the merkle tree of a file.
+    std::size_t leaf_count(std::size_t index) const
+    { return files_.at(index).leaf_count; }
+
+    /// The nodes of the merkle tree of a file, layer by layer from the leaves up to the root.
+    /// Empty for files without a tree.
+    std::vector<dt::sha256_hash> tree(std::size_t index) const;
+
+private:
+    struct file_entry
+    {
+        std::uint64_t file_size;
+        std::uint64_t leaf_count;
+        std::uint64_t offset;
+        std::uint64_t node_count;
+    };
+
+    std::vector<std::byte> data_ {};
+    dt::protocol protocol_ = dt::protocol::none;
+    std::size_t piece_size_ = 0;
+    std::optional<dt::sha1_hash> info_hash_v1_ {};
+    std::optional<dt::sha256_hash> info_hash_v2_ {};
+    std::vector<file_entry> files_ {};
+    std::vector<dt::sha1_hash> pieces_ {};
+};
+
+} // namespace torrenttools
@@ -0,0 +1,41 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <dottorrent/file_entry.hpp>
+#include <dottorrent/file_storage.hpp>
+
+#include "file_hasher.hpp"
+
+namespace torrenttools {
+
+/// A regular file of a file storage together with its hashes.
+/// Used to rearrange the files of a metafile without reading their data.
+struct hashed_file
+{
+    fs::path path;
+    dt::file_attributes attributes;
+    file_hashes hashes;
+};
+
+/// Extract all regular files and their hashes from a hashed storage.
+/// v1 piece hashes are only included when the storage is aligned to piece boundaries.
+/// Per-file checksums are kept and added back to the file entries by set_hashed_files.
+std::vector<hashed_file> extract_hashed_files(const dt::file_storage& storage, dt::protocol protocol);
+
+/// Sort files in the order of the v2 file tree.
+void sort_hashed_files(std::vector<hashed_file>& files);
+
+/// Replace the files of storage with files and set their hashes.
+/// Files are added in the given order. When protocol includes v1, padding files are inserted
+/// so every file starts on a piece boundary.
+/// The v1 hash of the incomplete last piece of a file depends on whether it is followed by padding.
+/// When the required variant is missing it is computed from the file in data_root.
+/// @throws std::invalid_argument when a tail piece is missing and no data_root is given.
+void set_hashed_files(dt::file_storage& storage,
+                      std::vector<hashed_file> files,
+                      dt::protocol protocol,
+                      const std::optional<fs::path>& data_root = std::nullopt);
+
+} // namespace torrenttools
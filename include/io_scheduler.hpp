@@ -0,0 +1,56 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace torrenttools {
+
+/// Run jobs on a shared pool of workers while limiting the number of jobs reading from the same device.
+///
+/// Jobs of the same device are started in the order they were added.
+/// Workers pick jobs from the devices in turn, so every device is kept busy
+/// as long as it has pending jobs and there are free workers.
+class io_scheduler
+{
+public:
+    /// @param threads: the number of jobs running at the same time over all devices.
+    explicit io_scheduler(std::size_t threads);
+
+    /// Add a job reading from device.
+    /// @param limit: the maximum number of jobs of device that run at the same time.
+    ///               The limit given for the first job of a device is used.
+    void add(std::uint64_t device, std::size_t limit, std::function<void()> job);
+
+    /// Run all jobs and block until they are done.
+    /// Jobs must handle their own errors, an exception escaping a job terminates the program.
+    void run();
+
+    std::size_t job_count() const noexcept
+    { return job_count_; }
+
+private:
+    struct device_queue
+    {
+        std::uint64_t device;
+        std::size_t limit;
+        std::size_t active = 0;
+        std::deque<std::function<void()>> jobs {};
+    };
+
+    void work() noexcept;
+
+    std::size_t thread_count_;
+    std::size_t job_count_ = 0;
+    std::vector<device_queue> devices_ {};
+    /// Device to try first when picking the next job.
+    std::size_t next_device_ = 0;
+    std::size_t pending_ = 0;
+    std::mutex mutex_ {};
+    std::condition_variable cv_ {};
+};
+
+} // namespace torrenttools
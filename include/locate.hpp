@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "common.hpp"
+#include "config.hpp"
+
+// forward declarations
+namespace CLI { class App; }
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+
+struct locate_app_options
+{
+    std::filesystem::path metafile;
+    std::filesystem::path search_root;
+    std::optional<std::filesystem::path> link_directory;
+    std::size_t threads = 2;
+};
+
+/// Regular files below a directory grouped by their size.
+using size_index = std::unordered_map<std::uint64_t, std::vector<fs::path>>;
+
+enum class locate_status
+{
+    /// A candidate of the same size matched the hashes of the file.
+    found,
+    /// The file is empty or a padding file, no data has to be located.
+    empty,
+    /// The file does not contain a complete piece, so a candidate of the same size was picked without checking.
+    unconfirmed,
+    /// No candidate of the same size matched the hashes of the file.
+    missing,
+};
+
+struct located_file
+{
+    locate_status status = locate_status::missing;
+    /// Path of the data of the file, for found and unconfirmed files.
+    std::optional<fs::path> path {};
+    /// Number of files of the same size in the search tree.
+    std::size_t candidates = 0;
+};
+
+void configure_locate_app(CLI::App* app, locate_app_options& options);
+
+/// Index all regular files below root by their size.
+/// The sizes are queried by threads workers since metadata lookups are latency bound.
+/// Files that cannot be queried are skipped.
+size_index build_size_index(const fs::path& root, std::size_t threads = 1);
+
+/// Find the data of every file of storage among the files of the size index.
+///
+/// Candidates with the same size are confirmed by hashing a single piece:
+/// a piece of the v2 piece layer or the merkle root of files not larger than a piece,
+/// and for v1 metafiles a piece that lies entirely within the file.
+/// Candidates with the same filename are tried first.
+/// @returns the result for every file of storage, padding files are reported as empty.
+std::vector<located_file> locate_files(const dt::file_storage& storage,
+                                       const size_index& index,
+                                       std::size_t threads = 1);
+
+/// Recreate the layout of storage below destination with hard links to the located files.
+/// Falls back to symbolic links when a file is on another filesystem.
+/// Empty files and padding files are created as empty and sparse files.
+/// Missing files are skipped.
+/// @throws std::runtime_error when a different file already exists at the path of a link.
+void link_located_files(const dt::file_storage& storage,
+                        const std::vector<located_file>& results,
+                        const fs::path& destination);
+
+void run_locate_app(const main_app_options& main_options, const locate_app_options& options);
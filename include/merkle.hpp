@@ -0,0 +1,69 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <vector>
+
+#include <dottorrent/hash.hpp>
+
+namespace torrenttools {
+
+namespace { namespace dt = dottorrent; }
+
+/// Size of the leaf blocks of a v2 merkle tree.
+constexpr std::size_t v2_block_size = 16 * 1024;
+
+/// View the bytes of a sha1 or sha256 hash.
+template <typename Hash>
+std::span<const std::byte> hash_bytes(const Hash& h) noexcept
+{
+    return std::span<const std::byte>(h.data(), Hash::size_bytes);
+}
+
+/// Mutable view of the bytes of a sha1 or sha256 hash.
+template <typename Hash>
+std::span<std::byte> hash_bytes(Hash& h) noexcept
+{
+    return std::span<std::byte>(h.data(), Hash::size_bytes);
+}
+
+/// Hash the concatenation of two merkle tree nodes.
+dt::sha256_hash merkle_hash_pair(const dt::sha256_hash& lhs, const dt::sha256_hash& rhs);
+
+/// Return the root of a merkle subtree with given number of all-zero leaf hashes.
+/// This is the value used to pad a layer to a power of two.
+/// @param leaf_count the number of leaves in the subtree, must be a power of two.
+const dt::sha256_hash& merkle_pad_hash(std::size_t leaf_count);
+
+/// Compute the root of a merkle tree from one of its layers.
+/// The layer is padded to width nodes using the pad hash for nodes spanning node_leaf_count leaves.
+/// @param layer the nodes of the layer, at most width nodes.
+/// @param width the number of nodes of the padded layer, must be a power of two.
+/// @param node_leaf_count the number of leaves spanned by a single node of the layer.
+dt::sha256_hash merkle_root(std::span<const dt::sha256_hash> layer,
+                            std::size_t width,
+                            std::size_t node_leaf_count = 1);
+
+/// Compute all layers of the merkle tree of a file from its leaf hashes, from the leaves up to the root.
+/// Layers are not padded: layer k has ceil(leaves.size() / 2^k) nodes
+/// and a node without a right sibling is combined with the pad hash of its layer.
+/// The last layer consists of the merkle root of the file.
+/// @returns the nodes of all layers, concatenated. Empty when there are no leaves.
+std::vector<dt::sha256_hash> merkle_tree(std::span<const dt::sha256_hash> leaves);
+
+/// Number of nodes of the unpadded merkle tree of a file with given number of leaves, see merkle_tree().
+std::size_t merkle_tree_size(std::size_t leaf_count) noexcept;
+
+/// Compute the v2 piece layer of a file for a larger piece size from its piece layer for a smaller piece size.
+/// Each node of the new layer is the root of the subtree formed by consecutive nodes of the old layer,
+/// so no file data is required. The merkle root of the file does not change.
+/// @param layer the piece layer for piece_size.
+/// @param piece_size the current piece size, a power of two of at least 16 KiB.
+/// @param new_piece_size the new piece size, a power of two larger than or equal to piece_size.
+/// @param file_size the size of the file.
+/// @returns the piece layer for new_piece_size, empty when the file is not larger than new_piece_size.
+std::vector<dt::sha256_hash> merge_piece_layer(std::span<const dt::sha256_hash> layer,
+                                               std::size_t piece_size,
+                                               std::size_t new_piece_size,
+                                               std::size_t file_size);
+
+} // namespace torrenttools
@@ -0,0 +1,72 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/metafile.hpp>
+
+#include "checksum_algorithm.hpp"
+
+namespace torrenttools {
+
+namespace { namespace dt = dottorrent; }
+
+/// Size and modification time of a file when a metafile was created.
+struct file_mtime
+{
+    std::uint64_t file_size = 0;
+    /// Last modification time in nanoseconds since the epoch.
+    std::int64_t mtime_ns = 0;
+
+    friend bool operator==(const file_mtime&, const file_mtime&) = default;
+};
+
+/// Size and modification time of the regular files of a torrent by path.
+/// Paths are relative to the root directory of the storage, with '/' as separator.
+using file_mtime_table = std::map<std::string, file_mtime>;
+
+/// Per-file data stored by torrenttools in the root dictionary of a metafile.
+///
+/// The info dictionary only holds data defined by the bittorrent protocol,
+/// so these are stored next to it, which leaves the infohash unchanged:
+///
+///     "file checksums": {"xxh3-128": {"dir/file.bin": <16 bytes>, ...}, ...}
+///     "file mtimes":    {"dir/file.bin": [<size>, <mtime in ns>], ...}
+struct metafile_extras
+{
+    fast_checksum_table checksums {};
+    file_mtime_table mtimes {};
+
+    bool empty() const noexcept
+    { return checksums.empty() && mtimes.empty(); }
+};
+
+constexpr std::string_view fast_checksums_key = "file checksums";
+constexpr std::string_view file_mtimes_key = "file mtimes";
+
+/// Record the size and modification time of the regular files of storage.
+/// @throws std::filesystem::filesystem_error when a file cannot be queried.
+file_mtime_table stat_storage_files(const dt::file_storage& storage);
+
+/// Read the extras of a metafile, empty when it has none.
+/// @throws std::invalid_argument when the file cannot be read.
+metafile_extras load_metafile_extras(const std::filesystem::path& metafile);
+
+/// Write a metafile including extras.
+void write_metafile_to(std::ostream& os,
+                       const dt::metafile& m,
+                       dt::protocol protocol,
+                       const metafile_extras& extras);
+
+/// Save a metafile including extras.
+/// @throws std::runtime_error when the file cannot be written.
+void save_metafile(const std::filesystem::path& path,
+                   const dt::metafile& m,
+                   dt::protocol protocol,
+                   const metafile_extras& extras);
+
+} // namespace torrenttools
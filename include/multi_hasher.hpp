@@ -0,0 +1,114 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "file_hasher.hpp"
+#include "piece_layout.hpp"
+
+namespace torrenttools {
+
+/// Hash multiple file storages listing the same files in a single read pass over the data.
+///
+/// The storages can differ in piece size, protocol and padding files,
+/// but must contain the same regular files in the same order.
+/// Every block of data is read once and passed to the hashers of all storages.
+/// The storages are divided over a fixed set of hashing threads,
+/// which hash a block while the next one is read.
+///
+/// The interface mirrors dottorrent::storage_hasher so the same progress reporting can be used.
+/// Progress is reported for the first storage.
+class multi_hasher
+{
+public:
+    /// @param targets the storages to hash and the protocol to hash each of them for.
+    /// @param threads the number of threads to hash with, at most one per storage is used.
+    ///                With a single thread all storages are hashed on the thread reading the data.
+    explicit multi_hasher(std::vector<std::pair<dt::file_storage*, dt::protocol>> targets,
+                          std::size_t threads = 1);
+
+    multi_hasher(const multi_hasher&) = delete;
+    multi_hasher& operator=(const multi_hasher&) = delete;
+
+    ~multi_hasher();
+
+    /// The data is hashed once for all targets, padding files are not counted in the progress.
+    dt::protocol protocol() const noexcept
+    { return dt::protocol::v2; }
+
+    void start();
+
+    /// Block until all data is hashed and store the results in the file storages.
+    /// Rethrows the error encountered while hashing.
+    void wait();
+
+    std::size_t bytes_done() const noexcept
+    { return bytes_done_.load(std::memory_order_relaxed); }
+
+    /// Index in the first storage of the file being hashed, and the number of bytes hashed for it.
+    std::pair<std::size_t, std::size_t> current_file_progress() const noexcept;
+
+private:
+    struct target
+    {
+        dt::file_storage* storage;
+        dt::protocol protocol;
+        piece_layout layout;
+        /// Index in storage of every regular file.
+        std::vector<std::size_t> file_indices;
+        /// Hashes files one by one, used when every file starts on a piece boundary.
+        std::optional<file_hasher> per_file;
+        std::vector<file_hashes> file_results;
+        /// Hashes the concatenation of all files, used for unaligned v1 storages.
+        std::optional<v1_file_hasher> stream;
+
+        void begin_file(std::size_t file);
+        void update(std::span<const std::byte> data);
+        void update_zeros(std::size_t count);
+        void end_file(std::size_t file);
+        void finish();
+    };
+
+    void run();
+
+    /// Hand a block of data, or count zero bytes when data is empty, to all targets.
+    /// When hashing threads are used this returns immediately and data must remain valid until wait_idle() returns.
+    void update_all(std::span<const std::byte> data, std::size_t zeros = 0);
+
+    /// Block until the hashing threads are done with the last block.
+    void wait_idle();
+
+    /// Hash the targets index, index + stride, ... for every block.
+    void run_worker(std::size_t index, std::size_t stride);
+
+    std::vector<target> targets_;
+    std::jthread thread_ {};
+    std::exception_ptr error_ {};
+    std::atomic_size_t bytes_done_ = 0;
+    std::atomic_size_t current_file_ = 0;
+    std::atomic_size_t current_file_bytes_ = 0;
+
+    /// A block is read into one buffer while the other is hashed.
+    std::array<std::vector<std::byte>, 2> buffers_ {};
+    std::mutex mutex_ {};
+    std::condition_variable cv_ {};
+    std::span<const std::byte> data_ {};
+    std::size_t zeros_ = 0;
+    /// Incremented for every block handed to the threads.
+    std::size_t generation_ = 0;
+    /// Number of threads still hashing the current block.
+    std::size_t pending_ = 0;
+    bool stop_ = false;
+    std::vector<std::jthread> workers_ {};
+};
+
+} // namespace torrenttools
@@ -0,0 +1,180 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "checksum_algorithm.hpp"
+#include "file_hasher.hpp"
+#include "file_stat.hpp"
+#include "piece_layout.hpp"
+
+namespace torrenttools {
+
+class hash_cache;
+class create_checkpoint;
+class hash_index_writer;
+
+/// Hash a file storage file by file instead of piece by piece.
+///
+/// Each file is hashed independently which allows the hashes of unchanged files
+/// to be taken from a hash_cache instead of reading them from disk.
+/// This requires every file to start on a piece boundary, which is always the case for v2 torrents.
+/// Hybrid and multi-file v1 storages must be aligned with align_to_pieces() first.
+///
+/// Files are handed out to the workers largest first, and files larger than the split size
+/// are hashed in ranges by multiple workers, so a single large file does not leave a long single threaded tail.
+///
+/// The interface mirrors dottorrent::storage_hasher so the same progress reporting can be used.
+class per_file_hasher
+{
+public:
+    per_file_hasher(dt::file_storage& storage, dt::protocol protocol, std::size_t threads = 1);
+
+    /// Use cache to look up and store file hashes.
+    void set_hash_cache(hash_cache* cache) noexcept
+    { cache_ = cache; }
+
+    /// Take the hashes of files stored in checkpoint instead of reading them, and add the hashes of every hashed file.
+    /// Large files are hashed in ranges and completed ranges are stored as well,
+    /// so an interrupted file is resumed from its last completed range.
+    void set_checkpoint(create_checkpoint* checkpoint) noexcept
+    { checkpoint_ = checkpoint; }
+
+    /// Add the v2 merkle tree of every file to index.
+    /// Stored hashes do not include the merkle trees, so all files are read even when a cache or checkpoint is set.
+    void set_hash_index(hash_index_writer* index) noexcept
+    { index_ = index; }
+
+    /// Compute per-file checksums with algorithms while reading the files for the piece hashes.
+    /// Stored hashes do not include checksums, so all files are read even when a cache or checkpoint is set,
+    /// and files are not split in ranges.
+    /// Checksums of dottorrent hash functions are added to the file entries, fast checksums to fast_checksums().
+    void set_checksums(std::vector<checksum_algorithm> algorithms)
+    { checksums_ = std::move(algorithms); }
+
+    /// Take the hashes of files with the same data on disk from the first of them instead of reading them again.
+    /// @param shared for every file the index of an earlier file with the same data, see find_shared_files().
+    void set_shared_files(std::vector<std::optional<std::size_t>> shared);
+
+    /// Share threads with other hashers: a slot is taken from slots while a file or range is hashed,
+    /// so all hashers using the same slots together hash at most its initial count of files at a time.
+    void set_slots(std::counting_semaphore<>* slots) noexcept
+    { slots_ = slots; }
+
+    /// Read files in blocks of at least size bytes.
+    void set_io_block_size(std::size_t size) noexcept
+    { io_block_size_ = size; }
+
+    /// Hash files larger than size in ranges of size bytes, rounded up to a multiple of the piece size.
+    /// Files are only split when hashing with multiple threads or with a checkpoint.
+    void set_split_size(std::size_t size) noexcept
+    { split_size_ = size; }
+
+    dt::protocol protocol() const noexcept
+    { return protocol_; }
+
+    void start();
+
+    /// Block until all files are hashed and store the results in the file storage.
+    /// Rethrows the first error encountered while hashing.
+    void wait();
+
+    bool done() const noexcept;
+
+    /// Total number of bytes processed.
+    /// For v1 torrents padding files are included, same as for dottorrent::storage_hasher.
+    std::size_t bytes_done() const noexcept;
+
+    /// Index of the first file that is not completely processed yet and the number of bytes processed for it.
+    std::pair<std::size_t, std::size_t> current_file_progress() const noexcept;
+
+    /// Number of files of which the hashes were taken from the hash cache.
+    std::size_t cache_hits() const noexcept
+    { return cache_hits_.load(std::memory_order_relaxed); }
+
+    /// Number of files of which the hashes were taken from the checkpoint.
+    std::size_t resumed_files() const noexcept
+    { return resumed_files_.load(std::memory_order_relaxed); }
+
+    /// Number of ranges of large files of which the hashes were taken from the checkpoint.
+    std::size_t resumed_ranges() const noexcept
+    { return resumed_ranges_.load(std::memory_order_relaxed); }
+
+    /// Number of files of which the hashes were taken from another file with the same data.
+    std::size_t shared_file_count() const noexcept;
+
+    /// Number of bytes that were not read because they belong to a shared file.
+    std::size_t shared_bytes() const noexcept;
+
+    /// Fast checksums of all files, available after wait().
+    const fast_checksum_table& fast_checksums() const noexcept
+    { return fast_checksums_; }
+
+private:
+    /// A file that is hashed in multiple ranges.
+    struct split_file
+    {
+        std::vector<file_hashes> parts;
+        std::atomic_size_t remaining;
+        std::atomic_bool failed = false;
+        file_stat status;
+    };
+
+    /// A file or range of a file to hash.
+    struct work_item
+    {
+        std::size_t index;
+        std::size_t offset;
+        std::size_t length;
+        /// The file the range belongs to, null when the item is a complete file.
+        split_file* split = nullptr;
+        std::size_t part = 0;
+    };
+
+    void plan_work();
+    void run();
+    bool find_file(std::size_t index, const file_stat& status);
+    void process_file(std::size_t index);
+    void process_part(const work_item& item);
+    void store_file(std::size_t index, const file_stat& status, file_hashes hashes);
+    void complete_file(std::size_t index);
+
+    dt::file_storage& storage_;
+    piece_layout layout_;
+    dt::protocol protocol_;
+    std::size_t thread_count_;
+    hash_cache* cache_ = nullptr;
+    create_checkpoint* checkpoint_ = nullptr;
+    hash_index_writer* index_ = nullptr;
+    std::vector<checksum_algorithm> checksums_ {};
+    std::counting_semaphore<>* slots_ = nullptr;
+    std::size_t split_size_;
+    std::size_t io_block_size_ = 0;
+
+    std::vector<work_item> work_ {};
+    std::vector<std::unique_ptr<split_file>> split_files_ {};
+    std::vector<std::jthread> workers_ {};
+    /// Index of the next work item.
+    std::atomic_size_t next_index_ = 0;
+    std::atomic_size_t cache_hits_ = 0;
+    std::atomic_size_t resumed_files_ = 0;
+    std::atomic_size_t resumed_ranges_ = 0;
+    std::unique_ptr<std::atomic_size_t[]> file_bytes_done_;
+    std::vector<std::optional<file_hashes>> results_;
+    std::vector<std::optional<std::size_t>> shared_ {};
+    fast_checksum_table fast_checksums_ {};
+
+    std::mutex error_mutex_ {};
+    std::exception_ptr error_ {};
+};
+
+} // namespace torrenttools
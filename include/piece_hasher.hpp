@@ -0,0 +1,75 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "piece_layout.hpp"
+
+namespace torrenttools {
+
+class create_checkpoint;
+
+/// Hash the v1 pieces of a file storage with a pool of workers, each reading a range of consecutive pieces.
+///
+/// Unlike per_file_hasher this works for storages where pieces span file boundaries.
+/// When a checkpoint is set, pieces stored in it are not read again
+/// and every hashed piece is added to it.
+///
+/// The interface mirrors dottorrent::storage_hasher so the same progress reporting can be used.
+class piece_hasher
+{
+public:
+    explicit piece_hasher(dt::file_storage& storage, std::size_t threads = 1);
+
+    void set_checkpoint(create_checkpoint* checkpoint) noexcept
+    { checkpoint_ = checkpoint; }
+
+    dt::protocol protocol() const noexcept
+    { return dt::protocol::v1; }
+
+    void start();
+
+    /// Block until all pieces are hashed and store them in the file storage.
+    /// Rethrows the first error encountered while hashing.
+    void wait();
+
+    /// Total number of bytes processed, including padding files and pieces taken from the checkpoint.
+    std::size_t bytes_done() const noexcept
+    { return bytes_done_.load(std::memory_order_relaxed); }
+
+    /// Index of the file containing the first unprocessed byte and the number of bytes processed for it.
+    /// Pieces are processed out of order by multiple workers, so this is an approximation.
+    std::pair<std::size_t, std::size_t> current_file_progress() const noexcept;
+
+    /// Number of pieces taken from the checkpoint.
+    std::size_t resumed_pieces() const noexcept
+    { return resumed_pieces_; }
+
+private:
+    void run();
+
+    dt::file_storage& storage_;
+    piece_layout layout_;
+    std::size_t thread_count_;
+    create_checkpoint* checkpoint_ = nullptr;
+
+    /// Half-open ranges of pieces to hash.
+    std::vector<std::pair<std::size_t, std::size_t>> work_ {};
+    std::vector<dt::sha1_hash> pieces_ {};
+    std::size_t resumed_pieces_ = 0;
+
+    std::vector<std::jthread> workers_ {};
+    std::atomic_size_t next_item_ = 0;
+    std::atomic_size_t bytes_done_ = 0;
+
+    std::mutex error_mutex_ {};
+    std::exception_ptr error_ {};
+};
+
+} // namespace torrenttools
@@ -0,0 +1,81 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "file_hasher.hpp"
+
+namespace torrenttools {
+
+/// Position of the files of a file storage in the v1 piece layout.
+/// Padding files are part of the layout, same as in the v1 metafile format.
+class piece_layout
+{
+public:
+    explicit piece_layout(const dt::file_storage& storage);
+
+    std::size_t piece_size() const noexcept
+    { return piece_size_; }
+
+    /// Total size of all files, including padding files.
+    std::size_t total_size() const noexcept
+    { return total_size_; }
+
+    std::size_t piece_count() const noexcept
+    { return (total_size_ + piece_size_ - 1) / piece_size_; }
+
+    /// Byte offset of the file at index in the concatenation of all files.
+    std::size_t file_offset(std::size_t index) const
+    { return offsets_.at(index); }
+
+    /// Index of the non-empty file containing the byte at offset.
+    std::size_t file_at(std::size_t offset) const;
+
+    /// Half-open range [first, last) of the pieces overlapping the file at index.
+    std::pair<std::size_t, std::size_t> piece_range(std::size_t index) const;
+
+    /// Check if the file at index starts on a piece boundary.
+    /// Empty files are always aligned.
+    bool is_aligned(std::size_t index) const;
+
+    /// Check if all regular files start on a piece boundary.
+    bool is_aligned() const;
+
+    /// Check if the last piece of the file at index is filled with padding,
+    /// as opposed to ending with the end of the torrent.
+    bool has_padded_tail(std::size_t index) const;
+
+private:
+    std::size_t piece_size_;
+    std::size_t total_size_ = 0;
+    std::vector<std::size_t> offsets_;
+    std::vector<std::size_t> sizes_;
+    std::vector<bool> padding_;
+};
+
+
+/// Insert BEP 47 padding files so every file starts on a piece boundary.
+/// Existing padding files are replaced, the v2 hashes of regular files are kept.
+void align_to_pieces(dt::file_storage& storage);
+
+/// Store the hashes of the file at index in storage.
+/// Only the hashes of the protocols in protocol are stored.
+/// The v1 piece hashes require the file to be aligned to a piece boundary.
+/// Per-file checksums of dottorrent hash functions in hashes are added to the file entry.
+void set_file_hashes(dt::file_storage& storage,
+                     const piece_layout& layout,
+                     std::size_t index,
+                     const file_hashes& hashes,
+                     dt::protocol protocol);
+
+/// Extract the hashes of the file at index from a hashed storage.
+/// The v1 piece hashes are only included when the file is aligned to a piece boundary.
+/// Per-file checksums of the file entry are included in the checksums of the result.
+file_hashes get_file_hashes(const dt::file_storage& storage,
+                            const piece_layout& layout,
+                            std::size_t index,
+                            dt::protocol protocol);
+
+} // namespace torrenttools
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "piece_layout.hpp"
+
+namespace torrenttools {
+
+/// Read the data of v1 pieces from the files of a file storage.
+/// Padding files and holes in sparse files are filled with zeros without reading them.
+class piece_reader
+{
+public:
+    using callback_type = std::function<void(std::size_t, std::span<const std::byte>)>;
+
+    explicit piece_reader(const dt::file_storage& storage);
+
+    const piece_layout& layout() const noexcept
+    { return layout_; }
+
+    /// Read the pieces in [first, last) and pass the index and data of every piece to callback.
+    /// Files are read sequentially, so reading a range of consecutive pieces is efficient.
+    /// The last piece of the torrent can be shorter than the piece size.
+    /// @throws std::filesystem::filesystem_error when a file is missing or too short.
+    void read(std::size_t first, std::size_t last, const callback_type& callback);
+
+private:
+    const dt::file_storage& storage_;
+    piece_layout layout_;
+    std::vector<std::byte> buffer_ {};
+};
+
+} // namespace torrenttools
@@ -0,0 +1,174 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/hasher/hasher.hpp>
+
+#include "piece_layout.hpp"
+#include "piece_reader.hpp"
+
+namespace torrenttools {
+
+class verify_state;
+
+/// Result of verifying a single piece.
+enum class piece_state : std::uint8_t
+{
+    /// The piece was not verified.
+    unchecked = 0,
+    /// The data of the piece matches its hash.
+    valid = 1,
+    /// The data of the piece does not match its hash or could not be read.
+    invalid = 2,
+};
+
+
+/// When to stop verifying after a piece failed.
+enum class fail_fast_mode
+{
+    /// Verify all selected pieces.
+    none,
+    /// Stop all workers at the first failed piece.
+    all,
+    /// Skip the remaining pieces of a file once one of its pieces failed. Only for v2 pieces.
+    file,
+};
+
+
+/// Verify a selection of the pieces of a file storage with a pool of workers.
+///
+/// For v1 the pieces are the v1 pieces, which can span file boundaries.
+/// For v2 the pieces are the pieces of the piece layer of every file, numbered in file order.
+/// Files that are not larger than a single piece form one piece which is checked against the merkle root.
+/// Hybrid storages are verified using their v2 hashes.
+///
+/// Missing or truncated files do not stop verification, the pieces that can not be read are invalid.
+///
+/// The selected pieces are handed out to the workers in runs of consecutive pieces of at most the split size.
+/// For v2 a run never spans files, and the runs are verified largest first,
+/// so a single large file does not leave a long single threaded tail.
+///
+/// The interface mirrors dottorrent::storage_verifier so the same progress reporting can be used.
+class piece_verifier
+{
+public:
+    piece_verifier(const dt::file_storage& storage, dt::protocol protocol, std::size_t threads = 1);
+
+    /// The protocol of the pieces, v1 or v2.
+    dt::protocol protocol() const noexcept
+    { return protocol_; }
+
+    std::size_t piece_count() const noexcept
+    { return piece_offsets_.size(); }
+
+    /// Number of data bytes covered by the piece at index.
+    std::size_t piece_bytes(std::size_t index) const;
+
+    /// Half-open range [first, last) of the pieces overlapping the file at index.
+    std::pair<std::size_t, std::size_t> file_pieces(std::size_t index) const;
+
+    /// Only verify the pieces for which selection is true, the state of other pieces is kept.
+    /// All pieces are verified by default.
+    void set_selection(std::vector<bool> selection);
+
+    /// Set the state of a piece before starting, eg. the result of an earlier run.
+    void set_piece_state(std::size_t index, piece_state state);
+
+    /// Stop verifying early after a piece failed.
+    /// Pieces that are skipped because of this remain unchecked.
+    void set_fail_fast(fail_fast_mode mode);
+
+    /// Hand out the pieces in runs of at most size bytes, rounded down to a multiple of the piece size.
+    void set_split_size(std::size_t size) noexcept
+    { split_size_ = size; }
+
+    /// Report the result of every verified piece to state.
+    void set_state(verify_state* state) noexcept
+    { state_ = state; }
+
+    void start();
+
+    /// Block until all selected pieces are verified.
+    /// Rethrows the first unexpected error encountered while verifying.
+    void wait();
+
+    /// Total number of bytes processed, including the bytes of pieces that are not selected.
+    std::size_t bytes_done() const noexcept
+    { return bytes_done_.load(std::memory_order_relaxed); }
+
+    /// Index of the file containing the first unprocessed byte and the number of bytes processed for it.
+    /// Pieces are processed out of order by multiple workers, so this is an approximation.
+    std::pair<std::size_t, std::size_t> current_file_progress() const noexcept;
+
+    piece_state state(std::size_t index) const noexcept
+    { return static_cast<piece_state>(states_[index].load(std::memory_order_relaxed)); }
+
+    /// Number of pieces that were verified by this run.
+    std::size_t verified_pieces() const noexcept
+    { return verified_pieces_.load(std::memory_order_relaxed); }
+
+    /// Index of the first piece that failed, in order of verification.
+    std::optional<std::size_t> first_failure() const noexcept;
+
+    /// Index of the first file overlapping the piece at index.
+    std::size_t piece_file(std::size_t index) const;
+
+    /// Number of pieces in given state.
+    std::size_t count(piece_state state) const noexcept;
+
+    /// Percentage of the file at index that is covered by valid pieces.
+    double percentage(std::size_t index) const;
+
+private:
+    void run();
+    void verify_v1(piece_reader& reader, dt::hasher& sha1, std::size_t first, std::size_t last);
+    void verify_v2(dt::hasher& sha256, std::size_t first, std::size_t last);
+    void set_result(std::size_t piece, bool valid);
+    void skip(std::size_t first, std::size_t last);
+    void stop() noexcept;
+
+    const dt::file_storage& storage_;
+    dt::protocol protocol_;
+    std::size_t thread_count_;
+    piece_layout layout_;
+    verify_state* state_ = nullptr;
+    fail_fast_mode fail_fast_ = fail_fast_mode::none;
+    std::size_t split_size_;
+
+    /// Offset of the first byte of every file in the stream of verified bytes.
+    /// For v2 padding files are not part of the stream.
+    std::vector<std::size_t> file_offsets_ {};
+    std::size_t total_size_ = 0;
+    /// Offset of every piece in the stream of verified bytes.
+    std::vector<std::size_t> piece_offsets_ {};
+    /// For v2: the file of every piece.
+    std::vector<std::size_t> piece_files_ {};
+
+    std::vector<bool> selection_ {};
+    std::unique_ptr<std::atomic_uint8_t[]> states_;
+
+    /// Half-open ranges of pieces to verify.
+    std::vector<std::pair<std::size_t, std::size_t>> work_ {};
+    std::vector<std::jthread> workers_ {};
+    std::atomic_size_t next_item_ = 0;
+    std::atomic_size_t bytes_done_ = 0;
+    std::atomic_size_t verified_pieces_ = 0;
+
+    std::atomic_bool stopped_ = false;
+    std::atomic_size_t first_failure_;
+    std::unique_ptr<std::atomic_bool[]> failed_files_;
+
+    std::mutex error_mutex_ {};
+    std::exception_ptr error_ {};
+};
+
+} // namespace torrenttools
@@ -6,12 +6,43 @@
 #include <dottorrent/storage_hasher.hpp>
 #include <dottorrent/storage_verifier.hpp>
 
+#include "multi_hasher.hpp"
+#include "per_file_hasher.hpp"
+#include "piece_hasher.hpp"
+#include "piece_verifier.hpp"
+#include "refresh.hpp"
+#include "web_seed_verifier.hpp"
+
 void run_with_progress(std::ostream& os, dottorrent::storage_hasher& verifier, const dottorrent::metafile& m);
 
 void run_with_simple_progress(std::ostream& os, dottorrent::storage_hasher& hasher, const dottorrent::metafile& m);
 
+void run_with_progress(std::ostream& os, torrenttools::per_file_hasher& hasher, const dottorrent::metafile& m);
+
+void run_with_simple_progress(std::ostream& os, torrenttools::per_file_hasher& hasher, const dottorrent::metafile& m);
+
+void run_with_progress(std::ostream& os, torrenttools::multi_hasher& hasher, const dottorrent::metafile& m);
+
+void run_with_simple_progress(std::ostream& os, torrenttools::multi_hasher& hasher, const dottorrent::metafile& m);
+
+void run_with_progress(std::ostream& os, torrenttools::piece_hasher& hasher, const dottorrent::metafile& m);
+
+void run_with_simple_progress(std::ostream& os, torrenttools::piece_hasher& hasher, const dottorrent::metafile& m);
+
+void run_with_progress(std::ostream& os, torrenttools::based_on_hasher& hasher, const dottorrent::metafile& m);
+
+void run_with_simple_progress(std::ostream& os, torrenttools::based_on_hasher& hasher, const dottorrent::metafile& m);
+
 void run_with_progress(std::ostream& os, dottorrent::storage_verifier& verifier, const dottorrent::metafile& m);
 
 void run_with_simple_progress(std::ostream& os, dottorrent::storage_verifier& verifier, const dottorrent::metafile& m);
 
+void run_with_progress(std::ostream& os, torrenttools::piece_verifier& verifier, const dottorrent::metafile& m);
+
+void run_with_simple_progress(std::ostream& os, torrenttools::piece_verifier& verifier, const dottorrent::metafile& m);
+
+void run_with_progress(std::ostream& os, torrenttools::web_seed_verifier& verifier, const dottorrent::metafile& m);
+
+void run_with_simple_progress(std::ostream& os, torrenttools::web_seed_verifier& verifier, const dottorrent::metafile& m);
+
 void print_completion_statistics(std::ostream& os, const dottorrent::metafile& m, std::chrono::system_clock::duration duration);
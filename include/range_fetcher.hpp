@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace torrenttools {
+
+/// Fetch byte ranges of HTTP resources with a number of parallel transfers.
+///
+/// Transfers to the same host share a limited number of connections.
+/// Over HTTP/2 multiple transfers are multiplexed on a single connection,
+/// over HTTP/1.1 connections are kept alive and reused for the next transfer.
+/// All callbacks are called from the thread calling run(), and may add new requests.
+///
+/// Only available when built with libcurl, see TORRENTTOOLS_CURL.
+class range_fetcher
+{
+public:
+    /// Called with the data of a range as it is received, in order.
+    using data_callback = std::function<void(std::span<const std::byte>)>;
+    /// Called once when a transfer completed.
+    /// The argument is true when the server returned exactly the requested range.
+    using done_callback = std::function<void(bool)>;
+
+    /// @param max_transfers the maximum number of transfers in progress at the same time.
+    /// @param max_connections the maximum number of connections per host.
+    /// @throws std::runtime_error when torrenttools was built without libcurl.
+    range_fetcher(std::size_t max_transfers, std::size_t max_connections);
+
+    range_fetcher(const range_fetcher&) = delete;
+    range_fetcher& operator=(const range_fetcher&) = delete;
+
+    ~range_fetcher();
+
+    /// Request length bytes of url starting at offset.
+    void add(std::string url, std::uint64_t offset, std::uint64_t length,
+             data_callback on_data, done_callback on_done);
+
+    /// Perform transfers until all requests, including the requests added by callbacks, are completed.
+    void run();
+
+    /// Check if fetching ranges is supported by this build.
+    static bool is_supported() noexcept;
+
+    /// State of a transfer in progress, defined by the implementation.
+    struct transfer;
+
+private:
+    struct request
+    {
+        std::string url;
+        std::uint64_t offset;
+        std::uint64_t length;
+        data_callback on_data;
+        done_callback on_done;
+    };
+
+    void start_pending();
+    void finish(void* handle, int result);
+
+    std::size_t max_transfers_;
+    std::deque<request> pending_ {};
+    std::vector<std::unique_ptr<transfer>> active_ {};
+    std::vector<void*> idle_handles_ {};
+    void* multi_ = nullptr;
+};
+
+} // namespace torrenttools
@@ -0,0 +1,128 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/metafile.hpp>
+
+#include "file_hasher.hpp"
+#include "file_stat.hpp"
+#include "metafile_extras.hpp"
+#include "piece_layout.hpp"
+
+namespace torrenttools {
+
+namespace { namespace dt = dottorrent; }
+
+/// Work done by a based_on_hasher.
+struct refresh_statistics
+{
+    std::size_t files_reused = 0;
+    std::size_t files_hashed = 0;
+    std::size_t pieces_reused = 0;
+    std::size_t pieces_hashed = 0;
+    std::size_t bytes_hashed = 0;
+};
+
+/// Check if a file was left untouched since a metafile was created.
+/// A file is unchanged when its size and modification time are the same as recorded in mtimes
+/// when the metafile was created, and its size matches entry, the file in the metafile.
+/// Files without a record are considered changed.
+bool is_unchanged_since(const file_mtime_table& mtimes, const dt::file_entry& entry, const file_stat& status);
+
+/// Hash a file storage, reusing the hashes of an earlier version of the same data in base.
+/// base_mtimes are the modification times recorded when base was created, see is_unchanged_since().
+///
+/// The v2 hashes of unchanged files are copied from base.
+/// v1 pieces are copied when base contains a piece covering exactly the same unchanged data,
+/// which includes pieces spanning file boundaries.
+/// All other files and pieces are read from disk and hashed, largest first by a pool of workers.
+/// Nothing can be reused when the piece size of base differs from the piece size of storage.
+///
+/// The interface mirrors dottorrent::storage_hasher so the same progress reporting can be used.
+class based_on_hasher
+{
+public:
+    based_on_hasher(dt::file_storage& storage,
+                    const dt::metafile& base,
+                    const file_mtime_table& base_mtimes,
+                    dt::protocol protocol,
+                    std::size_t threads = 1);
+
+    dt::protocol protocol() const noexcept
+    { return protocol_; }
+
+    void start();
+
+    /// Block until all files and pieces are hashed and store the results in the file storage.
+    /// Rethrows the first error encountered while hashing.
+    void wait();
+
+    /// Total number of bytes processed, including the data of which the hashes were reused.
+    /// For v1 torrents padding files are included, same as for dottorrent::storage_hasher.
+    std::size_t bytes_done() const noexcept;
+
+    /// Index of the first file that is not completely processed yet and the number of bytes processed for it.
+    std::pair<std::size_t, std::size_t> current_file_progress() const noexcept;
+
+    /// Work done, complete after wait().
+    const refresh_statistics& statistics() const noexcept
+    { return statistics_; }
+
+private:
+    /// Unit of work: either a range of a changed file or a run of consecutive v1 pieces.
+    struct work_item
+    {
+        bool is_file;
+        std::size_t first;
+        std::size_t last = 0;
+        /// For files: the range of the file to hash and its index in the parts of the file.
+        std::size_t offset = 0;
+        std::size_t length = 0;
+        std::size_t part = 0;
+    };
+
+    void plan_work();
+    void run();
+    /// Count the bytes of every file covered by a v1 piece as processed.
+    void complete_piece(std::size_t piece);
+
+    dt::file_storage& storage_;
+    const dt::metafile& base_;
+    const file_mtime_table& base_mtimes_;
+    dt::protocol protocol_;
+    std::size_t thread_count_;
+    piece_layout layout_;
+    refresh_statistics statistics_ {};
+
+    std::vector<work_item> work_ {};
+    std::vector<std::vector<file_hashes>> file_parts_ {};
+    std::vector<std::optional<file_hashes>> file_results_ {};
+    std::vector<dt::protocol> file_protocol_ {};
+    std::vector<dt::sha1_hash> pieces_ {};
+    std::vector<bool> piece_done_ {};
+
+    std::vector<std::jthread> workers_ {};
+    std::atomic_size_t next_item_ = 0;
+    std::atomic_size_t bytes_hashed_ = 0;
+    std::unique_ptr<std::atomic_size_t[]> file_bytes_done_;
+
+    std::mutex error_mutex_ {};
+    std::exception_ptr error_ {};
+};
+
+/// Hash storage with a based_on_hasher and return the work done.
+refresh_statistics hash_based_on(dt::file_storage& storage,
+                                 const dt::metafile& base,
+                                 const file_mtime_table& base_mtimes,
+                                 dt::protocol protocol,
+                                 std::size_t threads = 1);
+
+} // namespace torrenttools
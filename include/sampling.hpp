@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace torrenttools {
+
+/// Number of pieces to verify, given as an absolute count or as a fraction of all pieces.
+struct sample_size
+{
+    std::size_t count = 0;
+    double fraction = 0;
+
+    /// Number of pieces to sample out of piece_count, at least one and at most piece_count.
+    std::size_t resolve(std::size_t piece_count) const noexcept;
+};
+
+/// Select sample_count pieces out of piece_count, spread evenly over all pieces.
+/// The pieces are divided in sample_count consecutive strata and one piece is drawn at random from each,
+/// so every file with enough pieces is sampled. The same seed always selects the same pieces.
+std::vector<bool> sample_pieces(std::size_t piece_count, std::size_t sample_count, std::uint64_t seed);
+
+/// Upper bound of the Wilson score interval for a proportion failures / samples,
+/// at the confidence level corresponding to z standard deviations.
+/// Samples drawn from a finite number of pieces are treated as drawn with replacement,
+/// which makes the bound conservative.
+double wilson_upper_bound(std::size_t failures, std::size_t samples, double z = 1.96);
+
+} // namespace torrenttools
@@ -0,0 +1,74 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "file_stat.hpp"
+
+namespace torrenttools {
+
+namespace { namespace fs = std::filesystem; }
+
+/// Persistent record of the directory listings found by previous scans.
+///
+/// Each directory is keyed by its path and modification time.
+/// A directory's mtime changes whenever an entry is added, removed or renamed in it,
+/// so as long as the mtime is unchanged the cached listing can be reused
+/// without reading the directory or querying the files it contains.
+/// Only the names of the entries are stored: modifying a file in place does not change the mtime
+/// of its parent directory, so file sizes must always be read again by the caller.
+class scan_cache
+{
+public:
+    struct directory_record
+    {
+        std::int64_t mtime_ns;
+        std::vector<std::string> files;
+        std::vector<std::string> subdirectories;
+    };
+
+    scan_cache() = default;
+
+    /// Create a cache backed by the file at path.
+    /// Call load() to read previous results.
+    explicit scan_cache(fs::path path);
+
+    /// Read the cache file. A missing or unreadable cache file results in an empty cache.
+    void load();
+
+    /// Atomically write the cache file.
+    void save() const;
+
+    /// Return the listing of directory dir.
+    /// The cached listing is returned when the directory mtime is unchanged,
+    /// otherwise the directory is read again and the cache is updated.
+    const directory_record& list_directory(const fs::path& dir);
+
+    /// Remove all records of root and the directories below it that were not visited since the cache was loaded.
+    void prune(const fs::path& root);
+
+    const fs::path& path() const noexcept
+    { return path_; }
+
+    /// Number of directories listed from the cache.
+    std::size_t hits() const noexcept
+    { return hits_; }
+
+    /// Number of directories that had to be read from storage.
+    std::size_t misses() const noexcept
+    { return misses_; }
+
+private:
+    static directory_record read_directory(const fs::path& dir, std::int64_t mtime_ns);
+
+    fs::path path_;
+    std::unordered_map<std::string, directory_record> directories_;
+    std::unordered_set<std::string> visited_;
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+};
+
+} // namespace torrenttools
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+
+namespace torrenttools {
+
+namespace { namespace dt = dottorrent; }
+
+/// Find files in storage which refer to the same data on disk.
+///
+/// Hardlinks are detected by their device and inode number.
+/// When include_reflinks is set, files which share all their extents with an earlier file
+/// of the same size on the same device, eg. reflink copies, are detected as well.
+/// This requires FIEMAP support and is only available on Linux.
+///
+/// @returns for every file the index of the first file with the same data,
+///          or std::nullopt when the file is the first or only file with its data.
+std::vector<std::optional<std::size_t>> find_shared_files(const dt::file_storage& storage,
+                                                          bool include_reflinks = false);
+
+/// Align the files of storage to piece boundaries with align_to_pieces(),
+/// and return the result of find_shared_files() for the aligned storage.
+/// @param shared the result of find_shared_files() for the storage before it was aligned.
+std::vector<std::optional<std::size_t>> align_shared_files(dt::file_storage& storage,
+                                                           const std::vector<std::optional<std::size_t>>& shared);
+
+} // namespace torrenttools
@@ -0,0 +1,58 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "piece_verifier.hpp"
+
+namespace torrenttools {
+
+/// Result of verifying a file that can be shared with other jobs.
+class shared_result
+{
+public:
+    /// Store the state of every piece of the file and wake up all jobs waiting for it.
+    /// Pieces that are unchecked, eg. because the owner stopped early, must be verified by the other jobs.
+    void publish(std::vector<piece_state> states);
+
+    /// Block until the result is published and return the state of every piece of the file.
+    const std::vector<piece_state>& wait() const;
+
+private:
+    mutable std::mutex mutex_ {};
+    mutable std::condition_variable cv_ {};
+    std::optional<std::vector<piece_state>> states_ {};
+};
+
+
+/// Share the results of verifying files between the jobs of a batch,
+/// so a file contained in multiple metafiles is only read once.
+///
+/// Files are identified by a key which must capture both the data on disk and its expected hashes,
+/// including the piece size so the pieces of the file are the same in all jobs.
+/// The first job to claim a key owns it and must publish a result, also when verification fails.
+/// Other jobs wait for that result.
+/// All member functions are thread-safe.
+class shared_results
+{
+public:
+    /// Claim the result for key.
+    /// @returns the result and true when the caller is the owner and must publish it.
+    std::pair<std::shared_ptr<shared_result>, bool> claim(const std::string& key);
+
+    /// Number of claims that reused the result of an earlier claim.
+    std::size_t reused() const;
+
+private:
+    mutable std::mutex mutex_ {};
+    std::unordered_map<std::string, std::shared_ptr<shared_result>> results_ {};
+    std::size_t reused_ = 0;
+};
+
+} // namespace torrenttools
@@ -3,6 +3,7 @@
 #include <filesystem>
 #include <dottorrent/general.hpp>
 
+#include "checksum_algorithm.hpp"
 #include "common.hpp"
 
 // Forward declarations
@@ -24,7 +25,7 @@ struct show_app_options
     bool query_show_binary;
     bool show_padding_files = false;
     std::filesystem::path files_prefix;
-    std::optional<dt::hash_function> checksum_algorithm;
+    std::optional<torrenttools::checksum_algorithm> checksum_algorithm;
 };
 
 
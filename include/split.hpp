@@ -0,0 +1,34 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <dottorrent/general.hpp>
+#include <dottorrent/metafile.hpp>
+
+#include "common.hpp"
+#include "config.hpp"
+
+// forward declarations
+namespace CLI { class App; }
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+
+struct split_app_options
+{
+    std::filesystem::path metafile;
+    std::optional<std::filesystem::path> destination;
+    bool by_directory = false;
+    std::optional<dt::protocol> protocol_version;
+    std::optional<std::filesystem::path> data_directory;
+};
+
+void configure_split_app(CLI::App* app, split_app_options& options);
+
+/// Create a metafile for every top-level directory and file of a v2 metafile.
+std::vector<dt::metafile> split_metafile_by_directory(const dt::metafile& m,
+                                                      dt::protocol protocol,
+                                                      const std::optional<fs::path>& data_directory = std::nullopt);
+
+void run_split_app(const main_app_options& main_options, const split_app_options& options);
@@ -20,6 +20,7 @@
 #include <dottorrent/storage_verifier.hpp>
 
 #include "natural_sort.hpp"
+#include "piece_verifier.hpp"
 #include "formatters.hpp"
 #include "ls_colors.hpp"
 
@@ -255,6 +256,12 @@ std::string format_verify_file_tree(
         std::string_view prefix = ""sv,
         const tree_options& options = {});
 
+std::string format_verify_file_tree(
+        const dottorrent::metafile& m,
+        const torrenttools::piece_verifier& verifier,
+        std::string_view prefix = ""sv,
+        const tree_options& options = {});
+
 
 std::string format_file_stats(const dottorrent::metafile& m,
                               std::string_view prefix = "",
@@ -0,0 +1,39 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+#include <dottorrent/metafile.hpp>
+
+#include "common.hpp"
+#include "config.hpp"
+
+// forward declarations
+namespace CLI { class App; }
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+
+struct upgrade_app_options
+{
+    std::filesystem::path metafile;
+    std::filesystem::path target;
+    std::optional<std::filesystem::path> destination;
+};
+
+struct upgrade_result
+{
+    /// The hybrid metafile. Only valid when failed_pieces is empty.
+    dt::metafile metafile;
+    /// Indices of the v1 pieces of the original metafile that did not match the data.
+    std::vector<std::size_t> failed_pieces;
+};
+
+void configure_upgrade_app(CLI::App* app, upgrade_app_options& options);
+
+/// Verify the data of a v1 metafile and compute the hashes of a hybrid metafile in a single read pass.
+/// @param m a v1 metafile.
+/// @param target the file or directory with the data of the metafile.
+upgrade_result upgrade_metafile(const dt::metafile& m, const fs::path& target);
+
+void run_upgrade_app(const main_app_options& main_options, const upgrade_app_options& options);
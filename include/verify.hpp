@@ -3,6 +3,8 @@
 #include <string>
 #include <chrono>
 #include <filesystem>
+#include <optional>
+#include <vector>
 
 #include <dottorrent/metafile.hpp>
 #include <dottorrent/storage_verifier.hpp>
@@ -11,6 +13,7 @@
 
 #include "argument_parsers.hpp"
 #include "common.hpp"
+#include "sampling.hpp"
 
 namespace fs = std::filesystem;
 
@@ -22,9 +25,67 @@ struct verify_app_options
     fs::path files_root_directory;
     std::uint8_t threads;
     dottorrent::protocol protocol_version;
+    std::optional<fs::path> state;
+    bool recheck_failed = false;
+    bool quick = false;
+    std::optional<torrenttools::sample_size> sample;
+    std::optional<std::uint64_t> seed;
+    bool fail_fast = false;
+    bool fail_fast_per_file = false;
+    std::vector<std::string> include_patterns;
+    std::vector<std::string> exclude_patterns;
+    std::optional<fs::path> batch;
+    std::size_t queue_depth = 4;
+    bool fastresume = false;
+    bool web_seed = false;
+    std::size_t connections = 4;
 };
 
 
+/// A metafile and the data to verify it against.
+struct verify_job
+{
+    fs::path metafile;
+    fs::path target;
+
+    friend bool operator==(const verify_job&, const verify_job&) = default;
+};
+
+/// Read a batch list with one job per line: a metafile path and a target path separated by a tab.
+/// Empty lines and lines starting with # are skipped.
+/// @throws std::invalid_argument when the file cannot be read or a line has no target.
+std::vector<verify_job> read_verify_batch(const fs::path& path);
+
+
+/// Status of a file on disk compared to the metafile.
+enum class file_status
+{
+    ok,
+    missing,
+    wrong_size,
+};
+
+struct file_check_result
+{
+    std::size_t index;
+    file_status status;
+    /// Size of the file on disk, zero when missing.
+    std::uintmax_t file_size;
+};
+
+/// Check that every regular file of storage exists with the size listed in the metafile, using multiple threads.
+/// @returns the files that are missing or have a different size, ordered by index.
+std::vector<file_check_result> check_files(const dottorrent::file_storage& storage, std::size_t threads);
+
+/// Select the regular files of storage of which the path in the metafile matches the include patterns
+/// and does not match the exclude patterns, using the same rules as the file_matcher of the create command.
+/// @returns a flag for every file of storage, padding files are never selected.
+/// @throws std::invalid_argument when a pattern is not a valid regex.
+std::vector<bool> select_files(const dottorrent::file_storage& storage,
+                               const std::vector<std::string>& include_patterns,
+                               const std::vector<std::string>& exclude_patterns);
+
+
 void run_verify_app(const main_app_options& main_options, const verify_app_options& options);
 
 void print_verify_statistics(const dottorrent::metafile& m, std::chrono::system_clock::duration duration);
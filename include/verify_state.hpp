@@ -0,0 +1,88 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "piece_verifier.hpp"
+
+namespace torrenttools {
+
+/// Persistent results of verifying a metafile, used to resume an interrupted run,
+/// to only verify files again that changed since the previous run and to recheck failed pieces.
+///
+/// The state records the info hash of the metafile, the protocol of the pieces,
+/// the state of every piece as two bitfields and the size and modification time of every file.
+/// All member functions are thread-safe.
+class verify_state
+{
+public:
+    /// Create a state backed by the file at path.
+    explicit verify_state(std::filesystem::path path);
+
+    ~verify_state();
+
+    /// Read the state file.
+    /// @returns false when the state file does not exist.
+    /// @throws std::invalid_argument when the file is not a valid state file.
+    bool load();
+
+    /// Discard all results and start a new state for given metafile.
+    void reset(std::string info_hash, dt::protocol protocol, std::size_t piece_count);
+
+    /// Hex encoded info hash of the metafile the state belongs to.
+    std::string info_hash() const;
+
+    /// Check if the results were stored for the same protocol and number of pieces.
+    bool matches(dt::protocol protocol, std::size_t piece_count) const;
+
+    /// Return the indices of the regular files of storage of which the size or modification time
+    /// differs from the values recorded by update_files(), or which were missing.
+    std::vector<std::size_t> changed_files(const dt::file_storage& storage) const;
+
+    /// Record the size and modification time of all files of storage.
+    void update_files(const dt::file_storage& storage);
+
+    piece_state piece(std::size_t index) const;
+    void set_piece(std::size_t index, piece_state state);
+
+    /// Atomically write the state file.
+    void save() const;
+
+    /// Save the state every interval from a background thread, until stopped or destroyed.
+    void save_periodically(std::chrono::seconds interval);
+
+    /// Stop saving periodically.
+    void stop();
+
+    const std::filesystem::path& path() const noexcept
+    { return path_; }
+
+private:
+    struct file_record
+    {
+        /// Size of the file, -1 when the file did not exist.
+        std::int64_t file_size;
+        std::int64_t mtime_ns;
+
+        friend bool operator==(const file_record&, const file_record&) = default;
+    };
+
+    static std::vector<file_record> stat_files(const dt::file_storage& storage);
+
+    std::filesystem::path path_;
+    std::string info_hash_ {};
+    dt::protocol protocol_ = dt::protocol::none;
+    std::vector<piece_state> pieces_ {};
+    std::vector<file_record> files_ {};
+    mutable std::mutex mutex_ {};
+    std::jthread saver_ {};
+};
+
+} // namespace torrenttools
@@ -0,0 +1,123 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/hasher/hasher.hpp>
+
+#include "piece_layout.hpp"
+#include "piece_verifier.hpp"
+#include "range_fetcher.hpp"
+
+namespace torrenttools {
+
+/// Return the URL of a file of a torrent on a BEP 19 web seed.
+/// For single-file torrents an URL that does not end with a slash is the URL of the file itself,
+/// otherwise the name of the torrent and the path of the file are appended, percent-encoded.
+std::string web_seed_file_url(std::string_view url,
+                              std::string_view name,
+                              dt::file_mode mode,
+                              const std::filesystem::path& file_path);
+
+
+/// Verify a selection of the pieces of a file storage against the data served by a BEP 19 web seed.
+///
+/// Pieces are numbered the same as by piece_verifier.
+/// The data of every piece is requested with HTTP range requests, one per file the piece overlaps,
+/// and hashed while it is received. Padding files are not requested.
+/// Multiple pieces are requested in parallel over a limited number of connections.
+/// Pieces that cannot be fetched are invalid.
+class web_seed_verifier
+{
+public:
+    web_seed_verifier(const dt::file_storage& storage,
+                      std::string name,
+                      std::string url,
+                      dt::protocol protocol,
+                      std::size_t connections = 4);
+
+    dt::protocol protocol() const noexcept
+    { return pieces_.protocol(); }
+
+    std::size_t piece_count() const noexcept
+    { return pieces_.piece_count(); }
+
+    /// Only verify the pieces for which selection is true.
+    void set_selection(std::vector<bool> selection);
+
+    void start();
+
+    /// Block until all selected pieces are verified.
+    /// Rethrows the first unexpected error encountered while verifying.
+    void wait();
+
+    /// Total number of bytes processed, including the bytes of pieces that are not selected.
+    std::size_t bytes_done() const noexcept
+    { return bytes_done_.load(std::memory_order_relaxed); }
+
+    /// Index of the file containing the next piece to request and the number of bytes before it.
+    std::pair<std::size_t, std::size_t> current_file_progress() const noexcept;
+
+    /// The state of all pieces, which can be used for reporting in the same way as the results of a local run.
+    const piece_verifier& results() const noexcept
+    { return pieces_; }
+
+private:
+    /// Part of a piece stored in a single file.
+    struct segment
+    {
+        std::size_t file;
+        std::size_t offset;
+        std::size_t length;
+    };
+    /// A piece of which the data is being received.
+    struct piece_job
+    {
+        std::size_t piece;
+        std::vector<segment> segments;
+        std::size_t next_segment = 0;
+        std::unique_ptr<dt::hasher> hasher;
+        /// For v2: the current incomplete block and the hashes of the completed blocks.
+        std::vector<std::byte> block {};
+        std::vector<dt::sha256_hash> leaves {};
+        std::list<piece_job>::iterator position {};
+    };
+
+    void run();
+    void start_next_piece(range_fetcher& fetcher);
+    void fetch_next_segment(range_fetcher& fetcher, piece_job& job);
+    void update(piece_job& job, std::span<const std::byte> data);
+    void complete_piece(range_fetcher& fetcher, piece_job& job, bool received);
+    std::vector<segment> piece_segments(std::size_t piece) const;
+
+    const dt::file_storage& storage_;
+    piece_layout layout_;
+    piece_verifier pieces_;
+    std::vector<std::string> file_urls_ {};
+    std::size_t connections_;
+    std::vector<bool> selection_ {};
+
+    /// Offset of the first byte of every file in the stream of verified bytes, as for piece_verifier.
+    std::vector<std::size_t> file_offsets_ {};
+    std::size_t total_size_ = 0;
+
+    std::list<piece_job> jobs_ {};
+    std::size_t next_piece_ = 0;
+    std::atomic_size_t next_offset_ = 0;
+    std::atomic_size_t bytes_done_ = 0;
+
+    std::jthread worker_ {};
+    std::exception_ptr error_ {};
+};
+
+} // namespace torrenttools
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstddef>
+#include <span>
+
+#include <dottorrent/hash.hpp>
+
+namespace torrenttools {
+
+namespace { namespace dt = dottorrent; }
+
+/// Check if all bytes of data are zero.
+/// Scans 64 bytes at a time in a way compilers turn into SIMD instructions.
+bool is_zero(std::span<const std::byte> data) noexcept;
+
+/// Return a view of up to max_size zero bytes, at most 1 MiB.
+std::span<const std::byte> zero_bytes(std::size_t max_size) noexcept;
+
+/// SHA-1 hash of a v1 piece of piece_size zero bytes.
+const dt::sha1_hash& zero_piece_sha1(std::size_t piece_size);
+
+/// SHA-256 hash of a v2 leaf block of 16 KiB zero bytes.
+const dt::sha256_hash& zero_block_sha256();
+
+/// Root of the v2 merkle subtree of a piece of piece_size zero bytes.
+/// @param piece_size a power of two of at least 16 KiB.
+const dt::sha256_hash& zero_piece_sha256(std::size_t piece_size);
+
+} // namespace torrenttools
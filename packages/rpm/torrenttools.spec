@@ -17,6 +17,7 @@ BuildRequires:   automake
 BuildRequires:   libtool
 BuildRequires:   nasm
 BuildRequires:   tbb-devel
+BuildRequires:   libcurl-devel
 
 %{?fedora:BuildRequires:      gcc-c++ >= 10.2.1}
 %{?fedora:BuildRequires:      libstdc++-devel >= 10.2.1}
@@ -27,6 +28,7 @@ BuildRequires:   tbb-devel
 
 Requires:            openssl >= 1.0.0
 Requires:            tbb
+Requires:            libcurl
 
 %description
 A commandline tool for creating, inspecting and modifying BitTorrent metafiles.
@@ -53,13 +53,13 @@ static inline void trim(std::string &s) {
 }
 
 
-std::unordered_set<dottorrent::hash_function> checksum_transformer(const std::vector<std::string>& s)
+std::unordered_set<torrenttools::checksum_algorithm> checksum_transformer(const std::vector<std::string>& s)
 {
     // use a set to filter out duplicates
-    std::unordered_set<dt::hash_function> res {};
+    std::unordered_set<torrenttools::checksum_algorithm> res {};
 
     for (const auto& name : s) {
-        if (auto f = dt::make_hash_function(name); f) {
+        if (auto f = torrenttools::make_checksum_algorithm(name); f) {
             res.insert(f.value());
         }
         else {
@@ -317,6 +317,51 @@ std::optional<std::size_t> parse_commandline_size(std::string_view option, const
     return value;
 }
 
+tt::sample_size sample_size_transformer(std::string_view option, const std::vector<std::string>& v)
+{
+    if (v.size() > 1)
+        throw std::invalid_argument("Multiple values not supported.");
+
+    auto s = v.at(0);
+    trim(s);
+    bool percentage = s.ends_with('%');
+    if (percentage) {
+        s.pop_back();
+    }
+
+    // a fraction or percentage selects part of the pieces, an integer an absolute number of pieces
+    if (percentage || s.find('.') != std::string::npos) {
+        double value;
+        try {
+            std::size_t pos = 0;
+            value = std::stod(s, &pos);
+            if (pos != s.size()) {
+                throw std::invalid_argument(s);
+            }
+        }
+        catch (const std::exception&) {
+            throw CLI::ConversionError(fmt::format(err_msg, v.at(0), option, "expected number"));
+        }
+        if (percentage) {
+            value /= 100;
+        }
+        if (!(value > 0 && value <= 1)) {
+            throw std::invalid_argument(fmt::format(err_msg, v.at(0), option, "fraction must be between 0 and 1"));
+        }
+        return {.fraction = value};
+    }
+
+    std::size_t value;
+    auto [ptr, ec] = std::from_chars(s.data(), s.data()+s.size(), value);
+    if (ec != std::errc{} || ptr != s.data()+s.size()) {
+        throw CLI::ConversionError(fmt::format(err_msg, v.at(0), option, "expected integer or fraction"));
+    }
+    if (value == 0) {
+        throw std::invalid_argument(fmt::format(err_msg, v.at(0), option, "must be larger than 0"));
+    }
+    return {.count = value};
+}
+
 std::vector<std::optional<bool>> parse_commandline_booleans(std::string_view option, const std::vector<std::string>& v)
 {
     std::vector<std::optional<bool>> result;
@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <string>
+
+#include <fmt/format.h>
+#include <gsl-lite/gsl-lite.hpp>
+#include <bencode/bvalue.hpp>
+#include <bencode/encode.hpp>
+
+#include "checkpoint.hpp"
+#include "file_stat.hpp"
+#include "hash_encoding.hpp"
+#include "piece_layout.hpp"
+
+namespace bc = bencode;
+
+namespace torrenttools {
+
+namespace {
+
+constexpr std::int64_t checkpoint_version = 1;
+
+std::string encode_range_key(std::size_t index, std::size_t offset)
+{
+    return fmt::format("{}:{}", index, offset);
+}
+
+std::pair<std::size_t, std::size_t> decode_range_key(const std::string& key)
+{
+    auto separator = key.find(':');
+    if (separator == std::string::npos) {
+        throw std::invalid_argument("invalid file range key");
+    }
+    return {std::stoull(key.substr(0, separator)), std::stoull(key.substr(separator + 1))};
+}
+
+} // namespace
+
+
+create_checkpoint::create_checkpoint(std::filesystem::path path)
+    : path_(std::move(path))
+{}
+
+create_checkpoint::~create_checkpoint()
+{
+    stop();
+}
+
+void create_checkpoint::set_inputs(const dt::file_storage& storage, dt::protocol protocol)
+{
+    const auto piece_count = has_v1(protocol) ? piece_layout(storage).piece_count() : 0;
+
+    std::vector<file_record> files {};
+    for (const auto& entry : storage) {
+        if (entry.is_padding_file()) {
+            continue;
+        }
+        auto status = stat_file(storage.root_directory() / entry.path());
+        files.push_back({entry.path().generic_string(), entry.file_size(), status.mtime_ns});
+    }
+
+    std::scoped_lock lock(mutex_);
+    protocol_ = protocol;
+    piece_size_ = storage.piece_size();
+    files_ = std::move(files);
+    file_hashes_.clear();
+    range_hashes_.clear();
+    pieces_.assign(piece_count, {});
+    piece_done_.assign(piece_count, false);
+}
+
+void create_checkpoint::load()
+{
+    std::ifstream ifs(path_, std::ios::binary);
+    if (!ifs) {
+        throw std::invalid_argument(fmt::format("could not read checkpoint: {}", path_.string()));
+    }
+
+    std::scoped_lock lock(mutex_);
+    try {
+        auto bv = bc::decode_value(ifs);
+        if (get_integer(bv.at("version")) != checkpoint_version) {
+            throw std::invalid_argument("unsupported version");
+        }
+        protocol_ = static_cast<dt::protocol>(get_integer(bv.at("protocol")));
+        piece_size_ = static_cast<std::size_t>(get_integer(bv.at("piece size")));
+
+        files_.clear();
+        for (const auto& value : get_list(bv.at("files"))) {
+            files_.push_back({
+                .path = get_string(value.at("path")),
+                .file_size = static_cast<std::uint64_t>(get_integer(value.at("length"))),
+                .mtime_ns = get_integer(value.at("mtime")),
+            });
+        }
+
+        file_hashes_.clear();
+        if (auto it = get_dict(bv).find("file hashes"); it != get_dict(bv).end()) {
+            for (const auto& [key, value] : get_dict(it->second)) {
+                // files with invalid hashes are hashed again
+                try {
+                    auto index = std::stoull(key);
+                    const auto& dict = get_dict(value);
+                    auto file_size = static_cast<std::size_t>(get_integer(dict.at("length")));
+                    file_hashes_.insert_or_assign(index, decode_file_hashes(dict, piece_size_, file_size));
+                }
+                catch (const std::exception&) {
+                    continue;
+                }
+            }
+        }
+
+        range_hashes_.clear();
+        if (auto it = get_dict(bv).find("file ranges"); it != get_dict(bv).end()) {
+            for (const auto& [key, value] : get_dict(it->second)) {
+                // ranges with invalid hashes are hashed again
+                try {
+                    auto range = decode_range_key(key);
+                    const auto& dict = get_dict(value);
+                    auto length = static_cast<std::size_t>(get_integer(dict.at("length")));
+                    range_hashes_.insert_or_assign(range, decode_file_hashes(dict, piece_size_, length));
+                }
+                catch (const std::exception&) {
+                    continue;
+                }
+            }
+        }
+
+        pieces_ = decode_hashes<dt::sha1_hash>(get_string(bv.at("pieces")));
+        piece_done_ = decode_bitfield(get_string(bv.at("pieces done")), pieces_.size());
+    }
+    catch (const std::exception& e) {
+        throw std::invalid_argument(fmt::format("invalid checkpoint: {}: {}", path_.string(), e.what()));
+    }
+}
+
+void create_checkpoint::check_inputs(const dt::file_storage& storage, dt::protocol protocol) const
+{
+    std::scoped_lock lock(mutex_);
+
+    if (protocol != protocol_) {
+        throw std::invalid_argument("Checkpoint was created for a different protocol.");
+    }
+    if (storage.piece_size() != piece_size_) {
+        throw std::invalid_argument(fmt::format(
+                "Checkpoint was created with a piece size of {} bytes.", piece_size_));
+    }
+
+    auto record = files_.begin();
+    for (const auto& entry : storage) {
+        if (entry.is_padding_file()) {
+            continue;
+        }
+        if (record == files_.end() || record->path != entry.path().generic_string()) {
+            throw std::invalid_argument(fmt::format(
+                    "File list changed since the checkpoint was created: {}", entry.path().string()));
+        }
+        auto status = stat_file(storage.root_directory() / entry.path());
+        if (record->file_size != entry.file_size() || record->mtime_ns != status.mtime_ns) {
+            throw std::invalid_argument(fmt::format(
+                    "File was modified since the checkpoint was created: {}", entry.path().string()));
+        }
+        ++record;
+    }
+    if (record != files_.end()) {
+        throw std::invalid_argument(fmt::format(
+                "File list changed since the checkpoint was created: {}", record->path));
+    }
+}
+
+void create_checkpoint::save() const
+{
+    auto root = bc::bvalue::dict_type {};
+    {
+        std::scoped_lock lock(mutex_);
+
+        auto files = bc::bvalue::list_type {};
+        for (const auto& file : files_) {
+            auto dict = bc::bvalue::dict_type {};
+            dict["path"] = file.path;
+            dict["length"] = static_cast<std::int64_t>(file.file_size);
+            dict["mtime"] = file.mtime_ns;
+            files.emplace_back(std::move(dict));
+        }
+
+        auto hashes = bc::bvalue::dict_type {};
+        for (const auto& [index, file] : file_hashes_) {
+            auto dict = encode_file_hashes(file);
+            dict["length"] = static_cast<std::int64_t>(file.file_size);
+            hashes[std::to_string(index)] = std::move(dict);
+        }
+
+        auto ranges = bc::bvalue::dict_type {};
+        for (const auto& [range, part] : range_hashes_) {
+            auto dict = encode_file_hashes(part);
+            dict["length"] = static_cast<std::int64_t>(part.file_size);
+            ranges[encode_range_key(range.first, range.second)] = std::move(dict);
+        }
+
+
+        root["version"] = checkpoint_version;
+        root["protocol"] = static_cast<std::int64_t>(protocol_);
+        root["piece size"] = static_cast<std::int64_t>(piece_size_);
+        root["files"] = std::move(files);
+        root["file hashes"] = std::move(hashes);
+        root["file ranges"] = std::move(ranges);
+        root["pieces"] = encode_hashes(pieces_);
+        root["pieces done"] = encode_bitfield(piece_done_);
+    }
+
+    // write to a temporary file first so an interrupted write never corrupts the checkpoint
+    auto tmp_path = std::filesystem::path(path_).concat(".tmp");
+    {
+        std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            throw std::invalid_argument(fmt::format("could not write checkpoint: {}", tmp_path.string()));
+        }
+        bc::encode_to(ofs, bc::bvalue(std::move(root)));
+    }
+    std::filesystem::rename(tmp_path, path_);
+}
+
+void create_checkpoint::save_periodically(std::chrono::seconds interval)
+{
+    stop();
+    saver_ = std::jthread([this, interval](std::stop_token token) {
+        std::mutex mutex {};
+        std::condition_variable_any cv {};
+        std::unique_lock lock(mutex);
+
+        while (!token.stop_requested()) {
+            cv.wait_for(lock, token, interval, [] { return false; });
+            if (token.stop_requested()) {
+                break;
+            }
+            try {
+                save();
+            }
+            catch (const std::exception&) {
+                // keep the previous checkpoint, the next attempt may succeed
+            }
+        }
+    });
+}
+
+void create_checkpoint::stop()
+{
+    if (saver_.joinable()) {
+        saver_.request_stop();
+        saver_.join();
+    }
+}
+
+void create_checkpoint::remove() const
+{
+    std::error_code ec {};
+    std::filesystem::remove(path_, ec);
+}
+
+std::optional<file_hashes> create_checkpoint::find_file(std::size_t index) const
+{
+    std::scoped_lock lock(mutex_);
+    if (auto it = file_hashes_.find(index); it != file_hashes_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+void create_checkpoint::add_file(std::size_t index, const file_hashes& hashes)
+{
+    std::scoped_lock lock(mutex_);
+    file_hashes_.insert_or_assign(index, hashes);
+    range_hashes_.erase(range_hashes_.lower_bound({index, 0}),
+                        range_hashes_.lower_bound({index + 1, 0}));
+}
+
+std::optional<file_hashes> create_checkpoint::find_file_range(std::size_t index, std::size_t offset) const
+{
+    std::scoped_lock lock(mutex_);
+    if (auto it = range_hashes_.find({index, offset}); it != range_hashes_.end()) {
+        return it->second;
+    }
+    return std::nullopt;
+}
+
+void create_checkpoint::add_file_range(std::size_t index, std::size_t offset, const file_hashes& hashes)
+{
+    std::scoped_lock lock(mutex_);
+    range_hashes_.insert_or_assign(std::pair(index, offset), hashes);
+}
+
+std::optional<dt::sha1_hash> create_checkpoint::find_piece(std::size_t index) const
+{
+    std::scoped_lock lock(mutex_);
+    if (index < pieces_.size() && piece_done_[index]) {
+        return pieces_[index];
+    }
+    return std::nullopt;
+}
+
+void create_checkpoint::add_piece(std::size_t index, const dt::sha1_hash& hash)
+{
+    std::scoped_lock lock(mutex_);
+    Expects(index < pieces_.size());
+    pieces_[index] = hash;
+    piece_done_[index] = true;
+}
+
+std::size_t create_checkpoint::completed_files() const
+{
+    std::scoped_lock lock(mutex_);
+    return file_hashes_.size();
+}
+
+std::size_t create_checkpoint::completed_pieces() const
+{
+    std::scoped_lock lock(mutex_);
+    return std::count(piece_done_.begin(), piece_done_.end(), true);
+}
+
+} // namespace torrenttools
@@ -0,0 +1,265 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <dottorrent/checksum.hpp>
+#include <dottorrent/hasher/factory.hpp>
+
+#include <xxhash.h>
+#include <blake3.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#include <nmmintrin.h>
+#define TORRENTTOOLS_CRC32C_SSE42
+#endif
+
+#include "checksum_algorithm.hpp"
+
+namespace torrenttools {
+
+namespace {
+
+constexpr std::array fast_checksums {fast_checksum::xxh3_128, fast_checksum::crc32c, fast_checksum::blake3};
+
+constexpr auto crc32c_table = []() {
+    std::array<std::uint32_t, 256> table {};
+    for (std::uint32_t i = 0; i < table.size(); ++i) {
+        auto crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            // reversed Castagnoli polynomial
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : crc >> 1;
+        }
+        table[i] = crc;
+    }
+    return table;
+}();
+
+std::uint32_t crc32c_update_portable(std::uint32_t crc, std::span<const std::byte> data) noexcept
+{
+    for (auto b : data) {
+        crc = crc32c_table[(crc ^ std::to_integer<std::uint32_t>(b)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+#ifdef TORRENTTOOLS_CRC32C_SSE42
+__attribute__((target("sse4.2")))
+std::uint32_t crc32c_update_sse42(std::uint32_t crc, std::span<const std::byte> data) noexcept
+{
+    const auto* p = data.data();
+    auto n = data.size();
+#if defined(__x86_64__)
+    std::uint64_t crc64 = crc;
+    for (; n >= 8; p += 8, n -= 8) {
+        std::uint64_t value;
+        std::memcpy(&value, p, 8);
+        crc64 = _mm_crc32_u64(crc64, value);
+    }
+    crc = static_cast<std::uint32_t>(crc64);
+#endif
+    for (; n != 0; ++p, --n) {
+        crc = _mm_crc32_u8(crc, std::to_integer<std::uint8_t>(*p));
+    }
+    return crc;
+}
+
+const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+#endif
+
+
+class dottorrent_checksum_hasher : public checksum_algorithm_hasher
+{
+public:
+    explicit dottorrent_checksum_hasher(dt::hash_function f)
+        : hasher_(dt::make_hasher(f))
+        , digest_size_(dt::make_checksum_from_algorithm(f)->value().size())
+    {}
+
+    void update(std::span<const std::byte> data) override
+    { hasher_->update(data); }
+
+    std::size_t digest_size() const noexcept override
+    { return digest_size_; }
+
+    void finalize_to(std::span<std::byte> out) override
+    { hasher_->finalize_to(out); }
+
+private:
+    std::unique_ptr<dt::hasher> hasher_;
+    std::size_t digest_size_;
+};
+
+
+class xxh3_128_hasher : public checksum_algorithm_hasher
+{
+public:
+    xxh3_128_hasher()
+        : state_(XXH3_createState())
+    {
+        if (state_ == nullptr) {
+            throw std::bad_alloc();
+        }
+        XXH3_128bits_reset(state_);
+    }
+
+    ~xxh3_128_hasher() override
+    { XXH3_freeState(state_); }
+
+    void update(std::span<const std::byte> data) override
+    { XXH3_128bits_update(state_, data.data(), data.size()); }
+
+    std::size_t digest_size() const noexcept override
+    { return sizeof(XXH128_canonical_t); }
+
+    void finalize_to(std::span<std::byte> out) override
+    {
+        Expects(out.size() >= digest_size());
+        XXH128_canonical_t canonical;
+        XXH128_canonicalFromHash(&canonical, XXH3_128bits_digest(state_));
+        std::memcpy(out.data(), canonical.digest, sizeof(canonical.digest));
+        XXH3_128bits_reset(state_);
+    }
+
+private:
+    XXH3_state_t* state_;
+};
+
+
+class crc32c_hasher : public checksum_algorithm_hasher
+{
+public:
+    void update(std::span<const std::byte> data) override
+    { crc_ = crc32c_update(crc_, data); }
+
+    std::size_t digest_size() const noexcept override
+    { return 4; }
+
+    void finalize_to(std::span<std::byte> out) override
+    {
+        Expects(out.size() >= digest_size());
+        auto value = ~crc_;
+        for (std::size_t i = 0; i < 4; ++i) {
+            out[i] = static_cast<std::byte>(value >> (24 - 8 * i));
+        }
+        crc_ = ~std::uint32_t(0);
+    }
+
+private:
+    std::uint32_t crc_ = ~std::uint32_t(0);
+};
+
+
+class blake3_checksum_hasher : public checksum_algorithm_hasher
+{
+public:
+    blake3_checksum_hasher()
+    { blake3_hasher_init(&hasher_); }
+
+    void update(std::span<const std::byte> data) override
+    {
+#ifdef BLAKE3_USE_TBB
+        // hash the chunks of large blocks in parallel using the tree structure of BLAKE3
+        blake3_hasher_update_tbb(&hasher_, data.data(), data.size());
+#else
+        blake3_hasher_update(&hasher_, data.data(), data.size());
+#endif
+    }
+
+    std::size_t digest_size() const noexcept override
+    { return BLAKE3_OUT_LEN; }
+
+    void finalize_to(std::span<std::byte> out) override
+    {
+        Expects(out.size() >= digest_size());
+        blake3_hasher_finalize(&hasher_, reinterpret_cast<std::uint8_t*>(out.data()), BLAKE3_OUT_LEN);
+        blake3_hasher_init(&hasher_);
+    }
+
+private:
+    blake3_hasher hasher_;
+};
+
+} // namespace
+
+
+std::string_view to_string(fast_checksum f) noexcept
+{
+    switch (f) {
+    case fast_checksum::xxh3_128: return "xxh3-128";
+    case fast_checksum::crc32c:   return "crc32c";
+    case fast_checksum::blake3:   return "blake3";
+    }
+    return "";
+}
+
+std::string to_string(const checksum_algorithm& algorithm)
+{
+    if (const auto* f = std::get_if<fast_checksum>(&algorithm)) {
+        return std::string(to_string(*f));
+    }
+    return std::string(dt::to_string(std::get<dt::hash_function>(algorithm)));
+}
+
+std::optional<fast_checksum> make_fast_checksum(std::string_view name)
+{
+    auto it = std::find_if(fast_checksums.begin(), fast_checksums.end(),
+                           [=](fast_checksum f) { return to_string(f) == name; });
+    if (it == fast_checksums.end()) {
+        return std::nullopt;
+    }
+    return *it;
+}
+
+std::optional<checksum_algorithm> make_checksum_algorithm(std::string_view name)
+{
+    if (auto f = dt::make_hash_function(name); f) {
+        return *f;
+    }
+    if (auto f = make_fast_checksum(name); f) {
+        return *f;
+    }
+    return std::nullopt;
+}
+
+std::span<const fast_checksum> fast_checksum_algorithms() noexcept
+{
+    return fast_checksums;
+}
+
+std::size_t digest_size(fast_checksum f) noexcept
+{
+    switch (f) {
+    case fast_checksum::xxh3_128: return 16;
+    case fast_checksum::crc32c:   return 4;
+    case fast_checksum::blake3:   return BLAKE3_OUT_LEN;
+    }
+    return 0;
+}
+
+std::uint32_t crc32c_update(std::uint32_t crc, std::span<const std::byte> data) noexcept
+{
+#ifdef TORRENTTOOLS_CRC32C_SSE42
+    if (has_sse42) {
+        return crc32c_update_sse42(crc, data);
+    }
+#endif
+    return crc32c_update_portable(crc, data);
+}
+
+
+std::unique_ptr<checksum_algorithm_hasher> make_checksum_hasher(const checksum_algorithm& algorithm)
+{
+    if (const auto* f = std::get_if<dt::hash_function>(&algorithm)) {
+        return std::make_unique<dottorrent_checksum_hasher>(*f);
+    }
+    switch (std::get<fast_checksum>(algorithm)) {
+    case fast_checksum::xxh3_128: return std::make_unique<xxh3_128_hasher>();
+    case fast_checksum::crc32c:   return std::make_unique<crc32c_hasher>();
+    case fast_checksum::blake3:   return std::make_unique<blake3_checksum_hasher>();
+    }
+    throw std::invalid_argument("invalid checksum algorithm");
+}
+
+} // namespace torrenttools
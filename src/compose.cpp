@@ -0,0 +1,142 @@
+#include <iostream>
+#include <set>
+
+#include <CLI/App.hpp>
+#include <fmt/format.h>
+#include <dottorrent/metafile.hpp>
+
+#include "compose.hpp"
+#include "argument_parsers.hpp"
+#include "common.hpp"
+#include "hashed_file.hpp"
+#include "piece_layout.hpp"
+
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+void configure_compose_app(CLI::App* app, compose_app_options& options)
+{
+    const auto max_size = 1U << 20U;
+
+    CLI::callback_t metafiles_parser = [&](const CLI::results_t& v) -> bool {
+        for (const auto& s : v) {
+            options.metafiles.push_back(metafile_target_transformer({s}));
+        }
+        return true;
+    };
+    CLI::callback_t protocol_parser = [&](const CLI::results_t& v) -> bool {
+        options.protocol_version = protocol_transformer(v);
+        return true;
+    };
+    CLI::callback_t data_directory_parser = [&](const CLI::results_t& v) -> bool {
+        options.data_directory = path_transformer(v);
+        return true;
+    };
+
+    app->add_option("metafiles", metafiles_parser, "Metafiles to combine.")
+       ->type_name("<metafile>...")
+       ->required()
+       ->expected(1, max_size);
+
+    app->add_option("-o,--output", options.destination,
+               "Set the filename and/or output directory of the created file.\n"
+               "[default: <name>.torrent]\n"
+               "Use a path with trailing slash to only set the output directory.")
+       ->type_name("<path>");
+
+    app->add_option("-n,--name", options.name,
+               "Set the name of the combined torrent.")
+       ->type_name("<name>")
+       ->required();
+
+    app->add_option("-v,--protocol", protocol_parser,
+               "Set the bittorrent protocol to use.\n"
+               "Options are 2 or hybrid. [default: 2]")
+       ->type_name("<protocol>");
+
+    app->add_option("--data", data_directory_parser,
+               "Directory with the combined data.\n"
+               "Only required for hybrid metafiles when the last piece of a file has to be rehashed.")
+       ->type_name("<path>");
+}
+
+
+dt::metafile compose_metafiles(const std::vector<dt::metafile>& metafiles,
+                               const std::string& name,
+                               dt::protocol protocol,
+                               const std::optional<fs::path>& data_directory)
+{
+    if (metafiles.empty()) {
+        throw std::invalid_argument("No metafiles to compose.");
+    }
+    if (!tt::has_v2(protocol)) {
+        throw std::invalid_argument("Only v2 and hybrid metafiles can be composed.");
+    }
+
+    const auto piece_size = metafiles.front().storage().piece_size();
+    std::vector<tt::hashed_file> files {};
+    std::set<std::string> names {};
+
+    for (const auto& m : metafiles) {
+        const auto& storage = m.storage();
+
+        if ((storage.protocol() & protocol) != protocol) {
+            throw std::invalid_argument(fmt::format(
+                    "Metafile {} does not contain hashes for the requested protocol.", m.name()));
+        }
+        if (tt::has_v1(protocol) && !tt::piece_layout(storage).is_aligned()) {
+            throw std::invalid_argument(fmt::format("Hybrid metafile {} is not padded to piece boundaries.", m.name()));
+        }
+        if (storage.piece_size() != piece_size) {
+            throw std::invalid_argument("All metafiles must have the same piece size.");
+        }
+        if (!names.insert(m.name()).second) {
+            throw std::invalid_argument(fmt::format("Multiple metafiles with the same name: {}", m.name()));
+        }
+
+        for (auto& f : tt::extract_hashed_files(storage, protocol)) {
+            if (storage.file_mode() == dt::file_mode::single) {
+                f.path = m.name();
+            } else {
+                f.path = fs::path(m.name()) / f.path;
+            }
+            files.push_back(std::move(f));
+        }
+    }
+
+    // Trackers and other metadata are taken from the first metafile.
+    dt::metafile result = metafiles.front();
+    result.clear_web_seeds();
+    result.clear_http_seeds();
+    result.clear_similar_torrents();
+    result.clear_collections();
+    result.set_name(name);
+    result.set_creation_date(std::chrono::system_clock::now());
+    result.set_created_by(CREATED_BY_STRING);
+
+    auto& storage = result.storage();
+    storage.set_file_mode(dt::file_mode::multi);
+    storage.set_root_directory(data_directory.value_or(fs::path {}));
+
+    tt::sort_hashed_files(files);
+    tt::set_hashed_files(storage, std::move(files), protocol, data_directory);
+    return result;
+}
+
+
+void run_compose_app(const main_app_options& main_options, const compose_app_options& options)
+{
+    std::vector<dt::metafile> metafiles {};
+    for (const auto& path : options.metafiles) {
+        metafiles.push_back(dt::load_metafile(path));
+    }
+
+    auto protocol = options.protocol_version.value_or(dt::protocol::v2);
+    auto m = compose_metafiles(metafiles, options.name, protocol, options.data_directory);
+
+    fs::path destination_file = get_destination_path(m, options.destination);
+    dt::save_metafile(destination_file, m, protocol);
+
+    fmt::print("Composed {} metafiles with {} files.\n", metafiles.size(), m.storage().file_count());
+    fmt::print("Metafile written to: {}\n", destination_file.string());
+}
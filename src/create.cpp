@@ -6,6 +6,10 @@
 #include <ranges>
 #include <optional>
 #include <iostream>
+#include <atomic>
+#include <mutex>
+#include <semaphore>
+#include <thread>
 
 #if defined(TORRENTTOOLS_USE_TBB)
 #include <execution>
@@ -20,6 +24,20 @@
 
 #include "create.hpp"
 #include "file_matcher.hpp"
+#include "scan_cache.hpp"
+#include "hash_cache.hpp"
+#include "hash_index.hpp"
+#include "io_scheduler.hpp"
+#include "file_stat.hpp"
+#include "per_file_hasher.hpp"
+#include "fastresume.hpp"
+#include "piece_hasher.hpp"
+#include "checkpoint.hpp"
+#include "shared_files.hpp"
+#include "multi_hasher.hpp"
+#include "piece_layout.hpp"
+#include "metafile_extras.hpp"
+#include "refresh.hpp"
 #include "formatters.hpp"
 #include "info.hpp"
 #include "argument_parsers.hpp"
@@ -45,6 +63,9 @@ using namespace std::chrono_literals;
 constexpr std::string_view program_name = PROJECT_NAME;
 constexpr std::string_view program_version_string = PROJECT_VERSION_STRING;
 
+/// Interval between two writes of the checkpoint file.
+constexpr auto checkpoint_interval = 30s;
+
 // TODO: Write torrent to cout.
 // TODO: Add dry run options which will show all data but quits before hashing.
 
@@ -108,6 +129,43 @@ void configure_create_app(CLI::App* app, create_app_options& options)
         return true;
     };
 
+    CLI::callback_t scan_cache_parser = [&](const CLI::results_t& v) -> bool {
+        options.scan_cache = path_transformer(v, /*check_exists=*/false);
+        return true;
+    };
+
+    CLI::callback_t hash_cache_parser = [&](const CLI::results_t& v) -> bool {
+        options.hash_cache = path_transformer(v, /*check_exists=*/false);
+        return true;
+    };
+
+    CLI::callback_t checkpoint_parser = [&](const CLI::results_t& v) -> bool {
+        options.checkpoint = path_transformer(v, /*check_exists=*/false);
+        return true;
+    };
+
+    CLI::callback_t resume_parser = [&](const CLI::results_t& v) -> bool {
+        options.resume = path_transformer(v);
+        return true;
+    };
+
+    CLI::callback_t hash_index_parser = [&](const CLI::results_t& v) -> bool {
+        options.hash_index = path_transformer(v, /*check_exists=*/false);
+        return true;
+    };
+
+    CLI::callback_t based_on_parser = [&](const CLI::results_t& v) -> bool {
+        options.based_on = metafile_target_transformer(v);
+        return true;
+    };
+
+    CLI::callback_t also_parser = [&](const CLI::results_t& v) -> bool {
+        for (const auto& spec : v) {
+            options.extra_outputs.push_back(parse_output_spec(spec));
+        }
+        return true;
+    };
+
     CLI::callback_t io_block_size_parser = [&](const CLI::results_t& v) -> bool {
         options.io_block_size = io_block_size_transformer(v);
         return true;
@@ -285,6 +343,81 @@ void configure_create_app(CLI::App* app, create_app_options& options)
        ->type_name("<size[K|M]>")
        ->expected(1);
 
+    app->add_option("--scan-cache", scan_cache_parser,
+               "Reuse directory listings stored in given cache file.\n"
+               "Directories that did not change since the previous scan are not read again.\n"
+               "The cache file is created when it does not exist.")
+       ->type_name("<path>")
+       ->expected(1);
+
+    app->add_option("--hash-cache", hash_cache_parser,
+               "Reuse file hashes stored in given cache file.\n"
+               "Files that did not change since they were last hashed are not read again.\n"
+               "The cache file is created when it does not exist.")
+       ->type_name("<path>")
+       ->expected(1);
+
+    app->add_option("--based-on", based_on_parser,
+               "Reuse the hashes of unchanged files from an earlier version of the torrent.\n"
+               "Only changed files and the pieces overlapping them are read.\n"
+               "The earlier version must have been created with --record-mtimes.")
+       ->type_name("<metafile>")
+       ->expected(1);
+
+    options.record_mtimes = false;
+    app->add_flag_callback("--record-mtimes",
+            [&]() { options.record_mtimes = true; },
+            "Store the size and modification time of every file outside the info dictionary,\n"
+            "so the metafile can be used with --based-on.");
+
+    app->add_option("--checkpoint", checkpoint_parser,
+               "Periodically save the progress of hashing to given file.\n"
+               "An interrupted run can be continued with --resume.")
+       ->type_name("<path>")
+       ->expected(1);
+
+    app->add_option("--resume", resume_parser,
+               "Continue an interrupted run from given checkpoint file.\n"
+               "All other options must be the same as for the interrupted run.")
+       ->type_name("<path>")
+       ->expected(1);
+
+    app->add_option("--also", also_parser,
+               "Write additional metafiles from the same read of the data.\n"
+               "Each output is a comma separated list of key=value pairs.\n"
+               "Valid keys are protocol, piece-size, announce, source and output.\n"
+               " eg. \"--also protocol=2,piece-size=4M announce=https://tracker.example/announce\"")
+       ->type_name("<spec>...")
+       ->expected(0, max_size);
+
+    options.dedup_reflinks = false;
+    app->add_flag_callback("--dedup-reflinks",
+            [&]() { options.dedup_reflinks = true; },
+            "Read reflinked copies of a file only once.\n"
+            "Hardlinked files are always read only once.");
+
+    options.batch_per_directory = false;
+    app->add_flag_callback("--batch-per-directory",
+            [&]() { options.batch_per_directory = true; },
+            "Create a metafile for every subdirectory of the target directory.\n"
+            "The output option is used as the directory to write the metafiles to.");
+
+    options.batch_per_file = false;
+    app->add_flag_callback("--batch-per-file",
+            [&]() { options.batch_per_file = true; },
+            "Create a metafile for every file in the target directory.\n"
+            "The output option is used as the directory to write the metafiles to.");
+
+    options.fastresume = false;
+    app->add_flag_callback("--fastresume",
+            [&]() { options.fastresume = true; },
+            "Write libtorrent resume data next to the metafile, so a client can seed without checking the data.");
+
+    app->add_option("--hash-index", hash_index_parser,
+               "Write the v1 piece hashes and the complete v2 merkle tree of every file to given binary file.")
+       ->type_name("<path>")
+       ->expected(1);
+
     app->add_option("--profile,-P", options.profile,
             "Read options form a config profile.")
         ->type_name("<profile-name>")
@@ -298,6 +431,44 @@ void configure_create_app(CLI::App* app, create_app_options& options)
 
 
 
+create_output_options parse_output_spec(std::string_view spec)
+{
+    create_output_options output {};
+
+    for (std::size_t start = 0; start <= spec.size();) {
+        auto end = std::min(spec.find(',', start), spec.size());
+        auto field = spec.substr(start, end - start);
+        start = end + 1;
+
+        auto pos = field.find('=');
+        if (pos == std::string_view::npos || pos == 0 || pos + 1 == field.size()) {
+            throw std::invalid_argument(fmt::format("Invalid output specification: {}", spec));
+        }
+        auto key = field.substr(0, pos);
+        auto value = std::string(field.substr(pos + 1));
+
+        if (key == "protocol") {
+            output.protocol_version = protocol_transformer({value});
+        }
+        else if (key == "piece-size") {
+            output.piece_size = piece_size_transformer({value});
+        }
+        else if (key == "announce") {
+            // every announce url is added in a separate tier
+            output.announce_list.push_back({value});
+        }
+        else if (key == "source") {
+            output.source = value;
+        }
+        else if (key == "output") {
+            output.destination = path_transformer({value}, /*check_exists=*/false);
+        }
+        else {
+            throw std::invalid_argument(fmt::format("Invalid key in output specification: {}", key));
+        }
+    }
+    return output;
+}
 
 
 void configure_matcher(torrenttools::file_matcher& matcher, const create_app_options& options)
@@ -314,6 +485,28 @@ void configure_matcher(torrenttools::file_matcher& matcher, const create_app_opt
 
 
 
+namespace {
+
+void sort_file_list(std::vector<fs::path>& files)
+{
+#if defined(TORRENTTOOLS_USE_TBB)
+    std::sort(std::execution::par_unseq, files.begin(), files.end(),
+            [](const fs::path& lhs, const fs::path& rhs) {
+                return rng::lexicographical_compare(lhs.string(), rhs.string());
+            }
+    );
+#else
+    std::sort(files.begin(), files.end(),
+            [](const fs::path& lhs, const fs::path& rhs) {
+                return rng::lexicographical_compare(lhs.string(), rhs.string());
+            }
+    );
+#endif
+}
+
+} // namespace
+
+
 /// Select files and add the to the metafile
 void set_files_with_progress(dottorrent::metafile& m, const create_app_options& options, std::ostream& os)
 {
@@ -325,6 +518,13 @@ void set_files_with_progress(dottorrent::metafile& m, const create_app_options&
         torrenttools::file_matcher matcher{};
         configure_matcher(matcher, options);
 
+        std::optional<tt::scan_cache> cache {};
+        if (options.scan_cache) {
+            cache.emplace(*options.scan_cache);
+            cache->load();
+            matcher.set_scan_cache(&*cache);
+        }
+
         matcher.set_search_root(options.target);
         matcher.start();
 
@@ -337,24 +537,18 @@ void set_files_with_progress(dottorrent::metafile& m, const create_app_options&
         matcher.wait();
         std::cout << std::endl;
 
+        if (cache) {
+            cache->save();
+            fmt::format_to(out, "Scan cache: {} of {} directories unchanged\n",
+                           cache->hits(), cache->hits() + cache->misses());
+        }
+
         auto files = matcher.results();
 
         fmt::format_to(out, "Sorting file list...");
         std::flush(os);
 
-        #if defined(TORRENTTOOLS_USE_TBB)
-            std::sort(std::execution::par_unseq, files.begin(), files.end(),
-                    [](const fs::path& lhs, const fs::path& rhs) {
-                        return rng::lexicographical_compare(lhs.string(), rhs.string());
-                    }
-            );
-        #else
-            std::sort(files.begin(), files.end(),
-                    [](const fs::path& lhs, const fs::path& rhs) {
-                        return rng::lexicographical_compare(lhs.string(), rhs.string());
-                    }
-            );
-        #endif
+        sort_file_list(files);
 
         fmt::format_to(out, "\rSorting file list... Done.\n");
         std::flush(os);
@@ -379,40 +573,39 @@ void set_files_with_progress(dottorrent::metafile& m, const create_app_options&
     m.set_name(options.target.filename().string());
 }
 
-void postprocess_create_app(const CLI::App* app, const main_app_options& main_options, create_app_options& options)
-{
-    auto [config_ptr, tracker_db_ptr] = load_config_and_tracker_db(main_options);
 
-    if (config_ptr == nullptr && options.profile.has_value()) {
-        throw tt::profile_error("no configuration was found, but --profile requested.");
-    }
-
-    if (options.profile.has_value() && config_ptr != nullptr) {
-        merge_create_profile(*config_ptr, *options.profile, app, options);
-    }
-}
-
-void run_create_app(const main_app_options& main_options, create_app_options& options)
+void set_files(dottorrent::metafile& m, const create_app_options& options, tt::scan_cache* cache)
 {
-    namespace dt = dottorrent;
-    using namespace dottorrent::literals;
-
-    std::ostream& os = options.write_to_stdout ? std::cerr : std::cout;
-
-    // create a new metafile
-    dt::metafile m{};
+    dottorrent::file_storage& storage = m.storage();
 
-    // add files to the file_storage
-    auto& file_storage = m.storage();
+    if (fs::is_directory(options.target)) {
+        torrenttools::file_matcher matcher{};
+        configure_matcher(matcher, options);
+        if (cache != nullptr) {
+            matcher.set_scan_cache(cache);
+        }
+        matcher.set_search_root(options.target);
+        matcher.start();
+        matcher.wait();
 
-    set_files_with_progress(m, options, os);
+        auto files = matcher.results();
+        sort_file_list(files);
 
-    if (options.piece_size) {
-        file_storage.set_piece_size(*options.piece_size);
-    } else {
-        dottorrent::choose_piece_size(file_storage);
+        storage.set_root_directory(options.target);
+        storage.set_file_mode(dt::file_mode::multi);
+        storage.add_files(files.begin(), files.end());
+    }
+    else {
+        storage.set_root_directory(options.target.parent_path());
+        storage.set_file_mode(dt::file_mode::single);
+        storage.add_file(options.target);
     }
+    m.set_name(options.target.filename().string());
+}
 
+/// Set the trackers, seeds and other metadata given in options.
+void set_metafile_options(dottorrent::metafile& m, const create_app_options& options)
+{
     // announces
     if (!options.announce_group_list.empty()) {
         set_tracker_group(m, options.announce_group_list, tt::load_tracker_database(), tt::load_config());
@@ -488,6 +681,321 @@ void run_create_app(const main_app_options& main_options, create_app_options& op
             m.add_collection(s);
         }
     }
+}
+
+void postprocess_create_app(const CLI::App* app, const main_app_options& main_options, create_app_options& options)
+{
+    auto [config_ptr, tracker_db_ptr] = load_config_and_tracker_db(main_options);
+
+    if (config_ptr == nullptr && options.profile.has_value()) {
+        throw tt::profile_error("no configuration was found, but --profile requested.");
+    }
+
+    if (options.profile.has_value() && config_ptr != nullptr) {
+        merge_create_profile(*config_ptr, *options.profile, app, options);
+    }
+}
+
+/// Return the targets of a batch: the subdirectories and/or files directly below the batch root.
+std::vector<fs::path> list_batch_targets(const create_app_options& options)
+{
+    if (!fs::is_directory(options.target)) {
+        throw std::invalid_argument("Batch creation requires a directory as target.");
+    }
+
+    std::vector<fs::path> targets {};
+    for (const auto& entry : fs::directory_iterator(options.target)) {
+        if (!options.include_hidden_files && entry.path().filename().string().starts_with(".")) {
+            continue;
+        }
+        if ((options.batch_per_directory && entry.is_directory()) ||
+            (options.batch_per_file && entry.is_regular_file())) {
+            targets.push_back(entry.path());
+        }
+    }
+    sort_file_list(targets);
+    return targets;
+}
+
+namespace {
+
+/// Per-file checksums that are computed by dottorrent, without the fast checksums.
+std::unordered_set<dt::hash_function> dottorrent_checksums(const create_app_options& options)
+{
+    std::unordered_set<dt::hash_function> result {};
+    for (const auto& algorithm : options.checksums) {
+        if (const auto* f = std::get_if<dt::hash_function>(&algorithm)) {
+            result.insert(*f);
+        }
+    }
+    return result;
+}
+
+bool has_fast_checksums(const create_app_options& options)
+{
+    return rng::any_of(options.checksums, [](const auto& a) { return std::holds_alternative<tt::fast_checksum>(a); });
+}
+
+/// Write resume data for a metafile of which all pieces were just hashed.
+void write_complete_fastresume(const fs::path& destination, const dt::metafile& m, dt::protocol protocol)
+{
+    std::vector<bool> have(tt::fastresume_piece_count(m.storage(), protocol), true);
+    tt::write_fastresume(tt::fastresume_path(destination), m, protocol, have);
+}
+
+struct batch_job
+{
+    dt::metafile metafile;
+    fs::path destination;
+};
+
+/// Create one metafile for every target of a batch.
+/// All jobs are scanned up front and then run by an io_scheduler, largest jobs first,
+/// reading rotational disks with a single job at a time.
+/// The files of all running jobs share --threads hashing slots,
+/// so the remaining large jobs use all threads when the small jobs are done.
+void run_batch_create(create_app_options& options, std::ostream& os)
+{
+    if (options.write_to_stdout || options.read_from_stdin) {
+        throw std::invalid_argument("Batch creation cannot read from standard input or write to standard output.");
+    }
+    if (options.name || options.based_on || options.hash_cache || !options.extra_outputs.empty() ||
+        options.checkpoint || options.resume || options.hash_index) {
+        throw std::invalid_argument("Batch creation cannot be combined with --name, --based-on, --hash-cache, "
+                                    "--also, --checkpoint, --resume or --hash-index.");
+    }
+    if (has_fast_checksums(options)) {
+        throw std::invalid_argument("Batch creation only supports the checksums listed by --checksum-algorithms.");
+    }
+
+    std::optional<fs::path> destination_directory {};
+    if (options.destination) {
+        fs::create_directories(*options.destination);
+        destination_directory = *options.destination / "";
+    }
+
+    auto targets = list_batch_targets(options);
+    if (targets.empty()) {
+        throw std::invalid_argument("No batch targets found in target directory.");
+    }
+
+    std::optional<tt::scan_cache> cache {};
+    if (options.scan_cache) {
+        cache.emplace(*options.scan_cache);
+        cache->load();
+    }
+
+    std::vector<batch_job> jobs {};
+    jobs.reserve(targets.size());
+    std::vector<fs::path> destinations {};
+
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        fmt::format_to(std::ostreambuf_iterator(os), "\rScanning batch targets: {} of {}", i + 1, targets.size());
+        std::flush(os);
+
+        auto job_options = options;
+        job_options.target = targets[i];
+
+        auto& job = jobs.emplace_back();
+        set_files(job.metafile, job_options, cache ? &*cache : nullptr);
+        auto& storage = job.metafile.storage();
+        if (storage.file_count() == 0) {
+            jobs.pop_back();
+            continue;
+        }
+        if (options.piece_size) {
+            storage.set_piece_size(*options.piece_size);
+        } else {
+            dottorrent::choose_piece_size(storage);
+        }
+        set_metafile_options(job.metafile, options);
+
+        job.destination = get_destination_path(job.metafile, destination_directory);
+        if (rng::find(destinations, job.destination) != destinations.end()) {
+            throw std::invalid_argument(fmt::format(
+                    "Multiple metafiles would be written to {}.", job.destination.string()));
+        }
+        destinations.push_back(job.destination);
+    }
+    os << std::endl;
+
+    if (cache) {
+        cache->save();
+    }
+
+    // Start the largest jobs first so small jobs fill up the workers at the end.
+    rng::stable_sort(jobs, std::greater<>{}, [](const batch_job& job) {
+        return job.metafile.storage().total_file_size();
+    });
+
+    std::size_t total_size = 0;
+    for (const auto& job : jobs) {
+        total_size += job.metafile.storage().total_file_size();
+    }
+    os << fmt::format("Hashing {} metafiles, {} in total...\n", jobs.size(), tt::format_size(total_size));
+
+    const auto thread_count = std::max<std::size_t>(options.threads, 1);
+    auto scheduler = tt::io_scheduler(thread_count);
+    std::counting_semaphore<> slots(static_cast<std::ptrdiff_t>(thread_count));
+    std::size_t jobs_done = 0;
+    std::size_t jobs_failed = 0;
+    std::mutex output_mutex {};
+
+    auto run_job = [&](batch_job& job, bool rotational) {
+        try {
+            auto& storage = job.metafile.storage();
+            tt::metafile_extras extras {};
+            if (options.record_mtimes) {
+                extras.mtimes = tt::stat_storage_files(storage);
+            }
+            // Files can only be hashed one by one when they all start on a piece boundary.
+            if (options.protocol_version == dt::protocol::v2 || storage.file_count() <= 1 ||
+                tt::piece_layout(storage).is_aligned()) {
+                // files on rotational disks are read one at a time
+                auto hasher = tt::per_file_hasher(storage, options.protocol_version, rotational ? 1 : thread_count);
+                hasher.set_slots(&slots);
+                if (options.io_block_size) {
+                    hasher.set_io_block_size(*options.io_block_size);
+                }
+                if (!options.checksums.empty()) {
+                    auto checksums = std::vector<tt::checksum_algorithm>(
+                            options.checksums.begin(), options.checksums.end());
+                    rng::sort(checksums);
+                    hasher.set_checksums(std::move(checksums));
+                }
+                hasher.start();
+                hasher.wait();
+            }
+            else {
+                dt::storage_hasher_options hasher_options {
+                        .protocol_version = options.protocol_version,
+                        .checksums = dottorrent_checksums(options),
+                        .min_io_block_size = options.io_block_size,
+                        .threads = 1
+                };
+                slots.acquire();
+                try {
+                    auto hasher = dt::storage_hasher(storage, hasher_options);
+                    hasher.start();
+                    hasher.wait();
+                }
+                catch (...) {
+                    slots.release();
+                    throw;
+                }
+                slots.release();
+            }
+            tt::save_metafile(job.destination, job.metafile, options.protocol_version, extras);
+            if (options.fastresume) {
+                write_complete_fastresume(job.destination, job.metafile, options.protocol_version);
+            }
+
+            std::unique_lock lock(output_mutex);
+            ++jobs_done;
+            os << fmt::format("[{}/{}] Metafile written to: {}\n",
+                              jobs_done + jobs_failed, jobs.size(), job.destination.string());
+        }
+        catch (const std::exception& e) {
+            std::unique_lock lock(output_mutex);
+            ++jobs_failed;
+            os << fmt::format("[{}/{}] Failed to create {}: {}\n",
+                              jobs_done + jobs_failed, jobs.size(), job.destination.string(), e.what());
+        }
+        // Release the piece hashes as soon as the metafile is written.
+        job.metafile = {};
+    };
+
+    for (auto& job : jobs) {
+        auto device = tt::query_storage_device(job.metafile.storage().root_directory());
+        auto limit = device.rotational ? 1 : thread_count;
+        scheduler.add(device.id, limit, [&, rotational = device.rotational]() { run_job(job, rotational); });
+    }
+    scheduler.run();
+
+    if (jobs_failed != 0) {
+        throw std::runtime_error(fmt::format("{} of {} metafiles could not be created.", jobs_failed, jobs.size()));
+    }
+}
+
+} // namespace
+
+
+void run_create_app(const main_app_options& main_options, create_app_options& options)
+{
+    namespace dt = dottorrent;
+    using namespace dottorrent::literals;
+
+    std::ostream& os = options.write_to_stdout ? std::cerr : std::cout;
+
+    if (options.batch_per_directory || options.batch_per_file) {
+        run_batch_create(options, os);
+        return;
+    }
+    if (options.fastresume && options.write_to_stdout) {
+        throw std::invalid_argument("--fastresume cannot be combined with writing the metafile to standard output.");
+    }
+
+    // create a new metafile
+    dt::metafile m{};
+
+    // add files to the file_storage
+    auto& file_storage = m.storage();
+
+    set_files_with_progress(m, options, os);
+
+    std::optional<dt::metafile> base {};
+    tt::file_mtime_table base_mtimes {};
+    if (options.based_on) {
+        if (!options.checksums.empty()) {
+            throw std::invalid_argument("--based-on cannot be combined with --checksum.");
+        }
+        base = dt::load_metafile(*options.based_on);
+        base_mtimes = tt::load_metafile_extras(*options.based_on).mtimes;
+    }
+    if (!options.extra_outputs.empty() && (base || options.hash_cache || !options.checksums.empty())) {
+        throw std::invalid_argument("--also cannot be combined with --based-on, --hash-cache or --checksum.");
+    }
+
+    std::optional<tt::create_checkpoint> checkpoint {};
+    if (options.checkpoint || options.resume) {
+        if (options.checkpoint && options.resume) {
+            throw std::invalid_argument("--checkpoint cannot be combined with --resume, "
+                                        "--resume keeps updating the given checkpoint.");
+        }
+        if (base || !options.extra_outputs.empty() || !options.checksums.empty()) {
+            throw std::invalid_argument("--checkpoint and --resume cannot be combined with "
+                                        "--based-on, --also or --checksum.");
+        }
+        checkpoint.emplace(options.resume.value_or(options.checkpoint.value_or(fs::path{})));
+        if (options.resume) {
+            checkpoint->load();
+        }
+    }
+    // The merkle trees are only available when the files are read and hashed one by one.
+    if (options.hash_index && (base || !options.extra_outputs.empty() || checkpoint)) {
+        throw std::invalid_argument("--hash-index cannot be combined with --based-on, --also, --checkpoint "
+                                    "or --resume.");
+    }
+    // Unchanged files are detected by comparing with the modification times recorded in base.
+    if (base && base_mtimes.empty()) {
+        throw std::invalid_argument(fmt::format(
+                "{} does not contain the modification times of its files, "
+                "--based-on requires a metafile created with --record-mtimes.",
+                options.based_on->string()));
+    }
+
+    // Hashes can only be reused for the same piece size.
+    if (options.piece_size) {
+        file_storage.set_piece_size(*options.piece_size);
+    } else if (base) {
+        file_storage.set_piece_size(base->storage().piece_size());
+    } else if (options.resume) {
+        file_storage.set_piece_size(checkpoint->piece_size());
+    } else {
+        dottorrent::choose_piece_size(file_storage);
+    }
+
+    set_metafile_options(m, options);
 
     fs::path destination_file = get_destination_path(m, options.destination);
 
@@ -508,6 +1016,103 @@ void run_create_app(const main_app_options& main_options, create_app_options& op
     }
 #endif
 
+    std::optional<tt::hash_cache> cache {};
+    if (options.hash_cache) {
+        cache.emplace(*options.hash_cache);
+        cache->load();
+    }
+
+    // Additional metafiles with their own protocol, piece size and trackers, hashed from the same read of the data.
+    struct extra_output
+    {
+        dt::metafile metafile;
+        dt::protocol protocol;
+        fs::path destination;
+    };
+    std::vector<extra_output> extra_outputs {};
+    std::vector<fs::path> destinations {destination_file};
+
+    for (const auto& spec : options.extra_outputs) {
+        auto& output = extra_outputs.emplace_back(extra_output {
+                .metafile = m,
+                .protocol = spec.protocol_version.value_or(options.protocol_version)
+        });
+        auto& storage = output.metafile.storage();
+
+        if (spec.piece_size) {
+            storage.set_piece_size(*spec.piece_size);
+        }
+        if (output.protocol == dt::protocol::hybrid && storage.file_count() > 1) {
+            tt::align_to_pieces(storage);
+        }
+        if (!spec.announce_list.empty()) {
+            output.metafile.clear_trackers();
+            set_trackers(output.metafile, spec.announce_list, tt::load_tracker_database(), tt::load_config());
+            if (options.enable_cross_seeding) {
+                output.metafile.enable_cross_seeding();
+                output.metafile.other_info_fields().clear();
+            }
+        }
+        if (spec.source) {
+            output.metafile.set_source(*spec.source);
+        }
+
+        if (spec.destination) {
+            output.destination = get_destination_path(output.metafile, spec.destination);
+        } else {
+            output.destination = get_destination_path(output.metafile, destination_file.parent_path() / "");
+            // Distinguish outputs with the same name by protocol and piece size.
+            if (rng::find(destinations, output.destination) != destinations.end()) {
+                auto piece_size = storage.piece_size();
+                auto size_suffix = piece_size % 1_MiB == 0
+                        ? fmt::format("{}M", piece_size / 1_MiB)
+                        : fmt::format("{}K", piece_size / 1_KiB);
+                auto protocol_suffix = output.protocol == dt::protocol::hybrid
+                        ? "hybrid"s
+                        : fmt::format("v{}", output.protocol == dt::protocol::v2 ? 2 : 1);
+                output.destination.replace_filename(fmt::format(
+                        "{}-{}-{}.torrent", output.destination.stem().string(), protocol_suffix, size_suffix));
+            }
+        }
+        if (rng::find(destinations, output.destination) != destinations.end()) {
+            throw std::invalid_argument(fmt::format(
+                    "Multiple metafiles would be written to {}.", output.destination.string()));
+        }
+        destinations.push_back(output.destination);
+    }
+
+    // Align hybrid torrents up front so the v1 piece hashes of each file can be reused.
+    bool align_hybrid = options.protocol_version == dt::protocol::hybrid && file_storage.file_count() > 1;
+    if ((cache || base || checkpoint || !extra_outputs.empty()) && align_hybrid) {
+        tt::align_to_pieces(file_storage);
+    }
+
+    // Hardlinked and reflinked files only need to be read once, which requires hashing file by file.
+    // Hybrid torrents are only aligned for this when shared files are found.
+    std::vector<std::optional<std::size_t>> shared_files {};
+    if (!base && extra_outputs.empty() && options.protocol_version != dt::protocol::v1) {
+        shared_files = tt::find_shared_files(file_storage, options.dedup_reflinks);
+    }
+    bool has_shared_files = rng::any_of(shared_files, [](const auto& v) { return v.has_value(); });
+    if (has_shared_files && align_hybrid && !tt::piece_layout(file_storage).is_aligned()) {
+        shared_files = tt::align_shared_files(file_storage, shared_files);
+    }
+
+    std::optional<tt::hash_index_writer> index {};
+    if (options.hash_index) {
+        index.emplace(*options.hash_index, file_storage.file_count());
+    }
+
+    if (checkpoint) {
+        if (options.resume) {
+            checkpoint->check_inputs(file_storage, options.protocol_version);
+        } else {
+            checkpoint->set_inputs(file_storage, options.protocol_version);
+            checkpoint->save();
+        }
+        checkpoint->save_periodically(checkpoint_interval);
+    }
+
     create_general_info(os, m, destination_file, options.protocol_version, fmt_options);
     os << '\n';
 
@@ -515,31 +1120,171 @@ void run_create_app(const main_app_options& main_options, create_app_options& op
         throw std::invalid_argument("io-block-size must be larger or equal to the piece size.");
     }
 
-    // hash checking
-    dt::storage_hasher_options hasher_options {
-            .protocol_version = options.protocol_version,
-            .checksums = {options.checksums},
-            .min_io_block_size = options.io_block_size,
-            .threads = options.threads
+    auto run_hasher = [&](auto& hasher) {
+        os << "Hashing files..." << std::endl;
+
+        if (simple_progress) {
+            run_with_simple_progress(os, hasher, m);
+        } else {
+            run_with_progress(os, hasher, m);
+        }
     };
 
-    auto hasher = dt::storage_hasher(file_storage, hasher_options);
+    // Files can only be hashed one by one when they all start on a piece boundary.
+    // Per file checksums are computed from the same reads as the piece hashes, with the files spread over the threads.
+    // v2 and hybrid torrents are hashed file by file with multiple threads to schedule the largest files first.
+    // The v2 merkle trees for the hash index are only kept when hashing file by file.
+    // --based-on schedules the files it hashes largest first itself.
+    // v1 torrents are checkpointed piece by piece, so a large single file does not restart from zero.
+    bool balance_load = tt::has_v2(options.protocol_version) && options.threads > 1;
+    bool index_trees = index.has_value() && tt::has_v2(options.protocol_version);
+    bool checkpoint_per_file = checkpoint.has_value() && tt::has_v2(options.protocol_version);
+    bool hash_per_file = (cache.has_value() || checkpoint_per_file || has_shared_files ||
+                          balance_load || index_trees || !options.checksums.empty()) &&
+            (options.protocol_version == dt::protocol::v2 || file_storage.file_count() <= 1 ||
+             tt::piece_layout(file_storage).is_aligned());
+
+    // Fast checksums are only computed when hashing file by file.
+    if (has_fast_checksums(options) && !hash_per_file) {
+        throw std::invalid_argument("Fast checksums require all files to start on a piece boundary, "
+                                    "use --protocol v2 or hybrid.");
+    }
+    // Record the files before they are read, so changes made while hashing are detected by a later --based-on.
+    tt::metafile_extras extras {};
+    if (options.record_mtimes) {
+        extras.mtimes = tt::stat_storage_files(file_storage);
+    }
 
-    os << "Hashing files..." << std::endl;
+    if (base) {
+        os << fmt::format("Hashing files changed since {}...", options.based_on->filename().string()) << std::endl;
 
-    if (simple_progress) {
-        run_with_simple_progress(os, hasher, m);
-    } else {
-        run_with_progress(os, hasher, m);
+        auto hasher = tt::based_on_hasher(file_storage, *base, base_mtimes,
+                                          options.protocol_version, options.threads);
+        if (simple_progress) {
+            run_with_simple_progress(os, hasher, m);
+        } else {
+            run_with_progress(os, hasher, m);
+        }
+
+        const auto& statistics = hasher.statistics();
+        if (tt::has_v2(options.protocol_version)) {
+            os << fmt::format("Files reused:        {} of {}\n",
+                              statistics.files_reused, statistics.files_reused + statistics.files_hashed);
+        }
+        if (tt::has_v1(options.protocol_version)) {
+            os << fmt::format("Pieces reused:       {} of {}\n",
+                              statistics.pieces_reused, statistics.pieces_reused + statistics.pieces_hashed);
+        }
+        os << fmt::format("Data hashed:         {}\n", tt::format_size(statistics.bytes_hashed));
+    }
+    else if (!extra_outputs.empty()) {
+        std::vector<std::pair<dt::file_storage*, dt::protocol>> targets {{&file_storage, options.protocol_version}};
+        for (auto& output : extra_outputs) {
+            targets.emplace_back(&output.metafile.storage(), output.protocol);
+        }
+        auto hasher = tt::multi_hasher(std::move(targets), options.threads);
+        run_hasher(hasher);
+    }
+    else if (hash_per_file) {
+        auto hasher = tt::per_file_hasher(file_storage, options.protocol_version, options.threads);
+        if (options.io_block_size) {
+            hasher.set_io_block_size(*options.io_block_size);
+        }
+        if (cache) {
+            hasher.set_hash_cache(&*cache);
+        }
+        if (has_shared_files) {
+            hasher.set_shared_files(std::move(shared_files));
+        }
+        if (checkpoint) {
+            hasher.set_checkpoint(&*checkpoint);
+        }
+        if (index_trees) {
+            hasher.set_hash_index(&*index);
+        }
+        if (!options.checksums.empty()) {
+            auto checksums = std::vector<tt::checksum_algorithm>(options.checksums.begin(), options.checksums.end());
+            rng::sort(checksums);
+            hasher.set_checksums(std::move(checksums));
+        }
+        run_hasher(hasher);
+        extras.checksums = hasher.fast_checksums();
+
+        if (hasher.resumed_files() != 0) {
+            os << fmt::format("Files resumed:       {} from checkpoint\n", hasher.resumed_files());
+        }
+        if (hasher.resumed_ranges() != 0) {
+            os << fmt::format("Ranges resumed:      {} of large files from checkpoint\n", hasher.resumed_ranges());
+        }
+
+        if (hasher.shared_file_count() != 0) {
+            os << fmt::format("Shared files:        {} files, {} not read\n",
+                              hasher.shared_file_count(), tt::format_size(hasher.shared_bytes()));
+        }
+    }
+    else if (checkpoint) {
+        // v1 pieces are checkpointed piece by piece, including those spanning multiple files.
+        auto hasher = tt::piece_hasher(file_storage, options.threads);
+        hasher.set_checkpoint(&*checkpoint);
+        run_hasher(hasher);
+
+        if (hasher.resumed_pieces() != 0) {
+            os << fmt::format("Pieces resumed:      {} from checkpoint\n", hasher.resumed_pieces());
+        }
+    }
+    else {
+        dt::storage_hasher_options hasher_options {
+                .protocol_version = options.protocol_version,
+                .checksums = dottorrent_checksums(options),
+                .min_io_block_size = options.io_block_size,
+                .threads = options.threads
+        };
+
+        auto hasher = dt::storage_hasher(file_storage, hasher_options);
+        run_hasher(hasher);
+
+        if (cache) {
+            cache->insert(file_storage, options.protocol_version);
+        }
+    }
+
+    if (cache) {
+        cache->save();
+        fmt::format_to(std::ostreambuf_iterator(os), "Hash cache: {} of {} files reused\n",
+                       cache->hits(), cache->hits() + cache->misses());
     }
 
     // Join all threads and block until completed.
     if (!options.write_to_stdout) {
-        dt::save_metafile(destination_file, m, options.protocol_version);
+        tt::save_metafile(destination_file, m, options.protocol_version, extras);
         os << fmt::format("Metafile written to: {}\n", destination_file.string());
     } else {
         os << fmt::format("Metafile written to standard output.");
-        dt::write_metafile_to(std::cout, m, options.protocol_version);
+        tt::write_metafile_to(std::cout, m, options.protocol_version, extras);
+    }
+    for (const auto& output : extra_outputs) {
+        tt::save_metafile(output.destination, output.metafile, output.protocol, {.mtimes = extras.mtimes});
+        os << fmt::format("Metafile written to: {}\n", output.destination.string());
+    }
+
+    if (index) {
+        index->finish(m, options.protocol_version);
+        os << fmt::format("Hash index written to: {}\n", index->path().string());
+    }
+
+    if (options.fastresume) {
+        write_complete_fastresume(destination_file, m, options.protocol_version);
+        os << fmt::format("Resume data written to: {}\n", tt::fastresume_path(destination_file).string());
+        for (const auto& output : extra_outputs) {
+            write_complete_fastresume(output.destination, output.metafile, output.protocol);
+            os << fmt::format("Resume data written to: {}\n", tt::fastresume_path(output.destination).string());
+        }
+    }
+
+    // The checkpoint is no longer needed once the metafile is written.
+    if (checkpoint) {
+        checkpoint->stop();
+        checkpoint->remove();
     }
 }
 
@@ -632,6 +1377,15 @@ void merge_create_profile(const tt::config& cfg, std::string_view profile_name,
     if (app->get_option("--no-cross-seed")->empty()) {
         options.enable_cross_seeding = profile_options.enable_cross_seeding;
     }
+    if (app->get_option("--hash-cache")->empty()) {
+        options.hash_cache = profile_options.hash_cache;
+    }
+    if (app->get_option("--record-mtimes")->empty()) {
+        options.record_mtimes = profile_options.record_mtimes;
+    }
+    if (app->get_option("--scan-cache")->empty()) {
+        options.scan_cache = profile_options.scan_cache;
+    }
     if (app->get_option("--similar")->empty()) {
         options.similar_torrents = profile_options.similar_torrents;
     }
@@ -10,6 +10,10 @@
 #include "edit.hpp"
 #include "config_parser.hpp"
 #include "exceptions.hpp"
+#include "hashed_file.hpp"
+#include "merkle.hpp"
+#include "per_file_hasher.hpp"
+#include "piece_layout.hpp"
 
 namespace dt = dottorrent;
 namespace fs = std::filesystem;
@@ -55,6 +59,30 @@ void configure_edit_app(CLI::App* app, edit_app_options& options)
         return true;
     };
 
+    CLI::callback_t data_directory_parser = [&](const CLI::results_t& v) -> bool {
+        options.data_directory = path_transformer(v);
+        return true;
+    };
+
+    CLI::callback_t piece_size_parser = [&](const CLI::results_t& v) -> bool {
+        options.piece_size = piece_size_transformer(v);
+        if (!options.piece_size) {
+            throw std::invalid_argument("--piece-size: an explicit piece size is required.");
+        }
+        return true;
+    };
+
+    CLI::callback_t rename_parser = [&](const CLI::results_t& v) -> bool {
+        for (const auto& s : v) {
+            auto pos = s.find('=');
+            if (pos == std::string::npos || pos == 0 || pos + 1 == s.size()) {
+                throw std::invalid_argument(fmt::format("--rename: expected <old-path>=<new-path>, got: {}", s));
+            }
+            options.renames.emplace_back(fs::path(s.substr(0, pos)), fs::path(s.substr(pos + 1)));
+        }
+        return true;
+    };
+
     CLI::callback_t similar_parser = [&](const CLI::results_t& v) -> bool {
         options.similar_torrents = similar_transformer("--similar", v);
         return true;
@@ -182,6 +210,34 @@ void configure_edit_app(CLI::App* app, edit_app_options& options)
             ->type_name("<infohash|metafile>...")
             ->expected(0, max_size);
 
+    app->add_option("--data", data_directory_parser,
+                    "Directory with the files of the torrent.\n"
+                    "Required to hash files added with --add-file.")
+            ->type_name("<path>")
+            ->expected(1);
+
+    app->add_option("--add-file", options.add_files,
+                    "Add files to a v2 or hybrid metafile.\n"
+                    "Paths are relative to the directory given by --data.")
+            ->type_name("<path>...")
+            ->expected(0, max_size);
+
+    app->add_option("--remove-file", options.remove_files,
+                    "Remove files from a v2 or hybrid metafile.")
+            ->type_name("<path>...")
+            ->expected(0, max_size);
+
+    app->add_option("--rename", rename_parser,
+                    "Rename or move files in a v2 or hybrid metafile.")
+            ->type_name("<old-path=new-path>...")
+            ->expected(0, max_size);
+
+    app->add_option("-l,--piece-size", piece_size_parser,
+                    "Increase the piece size of a v2 metafile without reading data.\n"
+                    "Hybrid metafiles require the data given with --data to rehash the v1 pieces.")
+            ->type_name("<size[K|M]>")
+            ->expected(1);
+
     no_created_by_option->excludes(created_by_option);
 
     app->add_option("--profile,-P", options.profile,
@@ -333,6 +389,8 @@ void run_edit_app(const main_app_options& main_options, const edit_app_options&
 
     update_similar_torrents(m, options);
     update_collections(m, options);
+    update_files(m, options);
+    update_piece_size(m, options);
 
     fs::path destination_file = get_destination_path(m, options.destination);
     auto out = std::ostreambuf_iterator(os);
@@ -566,3 +624,113 @@ void update_collections(dt::metafile& m, const edit_app_options& options)
 }
 
 
+void update_files(dt::metafile& m, const edit_app_options& options)
+{
+    if (options.add_files.empty() && options.remove_files.empty() && options.renames.empty()) {
+        return;
+    }
+
+    auto& storage = m.storage();
+    const auto protocol = storage.protocol();
+
+    // v1 pieces span file boundaries, only v2 and aligned hybrid metafiles store independent per file hashes.
+    if (!tt::has_v2(protocol)) {
+        throw std::invalid_argument("Adding, removing or renaming files requires a v2 or hybrid metafile.");
+    }
+    if (storage.file_mode() == dt::file_mode::single) {
+        throw std::invalid_argument("Adding, removing or renaming files requires a multi-file metafile.");
+    }
+    if (tt::has_v1(protocol) && !tt::piece_layout(storage).is_aligned()) {
+        throw std::invalid_argument("Adding, removing or renaming files requires a hybrid metafile with padding files.");
+    }
+
+    auto files = tt::extract_hashed_files(storage, protocol);
+
+    auto find_file = [&](const fs::path& path) {
+        return rng::find_if(files, [&](const auto& f) { return f.path == path.lexically_normal(); });
+    };
+
+    for (const auto& path : options.remove_files) {
+        auto it = find_file(path);
+        if (it == files.end()) {
+            throw std::invalid_argument(fmt::format("File not found in metafile: {}", path.string()));
+        }
+        files.erase(it);
+    }
+
+    for (const auto& [from, to] : options.renames) {
+        auto it = find_file(from);
+        if (it == files.end()) {
+            throw std::invalid_argument(fmt::format("File not found in metafile: {}", from.string()));
+        }
+        if (find_file(to) != files.end()) {
+            throw std::invalid_argument(fmt::format("File already exists in metafile: {}", to.string()));
+        }
+        it->path = to.lexically_normal();
+    }
+
+    if (!options.add_files.empty() && !options.data_directory) {
+        throw std::invalid_argument("--data is required to add files.");
+    }
+    for (const auto& path : options.add_files) {
+        if (find_file(path) != files.end()) {
+            throw std::invalid_argument(fmt::format("File already exists in metafile: {}", path.string()));
+        }
+        auto hashes = tt::hash_file(*options.data_directory / path, protocol, storage.piece_size());
+        files.push_back({path.lexically_normal(), dt::file_attributes {}, std::move(hashes)});
+    }
+
+    if (files.empty()) {
+        throw std::invalid_argument("Cannot remove all files from a metafile.");
+    }
+
+    tt::sort_hashed_files(files);
+    tt::set_hashed_files(storage, std::move(files), protocol, options.data_directory);
+}
+
+
+void update_piece_size(dt::metafile& m, const edit_app_options& options)
+{
+    auto& storage = m.storage();
+
+    if (!options.piece_size || *options.piece_size == storage.piece_size()) {
+        return;
+    }
+
+    const auto protocol = storage.protocol();
+    const auto piece_size = storage.piece_size();
+    const auto new_piece_size = *options.piece_size;
+
+    if (!tt::has_v2(protocol)) {
+        throw std::invalid_argument("The piece size of v1 metafiles can not be changed without creating a new metafile.");
+    }
+    if (new_piece_size < piece_size) {
+        throw std::invalid_argument("The piece size of v2 metafiles can only be increased.");
+    }
+    // v1 pieces can not be derived from the v2 merkle trees
+    if (tt::has_v1(protocol) && !options.data_directory) {
+        throw std::invalid_argument(
+                "Changing the piece size of hybrid metafiles requires rehashing the v1 pieces. "
+                "Pass the data with --data.");
+    }
+
+    // v2 piece layers are inner nodes of the per file merkle trees and can be merged pairwise.
+    auto files = tt::extract_hashed_files(storage, dt::protocol::v2);
+    for (auto& f : files) {
+        auto& hashes = f.hashes;
+        hashes.piece_layer = tt::merge_piece_layer(hashes.piece_layer, piece_size, new_piece_size, hashes.file_size);
+        hashes.piece_size = new_piece_size;
+    }
+    storage.set_piece_size(new_piece_size);
+    tt::set_hashed_files(storage, std::move(files), dt::protocol::v2);
+
+    if (tt::has_v1(protocol)) {
+        if (storage.file_count() > 1) {
+            tt::align_to_pieces(storage);
+        }
+        storage.set_root_directory(*options.data_directory);
+        auto hasher = tt::per_file_hasher(storage, dt::protocol::v1);
+        hasher.start();
+        hasher.wait();
+    }
+}
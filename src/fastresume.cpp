@@ -0,0 +1,141 @@
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <fmt/format.h>
+#include <bencode/encode.hpp>
+
+#include "fastresume.hpp"
+#include "file_hasher.hpp"
+#include "file_stat.hpp"
+
+namespace bc = bencode;
+
+namespace torrenttools {
+
+namespace {
+
+/// libtorrent resume data format identifiers.
+constexpr auto fastresume_format = "libtorrent resume file";
+constexpr std::int64_t fastresume_version = 1;
+
+std::string hex_to_binary(std::string_view hex)
+{
+    std::string out {};
+    out.reserve(hex.size() / 2);
+    for (std::size_t i = 0; i + 1 < hex.size(); i += 2) {
+        out.push_back(static_cast<char>(std::stoi(std::string(hex.substr(i, 2)), nullptr, 16)));
+    }
+    return out;
+}
+
+} // namespace
+
+
+std::filesystem::path fastresume_path(const std::filesystem::path& metafile)
+{
+    return std::filesystem::path(metafile).replace_extension(".fastresume");
+}
+
+std::size_t fastresume_piece_count(const dt::file_storage& storage, dt::protocol protocol)
+{
+    const auto piece_size = storage.piece_size();
+    if (!has_v2(protocol)) {
+        return (storage.total_file_size() + piece_size - 1) / piece_size;
+    }
+    std::size_t count = 0;
+    for (const auto& entry : storage) {
+        if (!entry.is_padding_file()) {
+            count += (entry.file_size() + piece_size - 1) / piece_size;
+        }
+    }
+    return count;
+}
+
+bc::bvalue make_fastresume(const dt::metafile& m, dt::protocol protocol, const std::vector<bool>& have)
+{
+    const auto& storage = m.storage();
+
+    auto root = bc::bvalue::dict_type {};
+    root["file-format"] = fastresume_format;
+    root["file-version"] = fastresume_version;
+
+    if (has_v1(protocol)) {
+        root["info-hash"] = hex_to_binary(dt::info_hash_v1(m).hex_string());
+    }
+    if (has_v2(protocol)) {
+        root["info-hash2"] = hex_to_binary(dt::info_hash_v2(m).hex_string());
+    }
+
+    root["name"] = m.name();
+    // libtorrent stores the files of multi-file torrents in a directory named after the torrent below the save path
+    auto root_directory = std::filesystem::absolute(storage.root_directory()).lexically_normal();
+    if (!root_directory.has_filename()) {
+        root_directory = root_directory.parent_path();
+    }
+    if (storage.file_mode() == dt::file_mode::multi) {
+        root["save_path"] = root_directory.parent_path().string();
+
+        // map the files to a directory with another name, padding files are not stored
+        auto directory_name = root_directory.filename();
+        if (directory_name != std::filesystem::path(m.name())) {
+            auto mapped_files = bc::bvalue::list_type {};
+            for (const auto& entry : storage) {
+                mapped_files.emplace_back(entry.is_padding_file()
+                        ? std::string()
+                        : (directory_name / entry.path()).generic_string());
+            }
+            root["mapped_files"] = std::move(mapped_files);
+        }
+    } else {
+        root["save_path"] = root_directory.string();
+    }
+
+    std::string pieces(have.size(), '\0');
+    for (std::size_t i = 0; i < have.size(); ++i) {
+        pieces[i] = have[i] ? '\1' : '\0';
+    }
+    root["pieces"] = std::move(pieces);
+
+    auto file_sizes = bc::bvalue::list_type {};
+    for (const auto& entry : storage) {
+        std::int64_t file_size = 0;
+        std::int64_t mtime = 0;
+        if (entry.is_padding_file()) {
+            file_size = static_cast<std::int64_t>(entry.file_size());
+        } else {
+            try {
+                auto status = stat_file(storage.root_directory() / entry.path());
+                file_size = static_cast<std::int64_t>(status.file_size);
+                mtime = status.mtime_ns / 1'000'000'000;
+            }
+            catch (const std::filesystem::filesystem_error&) {
+                // missing files are recorded as empty
+            }
+        }
+        file_sizes.emplace_back(bc::bvalue::list_type {file_size, mtime});
+    }
+    root["file sizes"] = std::move(file_sizes);
+
+    root["allocation"] = "sparse";
+    root["paused"] = std::int64_t(0);
+    root["auto_managed"] = std::int64_t(1);
+
+    return bc::bvalue(std::move(root));
+}
+
+void write_fastresume(const std::filesystem::path& path,
+                      const dt::metafile& m,
+                      dt::protocol protocol,
+                      const std::vector<bool>& have)
+{
+    auto data = make_fastresume(m, protocol, have);
+
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        throw std::runtime_error(fmt::format("Could not write resume data: {}", path.string()));
+    }
+    bc::encode_to(ofs, data);
+}
+
+} // namespace torrenttools
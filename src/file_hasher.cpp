@@ -0,0 +1,557 @@
+#include <algorithm>
+#include <bit>
+#include <cerrno>
+#include <fstream>
+#include <limits>
+#include <system_error>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <dottorrent/hasher/factory.hpp>
+
+#include "file_hasher.hpp"
+#include "file_stat.hpp"
+#include "zero_data.hpp"
+
+namespace torrenttools {
+
+namespace {
+
+template <typename Hash>
+Hash digest(dt::hasher& hasher, std::span<const std::byte> data)
+{
+    Hash result {};
+    hasher.update(data);
+    hasher.finalize_to(hash_bytes(result));
+    return result;
+}
+
+constexpr std::size_t min_read_block_size = 1024 * 1024;
+
+/// Files from this size on are checksummed on separate threads,
+/// for smaller files starting the threads costs more than it saves.
+constexpr std::size_t min_threaded_checksum_size = 16 * 1024 * 1024;
+
+} // namespace
+
+
+v2_file_hasher::v2_file_hasher(std::size_t piece_size, bool keep_leaves)
+    : hasher_(dt::make_hasher(dt::hash_function::sha256))
+    , piece_size_(piece_size)
+    , keep_leaves_(keep_leaves)
+{
+    Expects(std::has_single_bit(piece_size));
+    Expects(piece_size >= v2_block_size);
+    block_.reserve(v2_block_size);
+}
+
+void v2_file_hasher::update(std::span<const std::byte> data)
+{
+    file_size_ += data.size();
+
+    while (!data.empty()) {
+        // hash full blocks directly from the input
+        if (block_.empty() && data.size() >= v2_block_size) {
+            add_leaf(data.first(v2_block_size));
+            data = data.subspan(v2_block_size);
+            continue;
+        }
+        auto n = std::min(v2_block_size - block_.size(), data.size());
+        block_.insert(block_.end(), data.begin(), data.begin() + n);
+        data = data.subspan(n);
+
+        if (block_.size() == v2_block_size) {
+            add_leaf(block_);
+            block_.clear();
+        }
+    }
+}
+
+void v2_file_hasher::update_zeros(std::size_t count)
+{
+    const auto piece_leaf_count = piece_size_ / v2_block_size;
+
+    while (count != 0) {
+        if (block_.empty() && leaves_.empty() && count >= piece_size_) {
+            if (keep_leaves_) {
+                all_leaves_.insert(all_leaves_.end(), piece_leaf_count, zero_block_sha256());
+            }
+            piece_layer_.push_back(zero_piece_sha256(piece_size_));
+            file_size_ += piece_size_;
+            count -= piece_size_;
+        }
+        else if (block_.empty() && count >= v2_block_size) {
+            if (keep_leaves_) {
+                all_leaves_.push_back(zero_block_sha256());
+            }
+            leaves_.push_back(zero_block_sha256());
+            file_size_ += v2_block_size;
+            count -= v2_block_size;
+            if (leaves_.size() == piece_leaf_count) {
+                complete_piece();
+            }
+        }
+        else {
+            auto data = zero_bytes(std::min(count, v2_block_size - block_.size()));
+            update(data);
+            count -= data.size();
+        }
+    }
+}
+
+void v2_file_hasher::finalize_to(file_hashes& hashes)
+{
+    // the last block is hashed as is, without padding
+    if (!block_.empty()) {
+        add_leaf(block_);
+        block_.clear();
+    }
+
+    hashes.piece_layer.clear();
+
+    if (file_size_ == 0) {
+        hashes.pieces_root = {};
+    }
+    else if (file_size_ <= piece_size_) {
+        // A file of exactly one piece completed its piece in add_leaf.
+        hashes.pieces_root = piece_layer_.empty()
+                ? merkle_root(leaves_, std::bit_ceil(leaves_.size()))
+                : piece_layer_.front();
+    }
+    else {
+        if (!leaves_.empty()) {
+            complete_piece();
+        }
+        hashes.pieces_root = merkle_root(piece_layer_, std::bit_ceil(piece_layer_.size()),
+                                         piece_size_ / v2_block_size);
+        hashes.piece_layer = std::move(piece_layer_);
+    }
+    hashes.leaves = std::move(all_leaves_);
+
+    file_size_ = 0;
+    leaves_.clear();
+    piece_layer_.clear();
+    all_leaves_.clear();
+}
+
+void v2_file_hasher::add_leaf(std::span<const std::byte> block)
+{
+    if (block.size() == v2_block_size && is_zero(block)) {
+        leaves_.push_back(zero_block_sha256());
+    } else {
+        leaves_.push_back(digest<dt::sha256_hash>(*hasher_, block));
+    }
+    if (keep_leaves_) {
+        all_leaves_.push_back(leaves_.back());
+    }
+
+    if (leaves_.size() == piece_size_ / v2_block_size) {
+        complete_piece();
+    }
+}
+
+void v2_file_hasher::complete_piece()
+{
+    // the last piece of a file is padded with zero leaves to the full piece width
+    piece_layer_.push_back(merkle_root(leaves_, piece_size_ / v2_block_size));
+    leaves_.clear();
+}
+
+
+v1_file_hasher::v1_file_hasher(std::size_t piece_size)
+    : hasher_(dt::make_hasher(dt::hash_function::sha1))
+    , piece_size_(piece_size)
+{
+    Expects(piece_size > 0);
+}
+
+void v1_file_hasher::update(std::span<const std::byte> data)
+{
+    while (!data.empty()) {
+        // hash complete pieces directly from the input
+        if (piece_fill_ == 0 && data.size() >= piece_size_) {
+            pieces_.push_back(hash_piece(data.first(piece_size_)));
+            data = data.subspan(piece_size_);
+            continue;
+        }
+        if (piece_.size() != piece_size_) {
+            piece_.resize(piece_size_);
+        }
+        auto n = std::min(piece_size_ - piece_fill_, data.size());
+        std::copy_n(data.begin(), n, piece_.begin() + piece_fill_);
+        piece_fill_ += n;
+        data = data.subspan(n);
+
+        if (piece_fill_ == piece_size_) {
+            pieces_.push_back(hash_piece(piece_));
+            piece_fill_ = 0;
+        }
+    }
+}
+
+void v1_file_hasher::update_zeros(std::size_t count)
+{
+    while (count != 0) {
+        if (piece_fill_ == 0 && count >= piece_size_) {
+            pieces_.push_back(zero_piece_sha1(piece_size_));
+            count -= piece_size_;
+            continue;
+        }
+        auto data = zero_bytes(std::min(count, piece_size_ - piece_fill_));
+        update(data);
+        count -= data.size();
+    }
+}
+
+dt::sha1_hash v1_file_hasher::hash_piece(std::span<const std::byte> piece)
+{
+    if (is_zero(piece)) {
+        return zero_piece_sha1(piece.size());
+    }
+    return digest<dt::sha1_hash>(*hasher_, piece);
+}
+
+void v1_file_hasher::finalize_to(file_hashes& hashes)
+{
+    hashes.pieces = std::move(pieces_);
+    hashes.tail_piece.reset();
+    hashes.padded_tail_piece.reset();
+
+    if (piece_fill_ != 0) {
+        auto tail = std::span<const std::byte>(piece_).first(piece_fill_);
+        hashes.tail_piece = digest<dt::sha1_hash>(*hasher_, tail);
+        std::fill(piece_.begin() + piece_fill_, piece_.end(), std::byte{0});
+        hashes.padded_tail_piece = digest<dt::sha1_hash>(*hasher_, piece_);
+    }
+
+    pieces_.clear();
+    piece_fill_ = 0;
+}
+
+
+file_hasher::file_hasher(dt::protocol protocol, std::size_t piece_size, bool keep_leaves)
+    : protocol_(protocol)
+    , piece_size_(piece_size)
+{
+    if (has_v1(protocol)) {
+        v1_hasher_.emplace(piece_size);
+    }
+    if (has_v2(protocol)) {
+        v2_hasher_.emplace(piece_size, keep_leaves);
+    }
+}
+
+void file_hasher::update(std::span<const std::byte> data)
+{
+    file_size_ += data.size();
+    if (v1_hasher_) {
+        v1_hasher_->update(data);
+    }
+    if (v2_hasher_) {
+        v2_hasher_->update(data);
+    }
+}
+
+void file_hasher::update_zeros(std::size_t count)
+{
+    file_size_ += count;
+    if (v1_hasher_) {
+        v1_hasher_->update_zeros(count);
+    }
+    if (v2_hasher_) {
+        v2_hasher_->update_zeros(count);
+    }
+}
+
+file_hashes file_hasher::finalize()
+{
+    file_hashes hashes {
+        .protocol = protocol_,
+        .piece_size = piece_size_,
+        .file_size = file_size_,
+    };
+    if (v1_hasher_) {
+        v1_hasher_->finalize_to(hashes);
+    }
+    if (v2_hasher_) {
+        v2_hasher_->finalize_to(hashes);
+    }
+    file_size_ = 0;
+    return hashes;
+}
+
+
+checksum_hasher::checksum_hasher(std::span<const checksum_algorithm> algorithms, bool threaded)
+    : algorithms_(algorithms.begin(), algorithms.end())
+{
+    for (const auto& algorithm : algorithms_) {
+        hashers_.push_back(make_checksum_hasher(algorithm));
+    }
+    if (threaded) {
+        for (std::size_t i = 0; i < hashers_.size(); ++i) {
+            threads_.emplace_back([this, i]() { run(i); });
+        }
+    }
+}
+
+checksum_hasher::~checksum_hasher()
+{
+    {
+        std::scoped_lock lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+}
+
+void checksum_hasher::update(std::span<const std::byte> data)
+{
+    if (threads_.empty()) {
+        for (auto& hasher : hashers_) {
+            hasher->update(data);
+        }
+        return;
+    }
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this]() { return pending_ == 0; });
+    data_ = data;
+    pending_ = threads_.size();
+    ++generation_;
+    lock.unlock();
+    cv_.notify_all();
+}
+
+void checksum_hasher::update_zeros(std::size_t count)
+{
+    while (count != 0) {
+        auto data = zero_bytes(count);
+        update(data);
+        count -= data.size();
+    }
+}
+
+void checksum_hasher::wait()
+{
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+file_checksums checksum_hasher::finalize()
+{
+    wait();
+    file_checksums result {};
+    for (std::size_t i = 0; i < algorithms_.size(); ++i) {
+        std::vector<std::byte> value(hashers_[i]->digest_size());
+        hashers_[i]->finalize_to(value);
+        result.emplace(algorithms_[i], std::move(value));
+    }
+    return result;
+}
+
+void checksum_hasher::run(std::size_t index)
+{
+    std::size_t generation = 0;
+    std::unique_lock lock(mutex_);
+
+    while (true) {
+        cv_.wait(lock, [&]() { return stop_ || generation_ != generation; });
+        if (stop_) {
+            return;
+        }
+        generation = generation_;
+        auto data = data_;
+        lock.unlock();
+
+        hashers_[index]->update(data);
+
+        lock.lock();
+        if (--pending_ == 0) {
+            cv_.notify_all();
+        }
+    }
+}
+
+
+file_hashes hash_file(const fs::path& path,
+                      dt::protocol protocol,
+                      std::size_t piece_size,
+                      std::atomic_size_t* bytes_done,
+                      bool keep_leaves,
+                      std::span<const checksum_algorithm> checksums,
+                      std::size_t io_block_size)
+{
+    return hash_file_range(path, protocol, piece_size, 0, std::numeric_limits<std::size_t>::max(),
+                           bytes_done, keep_leaves, checksums, io_block_size);
+}
+
+
+file_hashes hash_file_range(const fs::path& path,
+                            dt::protocol protocol,
+                            std::size_t piece_size,
+                            std::size_t offset,
+                            std::size_t length,
+                            std::atomic_size_t* bytes_done,
+                            bool keep_leaves,
+                            std::span<const checksum_algorithm> checksums,
+                            std::size_t io_block_size)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        throw fs::filesystem_error("could not open file", path, std::error_code(errno, std::generic_category()));
+    }
+
+    const auto end = length > std::numeric_limits<std::size_t>::max() - offset
+            ? std::numeric_limits<std::size_t>::max()
+            : offset + length;
+
+    file_hasher hasher(protocol, piece_size, keep_leaves);
+    std::vector<std::byte> buffer(std::max({piece_size, min_read_block_size, io_block_size}));
+
+    // The checksum threads hash a block while the next one is read into the other buffer.
+    const auto file_size = static_cast<std::size_t>(fs::file_size(path));
+    const auto threaded_checksums = !checksums.empty() &&
+            std::min(file_size, end) - std::min(file_size, offset) >= min_threaded_checksum_size;
+    checksum_hasher checksummer(checksums, threaded_checksums);
+    std::vector<std::byte> next_buffer(threaded_checksums ? buffer.size() : 0);
+
+    // Holes are hashed as zeros without reading them.
+    auto holes = find_holes(path);
+    auto next_hole = std::find_if(holes.begin(), holes.end(),
+                                  [=](const file_range& hole) { return hole.offset + hole.length > offset; });
+    std::size_t position = offset;
+    ifs.seekg(static_cast<std::streamoff>(position));
+
+    while (ifs && position < end) {
+        if (next_hole != holes.end() && position >= next_hole->offset) {
+            auto hole_end = std::min<std::size_t>(next_hole->offset + next_hole->length, end);
+            auto count = hole_end - position;
+            hasher.update_zeros(count);
+            checksummer.update_zeros(count);
+            position = hole_end;
+            ifs.seekg(static_cast<std::streamoff>(position));
+            if (bytes_done != nullptr) {
+                bytes_done->fetch_add(count, std::memory_order_relaxed);
+            }
+            ++next_hole;
+            continue;
+        }
+        auto read_size = std::min(buffer.size(), end - position);
+        if (next_hole != holes.end()) {
+            read_size = std::min<std::size_t>(read_size, next_hole->offset - position);
+        }
+        ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(read_size));
+        auto count = static_cast<std::size_t>(ifs.gcount());
+        if (count == 0) {
+            break;
+        }
+        auto data = std::span(buffer).first(count);
+        checksummer.update(data);
+        hasher.update(data);
+        position += count;
+
+        if (threaded_checksums) {
+            std::swap(buffer, next_buffer);
+        }
+        if (bytes_done != nullptr) {
+            bytes_done->fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+    checksummer.wait();
+    if (ifs.bad()) {
+        throw fs::filesystem_error("could not read file", path, std::make_error_code(std::errc::io_error));
+    }
+    auto hashes = hasher.finalize();
+    hashes.checksums = checksummer.finalize();
+    return hashes;
+}
+
+
+file_hashes merge_file_hashes(std::span<const file_hashes> parts)
+{
+    Expects(!parts.empty());
+
+    const auto protocol = parts.front().protocol;
+    const auto piece_size = parts.front().piece_size;
+    const auto piece_leaves = piece_size / v2_block_size;
+
+    file_hashes result {
+        .protocol = protocol,
+        .piece_size = piece_size,
+    };
+    std::vector<dt::sha256_hash> layer {};
+    std::optional<dt::sha256_hash> small_file_root {};
+
+    for (std::size_t i = 0; i < parts.size(); ++i) {
+        const auto& part = parts[i];
+        Expects(part.protocol == protocol && part.piece_size == piece_size);
+        Expects(i + 1 == parts.size() || part.file_size % piece_size == 0);
+
+        result.file_size += part.file_size;
+        if (has_v1(protocol)) {
+            result.pieces.insert(result.pieces.end(), part.pieces.begin(), part.pieces.end());
+        }
+        result.leaves.insert(result.leaves.end(), part.leaves.begin(), part.leaves.end());
+        if (!has_v2(protocol) || part.file_size == 0) {
+            continue;
+        }
+        if (part.file_size > piece_size) {
+            layer.insert(layer.end(), part.piece_layer.begin(), part.piece_layer.end());
+        } else {
+            // the root of a range of at most one piece is not padded to a full piece
+            auto node = part.pieces_root;
+            auto leaves = (part.file_size + v2_block_size - 1) / v2_block_size;
+            for (auto width = std::bit_ceil(leaves); width < piece_leaves; width *= 2) {
+                node = merkle_hash_pair(node, merkle_pad_hash(width));
+            }
+            layer.push_back(node);
+            small_file_root = part.pieces_root;
+        }
+    }
+
+    result.tail_piece = parts.back().tail_piece;
+    result.padded_tail_piece = parts.back().padded_tail_piece;
+
+    if (has_v2(protocol) && result.file_size != 0) {
+        if (result.file_size <= piece_size) {
+            result.pieces_root = *small_file_root;
+        } else {
+            result.pieces_root = merkle_root(layer, std::bit_ceil(layer.size()), piece_leaves);
+            result.piece_layer = std::move(layer);
+        }
+    }
+    return result;
+}
+
+
+void hash_tail_piece(const fs::path& path, file_hashes& hashes)
+{
+    Expects(hashes.piece_size > 0);
+
+    const auto tail_size = hashes.file_size % hashes.piece_size;
+    if (tail_size == 0) {
+        return;
+    }
+    if (fs::file_size(path) != hashes.file_size) {
+        throw fs::filesystem_error("file size does not match the metafile", path,
+                                   std::make_error_code(std::errc::invalid_argument));
+    }
+
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        throw fs::filesystem_error("could not open file", path, std::error_code(errno, std::generic_category()));
+    }
+    ifs.seekg(static_cast<std::streamoff>(hashes.file_size - tail_size));
+
+    std::vector<std::byte> buffer(tail_size);
+    ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(tail_size));
+    if (static_cast<std::size_t>(ifs.gcount()) != tail_size) {
+        throw fs::filesystem_error("could not read file", path, std::make_error_code(std::errc::io_error));
+    }
+
+    file_hashes tail {};
+    v1_file_hasher hasher(hashes.piece_size);
+    hasher.update(buffer);
+    hasher.finalize_to(tail);
+    hashes.tail_piece = tail.tail_piece;
+    hashes.padded_tail_piece = tail.padded_tail_piece;
+}
+
+} // namespace torrenttools
@@ -0,0 +1,167 @@
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <system_error>
+
+#include <fmt/format.h>
+
+#include "file_stat.hpp"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/stat.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+#endif
+
+namespace torrenttools {
+
+namespace fs = std::filesystem;
+
+file_stat stat_file(const fs::path& path)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct ::stat st {};
+    if (::stat(path.c_str(), &st) != 0) {
+        throw fs::filesystem_error("stat", path, std::error_code(errno, std::generic_category()));
+    }
+#if defined(__APPLE__)
+    const auto& mtime = st.st_mtimespec;
+#else
+    const auto& mtime = st.st_mtim;
+#endif
+    return {
+        .device = static_cast<std::uint64_t>(st.st_dev),
+        .inode = static_cast<std::uint64_t>(st.st_ino),
+        .file_size = static_cast<std::uint64_t>(st.st_size),
+        .mtime_ns = static_cast<std::int64_t>(mtime.tv_sec) * 1'000'000'000 + mtime.tv_nsec,
+    };
+#else
+    using namespace std::chrono;
+    auto mtime = fs::last_write_time(path).time_since_epoch();
+    return {
+        .file_size = fs::is_directory(path) ? 0 : fs::file_size(path),
+        .mtime_ns = duration_cast<nanoseconds>(mtime).count(),
+    };
+#endif
+}
+
+std::vector<file_range> find_holes(const fs::path& path)
+{
+    std::vector<file_range> holes {};
+#if defined(SEEK_HOLE) && defined(SEEK_DATA)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return {};
+    }
+    const auto end = ::lseek(fd, 0, SEEK_END);
+
+    for (off_t position = 0; position < end;) {
+        auto hole = ::lseek(fd, position, SEEK_HOLE);
+        // the implicit hole at the end of the file is not a real hole
+        if (hole < 0 || hole >= end) {
+            break;
+        }
+        auto data = ::lseek(fd, hole, SEEK_DATA);
+        if (data < 0) {
+            // ENXIO: no more data after the hole
+            data = end;
+        }
+        holes.push_back({static_cast<std::uint64_t>(hole), static_cast<std::uint64_t>(data - hole)});
+        position = data;
+    }
+    ::close(fd);
+#else
+    (void) path;
+#endif
+    return holes;
+}
+
+std::vector<file_extent> query_shared_extents(const fs::path& path)
+{
+    std::vector<file_extent> extents {};
+#if defined(__linux__)
+    constexpr std::size_t batch_size = 64;
+    // Extents which do not map to a stable physical location on disk.
+    constexpr auto unstable_flags = FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DELALLOC | FIEMAP_EXTENT_ENCODED |
+                                    FIEMAP_EXTENT_DATA_INLINE | FIEMAP_EXTENT_DATA_TAIL | FIEMAP_EXTENT_UNWRITTEN;
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return {};
+    }
+
+    // struct fiemap ends with a flexible array of extents
+    constexpr auto buffer_size = sizeof(struct fiemap) + batch_size * sizeof(struct fiemap_extent);
+    std::vector<std::uint64_t> buffer(buffer_size / sizeof(std::uint64_t) + 1);
+    auto* map = reinterpret_cast<struct fiemap*>(buffer.data());
+
+    bool done = false;
+    std::uint64_t start = 0;
+
+    while (!done) {
+        std::fill(buffer.begin(), buffer.end(), 0);
+        map->fm_start = start;
+        map->fm_length = FIEMAP_MAX_OFFSET - start;
+        map->fm_flags = FIEMAP_FLAG_SYNC;
+        map->fm_extent_count = batch_size;
+
+        if (::ioctl(fd, FS_IOC_FIEMAP, map) != 0 || map->fm_mapped_extents == 0) {
+            extents.clear();
+            break;
+        }
+        for (std::size_t i = 0; i < map->fm_mapped_extents; ++i) {
+            const auto& e = map->fm_extents[i];
+            if ((e.fe_flags & FIEMAP_EXTENT_SHARED) == 0 || (e.fe_flags & unstable_flags) != 0) {
+                ::close(fd);
+                return {};
+            }
+            extents.push_back({e.fe_logical, e.fe_physical, e.fe_length});
+            start = e.fe_logical + e.fe_length;
+            done = (e.fe_flags & FIEMAP_EXTENT_LAST) != 0;
+        }
+    }
+    ::close(fd);
+#else
+    (void) path;
+#endif
+    return extents;
+}
+
+storage_device query_storage_device(const fs::path& path)
+{
+    storage_device device {};
+#if defined(__unix__) || defined(__APPLE__)
+    struct ::stat st {};
+    if (::stat(path.c_str(), &st) != 0) {
+        return device;
+    }
+    device.id = static_cast<std::uint64_t>(st.st_dev);
+#endif
+#if defined(__linux__)
+    // /sys/dev/block/<major>:<minor> links to the device, partitions are a subdirectory of their disk
+    auto sysfs_path = fs::path(fmt::format("/sys/dev/block/{}:{}", major(st.st_dev), minor(st.st_dev)));
+    for (const auto& queue : {sysfs_path / "queue", sysfs_path / ".." / "queue"}) {
+        std::ifstream f(queue / "rotational");
+        int rotational = 0;
+        if (f >> rotational) {
+            device.rotational = rotational != 0;
+            break;
+        }
+    }
+#else
+    (void) path;
+#endif
+    return device;
+}
+
+} // namespace torrenttools
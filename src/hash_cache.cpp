@@ -0,0 +1,244 @@
+#include <charconv>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <string_view>
+
+#include <fmt/format.h>
+#include <bencode/bvalue.hpp>
+#include <bencode/encode.hpp>
+
+#include "hash_cache.hpp"
+#include "hash_encoding.hpp"
+#include "piece_layout.hpp"
+
+namespace bc = bencode;
+
+namespace torrenttools {
+
+namespace {
+
+constexpr std::int64_t hash_cache_version = 1;
+
+std::string encode_key(const hash_cache::key_type& key)
+{
+    return fmt::format("{}:{}:{}:{}:{}", key.device, key.inode, key.file_size, key.mtime_ns, key.piece_size);
+}
+
+template <typename T>
+void parse_key_field(std::string_view& s, T& value)
+{
+    auto [ptr, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc{}) {
+        throw std::invalid_argument("invalid hash cache key");
+    }
+    s.remove_prefix(ptr - s.data());
+    if (!s.empty()) {
+        if (s.front() != ':') {
+            throw std::invalid_argument("invalid hash cache key");
+        }
+        s.remove_prefix(1);
+    }
+}
+
+hash_cache::key_type decode_key(std::string_view s)
+{
+    hash_cache::key_type key {};
+    parse_key_field(s, key.device);
+    parse_key_field(s, key.inode);
+    parse_key_field(s, key.file_size);
+    parse_key_field(s, key.mtime_ns);
+    parse_key_field(s, key.piece_size);
+    if (!s.empty()) {
+        throw std::invalid_argument("invalid hash cache key");
+    }
+    return key;
+}
+
+hash_cache::key_type make_key(const file_stat& status, std::size_t piece_size)
+{
+    return {
+        .device = status.device,
+        .inode = status.inode,
+        .file_size = status.file_size,
+        .mtime_ns = status.mtime_ns,
+        .piece_size = piece_size,
+    };
+}
+
+} // namespace
+
+
+hash_cache::hash_cache(std::filesystem::path path)
+    : path_(std::move(path))
+{}
+
+void hash_cache::load()
+{
+    std::unique_lock lock(mutex_);
+    entries_.clear();
+
+    std::ifstream ifs(path_, std::ios::binary);
+    if (!ifs) {
+        return;
+    }
+
+    // The cache is an optimisation only: silently start over when it cannot be parsed.
+    try {
+        auto bv = bc::decode_value(ifs);
+        if (get_integer(bv.at("version")) != hash_cache_version) {
+            return;
+        }
+
+        for (const auto& [key_string, value] : get_dict(bv.at("files"))) {
+            // skip invalid entries, the other entries are still usable
+            try {
+                auto key = decode_key(key_string);
+                const auto& dict = get_dict(value);
+
+                entry_type entry {
+                    .hashes = decode_file_hashes(dict, key.piece_size, key.file_size),
+                    .last_used = std::chrono::system_clock::time_point(
+                            std::chrono::seconds(get_integer(dict.at("last used")))),
+                };
+                entries_.insert_or_assign(key, std::move(entry));
+            }
+            catch (const std::exception&) {
+                continue;
+            }
+        }
+    }
+    catch (const std::exception&) {
+        entries_.clear();
+    }
+}
+
+void hash_cache::save() const
+{
+    std::shared_lock lock(mutex_);
+
+    const auto now = std::chrono::system_clock::now();
+    auto files = bc::bvalue::dict_type {};
+
+    for (const auto& [key, entry] : entries_) {
+        if (now - entry.last_used > expiry_time) {
+            continue;
+        }
+        auto dict = encode_file_hashes(entry.hashes);
+        dict["last used"] = static_cast<std::int64_t>(
+                std::chrono::duration_cast<std::chrono::seconds>(entry.last_used.time_since_epoch()).count());
+        files[encode_key(key)] = std::move(dict);
+    }
+
+    auto root = bc::bvalue::dict_type {};
+    root["version"] = hash_cache_version;
+    root["files"] = std::move(files);
+
+    // write to a temporary file first so an interrupted write never corrupts the cache
+    auto tmp_path = std::filesystem::path(path_).concat(".tmp");
+    {
+        std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            throw std::invalid_argument(fmt::format("could not write hash cache: {}", tmp_path.string()));
+        }
+        bc::encode_to(ofs, bc::bvalue(std::move(root)));
+    }
+    std::filesystem::rename(tmp_path, path_);
+}
+
+std::optional<file_hashes> hash_cache::find(const file_stat& status,
+                                            std::size_t piece_size,
+                                            dt::protocol protocol,
+                                            bool padded_tail)
+{
+    std::unique_lock lock(mutex_);
+
+    auto it = entries_.find(make_key(status, piece_size));
+    if (it == entries_.end() || (it->second.hashes.protocol & protocol) != protocol) {
+        misses_.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+
+    const auto& hashes = it->second.hashes;
+    if (has_v1(protocol) && status.file_size % piece_size != 0) {
+        const auto& tail = padded_tail ? hashes.padded_tail_piece : hashes.tail_piece;
+        if (!tail.has_value()) {
+            misses_.fetch_add(1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+    }
+
+    it->second.last_used = std::chrono::system_clock::now();
+    hits_.fetch_add(1, std::memory_order_relaxed);
+    return hashes;
+}
+
+void hash_cache::insert(const file_stat& status, const file_hashes& hashes)
+{
+    if (hashes.file_size == 0 || hashes.protocol == dt::protocol::none) {
+        return;
+    }
+
+    std::unique_lock lock(mutex_);
+    auto [it, inserted] = entries_.try_emplace(make_key(status, hashes.piece_size));
+    auto& entry = it->second;
+    entry.last_used = std::chrono::system_clock::now();
+
+    if (inserted) {
+        entry.hashes = hashes;
+        // per-file checksums are not cached
+        entry.hashes.checksums.clear();
+        return;
+    }
+
+    // merge with the hashes of other protocols or the other tail piece variant
+    auto& cached = entry.hashes;
+    if (has_v2(hashes.protocol)) {
+        cached.pieces_root = hashes.pieces_root;
+        cached.piece_layer = hashes.piece_layer;
+    }
+    if (has_v1(hashes.protocol)) {
+        cached.pieces = hashes.pieces;
+        if (hashes.tail_piece) {
+            cached.tail_piece = hashes.tail_piece;
+        }
+        if (hashes.padded_tail_piece) {
+            cached.padded_tail_piece = hashes.padded_tail_piece;
+        }
+    }
+    cached.protocol = cached.protocol | hashes.protocol;
+}
+
+void hash_cache::insert(const dt::file_storage& storage, dt::protocol protocol)
+{
+    piece_layout layout(storage);
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage.at(i);
+        if (entry.is_padding_file() || entry.file_size() == 0) {
+            continue;
+        }
+        // v1 pieces of unaligned files span multiple files and cannot be reused per file
+        auto file_protocol = layout.is_aligned(i) ? protocol : (protocol & dt::protocol::v2);
+        if (file_protocol == dt::protocol::none) {
+            continue;
+        }
+        try {
+            auto status = stat_file(storage.root_directory() / entry.path());
+            if (status.file_size == entry.file_size()) {
+                insert(status, get_file_hashes(storage, layout, i, file_protocol));
+            }
+        }
+        catch (const std::filesystem::filesystem_error&) {
+            continue;
+        }
+    }
+}
+
+std::size_t hash_cache::size() const
+{
+    std::shared_lock lock(mutex_);
+    return entries_.size();
+}
+
+} // namespace torrenttools
@@ -0,0 +1,86 @@
+#include "hash_encoding.hpp"
+
+namespace bc = bencode;
+
+namespace torrenttools {
+
+std::string encode_bitfield(const std::vector<bool>& flags)
+{
+    std::string out((flags.size() + 7) / 8, '\0');
+    for (std::size_t i = 0; i < flags.size(); ++i) {
+        if (flags[i]) {
+            out[i / 8] = static_cast<char>(out[i / 8] | (0x80 >> (i % 8)));
+        }
+    }
+    return out;
+}
+
+std::vector<bool> decode_bitfield(std::string_view data, std::size_t size)
+{
+    if (data.size() != (size + 7) / 8) {
+        throw std::invalid_argument("invalid bitfield length");
+    }
+    std::vector<bool> flags(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        flags[i] = (static_cast<unsigned char>(data[i / 8]) & (0x80 >> (i % 8))) != 0;
+    }
+    return flags;
+}
+
+bc::bvalue::dict_type encode_file_hashes(const file_hashes& hashes)
+{
+    auto dict = bc::bvalue::dict_type {};
+
+    if (has_v2(hashes.protocol)) {
+        dict["pieces root"] = encode_hash(hashes.pieces_root);
+        dict["piece layer"] = encode_hashes(hashes.piece_layer);
+    }
+    if (has_v1(hashes.protocol)) {
+        dict["pieces"] = encode_hashes(hashes.pieces);
+        if (hashes.tail_piece) {
+            dict["tail piece"] = encode_hash(*hashes.tail_piece);
+        }
+        if (hashes.padded_tail_piece) {
+            dict["padded tail piece"] = encode_hash(*hashes.padded_tail_piece);
+        }
+    }
+    return dict;
+}
+
+file_hashes decode_file_hashes(const bc::bvalue::dict_type& dict, std::size_t piece_size, std::size_t file_size)
+{
+    if (piece_size == 0) {
+        throw std::invalid_argument("invalid piece size");
+    }
+    file_hashes hashes { .piece_size = piece_size, .file_size = file_size };
+
+    if (auto it = dict.find("pieces root"); it != dict.end()) {
+        hashes.pieces_root = dt::sha256_hash(get_string(it->second));
+        hashes.piece_layer = decode_hashes<dt::sha256_hash>(get_string(dict.at("piece layer")));
+        // files of at most one piece have no piece layer
+        auto layer_size = file_size > piece_size ? (file_size + piece_size - 1) / piece_size : 0;
+        if (hashes.piece_layer.size() != layer_size) {
+            throw std::invalid_argument("piece layer does not match the file size");
+        }
+        hashes.protocol = hashes.protocol | dt::protocol::v2;
+    }
+    if (auto it = dict.find("pieces"); it != dict.end()) {
+        hashes.pieces = decode_hashes<dt::sha1_hash>(get_string(it->second));
+        if (auto tail = dict.find("tail piece"); tail != dict.end()) {
+            hashes.tail_piece = dt::sha1_hash(get_string(tail->second));
+        }
+        if (auto tail = dict.find("padded tail piece"); tail != dict.end()) {
+            hashes.padded_tail_piece = dt::sha1_hash(get_string(tail->second));
+        }
+        if (hashes.pieces.size() != file_size / piece_size) {
+            throw std::invalid_argument("piece hashes do not match the file size");
+        }
+        if (file_size % piece_size == 0 && (hashes.tail_piece || hashes.padded_tail_piece)) {
+            throw std::invalid_argument("tail piece hash for a file without incomplete piece");
+        }
+        hashes.protocol = hashes.protocol | dt::protocol::v1;
+    }
+    return hashes;
+}
+
+} // namespace torrenttools
@@ -0,0 +1,249 @@
+#include <algorithm>
+#include <cstring>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <fmt/format.h>
+
+#include "hash_index.hpp"
+#include "file_hasher.hpp"
+#include "merkle.hpp"
+#include "piece_layout.hpp"
+
+namespace torrenttools {
+
+namespace {
+
+void put_u32(std::byte* out, std::uint32_t value) noexcept
+{
+    for (std::size_t i = 0; i < 4; ++i) {
+        out[i] = static_cast<std::byte>(value >> (8 * i));
+    }
+}
+
+void put_u64(std::byte* out, std::uint64_t value) noexcept
+{
+    for (std::size_t i = 0; i < 8; ++i) {
+        out[i] = static_cast<std::byte>(value >> (8 * i));
+    }
+}
+
+std::uint64_t get_u64(const std::byte* in) noexcept
+{
+    std::uint64_t value = 0;
+    for (std::size_t i = 0; i < 8; ++i) {
+        value |= std::to_integer<std::uint64_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+std::uint32_t get_u32(const std::byte* in) noexcept
+{
+    std::uint32_t value = 0;
+    for (std::size_t i = 0; i < 4; ++i) {
+        value |= std::to_integer<std::uint32_t>(in[i]) << (8 * i);
+    }
+    return value;
+}
+
+template <typename Hash>
+Hash get_hash(const std::byte* in) noexcept
+{
+    Hash h {};
+    std::copy_n(in, Hash::size_bytes, hash_bytes(h).begin());
+    return h;
+}
+
+template <typename Hash>
+bool is_zero_hash(const Hash& h) noexcept
+{
+    return std::all_of(hash_bytes(h).begin(), hash_bytes(h).end(), [](std::byte b) { return b == std::byte{0}; });
+}
+
+void write_bytes(std::ofstream& ofs, std::span<const std::byte> data)
+{
+    ofs.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+}
+
+} // namespace
+
+
+hash_index_writer::hash_index_writer(std::filesystem::path path, std::size_t file_count)
+    : path_(std::move(path))
+    , tmp_path_(std::filesystem::path(path_).concat(".tmp"))
+    , ofs_(tmp_path_, std::ios::binary | std::ios::trunc)
+    , trees_(file_count)
+{
+    if (!ofs_) {
+        throw std::invalid_argument(fmt::format("could not write hash index: {}", tmp_path_.string()));
+    }
+    // the header is written last, when all offsets are known
+    std::vector<std::byte> header(header_size);
+    write_bytes(ofs_, header);
+}
+
+hash_index_writer::~hash_index_writer()
+{
+    if (!finished_) {
+        ofs_.close();
+        std::error_code ec {};
+        std::filesystem::remove(tmp_path_, ec);
+    }
+}
+
+void hash_index_writer::add_tree(std::size_t index, std::span<const dt::sha256_hash> leaves)
+{
+    Expects(index < trees_.size());
+    if (leaves.empty()) {
+        return;
+    }
+    auto tree = merkle_tree(leaves);
+
+    std::scoped_lock lock(mutex_);
+    trees_[index] = {.leaf_count = leaves.size(), .offset = next_offset_, .node_count = tree.size()};
+    for (const auto& node : tree) {
+        write_bytes(ofs_, hash_bytes(node));
+    }
+    next_offset_ += tree.size() * dt::sha256_hash::size_bytes;
+}
+
+void hash_index_writer::share_tree(std::size_t index, std::size_t source)
+{
+    Expects(index < trees_.size() && source < trees_.size());
+    std::scoped_lock lock(mutex_);
+    trees_[index] = trees_[source];
+}
+
+void hash_index_writer::finish(const dt::metafile& m, dt::protocol protocol)
+{
+    const auto& storage = m.storage();
+    Expects(storage.file_count() == trees_.size());
+
+    const auto file_table_offset = next_offset_;
+    std::vector<std::byte> entry(file_entry_size);
+    for (std::size_t i = 0; i < trees_.size(); ++i) {
+        const auto& tree = trees_[i];
+        put_u64(entry.data(), storage.at(i).file_size());
+        put_u64(entry.data() + 8, tree.leaf_count);
+        put_u64(entry.data() + 16, tree.offset);
+        put_u64(entry.data() + 24, tree.node_count);
+        write_bytes(ofs_, entry);
+    }
+
+    const auto pieces_offset = file_table_offset + trees_.size() * file_entry_size;
+    const auto piece_count = has_v1(protocol) ? piece_layout(storage).piece_count() : 0;
+    for (std::size_t i = 0; i < piece_count; ++i) {
+        write_bytes(ofs_, hash_bytes(storage.get_piece_hash(i)));
+    }
+
+    std::vector<std::byte> header(header_size);
+    std::copy_n(reinterpret_cast<const std::byte*>(magic), sizeof(magic), header.begin());
+    put_u32(header.data() + 8, version);
+    put_u32(header.data() + 12, (has_v1(protocol) ? 1 : 0) | (has_v2(protocol) ? 2 : 0));
+    put_u64(header.data() + 16, storage.piece_size());
+    put_u64(header.data() + 24, storage.file_count());
+    put_u64(header.data() + 32, piece_count);
+    put_u64(header.data() + 40, file_table_offset);
+    put_u64(header.data() + 48, pieces_offset);
+    if (has_v2(protocol)) {
+        auto info_hash = dt::info_hash_v2(m);
+        std::copy_n(hash_bytes(info_hash).begin(), dt::sha256_hash::size_bytes, header.begin() + 56);
+    }
+    if (has_v1(protocol)) {
+        auto info_hash = dt::info_hash_v1(m);
+        std::copy_n(hash_bytes(info_hash).begin(), dt::sha1_hash::size_bytes, header.begin() + 88);
+    }
+    ofs_.seekp(0);
+    write_bytes(ofs_, header);
+
+    ofs_.close();
+    if (!ofs_) {
+        throw std::runtime_error(fmt::format("could not write hash index: {}", tmp_path_.string()));
+    }
+    std::filesystem::rename(tmp_path_, path_);
+    finished_ = true;
+}
+
+
+hash_index::hash_index(const std::filesystem::path& path)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) {
+        throw std::invalid_argument(fmt::format("could not read hash index: {}", path.string()));
+    }
+    ifs.seekg(0, std::ios::end);
+    data_.resize(static_cast<std::size_t>(ifs.tellg()));
+    ifs.seekg(0);
+    ifs.read(reinterpret_cast<char*>(data_.data()), static_cast<std::streamsize>(data_.size()));
+
+    auto invalid = [&]() {
+        return std::invalid_argument(fmt::format("invalid hash index: {}", path.string()));
+    };
+
+    constexpr auto header_size = hash_index_writer::header_size;
+    constexpr auto file_entry_size = hash_index_writer::file_entry_size;
+
+    if (!ifs || data_.size() < header_size ||
+        std::memcmp(data_.data(), hash_index_writer::magic, sizeof(hash_index_writer::magic)) != 0) {
+        throw invalid();
+    }
+    if (get_u32(data_.data() + 8) != hash_index_writer::version) {
+        throw std::invalid_argument(fmt::format("unsupported hash index version: {}", path.string()));
+    }
+
+    switch (get_u32(data_.data() + 12)) {
+    case 1:  protocol_ = dt::protocol::v1; break;
+    case 2:  protocol_ = dt::protocol::v2; break;
+    case 3:  protocol_ = dt::protocol::hybrid; break;
+    default: throw invalid();
+    }
+    piece_size_ = get_u64(data_.data() + 16);
+    const auto file_count = get_u64(data_.data() + 24);
+    const auto piece_count = get_u64(data_.data() + 32);
+    const auto file_table_offset = get_u64(data_.data() + 40);
+    const auto pieces_offset = get_u64(data_.data() + 48);
+
+    if (file_table_offset > data_.size() || (data_.size() - file_table_offset) / file_entry_size < file_count ||
+        pieces_offset > data_.size() || (data_.size() - pieces_offset) / dt::sha1_hash::size_bytes < piece_count) {
+        throw invalid();
+    }
+
+    if (auto h = get_hash<dt::sha256_hash>(data_.data() + 56); !is_zero_hash(h)) {
+        info_hash_v2_ = h;
+    }
+    if (auto h = get_hash<dt::sha1_hash>(data_.data() + 88); !is_zero_hash(h)) {
+        info_hash_v1_ = h;
+    }
+
+    files_.reserve(file_count);
+    for (std::size_t i = 0; i < file_count; ++i) {
+        const auto* entry = data_.data() + file_table_offset + i * file_entry_size;
+        auto& file = files_.emplace_back(file_entry {
+                .file_size = get_u64(entry),
+                .leaf_count = get_u64(entry + 8),
+                .offset = get_u64(entry + 16),
+                .node_count = get_u64(entry + 24),
+        });
+        if (file.node_count != merkle_tree_size(file.leaf_count) || file.offset > data_.size() ||
+            (data_.size() - file.offset) / dt::sha256_hash::size_bytes < file.node_count) {
+            throw invalid();
+        }
+    }
+
+    pieces_.reserve(piece_count);
+    for (std::size_t i = 0; i < piece_count; ++i) {
+        pieces_.push_back(get_hash<dt::sha1_hash>(data_.data() + pieces_offset + i * dt::sha1_hash::size_bytes));
+    }
+}
+
+std::vector<dt::sha256_hash> hash_index::tree(std::size_t index) const
+{
+    const auto& file = files_.at(index);
+    std::vector<dt::sha256_hash> nodes {};
+    nodes.reserve(file.node_count);
+    for (std::size_t i = 0; i < file.node_count; ++i) {
+        nodes.push_back(get_hash<dt::sha256_hash>(data_.data() + file.offset + i * dt::sha256_hash::size_bytes));
+    }
+    return nodes;
+}
+
+} // namespace torrenttools
@@ -0,0 +1,88 @@
+#include <algorithm>
+
+#include <fmt/format.h>
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "hashed_file.hpp"
+#include "piece_layout.hpp"
+
+namespace torrenttools {
+
+std::vector<hashed_file> extract_hashed_files(const dt::file_storage& storage, dt::protocol protocol)
+{
+    piece_layout layout(storage);
+    std::vector<hashed_file> files {};
+    files.reserve(storage.file_count());
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage.at(i);
+        if (entry.is_padding_file()) {
+            continue;
+        }
+        files.push_back({entry.path(), entry.attributes(), get_file_hashes(storage, layout, i, protocol)});
+    }
+    return files;
+}
+
+void sort_hashed_files(std::vector<hashed_file>& files)
+{
+    std::stable_sort(files.begin(), files.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.path < rhs.path;
+    });
+}
+
+void set_hashed_files(dt::file_storage& storage,
+                      std::vector<hashed_file> files,
+                      dt::protocol protocol,
+                      const std::optional<fs::path>& data_root)
+{
+    const auto piece_size = storage.piece_size();
+    Expects(piece_size > 0);
+
+    // Complete the v1 tail pieces whose variant changes with the new position of the file.
+    if (has_v1(protocol)) {
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            auto& hashes = files[i].hashes;
+            if (hashes.file_size % piece_size == 0) {
+                continue;
+            }
+            bool is_last = (i + 1 == files.size());
+            const auto& tail = is_last ? hashes.tail_piece : hashes.padded_tail_piece;
+            if (tail.has_value()) {
+                continue;
+            }
+            if (!data_root) {
+                throw std::invalid_argument(fmt::format(
+                        "the data of {} is required to rehash its last piece.", files[i].path.string()));
+            }
+            hash_tail_piece(*data_root / files[i].path, hashes);
+        }
+    }
+
+    dt::file_storage result {};
+    result.set_root_directory(storage.root_directory());
+    result.set_file_mode(storage.file_mode());
+    result.set_piece_size(piece_size);
+
+    for (const auto& f : files) {
+        Expects(f.hashes.piece_size == piece_size);
+        result.add_file(dt::file_entry(f.path, f.hashes.file_size, f.attributes));
+    }
+    if (has_v1(protocol) && files.size() > 1) {
+        align_to_pieces(result);
+    }
+    if (has_v1(protocol)) {
+        result.allocate_pieces();
+    }
+
+    piece_layout layout(result);
+    for (std::size_t i = 0, f = 0; i < result.file_count(); ++i) {
+        if (result.at(i).is_padding_file()) {
+            continue;
+        }
+        set_file_hashes(result, layout, i, files[f++].hashes, protocol);
+    }
+    storage = std::move(result);
+}
+
+} // namespace torrenttools
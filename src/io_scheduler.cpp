@@ -0,0 +1,73 @@
+#include <algorithm>
+#include <thread>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "io_scheduler.hpp"
+
+namespace torrenttools {
+
+io_scheduler::io_scheduler(std::size_t threads)
+    : thread_count_(std::max<std::size_t>(threads, 1))
+{}
+
+void io_scheduler::add(std::uint64_t device, std::size_t limit, std::function<void()> job)
+{
+    Expects(limit > 0);
+
+    auto it = std::find_if(devices_.begin(), devices_.end(),
+                           [=](const device_queue& q) { return q.device == device; });
+    if (it == devices_.end()) {
+        it = devices_.insert(devices_.end(), device_queue{.device = device, .limit = limit});
+    }
+    it->jobs.push_back(std::move(job));
+    ++job_count_;
+    ++pending_;
+}
+
+void io_scheduler::run()
+{
+    auto thread_count = std::min(thread_count_, std::max<std::size_t>(pending_, 1));
+    std::vector<std::jthread> workers {};
+    for (std::size_t i = 1; i < thread_count; ++i) {
+        workers.emplace_back(&io_scheduler::work, this);
+    }
+    work();
+}
+
+void io_scheduler::work() noexcept
+{
+    std::unique_lock lock(mutex_);
+
+    while (pending_ != 0) {
+        device_queue* queue = nullptr;
+        for (std::size_t i = 0; i < devices_.size(); ++i) {
+            auto& q = devices_[(next_device_ + i) % devices_.size()];
+            if (!q.jobs.empty() && q.active < q.limit) {
+                queue = &q;
+                next_device_ = (next_device_ + i + 1) % devices_.size();
+                break;
+            }
+        }
+        // all devices with pending jobs are busy
+        if (queue == nullptr) {
+            cv_.wait(lock);
+            continue;
+        }
+
+        auto job = std::move(queue->jobs.front());
+        queue->jobs.pop_front();
+        ++queue->active;
+        --pending_;
+
+        lock.unlock();
+        job();
+        lock.lock();
+
+        --queue->active;
+        cv_.notify_all();
+    }
+    cv_.notify_all();
+}
+
+} // namespace torrenttools
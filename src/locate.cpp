@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <thread>
+
+#include <CLI/App.hpp>
+#include <fmt/format.h>
+#include <dottorrent/metafile.hpp>
+
+#include "locate.hpp"
+#include "argument_parsers.hpp"
+#include "file_hasher.hpp"
+#include "file_matcher.hpp"
+#include "piece_layout.hpp"
+
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+void configure_locate_app(CLI::App* app, locate_app_options& options)
+{
+    CLI::callback_t metafile_parser = [&](const CLI::results_t& v) -> bool {
+        options.metafile = metafile_target_transformer(v);
+        return true;
+    };
+    CLI::callback_t search_root_parser = [&](const CLI::results_t& v) -> bool {
+        options.search_root = path_transformer(v);
+        return true;
+    };
+
+    app->add_option("metafile", metafile_parser, "Metafile to locate the data for.")
+       ->type_name("<metafile>")
+       ->required();
+
+    app->add_option("search-root", search_root_parser, "Directory to search for the files of the metafile.")
+       ->type_name("<path>")
+       ->required();
+
+    app->add_option("--link", options.link_directory,
+               "Recreate the layout of the torrent in given directory with hard links to the located files.\n"
+               "Files on another filesystem are linked with symbolic links.")
+       ->type_name("<path>");
+
+    app->add_option("-t, --threads", options.threads,
+               "Set the number of threads to use for scanning and hashing. [default: 2]")
+       ->type_name("<n>")
+       ->default_val(2);
+}
+
+
+namespace {
+
+/// Run fn(i) for every i in [0, count) on a pool of threads workers.
+template <typename Fn>
+void for_each_parallel(std::size_t count, std::size_t threads, Fn fn)
+{
+    std::atomic_size_t next_index = 0;
+    auto work = [&]() {
+        for (auto i = next_index.fetch_add(1); i < count; i = next_index.fetch_add(1)) {
+            fn(i);
+        }
+    };
+
+    std::vector<std::jthread> workers {};
+    for (std::size_t i = 1; i < threads; ++i) {
+        workers.emplace_back(work);
+    }
+    work();
+}
+
+/// Check if the file at path has the content of the file at index of storage by hashing a single piece.
+/// @returns std::nullopt when the file does not contain a piece that can be checked on its own.
+std::optional<bool> matches_file(const dt::file_storage& storage,
+                                 const tt::piece_layout& layout,
+                                 std::size_t index,
+                                 const fs::path& path)
+{
+    const auto& entry = storage.at(index);
+    const auto piece_size = storage.piece_size();
+    const auto file_size = entry.file_size();
+
+    if (tt::has_v2(storage.protocol())) {
+        if (file_size <= piece_size) {
+            auto hashes = tt::hash_file(path, dt::protocol::v2, piece_size);
+            return hashes.file_size == file_size && hashes.pieces_root == entry.pieces_root();
+        }
+        // check the middle of the file, headers are often shared between files of the same type
+        auto piece = (file_size / piece_size) / 2;
+        auto hashes = tt::hash_file_range(path, dt::protocol::v2, piece_size, piece * piece_size, piece_size);
+        return hashes.file_size == piece_size && hashes.pieces_root == entry.piece_layer().at(piece);
+    }
+
+    // v1 pieces span file boundaries, only pieces entirely within the file can be checked
+    auto file_offset = layout.file_offset(index);
+    auto first = (file_offset + piece_size - 1) / piece_size;
+    auto last = (file_offset + file_size) / piece_size;
+    if (first >= last) {
+        return std::nullopt;
+    }
+    auto piece = first + (last - first) / 2;
+    auto hashes = tt::hash_file_range(path, dt::protocol::v1, piece_size,
+                                      piece * piece_size - file_offset, piece_size);
+    return hashes.pieces.size() == 1 && hashes.pieces.front() == storage.get_piece_hash(piece);
+}
+
+} // namespace
+
+
+size_index build_size_index(const fs::path& root, std::size_t threads)
+{
+    tt::file_matcher matcher {};
+    matcher.include_hidden_files(true);
+    matcher.set_search_root(root);
+    matcher.start();
+    matcher.wait();
+    auto files = matcher.results();
+
+    std::vector<std::optional<std::uint64_t>> sizes(files.size());
+    for_each_parallel(files.size(), std::max<std::size_t>(threads, 1), [&](std::size_t i) {
+        std::error_code ec {};
+        auto size = fs::file_size(files[i], ec);
+        if (!ec) {
+            sizes[i] = size;
+        }
+    });
+
+    size_index index {};
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        if (sizes[i]) {
+            index[*sizes[i]].push_back(std::move(files[i]));
+        }
+    }
+    return index;
+}
+
+
+std::vector<located_file> locate_files(const dt::file_storage& storage,
+                                       const size_index& index,
+                                       std::size_t threads)
+{
+    if (storage.protocol() == dt::protocol::none) {
+        throw std::invalid_argument("Metafile does not contain piece hashes.");
+    }
+
+    tt::piece_layout layout(storage);
+    std::vector<located_file> results(storage.file_count());
+
+    for_each_parallel(storage.file_count(), std::max<std::size_t>(threads, 1), [&](std::size_t i) {
+        const auto& entry = storage.at(i);
+        auto& result = results[i];
+
+        if (entry.is_padding_file() || entry.file_size() == 0) {
+            result.status = locate_status::empty;
+            return;
+        }
+
+        auto it = index.find(entry.file_size());
+        if (it == index.end()) {
+            return;
+        }
+        auto candidates = it->second;
+        result.candidates = candidates.size();
+
+        auto filename = entry.path().filename();
+        std::stable_partition(candidates.begin(), candidates.end(), [&](const fs::path& p) {
+            return p.filename() == filename;
+        });
+
+        for (const auto& candidate : candidates) {
+            std::optional<bool> match {};
+            try {
+                match = matches_file(storage, layout, i, candidate);
+            }
+            catch (const std::exception&) {
+                // unreadable candidates can not be the data of the file
+                continue;
+            }
+            if (!match) {
+                result.status = locate_status::unconfirmed;
+                result.path = candidates.front();
+                return;
+            }
+            if (*match) {
+                result.status = locate_status::found;
+                result.path = candidate;
+                return;
+            }
+        }
+    });
+
+    return results;
+}
+
+
+void link_located_files(const dt::file_storage& storage,
+                        const std::vector<located_file>& results,
+                        const fs::path& destination)
+{
+    Expects(results.size() == storage.file_count());
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage.at(i);
+        const auto& result = results[i];
+        auto link = destination / entry.path();
+
+        if (result.status == locate_status::missing) {
+            continue;
+        }
+        fs::create_directories(link.parent_path());
+
+        if (result.status == locate_status::empty) {
+            if (!fs::exists(link)) {
+                // padding files are created as sparse files, same as the pad command
+                std::ofstream(link, std::ios::binary);
+                fs::resize_file(link, entry.file_size());
+            }
+            continue;
+        }
+
+        if (fs::exists(link)) {
+            if (fs::equivalent(link, *result.path)) {
+                continue;
+            }
+            throw std::runtime_error(fmt::format("Cannot link {}: a different file already exists.", link.string()));
+        }
+
+        std::error_code ec {};
+        fs::create_hard_link(*result.path, link, ec);
+        if (ec) {
+            fs::create_symlink(fs::absolute(*result.path), link);
+        }
+    }
+}
+
+
+void run_locate_app(const main_app_options& main_options, const locate_app_options& options)
+{
+    auto m = dt::load_metafile(options.metafile);
+    const auto& storage = m.storage();
+
+    std::cout << "Scanning search root...\n";
+    auto index = build_size_index(options.search_root, options.threads);
+
+    std::cout << "Locating files...\n";
+    auto results = locate_files(storage, index, options.threads);
+
+    std::size_t found = 0;
+    std::size_t unconfirmed = 0;
+    std::size_t missing = 0;
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage.at(i);
+        const auto& result = results[i];
+
+        switch (result.status) {
+        case locate_status::empty:
+            break;
+        case locate_status::found:
+            ++found;
+            std::cout << fmt::format("found        {} -> {}\n", entry.path().string(), result.path->string());
+            break;
+        case locate_status::unconfirmed:
+            ++unconfirmed;
+            std::cout << fmt::format("unconfirmed  {} -> {}\n", entry.path().string(), result.path->string());
+            break;
+        case locate_status::missing:
+            ++missing;
+            std::cout << fmt::format("missing      {} ({} candidates)\n", entry.path().string(), result.candidates);
+            break;
+        }
+    }
+
+    std::cout << fmt::format("\nFound:               {}\n", found);
+    std::cout << fmt::format("Unconfirmed:         {}\n", unconfirmed);
+    std::cout << fmt::format("Missing:             {}\n", missing);
+
+    if (options.link_directory) {
+        // the files of multi-file torrents are stored in a directory named after the torrent
+        auto destination = *options.link_directory;
+        if (storage.file_mode() == dt::file_mode::multi) {
+            destination /= m.name();
+        }
+        link_located_files(storage, results, destination);
+        std::cout << fmt::format("Links written to: {}\n", destination.string());
+    }
+}
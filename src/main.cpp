@@ -2,12 +2,16 @@
 #include <fmt/format.h>
 
 #include "config.hpp"
+#include "compose.hpp"
 #include "create.hpp"
 #include "edit.hpp"
 #include "info.hpp"
+#include "locate.hpp"
 #include "magnet.hpp"
 #include "pad.hpp"
 #include "show.hpp"
+#include "split.hpp"
+#include "upgrade.hpp"
 #include "verify.hpp"
 #include "help_formatter.hpp"
 #include "main_app.hpp"
@@ -31,6 +35,10 @@ int main(int argc, char** argv) {
     edit_app_options edit_options {};
     magnet_app_options magnet_options {};
     pad_app_options pad_options {};
+    compose_app_options compose_options {};
+    split_app_options split_options {};
+    upgrade_app_options upgrade_options {};
+    locate_app_options locate_options {};
 
     CLI::App app(main_description, PROJECT_NAME);
     app.formatter(std::make_shared<help_formatter>());
@@ -46,6 +54,10 @@ int main(int argc, char** argv) {
     auto edit_app    = app.add_subcommand("edit",   "Edit BitTorrent metafiles.");
     auto magnet_app  = app.add_subcommand("magnet", "Generate a magnet URI for BitTorrent metafiles.");
     auto pad_app     = app.add_subcommand("pad",    "Generate padding files for a BitTorrent metafile.");
+    auto compose_app = app.add_subcommand("compose", "Combine v2 BitTorrent metafiles without reading data.");
+    auto split_app   = app.add_subcommand("split",  "Split a v2 BitTorrent metafile without reading data.");
+    auto upgrade_app = app.add_subcommand("upgrade", "Upgrade a v1 BitTorrent metafile to a hybrid metafile.");
+    auto locate_app  = app.add_subcommand("locate", "Locate the data of a BitTorrent metafile in a directory tree.");
 
 
     configure_info_app(info_app, info_options);
@@ -55,6 +67,10 @@ int main(int argc, char** argv) {
     configure_edit_app(edit_app, edit_options);
     configure_magnet_app(magnet_app, magnet_options);
     configure_pad_app(pad_app, pad_options);
+    configure_compose_app(compose_app, compose_options);
+    configure_split_app(split_app, split_options);
+    configure_upgrade_app(upgrade_app, upgrade_options);
+    configure_locate_app(locate_app, locate_options);
 
     try {
         app.parse(argc, argv);
@@ -82,6 +98,18 @@ int main(int argc, char** argv) {
         else if (app.got_subcommand(pad_app)) {
             run_pad_app(main_options, pad_options);
         }
+        else if (app.got_subcommand(compose_app)) {
+            run_compose_app(main_options, compose_options);
+        }
+        else if (app.got_subcommand(split_app)) {
+            run_split_app(main_options, split_options);
+        }
+        else if (app.got_subcommand(upgrade_app)) {
+            run_upgrade_app(main_options, upgrade_options);
+        }
+        else if (app.got_subcommand(locate_app)) {
+            run_locate_app(main_options, locate_options);
+        }
     }
     catch (const CLI::CallForHelp &e) {
         std::cout << app.help() << std::endl;
@@ -37,6 +37,9 @@ void list_available_checksums()
     for (auto l : list) {
         std::cout << to_string(l) << '\n';
     }
+    for (auto f : torrenttools::fast_checksum_algorithms()) {
+        std::cout << torrenttools::to_string(f) << '\n';
+    }
 }
 
 void print_version()
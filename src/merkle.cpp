@@ -0,0 +1,131 @@
+#include <algorithm>
+#include <bit>
+#include <deque>
+#include <mutex>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <dottorrent/hasher/factory.hpp>
+
+#include "merkle.hpp"
+
+namespace torrenttools {
+
+dt::sha256_hash merkle_hash_pair(const dt::sha256_hash& lhs, const dt::sha256_hash& rhs)
+{
+    thread_local auto hasher = dt::make_hasher(dt::hash_function::sha256);
+
+    dt::sha256_hash result {};
+    hasher->update(hash_bytes(lhs));
+    hasher->update(hash_bytes(rhs));
+    hasher->finalize_to(hash_bytes(result));
+    return result;
+}
+
+const dt::sha256_hash& merkle_pad_hash(std::size_t leaf_count)
+{
+    Expects(std::has_single_bit(leaf_count));
+
+    // pad_hashes[i] is the root of a subtree with 2^i zero leaves.
+    // A deque keeps references to existing elements valid when it grows.
+    static std::deque<dt::sha256_hash> pad_hashes { dt::sha256_hash{} };
+    static std::mutex mutex {};
+
+    const auto depth = static_cast<std::size_t>(std::countr_zero(leaf_count));
+
+    std::scoped_lock lock(mutex);
+    while (pad_hashes.size() <= depth) {
+        const auto& previous = pad_hashes.back();
+        pad_hashes.push_back(merkle_hash_pair(previous, previous));
+    }
+    return pad_hashes[depth];
+}
+
+dt::sha256_hash merkle_root(std::span<const dt::sha256_hash> layer,
+                            std::size_t width,
+                            std::size_t node_leaf_count)
+{
+    Expects(std::has_single_bit(width));
+    Expects(layer.size() <= width);
+
+    std::vector<dt::sha256_hash> nodes(layer.begin(), layer.end());
+
+    while (width > 1) {
+        const auto& pad = merkle_pad_hash(node_leaf_count);
+        std::vector<dt::sha256_hash> parents {};
+        parents.reserve((nodes.size() + 1) / 2);
+
+        for (std::size_t i = 0; i < nodes.size(); i += 2) {
+            const auto& rhs = (i + 1 < nodes.size()) ? nodes[i + 1] : pad;
+            parents.push_back(merkle_hash_pair(nodes[i], rhs));
+        }
+        // a layer consisting only of padding collapses to the pad hash of the layer above
+        if (parents.empty()) {
+            return merkle_pad_hash(node_leaf_count * width);
+        }
+        nodes = std::move(parents);
+        width /= 2;
+        node_leaf_count *= 2;
+    }
+    return nodes.empty() ? merkle_pad_hash(node_leaf_count) : nodes.front();
+}
+
+std::vector<dt::sha256_hash> merkle_tree(std::span<const dt::sha256_hash> leaves)
+{
+    std::vector<dt::sha256_hash> tree {};
+    tree.reserve(merkle_tree_size(leaves.size()));
+    tree.insert(tree.end(), leaves.begin(), leaves.end());
+
+    std::size_t layer_begin = 0;
+    std::size_t layer_size = leaves.size();
+    std::size_t node_leaf_count = 1;
+
+    while (layer_size > 1) {
+        const auto& pad = merkle_pad_hash(node_leaf_count);
+        for (std::size_t i = 0; i < layer_size; i += 2) {
+            // tree grows while adding parents, index instead of holding references
+            auto rhs = (i + 1 < layer_size) ? tree[layer_begin + i + 1] : pad;
+            tree.push_back(merkle_hash_pair(tree[layer_begin + i], rhs));
+        }
+        layer_begin += layer_size;
+        layer_size = (layer_size + 1) / 2;
+        node_leaf_count *= 2;
+    }
+    return tree;
+}
+
+std::size_t merkle_tree_size(std::size_t leaf_count) noexcept
+{
+    std::size_t size = leaf_count;
+    for (; leaf_count > 1; leaf_count = (leaf_count + 1) / 2) {
+        size += (leaf_count + 1) / 2;
+    }
+    return size;
+}
+
+std::vector<dt::sha256_hash> merge_piece_layer(std::span<const dt::sha256_hash> layer,
+                                               std::size_t piece_size,
+                                               std::size_t new_piece_size,
+                                               std::size_t file_size)
+{
+    Expects(std::has_single_bit(piece_size) && piece_size >= v2_block_size);
+    Expects(std::has_single_bit(new_piece_size) && new_piece_size >= piece_size);
+
+    if (file_size <= new_piece_size) {
+        return {};
+    }
+    Expects(layer.size() == (file_size + piece_size - 1) / piece_size);
+
+    const auto group_size = new_piece_size / piece_size;
+    const auto node_leaf_count = piece_size / v2_block_size;
+
+    std::vector<dt::sha256_hash> result {};
+    result.reserve((layer.size() + group_size - 1) / group_size);
+
+    for (std::size_t i = 0; i < layer.size(); i += group_size) {
+        auto count = std::min(group_size, layer.size() - i);
+        result.push_back(merkle_root(layer.subspan(i, count), group_size, node_leaf_count));
+    }
+    return result;
+}
+
+} // namespace torrenttools
@@ -0,0 +1,157 @@
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <bencode/bvalue.hpp>
+#include <bencode/encode.hpp>
+
+#include "metafile_extras.hpp"
+#include "file_stat.hpp"
+
+namespace bc = bencode;
+
+namespace torrenttools {
+
+namespace {
+
+bc::bvalue encode_checksums(const fast_checksum_table& checksums)
+{
+    auto table = bc::bvalue::dict_type {};
+    for (const auto& [f, files] : checksums) {
+        auto values = bc::bvalue::dict_type {};
+        for (const auto& [path, value] : files) {
+            values[path] = std::string(reinterpret_cast<const char*>(value.data()), value.size());
+        }
+        table[std::string(to_string(f))] = std::move(values);
+    }
+    return table;
+}
+
+fast_checksum_table decode_checksums(const bc::bvalue& bv)
+{
+    fast_checksum_table table {};
+    for (const auto& [name, files] : get_dict(bv)) {
+        // checksums of algorithms added by later versions are skipped
+        auto f = make_fast_checksum(name);
+        if (!f) {
+            continue;
+        }
+        auto& values = table[*f];
+        for (const auto& [path, value] : get_dict(files)) {
+            const auto& s = get_string(value);
+            auto* bytes = reinterpret_cast<const std::byte*>(s.data());
+            values.emplace(path, std::vector<std::byte>(bytes, bytes + s.size()));
+        }
+    }
+    return table;
+}
+
+bc::bvalue encode_mtimes(const file_mtime_table& mtimes)
+{
+    auto table = bc::bvalue::dict_type {};
+    for (const auto& [path, record] : mtimes) {
+        table[path] = bc::bvalue::list_type {static_cast<std::int64_t>(record.file_size), record.mtime_ns};
+    }
+    return table;
+}
+
+file_mtime_table decode_mtimes(const bc::bvalue& bv)
+{
+    file_mtime_table table {};
+    for (const auto& [path, value] : get_dict(bv)) {
+        const auto& fields = get_list(value);
+        table.emplace(path, file_mtime {
+                .file_size = static_cast<std::uint64_t>(get_integer(fields.at(0))),
+                .mtime_ns = get_integer(fields.at(1)),
+        });
+    }
+    return table;
+}
+
+/// Encode a metafile and add the extras to its root dictionary.
+std::string encode_metafile(const dt::metafile& m, dt::protocol protocol, const metafile_extras& extras)
+{
+    std::ostringstream oss {};
+    dt::write_metafile_to(oss, m, protocol);
+    if (extras.empty()) {
+        return std::move(oss).str();
+    }
+
+    // keys are kept in sorted order, so the info dictionary is encoded exactly as before
+    auto bv = bc::decode_value(oss.str());
+    auto& root = get_dict(bv);
+    if (!extras.checksums.empty()) {
+        root[std::string(fast_checksums_key)] = encode_checksums(extras.checksums);
+    }
+    if (!extras.mtimes.empty()) {
+        root[std::string(file_mtimes_key)] = encode_mtimes(extras.mtimes);
+    }
+
+    std::ostringstream out {};
+    bc::encode_to(out, bv);
+    return std::move(out).str();
+}
+
+} // namespace
+
+
+file_mtime_table stat_storage_files(const dt::file_storage& storage)
+{
+    file_mtime_table table {};
+    for (const auto& entry : storage) {
+        if (entry.is_padding_file()) {
+            continue;
+        }
+        auto status = stat_file(storage.root_directory() / entry.path());
+        table.emplace(entry.path().generic_string(), file_mtime {
+                .file_size = status.file_size,
+                .mtime_ns = status.mtime_ns,
+        });
+    }
+    return table;
+}
+
+metafile_extras load_metafile_extras(const std::filesystem::path& metafile)
+{
+    std::ifstream ifs(metafile, std::ios::binary);
+    if (!ifs) {
+        throw std::invalid_argument(fmt::format("could not read metafile: {}", metafile.string()));
+    }
+    std::string data(std::istreambuf_iterator<char>{ifs}, std::istreambuf_iterator<char>{});
+    auto bv = bc::decode_value(data);
+
+    metafile_extras extras {};
+    const auto& root = get_dict(bv);
+    if (auto it = root.find(std::string(fast_checksums_key)); it != root.end()) {
+        extras.checksums = decode_checksums(it->second);
+    }
+    if (auto it = root.find(std::string(file_mtimes_key)); it != root.end()) {
+        extras.mtimes = decode_mtimes(it->second);
+    }
+    return extras;
+}
+
+void write_metafile_to(std::ostream& os,
+                       const dt::metafile& m,
+                       dt::protocol protocol,
+                       const metafile_extras& extras)
+{
+    os << encode_metafile(m, protocol, extras);
+}
+
+void save_metafile(const std::filesystem::path& path,
+                   const dt::metafile& m,
+                   dt::protocol protocol,
+                   const metafile_extras& extras)
+{
+    auto data = encode_metafile(m, protocol, extras);
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    if (!ofs) {
+        throw std::runtime_error(fmt::format("Could not write metafile: {}", path.string()));
+    }
+    ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+}
+
+} // namespace torrenttools
@@ -0,0 +1,300 @@
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "multi_hasher.hpp"
+#include "file_stat.hpp"
+
+namespace torrenttools {
+
+namespace {
+
+constexpr std::size_t read_block_size = 4 * 1024 * 1024;
+
+} // namespace
+
+
+multi_hasher::multi_hasher(std::vector<std::pair<dt::file_storage*, dt::protocol>> targets, std::size_t threads)
+{
+    Expects(!targets.empty());
+
+    for (auto [storage, protocol] : targets) {
+        target t {
+            .storage = storage,
+            .protocol = protocol,
+            .layout = piece_layout(*storage),
+        };
+        for (std::size_t i = 0; i < storage->file_count(); ++i) {
+            if (!storage->at(i).is_padding_file()) {
+                t.file_indices.push_back(i);
+            }
+        }
+        if (has_v2(protocol) || storage->file_count() <= 1 || t.layout.is_aligned()) {
+            t.per_file.emplace(protocol, storage->piece_size());
+        } else {
+            Expects(protocol == dt::protocol::v1);
+            t.stream.emplace(storage->piece_size());
+        }
+        targets_.push_back(std::move(t));
+    }
+
+    for (const auto& t : targets_) {
+        if (t.file_indices.size() != targets_.front().file_indices.size()) {
+            throw std::invalid_argument("All storages must contain the same files.");
+        }
+    }
+
+    auto worker_count = std::min(threads, targets_.size());
+    if (worker_count > 1) {
+        for (std::size_t i = 0; i < worker_count; ++i) {
+            workers_.emplace_back([this, i, worker_count]() { run_worker(i, worker_count); });
+        }
+    }
+}
+
+multi_hasher::~multi_hasher()
+{
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    {
+        std::scoped_lock lock(mutex_);
+        stop_ = true;
+    }
+    cv_.notify_all();
+}
+
+void multi_hasher::start()
+{
+    thread_ = std::jthread([this]() {
+        try {
+            run();
+        }
+        catch (...) {
+            error_ = std::current_exception();
+        }
+        // make sure progress reporting terminates
+        bytes_done_.store(targets_.front().storage->total_regular_file_size(), std::memory_order_relaxed);
+        current_file_.store(targets_.front().storage->file_count(), std::memory_order_relaxed);
+    });
+}
+
+void multi_hasher::wait()
+{
+    if (thread_.joinable()) {
+        thread_.join();
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    for (auto& t : targets_) {
+        t.finish();
+    }
+}
+
+std::pair<std::size_t, std::size_t> multi_hasher::current_file_progress() const noexcept
+{
+    return {current_file_.load(std::memory_order_relaxed), current_file_bytes_.load(std::memory_order_relaxed)};
+}
+
+void multi_hasher::run()
+{
+    const auto& primary = targets_.front();
+    const auto file_count = primary.file_indices.size();
+
+    for (auto& buffer : buffers_) {
+        buffer.resize(read_block_size);
+    }
+    std::size_t current_buffer = 0;
+
+    for (std::size_t file = 0; file < file_count; ++file) {
+        const auto& entry = primary.storage->at(primary.file_indices[file]);
+        auto path = primary.storage->root_directory() / entry.path();
+
+        current_file_.store(primary.file_indices[file], std::memory_order_relaxed);
+        current_file_bytes_.store(0, std::memory_order_relaxed);
+
+        for (auto& t : targets_) {
+            t.begin_file(file);
+        }
+
+        if (entry.file_size() != 0) {
+            std::ifstream ifs(path, std::ios::binary);
+            if (!ifs) {
+                throw fs::filesystem_error("could not open file", path,
+                                           std::make_error_code(std::errc::no_such_file_or_directory));
+            }
+            // holes are hashed as zeros without reading them
+            auto holes = find_holes(path);
+            auto next_hole = holes.begin();
+
+            for (std::size_t remaining = entry.file_size(); remaining != 0;) {
+                auto position = entry.file_size() - remaining;
+                if (next_hole != holes.end() && position == next_hole->offset) {
+                    auto n = std::min<std::size_t>(next_hole->length, remaining);
+                    update_all({}, n);
+                    ifs.seekg(static_cast<std::streamoff>(position + n));
+                    remaining -= n;
+                    ++next_hole;
+
+                    bytes_done_.fetch_add(n, std::memory_order_relaxed);
+                    current_file_bytes_.fetch_add(n, std::memory_order_relaxed);
+                    continue;
+                }
+                auto& buffer = buffers_[current_buffer];
+                current_buffer ^= 1;
+                auto n = std::min(remaining, buffer.size());
+                if (next_hole != holes.end()) {
+                    n = std::min<std::size_t>(n, next_hole->offset - position);
+                }
+                ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(n));
+                if (static_cast<std::size_t>(ifs.gcount()) != n) {
+                    throw fs::filesystem_error("unexpected end of file", path,
+                                               std::make_error_code(std::errc::io_error));
+                }
+                update_all(std::span(buffer).first(n));
+                remaining -= n;
+
+                bytes_done_.fetch_add(n, std::memory_order_relaxed);
+                current_file_bytes_.fetch_add(n, std::memory_order_relaxed);
+            }
+        }
+
+        // the hashing threads must be done with the file before it is finalized
+        wait_idle();
+        for (auto& t : targets_) {
+            t.end_file(file);
+        }
+    }
+}
+
+void multi_hasher::update_all(std::span<const std::byte> data, std::size_t zeros)
+{
+    if (workers_.empty()) {
+        for (auto& t : targets_) {
+            if (zeros != 0) {
+                t.update_zeros(zeros);
+            } else {
+                t.update(data);
+            }
+        }
+        return;
+    }
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this]() { return pending_ == 0; });
+    data_ = data;
+    zeros_ = zeros;
+    pending_ = workers_.size();
+    ++generation_;
+    lock.unlock();
+    cv_.notify_all();
+}
+
+void multi_hasher::wait_idle()
+{
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this]() { return pending_ == 0; });
+}
+
+void multi_hasher::run_worker(std::size_t index, std::size_t stride)
+{
+    std::size_t generation = 0;
+    std::unique_lock lock(mutex_);
+
+    while (true) {
+        cv_.wait(lock, [&]() { return stop_ || generation_ != generation; });
+        if (stop_) {
+            return;
+        }
+        generation = generation_;
+        auto data = data_;
+        auto zeros = zeros_;
+        lock.unlock();
+
+        for (auto i = index; i < targets_.size(); i += stride) {
+            if (zeros != 0) {
+                targets_[i].update_zeros(zeros);
+            } else {
+                targets_[i].update(data);
+            }
+        }
+
+        lock.lock();
+        if (--pending_ == 0) {
+            cv_.notify_all();
+        }
+    }
+}
+
+
+void multi_hasher::target::begin_file(std::size_t file)
+{
+    if (!stream) {
+        return;
+    }
+    // hash the padding files between the previous file and this one
+    auto first = file == 0 ? 0 : file_indices[file - 1] + 1;
+    for (auto i = first; i < file_indices[file]; ++i) {
+        stream->update_zeros(storage->at(i).file_size());
+    }
+}
+
+void multi_hasher::target::update(std::span<const std::byte> data)
+{
+    if (per_file) {
+        per_file->update(data);
+    } else {
+        stream->update(data);
+    }
+}
+
+void multi_hasher::target::update_zeros(std::size_t count)
+{
+    if (per_file) {
+        per_file->update_zeros(count);
+    } else {
+        stream->update_zeros(count);
+    }
+}
+
+void multi_hasher::target::end_file(std::size_t file)
+{
+    if (per_file) {
+        file_results.push_back(per_file->finalize());
+        return;
+    }
+    // trailing padding files
+    if (file + 1 == file_indices.size()) {
+        for (auto i = file_indices[file] + 1; i < storage->file_count(); ++i) {
+            stream->update_zeros(storage->at(i).file_size());
+        }
+    }
+}
+
+void multi_hasher::target::finish()
+{
+    if (has_v1(protocol)) {
+        storage->allocate_pieces();
+    }
+
+    if (per_file) {
+        for (std::size_t file = 0; file < file_results.size(); ++file) {
+            set_file_hashes(*storage, layout, file_indices[file], file_results[file], protocol);
+        }
+        return;
+    }
+
+    file_hashes hashes {};
+    stream->finalize_to(hashes);
+    if (hashes.tail_piece) {
+        hashes.pieces.push_back(*hashes.tail_piece);
+    }
+    for (std::size_t i = 0; i < hashes.pieces.size(); ++i) {
+        storage->set_piece_hash(i, hashes.pieces[i]);
+    }
+}
+
+} // namespace torrenttools
@@ -0,0 +1,365 @@
+#include <algorithm>
+#include <system_error>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "per_file_hasher.hpp"
+#include "hash_cache.hpp"
+#include "checkpoint.hpp"
+#include "file_stat.hpp"
+#include "hash_index.hpp"
+
+namespace torrenttools {
+
+per_file_hasher::per_file_hasher(dt::file_storage& storage, dt::protocol protocol, std::size_t threads)
+    : storage_(storage)
+    , layout_(storage)
+    , protocol_(protocol)
+    , thread_count_(std::max<std::size_t>(threads, 1))
+    , split_size_(default_split_size)
+    , file_bytes_done_(std::make_unique<std::atomic_size_t[]>(storage.file_count()))
+    , results_(storage.file_count())
+{
+    Expects(protocol != dt::protocol::none);
+    Expects(!has_v1(protocol) || storage.file_count() <= 1 || layout_.is_aligned());
+}
+
+void per_file_hasher::set_shared_files(std::vector<std::optional<std::size_t>> shared)
+{
+    Expects(shared.size() == storage_.file_count());
+    shared_ = std::move(shared);
+}
+
+void per_file_hasher::start()
+{
+    Expects(workers_.empty());
+
+    plan_work();
+    auto thread_count = std::min(thread_count_, std::max<std::size_t>(work_.size(), 1));
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this]() { run(); });
+    }
+}
+
+void per_file_hasher::wait()
+{
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+
+    // Copy the hashes of shared files, completing the tail piece variant it needs when taken from the cache.
+    for (std::size_t i = 0; i < shared_.size(); ++i) {
+        if (!shared_[i] || !results_[*shared_[i]]) {
+            continue;
+        }
+        auto hashes = *results_[*shared_[i]];
+        if (has_v1(protocol_) && hashes.file_size % storage_.piece_size() != 0) {
+            auto padded_tail = layout_.has_padded_tail(i);
+            if ((padded_tail && !hashes.padded_tail_piece) || (!padded_tail && !hashes.tail_piece)) {
+                hash_tail_piece(storage_.root_directory() / storage_.at(i).path(), hashes);
+            }
+        }
+        results_[i] = std::move(hashes);
+        if (index_ != nullptr) {
+            index_->share_tree(i, *shared_[i]);
+        }
+    }
+
+    if (has_v1(protocol_)) {
+        storage_.allocate_pieces();
+    }
+    for (std::size_t i = 0; i < results_.size(); ++i) {
+        if (!results_[i].has_value()) {
+            continue;
+        }
+        set_file_hashes(storage_, layout_, i, *results_[i], protocol_);
+        for (const auto& [algorithm, value] : results_[i]->checksums) {
+            if (const auto* f = std::get_if<fast_checksum>(&algorithm)) {
+                fast_checksums_[*f].insert_or_assign(storage_.at(i).path().generic_string(), value);
+            }
+        }
+    }
+    results_.clear();
+}
+
+std::size_t per_file_hasher::bytes_done() const noexcept
+{
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+        // v2 and hybrid torrents do not count padding files, v1 torrents do.
+        if (storage_.at(i).is_padding_file() && protocol_ != dt::protocol::v1) {
+            continue;
+        }
+        total += file_bytes_done_[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+std::size_t per_file_hasher::shared_file_count() const noexcept
+{
+    return std::count_if(shared_.begin(), shared_.end(), [](const auto& v) { return v.has_value(); });
+}
+
+std::size_t per_file_hasher::shared_bytes() const noexcept
+{
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < shared_.size(); ++i) {
+        if (shared_[i]) {
+            total += storage_.at(i).file_size();
+        }
+    }
+    return total;
+}
+
+bool per_file_hasher::done() const noexcept
+{
+    return current_file_progress().first == storage_.file_count();
+}
+
+std::pair<std::size_t, std::size_t> per_file_hasher::current_file_progress() const noexcept
+{
+    for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+        auto done = file_bytes_done_[i].load(std::memory_order_relaxed);
+        if (done < storage_.at(i).file_size()) {
+            return {i, done};
+        }
+    }
+    return {storage_.file_count(), 0};
+}
+
+void per_file_hasher::plan_work()
+{
+    const auto piece_size = storage_.piece_size();
+    // ranges must start on a piece boundary
+    const auto part_size = std::max(piece_size, (split_size_ + piece_size - 1) / piece_size * piece_size);
+
+    // With a checkpoint, files are also split with a single thread so completed ranges can be stored.
+    const bool may_split = thread_count_ > 1 || (checkpoint_ != nullptr && index_ == nullptr);
+
+    work_.clear();
+    work_.reserve(storage_.file_count());
+
+    for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+        const auto& entry = storage_.at(i);
+        const auto file_size = entry.file_size();
+        bool is_shared = !shared_.empty() && shared_[i];
+
+        if (!may_split || file_size <= part_size || entry.is_padding_file() || is_shared || !checksums_.empty()) {
+            work_.push_back({.index = i, .offset = 0, .length = file_size});
+            continue;
+        }
+
+        // Stored hashes are looked up before splitting, errors are reported when the file is processed.
+        file_stat status {};
+        try {
+            status = stat_file(storage_.root_directory() / entry.path());
+        }
+        catch (const fs::filesystem_error&) {
+            work_.push_back({.index = i, .offset = 0, .length = file_size});
+            continue;
+        }
+        if (find_file(i, status)) {
+            complete_file(i);
+            continue;
+        }
+
+        const auto part_count = (file_size + part_size - 1) / part_size;
+        auto& split = *split_files_.emplace_back(std::make_unique<split_file>());
+        split.parts.resize(part_count);
+        split.remaining = part_count;
+        split.status = status;
+
+        for (std::size_t part = 0; part < part_count; ++part) {
+            auto offset = part * part_size;
+            work_.push_back({
+                .index = i,
+                .offset = offset,
+                .length = std::min(part_size, file_size - offset),
+                .split = &split,
+                .part = part,
+            });
+        }
+    }
+
+    // Largest first, so the small files fill up the workers at the end.
+    std::stable_sort(work_.begin(), work_.end(),
+                     [](const work_item& lhs, const work_item& rhs) { return lhs.length > rhs.length; });
+}
+
+void per_file_hasher::run()
+{
+    auto record_error = [this]() {
+        std::unique_lock lock(error_mutex_);
+        if (!error_) {
+            error_ = std::current_exception();
+        }
+    };
+
+    for (auto i = next_index_.fetch_add(1); i < work_.size(); i = next_index_.fetch_add(1)) {
+        const auto& item = work_[i];
+        if (slots_ != nullptr) {
+            slots_->acquire();
+        }
+        try {
+            if (item.split == nullptr) {
+                process_file(item.index);
+            } else {
+                process_part(item);
+            }
+        }
+        catch (...) {
+            record_error();
+            if (item.split != nullptr) {
+                item.split->failed = true;
+            }
+        }
+        if (slots_ != nullptr) {
+            slots_->release();
+        }
+
+        // The last range of a split file combines the hashes of all ranges.
+        if (item.split != nullptr) {
+            auto& split = *item.split;
+            if (split.remaining.fetch_sub(1) != 1) {
+                continue;
+            }
+            if (!split.failed) {
+                try {
+                    store_file(item.index, split.status, merge_file_hashes(split.parts));
+                }
+                catch (...) {
+                    record_error();
+                }
+            }
+            split.parts.clear();
+        }
+        // Mark failed files as complete as well, so progress reporting terminates.
+        complete_file(item.index);
+    }
+}
+
+bool per_file_hasher::find_file(std::size_t index, const file_stat& status)
+{
+    if (index_ != nullptr || !checksums_.empty()) {
+        return false;
+    }
+    // hashes of a different size are treated as missing, the file changed since they were stored
+    const auto file_size = storage_.at(index).file_size();
+
+    if (checkpoint_ != nullptr) {
+        if (auto hashes = checkpoint_->find_file(index); hashes && hashes->file_size == file_size) {
+            results_[index] = std::move(*hashes);
+            resumed_files_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+
+    if (cache_ != nullptr) {
+        auto padded_tail = layout_.has_padded_tail(index);
+        auto hashes = status.file_size == file_size
+                ? cache_->find(status, storage_.piece_size(), protocol_, padded_tail)
+                : std::nullopt;
+        if (hashes) {
+            if (checkpoint_ != nullptr) {
+                checkpoint_->add_file(index, *hashes);
+            }
+            results_[index] = std::move(*hashes);
+            cache_hits_.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+    }
+    return false;
+}
+
+void per_file_hasher::process_file(std::size_t index)
+{
+    const auto& entry = storage_.at(index);
+
+    if (entry.is_padding_file()) {
+        return;
+    }
+    // The hashes are copied from the first file with the same data in wait().
+    if (!shared_.empty() && shared_[index]) {
+        return;
+    }
+    if (entry.file_size() == 0) {
+        results_[index] = file_hashes {
+            .protocol = protocol_,
+            .piece_size = storage_.piece_size(),
+            .checksums = checksum_hasher(checksums_, false).finalize(),
+        };
+        return;
+    }
+
+    auto file_path = storage_.root_directory() / entry.path();
+    auto status = stat_file(file_path);
+
+    if (find_file(index, status)) {
+        return;
+    }
+
+    auto hashes = hash_file(file_path, protocol_, storage_.piece_size(), &file_bytes_done_[index],
+                            index_ != nullptr, checksums_, io_block_size_);
+    store_file(index, status, std::move(hashes));
+}
+
+void per_file_hasher::process_part(const work_item& item)
+{
+    // The merkle trees for the index are not stored, ranges are only resumed without an index.
+    if (checkpoint_ != nullptr && index_ == nullptr) {
+        if (auto hashes = checkpoint_->find_file_range(item.index, item.offset);
+                hashes && hashes->file_size == item.length) {
+            file_bytes_done_[item.index].fetch_add(item.length, std::memory_order_relaxed);
+            item.split->parts[item.part] = std::move(*hashes);
+            resumed_ranges_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    auto file_path = storage_.root_directory() / storage_.at(item.index).path();
+    auto hashes = hash_file_range(file_path, protocol_, storage_.piece_size(),
+                                  item.offset, item.length, &file_bytes_done_[item.index], index_ != nullptr,
+                                  {}, io_block_size_);
+    if (hashes.file_size != item.length) {
+        throw fs::filesystem_error("file size changed while hashing", file_path,
+                                   std::make_error_code(std::errc::io_error));
+    }
+    if (checkpoint_ != nullptr && index_ == nullptr) {
+        checkpoint_->add_file_range(item.index, item.offset, hashes);
+    }
+    item.split->parts[item.part] = std::move(hashes);
+}
+
+void per_file_hasher::store_file(std::size_t index, const file_stat& status, file_hashes hashes)
+{
+    const auto& entry = storage_.at(index);
+    if (hashes.file_size != entry.file_size()) {
+        throw fs::filesystem_error("file size changed while hashing", storage_.root_directory() / entry.path(),
+                                   std::make_error_code(std::errc::io_error));
+    }
+
+    if (index_ != nullptr) {
+        index_->add_tree(index, hashes.leaves);
+        // the leaves are only needed for the index, do not keep them in memory until all files are done
+        hashes.leaves = {};
+    }
+    if (cache_ != nullptr) {
+        cache_->insert(status, hashes);
+    }
+    if (checkpoint_ != nullptr) {
+        checkpoint_->add_file(index, hashes);
+    }
+    results_[index] = std::move(hashes);
+}
+
+void per_file_hasher::complete_file(std::size_t index)
+{
+    file_bytes_done_[index].store(storage_.at(index).file_size(), std::memory_order_relaxed);
+}
+
+} // namespace torrenttools
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <optional>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <dottorrent/hasher/factory.hpp>
+
+#include "piece_hasher.hpp"
+#include "piece_reader.hpp"
+#include "checkpoint.hpp"
+#include "zero_data.hpp"
+
+namespace torrenttools {
+
+namespace {
+
+/// Amount of data read by a worker in one go.
+constexpr std::size_t work_item_size = 64 * 1024 * 1024;
+
+} // namespace
+
+
+piece_hasher::piece_hasher(dt::file_storage& storage, std::size_t threads)
+    : storage_(storage)
+    , layout_(storage)
+    , thread_count_(std::max<std::size_t>(threads, 1))
+{}
+
+void piece_hasher::start()
+{
+    Expects(workers_.empty());
+
+    const auto piece_count = layout_.piece_count();
+    const auto piece_size = layout_.piece_size();
+    const auto max_run = std::max<std::size_t>(work_item_size / piece_size, 1);
+    pieces_.resize(piece_count);
+
+    // split the pieces missing from the checkpoint into runs of consecutive pieces
+    std::size_t bytes_resumed = 0;
+    std::optional<std::size_t> run_start {};
+
+    for (std::size_t piece = 0; piece <= piece_count; ++piece) {
+        bool done = false;
+        if (piece < piece_count && checkpoint_ != nullptr) {
+            if (auto hash = checkpoint_->find_piece(piece); hash) {
+                pieces_[piece] = *hash;
+                bytes_resumed += std::min(piece_size, layout_.total_size() - piece * piece_size);
+                ++resumed_pieces_;
+                done = true;
+            }
+        }
+        bool end_run = run_start && (done || piece == piece_count || piece - *run_start == max_run);
+        if (end_run) {
+            work_.emplace_back(*run_start, piece);
+            run_start.reset();
+        }
+        if (!done && piece < piece_count && !run_start) {
+            run_start = piece;
+        }
+    }
+    bytes_done_.store(bytes_resumed, std::memory_order_relaxed);
+
+    auto thread_count = std::min(thread_count_, std::max<std::size_t>(work_.size(), 1));
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this]() { run(); });
+    }
+}
+
+void piece_hasher::wait()
+{
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+
+    storage_.allocate_pieces();
+    for (std::size_t i = 0; i < pieces_.size(); ++i) {
+        storage_.set_piece_hash(i, pieces_[i]);
+    }
+}
+
+std::pair<std::size_t, std::size_t> piece_hasher::current_file_progress() const noexcept
+{
+    auto done = bytes_done();
+    if (done >= layout_.total_size()) {
+        return {storage_.file_count(), 0};
+    }
+    auto index = layout_.file_at(done);
+    return {index, done - layout_.file_offset(index)};
+}
+
+void piece_hasher::run()
+{
+    auto sha1 = dt::make_hasher(dt::hash_function::sha1);
+    piece_reader reader(storage_);
+    const auto piece_size = layout_.piece_size();
+
+    for (auto i = next_item_.fetch_add(1); i < work_.size(); i = next_item_.fetch_add(1)) {
+        auto [first, last] = work_[i];
+        try {
+            reader.read(first, last, [&](std::size_t piece, std::span<const std::byte> data) {
+                if (data.size() == piece_size && is_zero(data)) {
+                    pieces_[piece] = zero_piece_sha1(piece_size);
+                } else {
+                    sha1->update(data);
+                    sha1->finalize_to(hash_bytes(pieces_[piece]));
+                }
+                if (checkpoint_ != nullptr) {
+                    checkpoint_->add_piece(piece, pieces_[piece]);
+                }
+                bytes_done_.fetch_add(data.size(), std::memory_order_relaxed);
+            });
+        }
+        catch (...) {
+            std::unique_lock lock(error_mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            // stop the other workers and let progress reporting terminate
+            next_item_.store(work_.size());
+            bytes_done_.store(layout_.total_size(), std::memory_order_relaxed);
+        }
+    }
+}
+
+} // namespace torrenttools
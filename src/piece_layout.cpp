@@ -0,0 +1,200 @@
+#include <algorithm>
+#include <string>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <dottorrent/checksum.hpp>
+#include <dottorrent/file_entry.hpp>
+
+#include "piece_layout.hpp"
+
+namespace torrenttools {
+
+piece_layout::piece_layout(const dt::file_storage& storage)
+    : piece_size_(storage.piece_size())
+{
+    Expects(piece_size_ > 0);
+
+    offsets_.reserve(storage.file_count());
+    sizes_.reserve(storage.file_count());
+    padding_.reserve(storage.file_count());
+
+    for (const auto& entry : storage) {
+        offsets_.push_back(total_size_);
+        sizes_.push_back(entry.file_size());
+        padding_.push_back(entry.is_padding_file());
+        total_size_ += entry.file_size();
+    }
+}
+
+std::size_t piece_layout::file_at(std::size_t offset) const
+{
+    Expects(offset < total_size_);
+    // empty files share their offset with the next file, take the last file starting at or before offset
+    auto it = std::upper_bound(offsets_.begin(), offsets_.end(), offset);
+    return static_cast<std::size_t>(std::distance(offsets_.begin(), it)) - 1;
+}
+
+std::pair<std::size_t, std::size_t> piece_layout::piece_range(std::size_t index) const
+{
+    auto offset = offsets_.at(index);
+    auto size = sizes_.at(index);
+    auto first = offset / piece_size_;
+
+    if (size == 0) {
+        return {first, first};
+    }
+    return {first, (offset + size + piece_size_ - 1) / piece_size_};
+}
+
+bool piece_layout::is_aligned(std::size_t index) const
+{
+    return sizes_.at(index) == 0 || offsets_.at(index) % piece_size_ == 0;
+}
+
+bool piece_layout::is_aligned() const
+{
+    for (std::size_t i = 0; i < offsets_.size(); ++i) {
+        if (!padding_[i] && !is_aligned(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool piece_layout::has_padded_tail(std::size_t index) const
+{
+    return offsets_.at(index) + sizes_.at(index) != total_size_;
+}
+
+
+void align_to_pieces(dt::file_storage& storage)
+{
+    const auto piece_size = storage.piece_size();
+    Expects(piece_size > 0);
+
+    // index of the last regular file, which does not need padding
+    std::size_t last_regular_file = 0;
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        if (!storage.at(i).is_padding_file()) {
+            last_regular_file = i;
+        }
+    }
+
+    dt::file_storage aligned {};
+    aligned.set_root_directory(storage.root_directory());
+    aligned.set_file_mode(storage.file_mode());
+    aligned.set_piece_size(piece_size);
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage.at(i);
+        if (entry.is_padding_file()) {
+            continue;
+        }
+        // copy the entry to keep its v2 hashes
+        aligned.add_file(entry);
+
+        if (auto remainder = entry.file_size() % piece_size; i != last_regular_file && remainder != 0) {
+            auto padding_size = piece_size - remainder;
+            aligned.add_file(dt::file_entry(fs::path(".pad") / std::to_string(padding_size),
+                                            padding_size,
+                                            dt::file_attributes::padding_file));
+        }
+    }
+    storage = std::move(aligned);
+}
+
+
+void set_file_hashes(dt::file_storage& storage,
+                     const piece_layout& layout,
+                     std::size_t index,
+                     const file_hashes& hashes,
+                     dt::protocol protocol)
+{
+    auto& entry = storage.at(index);
+    Expects(entry.file_size() == hashes.file_size);
+    Expects(storage.piece_size() == hashes.piece_size);
+
+    // fast checksums are not stored in the file entries
+    for (const auto& [algorithm, value] : hashes.checksums) {
+        const auto* function = std::get_if<dt::hash_function>(&algorithm);
+        if (function == nullptr) {
+            continue;
+        }
+        auto checksum = dt::make_checksum_from_algorithm(*function);
+        Expects(checksum->value().size() == value.size());
+        std::copy(value.begin(), value.end(), checksum->value().begin());
+        entry.add_checksum(std::move(checksum));
+    }
+
+    if (hashes.file_size == 0) {
+        return;
+    }
+
+    if (has_v2(protocol)) {
+        Expects(has_v2(hashes.protocol));
+        entry.set_pieces_root(hashes.pieces_root);
+        if (!hashes.piece_layer.empty()) {
+            entry.set_piece_layer(hashes.piece_layer);
+        }
+    }
+
+    if (has_v1(protocol)) {
+        Expects(has_v1(hashes.protocol));
+        Expects(layout.is_aligned(index));
+
+        auto [first, last] = layout.piece_range(index);
+        for (std::size_t i = 0; i < hashes.pieces.size(); ++i) {
+            storage.set_piece_hash(first + i, hashes.pieces[i]);
+        }
+        if (first + hashes.pieces.size() != last) {
+            const auto& tail = layout.has_padded_tail(index) ? hashes.padded_tail_piece : hashes.tail_piece;
+            Expects(tail.has_value());
+            storage.set_piece_hash(last - 1, *tail);
+        }
+    }
+}
+
+
+file_hashes get_file_hashes(const dt::file_storage& storage,
+                            const piece_layout& layout,
+                            std::size_t index,
+                            dt::protocol protocol)
+{
+    const auto& entry = storage.at(index);
+
+    file_hashes hashes {
+        .piece_size = storage.piece_size(),
+        .file_size = entry.file_size(),
+    };
+
+    if (has_v2(protocol) && entry.file_size() != 0) {
+        hashes.pieces_root = entry.pieces_root();
+        hashes.piece_layer = entry.piece_layer();
+        hashes.protocol = hashes.protocol | dt::protocol::v2;
+    }
+
+    if (has_v1(protocol) && layout.is_aligned(index)) {
+        auto [first, last] = layout.piece_range(index);
+        auto complete_pieces = entry.file_size() / storage.piece_size();
+
+        for (std::size_t i = first; i < first + complete_pieces; ++i) {
+            hashes.pieces.push_back(storage.get_piece_hash(i));
+        }
+        if (first + complete_pieces != last) {
+            if (layout.has_padded_tail(index)) {
+                hashes.padded_tail_piece = storage.get_piece_hash(last - 1);
+            } else {
+                hashes.tail_piece = storage.get_piece_hash(last - 1);
+            }
+        }
+        hashes.protocol = hashes.protocol | dt::protocol::v1;
+    }
+
+    for (const auto& [name, checksum] : entry.checksums()) {
+        auto value = checksum->value();
+        hashes.checksums.emplace(checksum->algorithm(), std::vector<std::byte>(value.begin(), value.end()));
+    }
+    return hashes;
+}
+
+} // namespace torrenttools
@@ -0,0 +1,96 @@
+#include <algorithm>
+#include <fstream>
+#include <system_error>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "piece_reader.hpp"
+#include "file_stat.hpp"
+
+namespace torrenttools {
+
+piece_reader::piece_reader(const dt::file_storage& storage)
+    : storage_(storage)
+    , layout_(storage)
+{}
+
+void piece_reader::read(std::size_t first, std::size_t last, const callback_type& callback)
+{
+    Expects(first <= last);
+    Expects(last <= layout_.piece_count());
+
+    if (first == last) {
+        return;
+    }
+
+    const auto piece_size = layout_.piece_size();
+    const auto end = std::min(last * piece_size, layout_.total_size());
+    auto position = first * piece_size;
+    auto piece_index = first;
+    std::size_t fill = 0;
+    buffer_.resize(piece_size);
+
+    for (auto index = layout_.file_at(position); position < end; ++index) {
+        const auto& entry = storage_.at(index);
+        const auto file_offset = layout_.file_offset(index);
+        const auto segment_end = std::min(file_offset + entry.file_size(), end);
+
+        if (position >= segment_end) {
+            continue;
+        }
+
+        std::ifstream ifs {};
+        auto file_path = storage_.root_directory() / entry.path();
+        std::vector<file_range> holes {};
+
+        if (!entry.is_padding_file()) {
+            ifs.open(file_path, std::ios::binary);
+            if (!ifs) {
+                throw fs::filesystem_error("could not open file", file_path,
+                                           std::make_error_code(std::errc::no_such_file_or_directory));
+            }
+            ifs.seekg(static_cast<std::streamoff>(position - file_offset));
+            holes = find_holes(file_path);
+        }
+        auto next_hole = holes.begin();
+
+        while (position < segment_end) {
+            auto n = std::min(piece_size - fill, segment_end - position);
+            auto* data = buffer_.data() + fill;
+            const auto local_offset = position - file_offset;
+
+            while (next_hole != holes.end() && next_hole->offset + next_hole->length <= local_offset) {
+                ++next_hole;
+            }
+            bool in_hole = next_hole != holes.end() && next_hole->offset <= local_offset;
+
+            // padding files and holes read as zeros without reading them
+            if (entry.is_padding_file() || in_hole) {
+                if (in_hole) {
+                    n = std::min<std::size_t>(n, next_hole->offset + next_hole->length - local_offset);
+                    ifs.seekg(static_cast<std::streamoff>(local_offset + n));
+                }
+                std::fill_n(data, n, std::byte {0});
+            }
+            else {
+                if (next_hole != holes.end()) {
+                    n = std::min<std::size_t>(n, next_hole->offset - local_offset);
+                }
+                ifs.read(reinterpret_cast<char*>(data), static_cast<std::streamsize>(n));
+                if (static_cast<std::size_t>(ifs.gcount()) != n) {
+                    throw fs::filesystem_error("unexpected end of file", file_path,
+                                               std::make_error_code(std::errc::io_error));
+                }
+            }
+            fill += n;
+            position += n;
+
+            if (fill == piece_size || position == end) {
+                callback(piece_index++, std::span<const std::byte>(buffer_.data(), fill));
+                fill = 0;
+            }
+        }
+    }
+}
+
+} // namespace torrenttools
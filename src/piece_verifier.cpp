@@ -0,0 +1,419 @@
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <limits>
+#include <optional>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <dottorrent/hasher/factory.hpp>
+
+#include "piece_verifier.hpp"
+#include "piece_reader.hpp"
+#include "file_stat.hpp"
+#include "verify_state.hpp"
+#include "zero_data.hpp"
+
+namespace torrenttools {
+
+namespace {
+
+/// Default amount of data read by a worker in one go.
+constexpr std::size_t default_run_size = 64 * 1024 * 1024;
+
+constexpr std::size_t no_failure = std::numeric_limits<std::size_t>::max();
+
+/// Thrown from the read callback to abort reading when verification stopped.
+struct verification_stopped {};
+
+} // namespace
+
+
+piece_verifier::piece_verifier(const dt::file_storage& storage, dt::protocol protocol, std::size_t threads)
+    : storage_(storage)
+    , protocol_(has_v2(protocol) ? dt::protocol::v2 : dt::protocol::v1)
+    , thread_count_(std::max<std::size_t>(threads, 1))
+    , layout_(storage)
+    , split_size_(default_run_size)
+    , first_failure_(no_failure)
+{
+    const auto piece_size = storage.piece_size();
+
+    if (protocol_ == dt::protocol::v1) {
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            file_offsets_.push_back(layout_.file_offset(i));
+        }
+        total_size_ = layout_.total_size();
+        for (std::size_t piece = 0; piece < layout_.piece_count(); ++piece) {
+            piece_offsets_.push_back(piece * piece_size);
+        }
+    }
+    else {
+        // v2 pieces never span file boundaries and padding files are not hashed
+        std::size_t offset = 0;
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            const auto& entry = storage.at(i);
+            file_offsets_.push_back(offset);
+            if (entry.is_padding_file()) {
+                continue;
+            }
+            for (std::size_t position = 0; position < entry.file_size(); position += piece_size) {
+                piece_offsets_.push_back(offset + position);
+                piece_files_.push_back(i);
+            }
+            offset += entry.file_size();
+        }
+        total_size_ = offset;
+    }
+
+    selection_.assign(piece_count(), true);
+    states_ = std::make_unique<std::atomic_uint8_t[]>(piece_count());
+    failed_files_ = std::make_unique<std::atomic_bool[]>(storage.file_count());
+}
+
+std::size_t piece_verifier::piece_bytes(std::size_t index) const
+{
+    Expects(index < piece_count());
+    const auto offset = piece_offsets_[index];
+    auto end = total_size_;
+    if (protocol_ == dt::protocol::v2) {
+        auto file = piece_files_[index];
+        end = file_offsets_[file] + storage_.at(file).file_size();
+    }
+    return std::min(storage_.piece_size(), end - offset);
+}
+
+std::pair<std::size_t, std::size_t> piece_verifier::file_pieces(std::size_t index) const
+{
+    if (protocol_ == dt::protocol::v1) {
+        return layout_.piece_range(index);
+    }
+    auto [first, last] = std::equal_range(piece_files_.begin(), piece_files_.end(), index);
+    return {static_cast<std::size_t>(first - piece_files_.begin()),
+            static_cast<std::size_t>(last - piece_files_.begin())};
+}
+
+void piece_verifier::set_selection(std::vector<bool> selection)
+{
+    Expects(selection.size() == piece_count());
+    selection_ = std::move(selection);
+}
+
+void piece_verifier::set_fail_fast(fail_fast_mode mode)
+{
+    Expects(mode != fail_fast_mode::file || protocol_ == dt::protocol::v2);
+    fail_fast_ = mode;
+}
+
+void piece_verifier::set_piece_state(std::size_t index, piece_state state)
+{
+    Expects(index < piece_count());
+    states_[index].store(static_cast<std::uint8_t>(state), std::memory_order_relaxed);
+}
+
+void piece_verifier::start()
+{
+    Expects(workers_.empty());
+
+    const auto max_run = std::max<std::size_t>(split_size_ / storage_.piece_size(), 1);
+
+    // split the selected pieces into runs of consecutive pieces of the same file for v2
+    std::size_t bytes_skipped = 0;
+    std::optional<std::size_t> run_start {};
+
+    for (std::size_t piece = 0; piece <= piece_count(); ++piece) {
+        bool selected = piece < piece_count() && selection_[piece];
+        if (piece < piece_count() && !selected) {
+            bytes_skipped += piece_bytes(piece);
+        }
+        bool end_run = run_start && (!selected || piece - *run_start == max_run ||
+                                     (protocol_ == dt::protocol::v2 && piece_files_[piece] != piece_files_[*run_start]));
+        if (end_run) {
+            work_.emplace_back(*run_start, piece);
+            run_start.reset();
+        }
+        if (selected && !run_start) {
+            run_start = piece;
+        }
+    }
+    bytes_done_.store(bytes_skipped, std::memory_order_relaxed);
+
+    // Runs of v2 pieces end at file boundaries, so their size varies with the file sizes.
+    // Verify the largest runs first, so small files fill up the workers at the end.
+    if (protocol_ == dt::protocol::v2) {
+        auto run_bytes = [this](const std::pair<std::size_t, std::size_t>& run) {
+            return piece_offsets_[run.second - 1] + piece_bytes(run.second - 1) - piece_offsets_[run.first];
+        };
+        std::stable_sort(work_.begin(), work_.end(), [&](const auto& lhs, const auto& rhs) {
+            return run_bytes(lhs) > run_bytes(rhs);
+        });
+    }
+
+    auto thread_count = std::min(thread_count_, std::max<std::size_t>(work_.size(), 1));
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this]() { run(); });
+    }
+}
+
+void piece_verifier::wait()
+{
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+std::pair<std::size_t, std::size_t> piece_verifier::current_file_progress() const noexcept
+{
+    auto done = bytes_done();
+    if (done >= total_size_) {
+        return {storage_.file_count(), 0};
+    }
+    // the last file starting before done, files which are empty in the stream share the offset of the next file
+    auto it = std::upper_bound(file_offsets_.begin(), file_offsets_.end(), done);
+    auto index = static_cast<std::size_t>(std::distance(file_offsets_.begin(), it)) - 1;
+    return {index, done - file_offsets_[index]};
+}
+
+std::optional<std::size_t> piece_verifier::first_failure() const noexcept
+{
+    auto piece = first_failure_.load(std::memory_order_relaxed);
+    if (piece == no_failure) {
+        return std::nullopt;
+    }
+    return piece;
+}
+
+std::size_t piece_verifier::piece_file(std::size_t index) const
+{
+    Expects(index < piece_count());
+    if (protocol_ == dt::protocol::v2) {
+        return piece_files_[index];
+    }
+    return layout_.file_at(piece_offsets_[index]);
+}
+
+std::size_t piece_verifier::count(piece_state state) const noexcept
+{
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < piece_count(); ++i) {
+        n += (this->state(i) == state);
+    }
+    return n;
+}
+
+double piece_verifier::percentage(std::size_t index) const
+{
+    const auto& entry = storage_.at(index);
+    if (entry.file_size() == 0) {
+        return 100.0;
+    }
+    const auto file_begin = file_offsets_[index];
+    const auto file_end = file_begin + entry.file_size();
+
+    std::size_t valid_bytes = 0;
+    auto [first, last] = file_pieces(index);
+    for (auto piece = first; piece < last; ++piece) {
+        if (state(piece) != piece_state::valid) {
+            continue;
+        }
+        auto begin = std::max(piece_offsets_[piece], file_begin);
+        auto end = std::min(piece_offsets_[piece] + piece_bytes(piece), file_end);
+        valid_bytes += end - begin;
+    }
+    return 100.0 * static_cast<double>(valid_bytes) / static_cast<double>(entry.file_size());
+}
+
+void piece_verifier::run()
+{
+    std::optional<piece_reader> reader {};
+    std::unique_ptr<dt::hasher> hasher {};
+
+    if (protocol_ == dt::protocol::v1) {
+        reader.emplace(storage_);
+        hasher = dt::make_hasher(dt::hash_function::sha1);
+    } else {
+        hasher = dt::make_hasher(dt::hash_function::sha256);
+    }
+
+    for (auto i = next_item_.fetch_add(1); i < work_.size(); i = next_item_.fetch_add(1)) {
+        auto [first, last] = work_[i];
+        try {
+            if (protocol_ == dt::protocol::v1) {
+                verify_v1(*reader, *hasher, first, last);
+            } else {
+                verify_v2(*hasher, first, last);
+            }
+        }
+        catch (const verification_stopped&) {
+            break;
+        }
+        catch (...) {
+            std::unique_lock lock(error_mutex_);
+            if (!error_) {
+                error_ = std::current_exception();
+            }
+            stop();
+        }
+    }
+}
+
+void piece_verifier::verify_v1(piece_reader& reader, dt::hasher& sha1, std::size_t first, std::size_t last)
+{
+    const auto piece_size = storage_.piece_size();
+    auto next = first;
+
+    auto check = [&](std::size_t piece, std::span<const std::byte> data) {
+        if (stopped_.load(std::memory_order_relaxed)) {
+            throw verification_stopped {};
+        }
+        dt::sha1_hash hash {};
+        if (data.size() == piece_size && is_zero(data)) {
+            hash = zero_piece_sha1(piece_size);
+        } else {
+            sha1.update(data);
+            sha1.finalize_to(hash_bytes(hash));
+        }
+        set_result(piece, hash == storage_.get_piece_hash(piece));
+        next = piece + 1;
+    };
+
+    try {
+        reader.read(first, last, check);
+    }
+    catch (const fs::filesystem_error&) {
+        // A file is missing or truncated, read the remaining pieces one by one
+        // so pieces of other files in the same run are still verified.
+        for (auto piece = next; piece < last && !stopped_.load(std::memory_order_relaxed); ++piece) {
+            try {
+                reader.read(piece, piece + 1, check);
+            }
+            catch (const fs::filesystem_error&) {
+                set_result(piece, false);
+            }
+        }
+    }
+}
+
+void piece_verifier::verify_v2(dt::hasher& sha256, std::size_t first, std::size_t last)
+{
+    const auto piece_size = storage_.piece_size();
+    const auto file_index = piece_files_[first];
+    const auto& entry = storage_.at(file_index);
+    const auto file_offset = file_offsets_[file_index];
+
+    const auto file_path = storage_.root_directory() / entry.path();
+    std::ifstream ifs(file_path, std::ios::binary);
+    bool readable = static_cast<bool>(ifs);
+
+    // blocks in holes of sparse files are zero and are not read
+    std::vector<file_range> holes {};
+    if (readable) {
+        ifs.seekg(static_cast<std::streamoff>(piece_offsets_[first] - file_offset));
+        holes = find_holes(file_path);
+    }
+    auto next_hole = holes.begin();
+    auto is_hole = [&](std::size_t offset, std::size_t length) {
+        while (next_hole != holes.end() && next_hole->offset + next_hole->length <= offset) {
+            ++next_hole;
+        }
+        return next_hole != holes.end() && next_hole->offset <= offset &&
+               offset + length <= next_hole->offset + next_hole->length;
+    };
+
+    std::vector<std::byte> block(v2_block_size);
+    std::vector<dt::sha256_hash> leaves {};
+    leaves.reserve(piece_size / v2_block_size);
+
+    for (auto piece = first; piece < last; ++piece) {
+        if (stopped_.load(std::memory_order_relaxed)) {
+            return;
+        }
+        if (fail_fast_ == fail_fast_mode::file && failed_files_[file_index].load(std::memory_order_relaxed)) {
+            skip(piece, last);
+            return;
+        }
+        const auto size = piece_bytes(piece);
+        leaves.clear();
+
+        for (std::size_t position = 0; readable && position < size; position += v2_block_size) {
+            auto n = std::min(v2_block_size, size - position);
+            auto local_offset = piece_offsets_[piece] - file_offset + position;
+            if (n == v2_block_size && is_hole(local_offset, n)) {
+                leaves.push_back(zero_block_sha256());
+                ifs.seekg(static_cast<std::streamoff>(local_offset + n));
+                continue;
+            }
+            ifs.read(reinterpret_cast<char*>(block.data()), static_cast<std::streamsize>(n));
+            if (static_cast<std::size_t>(ifs.gcount()) != n) {
+                readable = false;
+                break;
+            }
+            auto data = std::span<const std::byte>(block).first(n);
+            if (n == v2_block_size && is_zero(data)) {
+                leaves.push_back(zero_block_sha256());
+            } else {
+                sha256.update(data);
+                sha256.finalize_to(hash_bytes(leaves.emplace_back()));
+            }
+        }
+
+        bool valid = false;
+        if (readable) {
+            // Files larger than a piece are checked against their piece layer, padded to a full piece,
+            // smaller files against their merkle root.
+            if (entry.file_size() > piece_size) {
+                auto local_index = (piece_offsets_[piece] - file_offset) / piece_size;
+                auto root = merkle_root(leaves, piece_size / v2_block_size);
+                valid = root == entry.piece_layer().at(local_index);
+            } else {
+                valid = merkle_root(leaves, std::bit_ceil(leaves.size())) == entry.pieces_root();
+            }
+        }
+        set_result(piece, valid);
+    }
+}
+
+void piece_verifier::set_result(std::size_t piece, bool valid)
+{
+    auto state = valid ? piece_state::valid : piece_state::invalid;
+    states_[piece].store(static_cast<std::uint8_t>(state), std::memory_order_relaxed);
+    verified_pieces_.fetch_add(1, std::memory_order_relaxed);
+    bytes_done_.fetch_add(piece_bytes(piece), std::memory_order_relaxed);
+
+    if (state_ != nullptr) {
+        state_->set_piece(piece, state);
+    }
+    if (valid) {
+        return;
+    }
+
+    auto expected = no_failure;
+    first_failure_.compare_exchange_strong(expected, piece, std::memory_order_relaxed);
+
+    if (fail_fast_ == fail_fast_mode::all) {
+        stop();
+    } else if (fail_fast_ == fail_fast_mode::file) {
+        failed_files_[piece_files_[piece]].store(true, std::memory_order_relaxed);
+    }
+}
+
+void piece_verifier::skip(std::size_t first, std::size_t last)
+{
+    for (auto piece = first; piece < last; ++piece) {
+        bytes_done_.fetch_add(piece_bytes(piece), std::memory_order_relaxed);
+    }
+}
+
+void piece_verifier::stop() noexcept
+{
+    // let the other workers finish their current piece and progress reporting terminate
+    stopped_.store(true, std::memory_order_relaxed);
+    next_item_.store(work_.size());
+    bytes_done_.store(total_size_, std::memory_order_relaxed);
+}
+
+} // namespace torrenttools
@@ -16,6 +16,7 @@ static const std::set<std::string_view> create_config_keys {
         "creation-date",
         "dht-node",
         "exclude",
+        "hash-cache",
         "http-seed",
         "include",
         "include-hidden",
@@ -25,6 +26,7 @@ static const std::set<std::string_view> create_config_keys {
         "piece-size",
         "private",
         "protocol",
+        "scan-cache",
         "set-created-by",
         "set-creation-date",
         "similar",
@@ -158,6 +160,15 @@ profile parse_create_profile(const YAML::Node& profile_data)
         }
     }
 
+    // hash-cache
+    if (auto n = profile_data["hash-cache"]; n) {
+        try {
+            options.hash_cache = path_transformer({n.as<std::string>()}, /*check_exists=*/false);
+        } catch (const YAML::BadConversion& err) {
+            throw profile_error("value type for key hash-cache must be a string");
+        }
+    }
+
     // include
     if (auto n = profile_data["include"]; n) {
         try { options.include_patterns = n.as<std::vector<std::string>>(); }
@@ -232,6 +243,24 @@ profile parse_create_profile(const YAML::Node& profile_data)
         }
     }
 
+    // record-mtimes
+    if (auto n = profile_data["record-mtimes"]; n) {
+        try {
+            options.record_mtimes = n.as<bool>();
+        } catch (const YAML::BadConversion& err) {
+            throw profile_error("value type for key record-mtimes must be a boolean");
+        }
+    }
+
+    // scan-cache
+    if (auto n = profile_data["scan-cache"]; n) {
+        try {
+            options.scan_cache = path_transformer({n.as<std::string>()}, /*check_exists=*/false);
+        } catch (const YAML::BadConversion& err) {
+            throw profile_error("value type for key scan-cache must be a string");
+        }
+    }
+
     // set-created-by
     if (auto n = profile_data["set-created-by"]; n) {
         try {
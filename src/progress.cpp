@@ -35,7 +35,10 @@ namespace tc = termcontrol;
 // TODO: progress plugins for eta rate and timers
 
 
-void run_with_progress(std::ostream& os, dottorrent::storage_hasher& hasher, const dottorrent::metafile& m)
+namespace {
+
+template <typename Hasher>
+void run_hasher_with_progress(std::ostream& os, Hasher& hasher, const dottorrent::metafile& m)
 {
     using namespace std::chrono_literals;
 
@@ -97,7 +100,8 @@ void run_with_progress(std::ostream& os, dottorrent::storage_hasher& hasher, con
 
 
 /// Progress using only carriage return and newline characters.
-void run_with_simple_progress(std::ostream& os, dottorrent::storage_hasher& hasher, const dottorrent::metafile& m)
+template <typename Hasher>
+void run_hasher_with_simple_progress(std::ostream& os, Hasher& hasher, const dottorrent::metafile& m)
 {
     using namespace std::chrono_literals;
 
@@ -150,7 +154,9 @@ void run_with_simple_progress(std::ostream& os, dottorrent::storage_hasher& hash
     print_completion_statistics(os, m, total_duration);
 }
 
-void run_with_progress(std::ostream& os, dottorrent::storage_verifier& verifier, const dottorrent::metafile& m)
+
+template <typename Verifier>
+void run_verifier_with_progress(std::ostream& os, Verifier& verifier, const dottorrent::metafile& m)
 {
     using namespace std::chrono_literals;
 
@@ -212,7 +218,8 @@ void run_with_progress(std::ostream& os, dottorrent::storage_verifier& verifier,
 
 
 /// Progress using only carriage return and newline characters.
-void run_with_simple_progress(std::ostream& os, dottorrent::storage_verifier& verifier, const dottorrent::metafile& m)
+template <typename Verifier>
+void run_verifier_with_simple_progress(std::ostream& os, Verifier& verifier, const dottorrent::metafile& m)
 {
     using namespace std::chrono_literals;
 
@@ -265,6 +272,89 @@ void run_with_simple_progress(std::ostream& os, dottorrent::storage_verifier& ve
     print_completion_statistics(os, m, total_duration);
 }
 
+} // namespace
+
+
+void run_with_progress(std::ostream& os, dottorrent::storage_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_progress(os, hasher, m);
+}
+
+void run_with_simple_progress(std::ostream& os, dottorrent::storage_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_simple_progress(os, hasher, m);
+}
+
+void run_with_progress(std::ostream& os, tt::per_file_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_progress(os, hasher, m);
+}
+
+void run_with_simple_progress(std::ostream& os, tt::per_file_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_simple_progress(os, hasher, m);
+}
+
+void run_with_progress(std::ostream& os, tt::multi_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_progress(os, hasher, m);
+}
+
+void run_with_simple_progress(std::ostream& os, tt::multi_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_simple_progress(os, hasher, m);
+}
+
+void run_with_progress(std::ostream& os, tt::piece_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_progress(os, hasher, m);
+}
+
+void run_with_simple_progress(std::ostream& os, tt::piece_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_simple_progress(os, hasher, m);
+}
+
+void run_with_progress(std::ostream& os, tt::based_on_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_progress(os, hasher, m);
+}
+
+void run_with_simple_progress(std::ostream& os, tt::based_on_hasher& hasher, const dottorrent::metafile& m)
+{
+    run_hasher_with_simple_progress(os, hasher, m);
+}
+
+void run_with_progress(std::ostream& os, dottorrent::storage_verifier& verifier, const dottorrent::metafile& m)
+{
+    run_verifier_with_progress(os, verifier, m);
+}
+
+void run_with_simple_progress(std::ostream& os, dottorrent::storage_verifier& verifier, const dottorrent::metafile& m)
+{
+    run_verifier_with_simple_progress(os, verifier, m);
+}
+
+void run_with_progress(std::ostream& os, tt::piece_verifier& verifier, const dottorrent::metafile& m)
+{
+    run_verifier_with_progress(os, verifier, m);
+}
+
+void run_with_simple_progress(std::ostream& os, tt::piece_verifier& verifier, const dottorrent::metafile& m)
+{
+    run_verifier_with_simple_progress(os, verifier, m);
+}
+
+void run_with_progress(std::ostream& os, tt::web_seed_verifier& verifier, const dottorrent::metafile& m)
+{
+    run_verifier_with_progress(os, verifier, m);
+}
+
+void run_with_simple_progress(std::ostream& os, tt::web_seed_verifier& verifier, const dottorrent::metafile& m)
+{
+    run_verifier_with_simple_progress(os, verifier, m);
+}
+
 
 void print_completion_statistics(std::ostream& os, const dottorrent::metafile& m, std::chrono::system_clock::duration duration)
 {
@@ -0,0 +1,202 @@
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#ifdef TORRENTTOOLS_USE_CURL
+#include <curl/curl.h>
+#endif
+
+#include "config.hpp"
+#include "range_fetcher.hpp"
+
+namespace torrenttools {
+
+#ifdef TORRENTTOOLS_USE_CURL
+
+struct range_fetcher::transfer
+{
+    CURL* handle;
+    request req;
+    std::uint64_t received = 0;
+};
+
+namespace {
+
+std::once_flag curl_init_flag {};
+
+long response_code(CURL* handle)
+{
+    long code = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &code);
+    return code;
+}
+
+/// Servers that do not support range requests return the complete resource with status 200.
+/// That is only the requested data when the range starts at the beginning,
+/// longer responses are aborted by the length check.
+bool is_range_response(long code, std::uint64_t offset)
+{
+    return code == 206 || (code == 200 && offset == 0);
+}
+
+std::size_t write_callback(char* ptr, std::size_t size, std::size_t nmemb, void* userdata)
+{
+    auto* t = static_cast<range_fetcher::transfer*>(userdata);
+    const auto n = size * nmemb;
+
+    // returning less than n aborts the transfer
+    if (!is_range_response(response_code(t->handle), t->req.offset) || t->received + n > t->req.length) {
+        return 0;
+    }
+    t->received += n;
+    t->req.on_data(std::span<const std::byte>(reinterpret_cast<const std::byte*>(ptr), n));
+    return n;
+}
+
+} // namespace
+
+
+range_fetcher::range_fetcher(std::size_t max_transfers, std::size_t max_connections)
+    : max_transfers_(std::max<std::size_t>(max_transfers, 1))
+{
+    std::call_once(curl_init_flag, []() { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    multi_ = curl_multi_init();
+    if (multi_ == nullptr) {
+        throw std::runtime_error("Could not initialize libcurl.");
+    }
+    curl_multi_setopt(multi_, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    curl_multi_setopt(multi_, CURLMOPT_MAX_HOST_CONNECTIONS, static_cast<long>(std::max<std::size_t>(max_connections, 1)));
+}
+
+range_fetcher::~range_fetcher()
+{
+    for (auto& t : active_) {
+        curl_multi_remove_handle(multi_, t->handle);
+        curl_easy_cleanup(t->handle);
+    }
+    for (auto* handle : idle_handles_) {
+        curl_easy_cleanup(handle);
+    }
+    curl_multi_cleanup(multi_);
+}
+
+void range_fetcher::add(std::string url, std::uint64_t offset, std::uint64_t length,
+                        data_callback on_data, done_callback on_done)
+{
+    pending_.push_back({std::move(url), offset, length, std::move(on_data), std::move(on_done)});
+}
+
+void range_fetcher::run()
+{
+    start_pending();
+
+    while (!active_.empty()) {
+        int running = 0;
+        if (auto rc = curl_multi_perform(multi_, &running); rc != CURLM_OK) {
+            throw std::runtime_error(fmt::format("HTTP transfer failed: {}", curl_multi_strerror(rc)));
+        }
+
+        int messages = 0;
+        while (CURLMsg* msg = curl_multi_info_read(multi_, &messages)) {
+            if (msg->msg == CURLMSG_DONE) {
+                finish(msg->easy_handle, msg->data.result);
+            }
+        }
+        // callbacks of completed transfers can add new requests
+        start_pending();
+
+        if (!active_.empty()) {
+            curl_multi_poll(multi_, nullptr, 0, 1000, nullptr);
+        }
+    }
+}
+
+bool range_fetcher::is_supported() noexcept
+{
+    return true;
+}
+
+void range_fetcher::start_pending()
+{
+    while (!pending_.empty() && active_.size() < max_transfers_) {
+        CURL* handle = nullptr;
+        if (idle_handles_.empty()) {
+            handle = curl_easy_init();
+            if (handle == nullptr) {
+                throw std::runtime_error("Could not initialize libcurl.");
+            }
+        } else {
+            handle = idle_handles_.back();
+            idle_handles_.pop_back();
+            curl_easy_reset(handle);
+        }
+
+        auto& t = active_.emplace_back(std::make_unique<transfer>(transfer{handle, std::move(pending_.front())}));
+        pending_.pop_front();
+
+        auto range = fmt::format("{}-{}", t->req.offset, t->req.offset + t->req.length - 1);
+        curl_easy_setopt(handle, CURLOPT_URL, t->req.url.c_str());
+        // CURLOPT_RANGE copies the string
+        curl_easy_setopt(handle, CURLOPT_RANGE, range.c_str());
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &write_callback);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, t.get());
+        curl_easy_setopt(handle, CURLOPT_USERAGENT, CREATED_BY_STRING);
+        curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(handle, CURLOPT_PIPEWAIT, 1L);
+        curl_easy_setopt(handle, CURLOPT_CONNECTTIMEOUT, 30L);
+        // abort transfers that stall for a minute
+        curl_easy_setopt(handle, CURLOPT_LOW_SPEED_LIMIT, 1L);
+        curl_easy_setopt(handle, CURLOPT_LOW_SPEED_TIME, 60L);
+
+        curl_multi_add_handle(multi_, handle);
+    }
+}
+
+void range_fetcher::finish(void* handle, int result)
+{
+    auto it = std::find_if(active_.begin(), active_.end(), [=](const auto& t) { return t->handle == handle; });
+    if (it == active_.end()) {
+        return;
+    }
+    auto t = std::move(*it);
+    active_.erase(it);
+    curl_multi_remove_handle(multi_, t->handle);
+    idle_handles_.push_back(t->handle);
+
+    bool ok = result == CURLE_OK &&
+              is_range_response(response_code(t->handle), t->req.offset) &&
+              t->received == t->req.length;
+    t->req.on_done(ok);
+}
+
+#else
+
+struct range_fetcher::transfer {};
+
+range_fetcher::range_fetcher(std::size_t max_transfers, std::size_t)
+    : max_transfers_(max_transfers)
+{
+    throw std::runtime_error("Web seeds are not supported: " PROJECT_NAME " was built without libcurl.");
+}
+
+range_fetcher::~range_fetcher() = default;
+
+void range_fetcher::add(std::string, std::uint64_t, std::uint64_t, data_callback, done_callback) {}
+
+void range_fetcher::run() {}
+
+bool range_fetcher::is_supported() noexcept
+{
+    return false;
+}
+
+void range_fetcher::start_pending() {}
+
+void range_fetcher::finish(void*, int) {}
+
+#endif
+
+} // namespace torrenttools
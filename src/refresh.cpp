@@ -0,0 +1,420 @@
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <thread>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <dottorrent/hasher/factory.hpp>
+
+#include "refresh.hpp"
+#include "file_hasher.hpp"
+#include "piece_layout.hpp"
+#include "piece_reader.hpp"
+#include "zero_data.hpp"
+
+namespace torrenttools {
+
+namespace {
+
+/// Part of a v1 piece that is stored in a single file.
+struct piece_segment
+{
+    std::size_t file;
+    std::size_t offset;
+    std::size_t length;
+};
+
+std::vector<piece_segment> piece_segments(const dt::file_storage& storage,
+                                          const piece_layout& layout,
+                                          std::size_t piece)
+{
+    std::vector<piece_segment> segments {};
+    auto position = piece * layout.piece_size();
+    const auto end = std::min(position + layout.piece_size(), layout.total_size());
+
+    for (auto index = layout.file_at(position); position < end; ++index) {
+        const auto file_offset = layout.file_offset(index);
+        const auto file_end = file_offset + storage.at(index).file_size();
+        if (position >= file_end) {
+            continue;
+        }
+        auto length = std::min(file_end, end) - position;
+        segments.push_back({index, position - file_offset, length});
+        position += length;
+    }
+    return segments;
+}
+
+} // namespace
+
+
+bool is_unchanged_since(const file_mtime_table& mtimes, const dt::file_entry& entry, const file_stat& status)
+{
+    auto it = mtimes.find(entry.path().generic_string());
+    if (it == mtimes.end()) {
+        return false;
+    }
+    const auto& record = it->second;
+    return record.file_size == entry.file_size() &&
+           record.file_size == status.file_size &&
+           record.mtime_ns == status.mtime_ns;
+}
+
+
+based_on_hasher::based_on_hasher(dt::file_storage& storage,
+                                 const dt::metafile& base,
+                                 const file_mtime_table& base_mtimes,
+                                 dt::protocol protocol,
+                                 std::size_t threads)
+    : storage_(storage)
+    , base_(base)
+    , base_mtimes_(base_mtimes)
+    , protocol_(protocol)
+    , thread_count_(std::max<std::size_t>(threads, 1))
+    , layout_(storage)
+    , file_bytes_done_(std::make_unique<std::atomic_size_t[]>(storage.file_count()))
+{}
+
+void based_on_hasher::start()
+{
+    Expects(workers_.empty());
+
+    plan_work();
+    auto thread_count = std::min(thread_count_, std::max<std::size_t>(work_.size(), 1));
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back([this]() { run(); });
+    }
+}
+
+void based_on_hasher::plan_work()
+{
+    const auto& base_storage = base_.storage();
+    const auto piece_size = storage_.piece_size();
+    const bool same_piece_size = base_storage.piece_size() == piece_size;
+    piece_layout base_layout(base_storage);
+
+    // Map every unchanged file to the index of the same file in base.
+    std::vector<std::optional<std::size_t>> base_index(storage_.file_count());
+    if (same_piece_size) {
+        std::map<fs::path, std::size_t> base_paths {};
+        for (std::size_t i = 0; i < base_storage.file_count(); ++i) {
+            if (!base_storage.at(i).is_padding_file()) {
+                base_paths.emplace(base_storage.at(i).path(), i);
+            }
+        }
+        for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+            const auto& entry = storage_.at(i);
+            if (entry.is_padding_file()) {
+                continue;
+            }
+            auto it = base_paths.find(entry.path());
+            if (it == base_paths.end()) {
+                continue;
+            }
+            auto status = stat_file(storage_.root_directory() / entry.path());
+            if (status.file_size == entry.file_size() &&
+                is_unchanged_since(base_mtimes_, base_storage.at(it->second), status)) {
+                base_index[i] = it->second;
+            }
+        }
+    }
+
+    // With multiple threads large files and long runs of pieces are split, ranges must start on a piece boundary.
+    const auto part_size = std::max(piece_size, (default_split_size + piece_size - 1) / piece_size * piece_size);
+    const bool split = thread_count_ > 1;
+
+    work_.clear();
+    file_parts_.assign(storage_.file_count(), {});
+    file_results_.assign(storage_.file_count(), std::nullopt);
+    file_protocol_.assign(storage_.file_count(), dt::protocol::none);
+
+    if (has_v1(protocol_)) {
+        pieces_.assign(layout_.piece_count(), {});
+        piece_done_.assign(layout_.piece_count(), false);
+    }
+    // v2 and hybrid torrents do not count padding files in their progress.
+    if (protocol_ != dt::protocol::v1) {
+        for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+            if (storage_.at(i).is_padding_file()) {
+                file_bytes_done_[i].store(storage_.at(i).file_size(), std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // v2: copy the merkle trees of unchanged files, hash changed files as a whole.
+    if (has_v2(protocol_)) {
+        const bool base_has_v2 = has_v2(base_storage.protocol());
+
+        for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+            const auto& entry = storage_.at(i);
+            if (entry.is_padding_file() || entry.file_size() == 0) {
+                continue;
+            }
+            if (base_has_v2 && base_index[i]) {
+                const auto& base_entry = base_storage.at(*base_index[i]);
+                file_results_[i] = file_hashes {
+                        .protocol = dt::protocol::v2,
+                        .piece_size = piece_size,
+                        .file_size = entry.file_size(),
+                        .pieces_root = base_entry.pieces_root(),
+                        .piece_layer = base_entry.piece_layer(),
+                };
+                // for hybrid torrents the progress of the file follows its v1 pieces
+                if (!has_v1(protocol_)) {
+                    file_bytes_done_[i].store(entry.file_size(), std::memory_order_relaxed);
+                }
+                ++statistics_.files_reused;
+                continue;
+            }
+
+            // Compute the v1 pieces of aligned files in the same pass.
+            file_protocol_[i] = dt::protocol::v2;
+            if (has_v1(protocol_) && layout_.is_aligned(i)) {
+                file_protocol_[i] = dt::protocol::hybrid;
+                auto [first, last] = layout_.piece_range(i);
+                auto complete_pieces = entry.file_size() / piece_size;
+                std::fill_n(piece_done_.begin() + first, complete_pieces, true);
+
+                // The tail piece can only be taken from the file when it is followed by nothing or by padding.
+                if (first + complete_pieces != last) {
+                    auto segments = piece_segments(storage_, layout_, last - 1);
+                    bool tail_only = segments.size() == 1;
+                    bool padded_tail = segments.size() == 2 &&
+                                       storage_.at(segments[1].file).is_padding_file() &&
+                                       segments[0].length + segments[1].length == piece_size;
+                    if (tail_only || padded_tail) {
+                        piece_done_[last - 1] = true;
+                    }
+                }
+            }
+            auto part_count = split ? (entry.file_size() + part_size - 1) / part_size : 1;
+            file_parts_[i].resize(part_count);
+            for (std::size_t part = 0; part < part_count; ++part) {
+                auto offset = part * part_size;
+                auto length = part + 1 == part_count ? entry.file_size() - offset : part_size;
+                work_.push_back({.is_file = true, .first = i, .offset = offset, .length = length, .part = part});
+            }
+            ++statistics_.files_hashed;
+        }
+    }
+
+    // v1: copy pieces covering exactly the same unchanged data in base, hash the others.
+    if (has_v1(protocol_)) {
+        const bool base_has_v1 = same_piece_size && has_v1(base_storage.protocol());
+
+        auto find_base_piece = [&](std::size_t piece) -> std::optional<std::size_t> {
+            auto segments = piece_segments(storage_, layout_, piece);
+            const auto& front = segments.front();
+            if (!base_index[front.file]) {
+                return std::nullopt;
+            }
+            auto base_offset = base_layout.file_offset(*base_index[front.file]) + front.offset;
+            if (base_offset % piece_size != 0) {
+                return std::nullopt;
+            }
+            auto base_piece = base_offset / piece_size;
+            auto base_segments = piece_segments(base_storage, base_layout, base_piece);
+            if (base_segments.size() != segments.size()) {
+                return std::nullopt;
+            }
+            for (std::size_t i = 0; i < segments.size(); ++i) {
+                const auto& s = segments[i];
+                const auto& b = base_segments[i];
+                if (s.length != b.length) {
+                    return std::nullopt;
+                }
+                if (storage_.at(s.file).is_padding_file()) {
+                    if (!base_storage.at(b.file).is_padding_file()) {
+                        return std::nullopt;
+                    }
+                }
+                else if (base_index[s.file] != b.file || s.offset != b.offset) {
+                    return std::nullopt;
+                }
+            }
+            return base_piece;
+        };
+
+        const auto max_run = split ? part_size / piece_size : pieces_.size();
+        std::optional<std::size_t> run_start {};
+        for (std::size_t piece = 0; piece <= pieces_.size(); ++piece) {
+            bool dirty = false;
+            if (piece < pieces_.size() && !piece_done_[piece]) {
+                if (auto base_piece = base_has_v1 ? find_base_piece(piece) : std::nullopt; base_piece) {
+                    pieces_[piece] = base_storage.get_piece_hash(*base_piece);
+                    piece_done_[piece] = true;
+                    complete_piece(piece);
+                    ++statistics_.pieces_reused;
+                } else {
+                    dirty = true;
+                }
+            }
+            if (run_start && (!dirty || piece - *run_start == max_run)) {
+                work_.push_back({.is_file = false, .first = *run_start, .last = piece});
+                run_start.reset();
+            }
+            if (dirty && !run_start) {
+                run_start = piece;
+            }
+        }
+        statistics_.pieces_hashed = pieces_.size() - statistics_.pieces_reused;
+    }
+
+    // Largest first, so small items fill up the workers at the end.
+    auto item_bytes = [&](const work_item& item) {
+        return item.is_file ? item.length : (item.last - item.first) * piece_size;
+    };
+    std::stable_sort(work_.begin(), work_.end(), [&](const work_item& lhs, const work_item& rhs) {
+        return item_bytes(lhs) > item_bytes(rhs);
+    });
+}
+
+void based_on_hasher::run()
+{
+    const auto piece_size = storage_.piece_size();
+    auto sha1 = dt::make_hasher(dt::hash_function::sha1);
+    piece_reader reader(storage_);
+
+    for (auto i = next_item_.fetch_add(1); i < work_.size(); i = next_item_.fetch_add(1)) {
+        const auto& item = work_[i];
+        try {
+            if (item.is_file) {
+                auto path = storage_.root_directory() / storage_.at(item.first).path();
+                auto hashes = hash_file_range(path, file_protocol_[item.first], piece_size,
+                                              item.offset, item.length, &file_bytes_done_[item.first]);
+                if (hashes.file_size != item.length) {
+                    throw fs::filesystem_error("file size changed while hashing", path,
+                                               std::make_error_code(std::errc::io_error));
+                }
+                bytes_hashed_.fetch_add(hashes.file_size, std::memory_order_relaxed);
+                file_parts_[item.first][item.part] = std::move(hashes);
+            }
+            else {
+                reader.read(item.first, item.last, [&](std::size_t piece, std::span<const std::byte> data) {
+                    if (data.size() == piece_size && is_zero(data)) {
+                        pieces_[piece] = zero_piece_sha1(piece_size);
+                    } else {
+                        sha1->update(data);
+                        sha1->finalize_to(hash_bytes(pieces_[piece]));
+                    }
+                    bytes_hashed_.fetch_add(data.size(), std::memory_order_relaxed);
+                    complete_piece(piece);
+                });
+            }
+        }
+        catch (...) {
+            {
+                std::unique_lock lock(error_mutex_);
+                if (!error_) {
+                    error_ = std::current_exception();
+                }
+            }
+            // Mark failed work as complete as well, so progress reporting terminates.
+            if (item.is_file) {
+                file_bytes_done_[item.first].store(storage_.at(item.first).file_size(), std::memory_order_relaxed);
+            } else {
+                for (auto piece = item.first; piece < item.last; ++piece) {
+                    complete_piece(piece);
+                }
+            }
+        }
+    }
+}
+
+void based_on_hasher::complete_piece(std::size_t piece)
+{
+    for (const auto& segment : piece_segments(storage_, layout_, piece)) {
+        file_bytes_done_[segment.file].fetch_add(segment.length, std::memory_order_relaxed);
+    }
+}
+
+void based_on_hasher::wait()
+{
+    for (auto& worker : workers_) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+    statistics_.bytes_hashed = bytes_hashed_.load();
+
+    // Combine the ranges of split files.
+    for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+        if (file_parts_[i].empty()) {
+            continue;
+        }
+        auto hashes = file_parts_[i].size() == 1 ? std::move(file_parts_[i].front())
+                                                 : merge_file_hashes(file_parts_[i]);
+        if (has_v1(file_protocol_[i])) {
+            auto [first, last] = layout_.piece_range(i);
+            std::copy(hashes.pieces.begin(), hashes.pieces.end(), pieces_.begin() + first);
+            if (first + hashes.pieces.size() != last && piece_done_[last - 1]) {
+                pieces_[last - 1] = layout_.has_padded_tail(i) ? *hashes.padded_tail_piece : *hashes.tail_piece;
+            }
+        }
+        file_results_[i] = std::move(hashes);
+    }
+
+    // Store the results in the storage.
+    if (has_v1(protocol_)) {
+        storage_.allocate_pieces();
+        for (std::size_t i = 0; i < pieces_.size(); ++i) {
+            storage_.set_piece_hash(i, pieces_[i]);
+        }
+    }
+    if (has_v2(protocol_)) {
+        for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+            if (file_results_[i]) {
+                set_file_hashes(storage_, layout_, i, *file_results_[i], dt::protocol::v2);
+            }
+        }
+    }
+    file_parts_.clear();
+    file_results_.clear();
+}
+
+std::size_t based_on_hasher::bytes_done() const noexcept
+{
+    std::size_t total = 0;
+    for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+        const auto& entry = storage_.at(i);
+        // v2 and hybrid torrents do not count padding files, v1 torrents do.
+        if (entry.is_padding_file() && protocol_ != dt::protocol::v1) {
+            continue;
+        }
+        // the tail of a file can be counted both by its own hashes and by a piece spanning the next file
+        total += std::min(file_bytes_done_[i].load(std::memory_order_relaxed), entry.file_size());
+    }
+    return total;
+}
+
+std::pair<std::size_t, std::size_t> based_on_hasher::current_file_progress() const noexcept
+{
+    for (std::size_t i = 0; i < storage_.file_count(); ++i) {
+        auto done = file_bytes_done_[i].load(std::memory_order_relaxed);
+        if (done < storage_.at(i).file_size()) {
+            return {i, done};
+        }
+    }
+    return {storage_.file_count(), 0};
+}
+
+
+refresh_statistics hash_based_on(dt::file_storage& storage,
+                                 const dt::metafile& base,
+                                 const file_mtime_table& base_mtimes,
+                                 dt::protocol protocol,
+                                 std::size_t threads)
+{
+    auto hasher = based_on_hasher(storage, base, base_mtimes, protocol, threads);
+    hasher.start();
+    hasher.wait();
+    return hasher.statistics();
+}
+
+} // namespace torrenttools
@@ -0,0 +1,55 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "sampling.hpp"
+
+namespace torrenttools {
+
+std::size_t sample_size::resolve(std::size_t piece_count) const noexcept
+{
+    std::size_t n = count;
+    if (n == 0) {
+        n = static_cast<std::size_t>(std::ceil(fraction * static_cast<double>(piece_count)));
+    }
+    return std::clamp<std::size_t>(n, std::min<std::size_t>(piece_count, 1), piece_count);
+}
+
+std::vector<bool> sample_pieces(std::size_t piece_count, std::size_t sample_count, std::uint64_t seed)
+{
+    Expects(sample_count <= piece_count);
+
+    std::vector<bool> selection(piece_count);
+    if (sample_count == 0) {
+        return selection;
+    }
+
+    // std::mt19937_64 produces the same sequence on every platform,
+    // unlike the standard distributions, so the offset is drawn with a plain modulo.
+    std::mt19937_64 generator(seed);
+
+    for (std::size_t i = 0; i < sample_count; ++i) {
+        auto first = i * piece_count / sample_count;
+        auto last = (i + 1) * piece_count / sample_count;
+        selection[first + generator() % (last - first)] = true;
+    }
+    return selection;
+}
+
+double wilson_upper_bound(std::size_t failures, std::size_t samples, double z)
+{
+    if (samples == 0) {
+        return 1.0;
+    }
+    const auto n = static_cast<double>(samples);
+    const auto p = static_cast<double>(failures) / n;
+    const auto z2 = z * z;
+
+    auto center = p + z2 / (2 * n);
+    auto margin = z * std::sqrt(p * (1 - p) / n + z2 / (4 * n * n));
+    return std::min(1.0, (center + margin) / (1 + z2 / n));
+}
+
+} // namespace torrenttools
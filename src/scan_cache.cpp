@@ -0,0 +1,139 @@
+#include <fstream>
+#include <iterator>
+
+#include <fmt/format.h>
+#include <bencode/bvalue.hpp>
+#include <bencode/encode.hpp>
+
+#include "scan_cache.hpp"
+
+namespace bc = bencode;
+
+namespace torrenttools {
+
+constexpr std::int64_t scan_cache_version = 2;
+
+scan_cache::scan_cache(fs::path path)
+    : path_(std::move(path))
+{}
+
+void scan_cache::load()
+{
+    directories_.clear();
+    visited_.clear();
+
+    std::ifstream ifs(path_, std::ios::binary);
+    if (!ifs) {
+        return;
+    }
+
+    // The cache is an optimisation only: silently start over when it cannot be parsed.
+    try {
+        auto bv = bc::decode_value(ifs);
+        if (get_integer(bv.at("version")) != scan_cache_version) {
+            return;
+        }
+
+        for (const auto& [key, value] : get_dict(bv.at("directories"))) {
+            directory_record record {
+                .mtime_ns = get_integer(value.at("mtime")),
+            };
+            for (const auto& f : get_list(value.at("files"))) {
+                record.files.push_back(get_string(f));
+            }
+            for (const auto& d : get_list(value.at("subdirectories"))) {
+                record.subdirectories.push_back(get_string(d));
+            }
+            directories_.emplace(key, std::move(record));
+        }
+    }
+    catch (const std::exception&) {
+        directories_.clear();
+    }
+}
+
+void scan_cache::save() const
+{
+    auto directories = bc::bvalue::dict_type {};
+
+    for (const auto& [key, record] : directories_) {
+        auto files = bc::bvalue::list_type {};
+        for (const auto& f : record.files) {
+            files.push_back(f);
+        }
+        auto subdirectories = bc::bvalue::list_type {};
+        for (const auto& d : record.subdirectories) {
+            subdirectories.push_back(d);
+        }
+
+        auto entry = bc::bvalue::dict_type {};
+        entry["mtime"] = record.mtime_ns;
+        entry["files"] = std::move(files);
+        entry["subdirectories"] = std::move(subdirectories);
+        directories[key] = std::move(entry);
+    }
+
+    auto root = bc::bvalue::dict_type {};
+    root["version"] = scan_cache_version;
+    root["directories"] = std::move(directories);
+
+    // write to a temporary file first so an interrupted write never corrupts the cache
+    auto tmp_path = fs::path(path_).concat(".tmp");
+    {
+        std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            throw std::invalid_argument(fmt::format("could not write scan cache: {}", tmp_path.string()));
+        }
+        bc::encode_to(ofs, bc::bvalue(std::move(root)));
+    }
+    fs::rename(tmp_path, path_);
+}
+
+const scan_cache::directory_record& scan_cache::list_directory(const fs::path& dir)
+{
+    auto key = dir.lexically_normal().string();
+    auto mtime_ns = stat_file(dir).mtime_ns;
+    visited_.insert(key);
+
+    if (auto it = directories_.find(key); it != directories_.end() && it->second.mtime_ns == mtime_ns) {
+        ++hits_;
+        return it->second;
+    }
+
+    ++misses_;
+    auto [it, inserted] = directories_.insert_or_assign(key, read_directory(dir, mtime_ns));
+    return it->second;
+}
+
+void scan_cache::prune(const fs::path& root)
+{
+    auto prefix = root.lexically_normal().string();
+    // a sibling such as "/lib/ab" must not match a root of "/lib/a"
+    auto separator_prefix = prefix.ends_with(fs::path::preferred_separator)
+            ? prefix : prefix + static_cast<char>(fs::path::preferred_separator);
+
+    std::erase_if(directories_, [&](const auto& item) {
+        const auto& [key, record] = item;
+        return (key == prefix || key.starts_with(separator_prefix)) && !visited_.contains(key);
+    });
+}
+
+auto scan_cache::read_directory(const fs::path& dir, std::int64_t mtime_ns) -> directory_record
+{
+    directory_record record { .mtime_ns = mtime_ns };
+
+    for (const auto& entry : fs::directory_iterator(dir)) {
+        auto name = entry.path().filename().string();
+
+        // do not follow directory symlinks, same as recursive_directory_iterator
+        if (entry.is_directory() && !entry.is_symlink()) {
+            record.subdirectories.push_back(std::move(name));
+        }
+        else if (entry.is_regular_file()) {
+            record.files.push_back(std::move(name));
+        }
+    }
+    return record;
+}
+
+} // namespace torrenttools
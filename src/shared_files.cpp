@@ -0,0 +1,84 @@
+#include <map>
+#include <tuple>
+
+#include <gsl-lite/gsl-lite.hpp>
+
+#include "shared_files.hpp"
+#include "file_stat.hpp"
+#include "piece_layout.hpp"
+
+namespace torrenttools {
+
+std::vector<std::optional<std::size_t>> find_shared_files(const dt::file_storage& storage, bool include_reflinks)
+{
+    using inode_key = std::pair<std::uint64_t, std::uint64_t>;
+    using extent_key = std::tuple<std::uint64_t, std::uint64_t, std::vector<file_extent>>;
+
+    std::vector<std::optional<std::size_t>> shared(storage.file_count());
+    std::map<inode_key, std::size_t> inodes {};
+    std::map<extent_key, std::size_t> extents {};
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage.at(i);
+        if (entry.is_padding_file() || entry.file_size() == 0) {
+            continue;
+        }
+        auto path = storage.root_directory() / entry.path();
+        auto status = stat_file(path);
+        if (status.inode == 0 || status.file_size != entry.file_size()) {
+            continue;
+        }
+
+        auto [it, inserted] = inodes.emplace(inode_key(status.device, status.inode), i);
+        if (!inserted) {
+            shared[i] = it->second;
+            continue;
+        }
+        if (include_reflinks) {
+            auto file_extents = query_shared_extents(path);
+            if (file_extents.empty()) {
+                continue;
+            }
+            auto key = extent_key(status.device, status.file_size, std::move(file_extents));
+            if (auto [eit, extent_inserted] = extents.emplace(std::move(key), i); !extent_inserted) {
+                shared[i] = eit->second;
+            }
+        }
+    }
+    return shared;
+}
+
+std::vector<std::optional<std::size_t>> align_shared_files(dt::file_storage& storage,
+                                                           const std::vector<std::optional<std::size_t>>& shared)
+{
+    Expects(shared.size() == storage.file_count());
+
+    auto regular_files = [&]() {
+        std::vector<std::size_t> indices {};
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            if (!storage.at(i).is_padding_file()) {
+                indices.push_back(i);
+            }
+        }
+        return indices;
+    };
+
+    // padding files are inserted between the regular files, which keep their order
+    auto old_indices = regular_files();
+    align_to_pieces(storage);
+    auto new_indices = regular_files();
+
+    std::vector<std::size_t> new_index(shared.size());
+    for (std::size_t i = 0; i < old_indices.size(); ++i) {
+        new_index[old_indices[i]] = new_indices[i];
+    }
+    std::vector<std::optional<std::size_t>> result(storage.file_count());
+    for (std::size_t i = 0; i < old_indices.size(); ++i) {
+        if (auto first = shared[old_indices[i]]) {
+            result[new_indices[i]] = new_index[*first];
+        }
+    }
+    return result;
+}
+
+} // namespace torrenttools
@@ -0,0 +1,41 @@
+#include "shared_results.hpp"
+
+namespace torrenttools {
+
+void shared_result::publish(std::vector<piece_state> states)
+{
+    {
+        std::unique_lock lock(mutex_);
+        states_ = std::move(states);
+    }
+    cv_.notify_all();
+}
+
+const std::vector<piece_state>& shared_result::wait() const
+{
+    std::unique_lock lock(mutex_);
+    cv_.wait(lock, [this]() { return states_.has_value(); });
+    // the states are not modified after they are published
+    return *states_;
+}
+
+
+std::pair<std::shared_ptr<shared_result>, bool> shared_results::claim(const std::string& key)
+{
+    std::unique_lock lock(mutex_);
+    auto [it, inserted] = results_.try_emplace(key);
+    if (inserted) {
+        it->second = std::make_shared<shared_result>();
+    } else {
+        ++reused_;
+    }
+    return {it->second, inserted};
+}
+
+std::size_t shared_results::reused() const
+{
+    std::unique_lock lock(mutex_);
+    return reused_;
+}
+
+} // namespace torrenttools
@@ -16,6 +16,7 @@
 #include "argument_parsers.hpp"
 #include "show.hpp"
 #include "escape_binary_fields.hpp"
+#include "metafile_extras.hpp"
 
 
 
@@ -577,22 +578,28 @@ void run_show_checksum_subapp(const main_app_options& main_options, const show_a
     auto m = dt::load_metafile(options.metafile);\
     const auto& storage = m.storage();
 
+    // fast checksums are stored outside the file entries
+    auto fast_checksums = tt::load_metafile_extras(options.metafile).checksums;
+
     // check the available checksum functions
-    std::set<dt::hash_function> available_checksums;
+    std::set<tt::checksum_algorithm> available_checksums;
 
     for (const auto& f: storage) {
         for (const auto& [key, value] : f.checksums()) {
             available_checksums.emplace(value->algorithm());
         }
     }
+    for (const auto& [algo, values] : fast_checksums) {
+        available_checksums.emplace(algo);
+    }
 
-    std::vector<dt::hash_function> out;
+    std::vector<tt::checksum_algorithm> out;
     rng::copy(available_checksums, std::back_inserter(out));
     rng::sort(out);
 
     if (!options.checksum_algorithm) {
         for (const auto& algo : out) {
-            std::cout << dt::to_string(algo) << '\n';
+            std::cout << tt::to_string(algo) << '\n';
         }
 
         return;
@@ -601,12 +608,23 @@ void run_show_checksum_subapp(const main_app_options& main_options, const show_a
     // first check if the metafile contains checksums of this algorithm
     if (!available_checksums.contains(*options.checksum_algorithm)) {
         auto s = fmt::format( "no {} checksums contained in metafile",
-                             dt::to_string(*options.checksum_algorithm));
+                             tt::to_string(*options.checksum_algorithm));
         throw std::invalid_argument(s);
     }
 
     // otherwise we print all files and their checksums in <algorithm_name>sum format
-    auto checksum_key = std::string(dt::to_string(*options.checksum_algorithm));
+    if (const auto* f = std::get_if<tt::fast_checksum>(&*options.checksum_algorithm)) {
+        const auto& values = fast_checksums.at(*f);
+        for (const auto& file : m.storage()) {
+            auto it = values.find(file.path().generic_string());
+            if (it == values.end()) {
+                continue;
+            }
+            std::cout << fmt::format("{} *{}", dt::to_hexadecimal_string(std::span<const std::byte>(it->second)), file.path().string()) << std::endl;
+        }
+        return;
+    }
+    auto checksum_key = tt::to_string(*options.checksum_algorithm);
     for (const auto& file : m.storage()) {
         auto checksum = file.checksums().at(checksum_key)->value();
         auto line = fmt::format("{} *{}", dt::to_hexadecimal_string(checksum), file.path().string());
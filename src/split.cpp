@@ -0,0 +1,137 @@
+#include <iostream>
+#include <map>
+#include <set>
+
+#include <CLI/App.hpp>
+#include <fmt/format.h>
+#include <dottorrent/metafile.hpp>
+
+#include "split.hpp"
+#include "argument_parsers.hpp"
+#include "common.hpp"
+#include "hashed_file.hpp"
+#include "piece_layout.hpp"
+
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+void configure_split_app(CLI::App* app, split_app_options& options)
+{
+    CLI::callback_t metafile_parser = [&](const CLI::results_t& v) -> bool {
+        options.metafile = metafile_target_transformer(v);
+        return true;
+    };
+    CLI::callback_t protocol_parser = [&](const CLI::results_t& v) -> bool {
+        options.protocol_version = protocol_transformer(v);
+        return true;
+    };
+    CLI::callback_t data_directory_parser = [&](const CLI::results_t& v) -> bool {
+        options.data_directory = path_transformer(v);
+        return true;
+    };
+
+    app->add_option("metafile", metafile_parser, "Metafile to split.")
+       ->type_name("<metafile>")
+       ->required();
+
+    app->add_option("-o,--output", options.destination,
+               "Set the output directory of the created files. [default: current directory]")
+       ->type_name("<path>");
+
+    app->add_flag("--by-directory", options.by_directory,
+               "Create a metafile for every top-level directory.\n"
+               "Files in the root directory each get their own single-file metafile.")
+       ->required();
+
+    app->add_option("-v,--protocol", protocol_parser,
+               "Set the bittorrent protocol to use.\n"
+               "Options are 2 or hybrid. [default: 2]")
+       ->type_name("<protocol>");
+
+    app->add_option("--data", data_directory_parser,
+               "Directory with the data of the metafile.\n"
+               "Only required for hybrid metafiles when the last piece of a file has to be rehashed.")
+       ->type_name("<path>");
+}
+
+
+std::vector<dt::metafile> split_metafile_by_directory(const dt::metafile& m,
+                                                      dt::protocol protocol,
+                                                      const std::optional<fs::path>& data_directory)
+{
+    const auto& storage = m.storage();
+
+    if (!tt::has_v2(protocol)) {
+        throw std::invalid_argument("Only v2 and hybrid metafiles can be split.");
+    }
+    if ((storage.protocol() & protocol) != protocol) {
+        throw std::invalid_argument("Metafile does not contain hashes for the requested protocol.");
+    }
+    if (tt::has_v1(protocol) && !tt::piece_layout(storage).is_aligned()) {
+        throw std::invalid_argument("Hybrid metafile is not padded to piece boundaries.");
+    }
+    if (storage.file_mode() == dt::file_mode::single) {
+        throw std::invalid_argument("Cannot split a single-file metafile.");
+    }
+
+    // group files by their top-level directory
+    std::map<std::string, std::vector<tt::hashed_file>> groups {};
+    std::set<std::string> top_level_files {};
+
+    for (auto& f : tt::extract_hashed_files(storage, protocol)) {
+        auto first = *f.path.begin();
+        if (f.path == first) {
+            top_level_files.insert(first.string());
+        } else {
+            f.path = f.path.lexically_relative(first);
+        }
+        groups[first.string()].push_back(std::move(f));
+    }
+
+    std::vector<dt::metafile> results {};
+    for (auto& [name, files] : groups) {
+        dt::metafile result = m;
+        result.clear_web_seeds();
+        result.clear_http_seeds();
+        result.clear_similar_torrents();
+        result.clear_collections();
+        result.set_name(name);
+        result.set_creation_date(std::chrono::system_clock::now());
+        result.set_created_by(CREATED_BY_STRING);
+
+        // a top-level file becomes a single-file metafile
+        bool is_single_file = top_level_files.contains(name);
+
+        auto& result_storage = result.storage();
+        result_storage.set_file_mode(is_single_file ? dt::file_mode::single : dt::file_mode::multi);
+
+        std::optional<fs::path> group_data {};
+        if (data_directory) {
+            group_data = is_single_file ? *data_directory : *data_directory / name;
+            result_storage.set_root_directory(*group_data);
+        }
+
+        tt::sort_hashed_files(files);
+        tt::set_hashed_files(result_storage, std::move(files), protocol, group_data);
+        results.push_back(std::move(result));
+    }
+    return results;
+}
+
+
+void run_split_app(const main_app_options& main_options, const split_app_options& options)
+{
+    auto m = dt::load_metafile(options.metafile);
+    auto protocol = options.protocol_version.value_or(dt::protocol::v2);
+
+    auto destination_directory = options.destination.value_or(fs::current_path());
+    fs::create_directories(destination_directory);
+
+    auto results = split_metafile_by_directory(m, protocol, options.data_directory);
+
+    for (auto& result : results) {
+        auto destination_file = get_destination_path(result, destination_directory);
+        dt::save_metafile(destination_file, result, protocol);
+        fmt::print("Metafile written to: {}\n", destination_file.string());
+    }
+}
@@ -1,3 +1,6 @@
+#include <functional>
+#include <unordered_map>
+
 #include "tree_view.hpp"
 
 tree_printer::tree_printer(const dottorrent::metafile& m, std::string_view prefix, tree_options options)
@@ -157,9 +160,11 @@ std::string format_file_tree(const dottorrent::metafile& m, std::string_view pre
 
 
 
+namespace {
+
 std::string format_verify_file_tree(
         const dottorrent::metafile& m,
-        const dottorrent::storage_verifier& verifier,
+        const std::function<double(const dt::file_entry&)>& percentage_of,
         std::string_view prefix,
         const tree_options& options)
 {
@@ -196,7 +201,7 @@ std::string format_verify_file_tree(
     for (auto [line, file_ptr] : entries) {
         if (file_ptr != nullptr) {
             file_size = tt::format_tree_size(file_ptr->file_size());
-            double pct = verifier.percentage(*file_ptr);
+            double pct = percentage_of(*file_ptr);
             percentage_bar = clp::draw_progress_bar(pct,
                     { .complete_frames = std::span(clp::bar_frames::horizontal_blocks) }, {}, 10);
             percentage = tt::format_percentage(pct);
@@ -218,6 +223,35 @@ std::string format_verify_file_tree(
     return result;
 }
 
+} // namespace
+
+
+std::string format_verify_file_tree(
+        const dottorrent::metafile& m,
+        const dottorrent::storage_verifier& verifier,
+        std::string_view prefix,
+        const tree_options& options)
+{
+    return format_verify_file_tree(
+            m, [&](const dt::file_entry& entry) { return verifier.percentage(entry); }, prefix, options);
+}
+
+
+std::string format_verify_file_tree(
+        const dottorrent::metafile& m,
+        const tt::piece_verifier& verifier,
+        std::string_view prefix,
+        const tree_options& options)
+{
+    const auto& storage = m.storage();
+    std::unordered_map<const dt::file_entry*, std::size_t> indices {};
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        indices.emplace(&storage.at(i), i);
+    }
+    return format_verify_file_tree(
+            m, [&](const dt::file_entry& entry) { return verifier.percentage(indices.at(&entry)); }, prefix, options);
+}
+
 
 std::string format_file_stats(const dottorrent::metafile& m, std::string_view prefix, bool include_pad_files)
 {
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <bit>
+#include <fstream>
+#include <iostream>
+
+#include <CLI/App.hpp>
+#include <fmt/format.h>
+#include <dottorrent/metafile.hpp>
+
+#include "upgrade.hpp"
+#include "argument_parsers.hpp"
+#include "file_hasher.hpp"
+#include "formatters.hpp"
+#include "hashed_file.hpp"
+#include "piece_layout.hpp"
+#include "progress.hpp"
+
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+void configure_upgrade_app(CLI::App* app, upgrade_app_options& options)
+{
+    CLI::callback_t metafile_parser = [&](const CLI::results_t& v) -> bool {
+        options.metafile = metafile_target_transformer(v);
+        return true;
+    };
+    CLI::callback_t target_parser = [&](const CLI::results_t& v) -> bool {
+        options.target = path_transformer(v);
+        return true;
+    };
+
+    app->add_option("metafile", metafile_parser, "v1 metafile to upgrade.")
+       ->type_name("<metafile>")
+       ->required();
+
+    app->add_option("target", target_parser, "Target filename or directory with the data of the metafile.")
+       ->type_name("<path>")
+       ->required();
+
+    app->add_option("-o,--output", options.destination,
+               "Set the filename and/or output directory of the created file.\n"
+               "[default: <metafile-name>.hybrid.torrent]")
+       ->type_name("<path>");
+}
+
+
+upgrade_result upgrade_metafile(const dt::metafile& m, const fs::path& target)
+{
+    const auto& storage = m.storage();
+    const auto piece_size = storage.piece_size();
+
+    if (storage.protocol() != dt::protocol::v1) {
+        throw std::invalid_argument("Only v1 metafiles can be upgraded.");
+    }
+    if (!std::has_single_bit(piece_size) || piece_size < tt::v2_block_size) {
+        throw std::invalid_argument("v2 requires the piece size to be a power of two of at least 16 KiB.");
+    }
+
+    auto data_path = [&](const dt::file_entry& entry) {
+        if (storage.file_mode() == dt::file_mode::single && fs::is_regular_file(target)) {
+            return target;
+        }
+        return target / entry.path();
+    };
+
+    // The original v1 pieces are computed over the concatenation of all files, including padding.
+    // The hybrid hashes are computed per file, in the same read pass.
+    tt::v1_file_hasher v1_hasher(piece_size);
+    tt::file_hasher hybrid_hasher(dt::protocol::hybrid, piece_size);
+
+    std::vector<tt::hashed_file> files {};
+    std::vector<std::byte> buffer(std::max<std::size_t>(piece_size, 1024 * 1024));
+
+    for (const auto& entry : storage) {
+        if (entry.is_padding_file()) {
+            v1_hasher.update_zeros(entry.file_size());
+            continue;
+        }
+
+        auto path = data_path(entry);
+        std::ifstream ifs(path, std::ios::binary);
+        std::size_t bytes_read = 0;
+
+        while (ifs && bytes_read < entry.file_size()) {
+            auto n = std::min(buffer.size(), entry.file_size() - bytes_read);
+            ifs.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(n));
+            auto count = static_cast<std::size_t>(ifs.gcount());
+            if (count == 0) {
+                break;
+            }
+            auto data = std::span(buffer).first(count);
+            v1_hasher.update(data);
+            hybrid_hasher.update(data);
+            bytes_read += count;
+        }
+
+        // Missing data is hashed as zeros so the following pieces stay aligned,
+        // the affected pieces will fail verification.
+        if (bytes_read < entry.file_size()) {
+            v1_hasher.update_zeros(entry.file_size() - bytes_read);
+            hybrid_hasher.update_zeros(entry.file_size() - bytes_read);
+        }
+        auto hashes = hybrid_hasher.finalize();
+        // keep the per-file checksums (e.g. md5sum) of the original entry
+        for (const auto& [name, checksum] : entry.checksums()) {
+            auto value = checksum->value();
+            hashes.checksums.emplace(checksum->algorithm(), std::vector<std::byte>(value.begin(), value.end()));
+        }
+        files.push_back({entry.path(), entry.attributes(), std::move(hashes)});
+    }
+
+    tt::file_hashes v1_pieces {};
+    v1_hasher.finalize_to(v1_pieces);
+    if (v1_pieces.tail_piece) {
+        v1_pieces.pieces.push_back(*v1_pieces.tail_piece);
+    }
+
+    upgrade_result result { .metafile = m };
+
+    for (std::size_t i = 0; i < v1_pieces.pieces.size(); ++i) {
+        if (v1_pieces.pieces[i] != storage.get_piece_hash(i)) {
+            result.failed_pieces.push_back(i);
+        }
+    }
+    if (!result.failed_pieces.empty()) {
+        return result;
+    }
+
+    // hybrid metafiles list files in file tree order, with every file padded to a piece boundary
+    tt::sort_hashed_files(files);
+    tt::set_hashed_files(result.metafile.storage(), std::move(files), dt::protocol::hybrid);
+    return result;
+}
+
+
+void run_upgrade_app(const main_app_options& main_options, const upgrade_app_options& options)
+{
+    auto m = dt::load_metafile(options.metafile);
+    auto out = std::ostreambuf_iterator(std::cout);
+
+    fmt::format_to(out, "Verifying and hashing {} ({})...\n",
+                   m.name(), tt::format_size(m.storage().total_file_size()));
+    std::flush(std::cout);
+
+    auto start_time = std::chrono::system_clock::now();
+    auto result = upgrade_metafile(m, options.target);
+    auto duration = std::chrono::system_clock::now() - start_time;
+
+    if (!result.failed_pieces.empty()) {
+        throw std::runtime_error(fmt::format(
+                "{} of {} v1 pieces do not match the data, no metafile was written.",
+                result.failed_pieces.size(), tt::piece_layout(m.storage()).piece_count()));
+    }
+
+    auto destination_file = options.destination.value_or(
+            fs::current_path() / fmt::format("{}.hybrid.torrent", options.metafile.stem().string()));
+    if (fs::is_directory(destination_file)) {
+        destination_file /= fmt::format("{}.hybrid.torrent", options.metafile.stem().string());
+    }
+
+    print_completion_statistics(std::cout, result.metafile, duration);
+    dt::save_metafile(destination_file, result.metafile, dt::protocol::hybrid);
+    fmt::format_to(out, "Metafile written to: {}\n", destination_file.string());
+}
@@ -7,14 +7,43 @@
 #include "tree_view.hpp"
 #include "cli_helpers.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <tuple>
+
 #include <fmt/format.h>
+#include <gsl-lite/gsl-lite.hpp>
 
 #include "create.hpp"
+#include "file_hasher.hpp"
+#include "fastresume.hpp"
+#include "file_matcher.hpp"
+#include "file_stat.hpp"
+#include "hash_encoding.hpp"
+#include "io_scheduler.hpp"
+#include "piece_layout.hpp"
+#include "piece_verifier.hpp"
 #include "progress.hpp"
+#include "shared_results.hpp"
+#include "verify_state.hpp"
+#include "web_seed_verifier.hpp"
+
+namespace tt = torrenttools;
+
+using namespace std::chrono_literals;
+
+/// Interval between two writes of the verify state file.
+constexpr auto verify_state_interval = 30s;
 
 
 void configure_verify_app(CLI::App* app, verify_app_options& options)
 {
+    const auto max_size = 1U << 20U;
+
     CLI::callback_t protocol_parser = [&](const CLI::results_t& v) -> bool {
         options.protocol_version = protocol_transformer(v);
         return true;
@@ -27,15 +56,25 @@ void configure_verify_app(CLI::App* app, verify_app_options& options)
         options.files_root_directory = path_transformer(v);
         return true;
     };
+    CLI::callback_t sample_parser = [&](const CLI::results_t& v) -> bool {
+        options.sample = sample_size_transformer("--sample", v);
+        return true;
+    };
+    CLI::callback_t state_parser = [&](const CLI::results_t& v) -> bool {
+        options.state = path_transformer(v, /*check_exists=*/false);
+        return true;
+    };
+    CLI::callback_t batch_parser = [&](const CLI::results_t& v) -> bool {
+        options.batch = path_transformer(v);
+        return true;
+    };
 
     app->add_option("metafile", metafile_transformer,
-               "Metafile path.")
-       ->required()
+               "Metafile path. Required unless --batch is given.")
        ->type_name("<path>");
 
     app->add_option("target", files_transformer,
-               "Target filename or directory to verify pieces for.")
-       ->required()
+               "Target filename or directory to verify pieces for. Required unless --batch or --web-seed is given.")
        ->type_name("<path>");
 
     app->add_option("-v,--protocol", protocol_parser,
@@ -47,18 +86,774 @@ void configure_verify_app(CLI::App* app, verify_app_options& options)
                "Set the number of threads to use for hashing. [default: 2]")
        ->type_name("<n>")
        ->default_val(2);
+
+    app->add_option("--state", state_parser,
+               "Store the results in given file and reuse them in later runs.\n"
+               "Only pieces of files that changed since the previous run are verified.\n"
+               "An interrupted run continues where it stopped.")
+       ->type_name("<path>")
+       ->expected(1);
+
+    options.recheck_failed = false;
+    app->add_flag_callback("--recheck-failed",
+               [&]() { options.recheck_failed = true; },
+               "Only verify the pieces that failed in the previous run. Requires --state.");
+
+    options.quick = false;
+    app->add_flag_callback("--quick",
+               [&]() { options.quick = true; },
+               "Only check that all files exist and have the expected size, without reading data.");
+
+    app->add_option("--sample", sample_parser,
+               "Only verify a random sample of pieces spread over all files and estimate the corruption rate.\n"
+               "Given as a number of pieces, a fraction or a percentage. eg. 1000, 0.01 or 1%")
+       ->type_name("<fraction|count>")
+       ->expected(1);
+
+    app->add_option("--seed", options.seed,
+               "Seed used to select the pieces to sample. [default: derived from the infohash]")
+       ->type_name("<n>");
+
+    options.fail_fast = false;
+    app->add_flag_callback("--fail-fast",
+               [&]() { options.fail_fast = true; },
+               "Stop at the first missing file or failed piece and exit with an error.");
+
+    options.fail_fast_per_file = false;
+    app->add_flag_callback("--fail-fast-per-file",
+               [&]() { options.fail_fast_per_file = true; },
+               "Skip the remaining pieces of a file after one of its pieces failed.\n"
+               "Only for v2 and hybrid metafiles.");
+
+    app->add_option("--include", options.include_patterns,
+               "Only verify files matching given regex.")
+       ->type_name("<regex>...")
+       ->expected(0, max_size);
+
+    app->add_option("--exclude", options.exclude_patterns,
+               "Do not verify files matching given regex.")
+       ->type_name("<regex>...")
+       ->expected(0, max_size);
+
+    options.fastresume = false;
+    app->add_flag_callback("--fastresume",
+               [&]() { options.fastresume = true; },
+               "Write libtorrent resume data with the valid pieces next to the metafile,\n"
+               "so a client can start seeding without checking the data again.");
+
+    app->add_option("--batch", batch_parser,
+               "Verify all metafiles listed in given file, one per line, followed by a tab and the target.\n"
+               "Rotational disks are read by one job at a time, solid state disks by up to --queue-depth jobs.")
+       ->type_name("<path>")
+       ->expected(1);
+
+    app->add_option("--queue-depth", options.queue_depth,
+               "Maximum number of jobs reading from the same solid state disk in batch mode. [default: 4]")
+       ->type_name("<n>")
+       ->default_val(4);
+
+    options.web_seed = false;
+    app->add_flag_callback("--web-seed",
+               [&]() { options.web_seed = true; },
+               "Verify the data served by the HTTP web seeds of the metafile instead of local data.");
+
+    app->add_option("--connections", options.connections,
+               "Maximum number of connections to a web seed. [default: 4]")
+       ->type_name("<n>")
+       ->default_val(4);
+}
+
+
+namespace {
+
+void print_verify_file_tree(const dottorrent::metafile& m, const auto& verifier)
+{
+    auto terminal_size = termcontrol::get_terminal_size();
+    tree_options tree_options {
+        .show_file_size = false,
+        .show_directory_size = false,
+        .max_entry_size = terminal_size.cols,
+    };
+
+    auto verify_file_tree = format_verify_file_tree(
+            m, verifier, "  ",
+            tree_options);
+
+    std::cout << "\nFiles:\n";
+    std::cout << verify_file_tree;
+}
+
+/// Check the existence and size of all files without reading data.
+void verify_quick(const dottorrent::metafile& m, const verify_app_options& options)
+{
+    const auto& file_storage = m.storage();
+    auto start_time = std::chrono::system_clock::now();
+    auto problems = check_files(file_storage, std::max<std::size_t>(options.threads, 1));
+    auto duration = std::chrono::system_clock::now() - start_time;
+
+    std::size_t missing = 0;
+    for (const auto& problem : problems) {
+        const auto& entry = file_storage.at(problem.index);
+        if (problem.status == file_status::missing) {
+            std::cout << fmt::format("Missing:             {}\n", entry.path().string());
+            ++missing;
+        } else {
+            std::cout << fmt::format("Wrong size:          {} ({}, expected {})\n", entry.path().string(),
+                                     tt::format_size(problem.file_size), tt::format_size(entry.file_size()));
+        }
+    }
+
+    std::cout << fmt::format("Checked {} files in {}: {} missing, {} with a different size.\n",
+                             file_storage.file_count(), tt::format_duration(duration),
+                             missing, problems.size() - missing);
+    if (!problems.empty()) {
+        throw std::runtime_error(fmt::format("{} of {} files are missing or have a different size.",
+                                             problems.size(), file_storage.file_count()));
+    }
+}
+
+std::string info_hash_string(const dottorrent::metafile& m)
+{
+    return tt::has_v1(m.storage().protocol()) ? dt::info_hash_v1(m).hex_string()
+                                              : dt::info_hash_v2(m).hex_string();
+}
+
+void check_protocol(const dottorrent::metafile& m, dottorrent::protocol protocol)
+{
+    if (tt::has_v2(protocol) && !tt::has_v2(m.storage().protocol())) {
+        throw std::invalid_argument("Metafile does not contain v2 hashes.");
+    }
+    if (!tt::has_v2(protocol) && !tt::has_v1(m.storage().protocol())) {
+        throw std::invalid_argument("Metafile does not contain v1 hashes.");
+    }
+}
+
+void set_fail_fast(tt::piece_verifier& verifier, const verify_app_options& options)
+{
+    if (options.fail_fast) {
+        verifier.set_fail_fast(tt::fail_fast_mode::all);
+    }
+    else if (options.fail_fast_per_file) {
+        if (verifier.protocol() != dt::protocol::v2) {
+            throw std::invalid_argument("--fail-fast-per-file requires a v2 or hybrid metafile.");
+        }
+        verifier.set_fail_fast(tt::fail_fast_mode::file);
+    }
+}
+
+void print_failed_files(const dottorrent::metafile& m, const tt::piece_verifier& verifier)
+{
+    const auto& file_storage = m.storage();
+    std::cout << "\nFiles with failed pieces:\n";
+    for (std::size_t i = 0; i < file_storage.file_count(); ++i) {
+        auto [first, last] = verifier.file_pieces(i);
+        for (auto piece = first; piece < last; ++piece) {
+            if (verifier.state(piece) == tt::piece_state::invalid) {
+                std::cout << fmt::format("  {}\n", file_storage.at(i).path().string());
+                break;
+            }
+        }
+    }
+}
+
+/// Write resume data with the valid pieces of verifier next to the metafile.
+void write_resume_data(const dottorrent::metafile& m,
+                       const tt::piece_verifier& verifier,
+                       const verify_app_options& options)
+{
+    if (!options.fastresume) {
+        return;
+    }
+    const auto protocol = m.storage().protocol();
+    // hybrid metafiles verified with v1 pieces only match when all files are padded
+    if (verifier.piece_count() != tt::fastresume_piece_count(m.storage(), protocol)) {
+        throw std::runtime_error("Cannot write resume data: the verified pieces do not match the pieces of the metafile.");
+    }
+    std::vector<bool> have(verifier.piece_count());
+    for (std::size_t i = 0; i < have.size(); ++i) {
+        have[i] = verifier.state(i) == tt::piece_state::valid;
+    }
+    auto path = tt::fastresume_path(options.metafile);
+    tt::write_fastresume(path, m, protocol, have);
+    std::cout << fmt::format("Resume data written to: {}\n", path.string());
+}
+
+/// Throw when verification stopped at the first failed piece.
+void check_fail_fast(const dottorrent::metafile& m, const tt::piece_verifier& verifier, const verify_app_options& options)
+{
+    if (!options.fail_fast) {
+        return;
+    }
+    if (auto piece = verifier.first_failure(); piece) {
+        const auto& entry = m.storage().at(verifier.piece_file(*piece));
+        throw std::runtime_error(fmt::format("Piece {} failed verification: {}", *piece, entry.path().string()));
+    }
+}
+
+/// Verify until the first failure, without reporting the state of individual files.
+void verify_fail_fast(const dottorrent::metafile& m,
+                      const verify_app_options& options,
+                      dottorrent::protocol protocol,
+                      bool simple_progress)
+{
+    const auto& file_storage = m.storage();
+    check_protocol(m, protocol);
+
+    // missing and truncated files are found without reading any data
+    if (options.fail_fast) {
+        auto problems = check_files(file_storage, std::max<std::size_t>(options.threads, 1));
+        if (!problems.empty()) {
+            const auto& problem = problems.front();
+            auto reason = problem.status == file_status::missing ? "Missing file" : "File has a different size";
+            throw std::runtime_error(fmt::format("{}: {}", reason, file_storage.at(problem.index).path().string()));
+        }
+    }
+
+    auto verifier = tt::piece_verifier(file_storage, protocol, options.threads);
+    set_fail_fast(verifier, options);
+
+    std::cout << "Verifying files...\n";
+
+    if (simple_progress) {
+        run_with_simple_progress(std::cout, verifier, m);
+    } else {
+        run_with_progress(std::cout, verifier, m);
+    }
+
+    write_resume_data(m, verifier, options);
+    check_fail_fast(m, verifier, options);
+
+    if (auto failures = verifier.count(tt::piece_state::invalid); failures != 0) {
+        print_failed_files(m, verifier);
+        throw std::runtime_error(fmt::format("{} pieces failed verification.", failures));
+    }
+    std::cout << "All pieces are valid.\n";
 }
 
+/// Verify a random sample of the pieces and estimate the fraction of corrupt pieces.
+void verify_sample(const dottorrent::metafile& m,
+                   const verify_app_options& options,
+                   dottorrent::protocol protocol,
+                   bool simple_progress)
+{
+    const auto& file_storage = m.storage();
+    check_protocol(m, protocol);
+
+    auto verifier = tt::piece_verifier(file_storage, protocol, options.threads);
+    const auto piece_count = verifier.piece_count();
+    const auto sample_count = options.sample->resolve(piece_count);
+
+    // the default seed depends only on the metafile, so repeated runs check the same pieces
+    auto seed = options.seed.value_or(std::stoull(info_hash_string(m).substr(0, 16), nullptr, 16));
+    verifier.set_selection(tt::sample_pieces(piece_count, sample_count, seed));
+    set_fail_fast(verifier, options);
+
+    std::cout << fmt::format("Verifying a sample of {} of {} pieces (seed {})...\n", sample_count, piece_count, seed);
+
+    if (simple_progress) {
+        run_with_simple_progress(std::cout, verifier, m);
+    } else {
+        run_with_progress(std::cout, verifier, m);
+    }
+
+    check_fail_fast(m, verifier, options);
+
+    auto failures = verifier.count(tt::piece_state::invalid);
+    auto rate = sample_count == 0 ? 0.0 : static_cast<double>(failures) / static_cast<double>(sample_count);
+    auto upper_bound = tt::wilson_upper_bound(failures, sample_count);
+
+    std::cout << fmt::format("Failed pieces:       {} of {} sampled\n", failures, sample_count);
+    std::cout << fmt::format("Corruption rate:     {:.2f}% (95% upper bound {:.2f}%, at most {} of {} pieces)\n",
+                             100 * rate, 100 * upper_bound,
+                             static_cast<std::size_t>(std::ceil(upper_bound * static_cast<double>(piece_count))),
+                             piece_count);
+
+    if (failures == 0) {
+        return;
+    }
+    print_failed_files(m, verifier);
+    throw std::runtime_error(fmt::format("{} of {} sampled pieces failed verification.", failures, sample_count));
+}
+
+/// Verify the data served by the HTTP web seeds of the metafile, or a sample of it.
+void verify_web_seeds(const dottorrent::metafile& m,
+                      const verify_app_options& options,
+                      dottorrent::protocol protocol,
+                      bool simple_progress)
+{
+    const auto& file_storage = m.storage();
+    check_protocol(m, protocol);
+
+    std::vector<std::string> urls {};
+    for (const auto& url : m.web_seeds()) {
+        if (url.starts_with("http://") || url.starts_with("https://")) {
+            urls.push_back(url);
+        } else {
+            std::cout << fmt::format("Skipping web seed {}: only HTTP web seeds are supported.\n", url);
+        }
+    }
+    if (urls.empty()) {
+        throw std::invalid_argument("Metafile does not contain HTTP web seeds.");
+    }
+
+    std::size_t failed_seeds = 0;
+    for (const auto& url : urls) {
+        auto verifier = tt::web_seed_verifier(file_storage, m.name(), url, protocol, options.connections);
+        const auto piece_count = verifier.piece_count();
+        auto checked_count = piece_count;
+
+        if (options.sample) {
+            checked_count = options.sample->resolve(piece_count);
+            auto seed = options.seed.value_or(std::stoull(info_hash_string(m).substr(0, 16), nullptr, 16));
+            verifier.set_selection(tt::sample_pieces(piece_count, checked_count, seed));
+            std::cout << fmt::format("Verifying a sample of {} of {} pieces from web seed {} (seed {})...\n",
+                                     checked_count, piece_count, url, seed);
+        } else {
+            std::cout << fmt::format("Verifying web seed {}...\n", url);
+        }
+
+        if (simple_progress) {
+            run_with_simple_progress(std::cout, verifier, m);
+        } else {
+            run_with_progress(std::cout, verifier, m);
+        }
+
+        const auto& results = verifier.results();
+        print_verify_file_tree(m, results);
+
+        auto failures = results.count(tt::piece_state::invalid);
+        std::cout << fmt::format("Failed pieces:       {} of {}\n\n", failures, checked_count);
+        failed_seeds += (failures != 0);
+    }
+
+    if (failed_seeds != 0) {
+        throw std::runtime_error(fmt::format("{} of {} web seeds served invalid data.", failed_seeds, urls.size()));
+    }
+}
+
+/// Verify only the pieces overlapping the files matching the include and exclude patterns.
+/// v1 pieces at the boundary of a selected file can contain data of files that were not selected.
+/// When such a piece fails it is unknown which of the files is damaged.
+void verify_selected_files(const dottorrent::metafile& m,
+                           const verify_app_options& options,
+                           dottorrent::protocol protocol,
+                           bool simple_progress)
+{
+    const auto& file_storage = m.storage();
+    check_protocol(m, protocol);
+
+    auto files = select_files(file_storage, options.include_patterns, options.exclude_patterns);
+    auto verifier = tt::piece_verifier(file_storage, protocol, options.threads);
+    const auto piece_count = verifier.piece_count();
+
+    std::vector<bool> selection(piece_count);
+    for (std::size_t i = 0; i < file_storage.file_count(); ++i) {
+        if (files[i]) {
+            auto [first, last] = verifier.file_pieces(i);
+            std::fill(selection.begin() + first, selection.begin() + last, true);
+        }
+    }
+    // pieces that also contain data of files that were not selected
+    std::vector<bool> shared(piece_count);
+    for (std::size_t i = 0; i < file_storage.file_count(); ++i) {
+        if (!files[i] && !file_storage.at(i).is_padding_file()) {
+            auto [first, last] = verifier.file_pieces(i);
+            for (auto piece = first; piece < last; ++piece) {
+                shared[piece] = selection[piece];
+            }
+        }
+    }
+
+    auto selected_files = static_cast<std::size_t>(std::count(files.begin(), files.end(), true));
+    auto selected_pieces = static_cast<std::size_t>(std::count(selection.begin(), selection.end(), true));
+    verifier.set_selection(std::move(selection));
+    set_fail_fast(verifier, options);
+
+    std::cout << fmt::format("Verifying {} of {} files, {} of {} pieces...\n",
+                             selected_files, file_storage.file_count(), selected_pieces, piece_count);
+
+    if (simple_progress) {
+        run_with_simple_progress(std::cout, verifier, m);
+    } else {
+        run_with_progress(std::cout, verifier, m);
+    }
+
+    write_resume_data(m, verifier, options);
+    check_fail_fast(m, verifier, options);
+
+    std::cout << fmt::format("Failed pieces:       {} of {}\n",
+                             verifier.count(tt::piece_state::invalid), selected_pieces);
+    std::cout << "\nFiles:\n";
+
+    for (std::size_t i = 0; i < file_storage.file_count(); ++i) {
+        if (!files[i]) {
+            continue;
+        }
+        auto [first, last] = verifier.file_pieces(i);
+        std::size_t failed = 0;
+        std::size_t failed_shared = 0;
+        std::size_t unchecked = 0;
+
+        for (auto piece = first; piece < last; ++piece) {
+            auto state = verifier.state(piece);
+            if (state == tt::piece_state::invalid) {
+                ++failed;
+                failed_shared += shared[piece];
+            } else if (state == tt::piece_state::unchecked) {
+                ++unchecked;
+            }
+        }
+
+        const auto path = file_storage.at(i).path().string();
+        if (failed != failed_shared) {
+            std::cout << fmt::format("  failed        {} ({} of {} pieces)\n", path, failed, last - first);
+        } else if (failed != 0) {
+            std::cout << fmt::format("  inconclusive  {} (failed pieces also contain data of other files)\n", path);
+        } else if (unchecked != 0) {
+            std::cout << fmt::format("  unchecked     {}\n", path);
+        } else {
+            std::cout << fmt::format("  ok            {}\n", path);
+        }
+    }
+}
+
+/// Key identifying the data on disk and the expected hashes of the file at index,
+/// or std::nullopt when the result of the file cannot be shared with other metafiles.
+///
+/// v2 files are identified by their pieces root and the piece size.
+/// v1 files are identified by their piece hashes, which requires the pieces of the file to contain no data of other files.
+/// The layout is only used for v1.
+std::optional<std::string> shared_file_key(const dottorrent::file_storage& storage,
+                                           const tt::piece_verifier& verifier,
+                                           const tt::piece_layout* layout,
+                                           std::size_t index)
+{
+    const auto& entry = storage.at(index);
+    if (entry.is_padding_file() || entry.file_size() == 0) {
+        return std::nullopt;
+    }
+    tt::file_stat stat {};
+    try {
+        stat = tt::stat_file(storage.root_directory() / entry.path());
+    }
+    catch (const fs::filesystem_error&) {
+        return std::nullopt;
+    }
+    // device and inode are not available on all platforms
+    if (stat.device == 0 && stat.inode == 0) {
+        return std::nullopt;
+    }
+
+    auto key = fmt::format("{}:{}:{}:", stat.device, stat.inode, entry.file_size());
+
+    if (verifier.protocol() == dt::protocol::v2) {
+        return key + fmt::format("v2:{}:", storage.piece_size()) + tt::encode_hash(entry.pieces_root());
+    }
+
+    Expects(layout != nullptr);
+    if (!layout->is_aligned(index)) {
+        return std::nullopt;
+    }
+    // the tail piece must end with the torrent or be filled with padding
+    const auto end = layout->file_offset(index) + entry.file_size();
+    if (end % layout->piece_size() != 0 && end != layout->total_size()) {
+        auto next = index + 1;
+        while (next < storage.file_count() && storage.at(next).file_size() == 0) {
+            ++next;
+        }
+        if (next == storage.file_count() || !storage.at(next).is_padding_file()) {
+            return std::nullopt;
+        }
+    }
+
+    key += fmt::format("v1:{}:", layout->piece_size());
+    auto [first, last] = verifier.file_pieces(index);
+    for (auto piece = first; piece < last; ++piece) {
+        key += tt::encode_hash(storage.get_piece_hash(piece));
+    }
+    return key;
+}
+
+/// State of every piece of the file at index.
+std::vector<tt::piece_state> file_piece_states(const tt::piece_verifier& verifier, std::size_t index)
+{
+    auto [first, last] = verifier.file_pieces(index);
+    std::vector<tt::piece_state> states {};
+    states.reserve(last - first);
+    for (auto piece = first; piece < last; ++piece) {
+        states.push_back(verifier.state(piece));
+    }
+    return states;
+}
+
+/// Verify the data of a metafile, reusing the results of files that are shared with other metafiles of a batch.
+/// @returns the number of failed pieces and the number of pieces, and the number of files verified by other jobs.
+std::tuple<std::size_t, std::size_t, std::size_t>
+verify_batch_job(const dottorrent::metafile& m,
+                 dottorrent::protocol protocol,
+                 bool fail_fast,
+                 tt::shared_results& shared)
+{
+    const auto& storage = m.storage();
+    // threads are shared between jobs, every job is verified by a single worker
+    auto verifier = tt::piece_verifier(storage, protocol, 1);
+    const auto piece_count = verifier.piece_count();
+
+    std::optional<tt::piece_layout> layout {};
+    if (verifier.protocol() == dt::protocol::v1) {
+        layout.emplace(storage);
+    }
+
+    std::vector<std::pair<std::size_t, std::shared_ptr<tt::shared_result>>> owned {};
+    std::vector<std::pair<std::size_t, std::shared_ptr<tt::shared_result>>> waiting {};
+    std::vector<bool> selection(piece_count, true);
+
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        auto key = shared_file_key(storage, verifier, layout ? &*layout : nullptr, i);
+        if (!key) {
+            continue;
+        }
+        auto [result, owner] = shared.claim(*key);
+        if (owner) {
+            owned.emplace_back(i, std::move(result));
+        } else {
+            auto [first, last] = verifier.file_pieces(i);
+            std::fill(selection.begin() + first, selection.begin() + last, false);
+            waiting.emplace_back(i, std::move(result));
+        }
+    }
+
+    verifier.set_selection(std::move(selection));
+    if (fail_fast) {
+        verifier.set_fail_fast(tt::fail_fast_mode::all);
+    }
+
+    // other jobs wait for the results of owned files, so they are published whatever happens
+    try {
+        verifier.start();
+        verifier.wait();
+    }
+    catch (...) {
+        for (auto& [index, result] : owned) {
+            auto [first, last] = verifier.file_pieces(index);
+            result->publish(std::vector<tt::piece_state>(last - first, tt::piece_state::unchecked));
+        }
+        throw;
+    }
+    for (auto& [index, result] : owned) {
+        result->publish(file_piece_states(verifier, index));
+    }
+
+    auto failures = verifier.count(tt::piece_state::invalid);
+    if (fail_fast && failures != 0) {
+        return {failures, piece_count, 0};
+    }
+
+    // Pieces the owner did not verify, eg. because it stopped early, are verified here.
+    std::vector<bool> recheck(piece_count, false);
+    bool any_recheck = false;
+    for (auto& [index, result] : waiting) {
+        const auto& states = result->wait();
+        auto [first, last] = verifier.file_pieces(index);
+        Expects(states.size() == last - first);
+        for (std::size_t i = 0; i < states.size(); ++i) {
+            if (states[i] == tt::piece_state::unchecked) {
+                recheck[first + i] = true;
+                any_recheck = true;
+            } else if (states[i] == tt::piece_state::invalid) {
+                ++failures;
+            }
+        }
+    }
+    if (any_recheck) {
+        auto retry = tt::piece_verifier(storage, protocol, 1);
+        retry.set_selection(std::move(recheck));
+        retry.start();
+        retry.wait();
+        failures += retry.count(tt::piece_state::invalid);
+    }
+    return {failures, piece_count, waiting.size()};
+}
+
+/// Verify all jobs of a batch list with a shared pool of --threads workers,
+/// limiting the number of jobs reading from the same device at the same time.
+void run_verify_batch(const verify_app_options& options, std::ostream& os)
+{
+    if (options.state || options.sample || options.quick || options.fail_fast_per_file ||
+        !options.include_patterns.empty() || !options.exclude_patterns.empty()) {
+        throw std::invalid_argument("--batch cannot be combined with --state, --sample, --quick, "
+                                    "--fail-fast-per-file, --include or --exclude.");
+    }
+    if (!options.metafile.empty() || !options.files_root_directory.empty()) {
+        throw std::invalid_argument("--batch cannot be combined with a metafile and target.");
+    }
+    if (options.queue_depth == 0) {
+        throw std::invalid_argument("--queue-depth must be at least 1.");
+    }
+
+    auto jobs = read_verify_batch(*options.batch);
+    auto scheduler = tt::io_scheduler(options.threads);
+    auto shared = tt::shared_results();
+
+    std::size_t jobs_done = 0;
+    std::size_t jobs_failed = 0;
+    std::mutex output_mutex {};
+    auto start_time = std::chrono::system_clock::now();
+
+    for (const auto& job : jobs) {
+        auto device = tt::query_storage_device(job.target);
+        auto limit = device.rotational ? 1 : options.queue_depth;
+
+        scheduler.add(device.id, limit, [&]() {
+            std::string result {};
+            bool failed = true;
+            try {
+                verify_metafile(job.metafile);
+                // metafiles are only loaded when their job starts to keep memory bounded for large batches
+                auto m = dottorrent::load_metafile(job.metafile);
+                auto& storage = m.storage();
+                storage.set_root_directory(job.target);
+
+                auto protocol = options.protocol_version;
+                if (protocol == dottorrent::protocol::none) {
+                    protocol = storage.protocol();
+                }
+                check_protocol(m, protocol);
+
+                auto [failures, piece_count, reused] = verify_batch_job(m, protocol, options.fail_fast, shared);
+                if (failures != 0) {
+                    result = fmt::format("failed, {} of {} pieces", failures, piece_count);
+                } else {
+                    result = "ok";
+                    failed = false;
+                }
+                if (reused != 0) {
+                    result += fmt::format(" ({} files shared with other metafiles)", reused);
+                }
+            }
+            catch (const std::exception& e) {
+                result = fmt::format("error, {}", e.what());
+            }
+
+            std::unique_lock lock(output_mutex);
+            ++jobs_done;
+            jobs_failed += failed;
+            os << fmt::format("[{}/{}] {}: {}\n", jobs_done, jobs.size(), job.metafile.string(), result);
+            std::flush(os);
+        });
+    }
+
+    scheduler.run();
+
+    auto duration = std::chrono::system_clock::now() - start_time;
+    os << fmt::format("Verified {} metafiles in {}: {} ok, {} failed, {} files reused from other metafiles.\n",
+                      jobs.size(), tt::format_duration(duration), jobs.size() - jobs_failed, jobs_failed,
+                      shared.reused());
+
+    if (jobs_failed != 0) {
+        throw std::runtime_error(fmt::format("{} of {} metafiles failed verification.", jobs_failed, jobs.size()));
+    }
+}
+
+/// Verify only the pieces that are not known from the state file.
+void verify_with_state(const dottorrent::metafile& m,
+                       const verify_app_options& options,
+                       dottorrent::protocol protocol,
+                       bool simple_progress)
+{
+    const auto& file_storage = m.storage();
+
+    check_protocol(m, protocol);
+
+    auto verifier = tt::piece_verifier(file_storage, protocol, options.threads);
+    const auto piece_count = verifier.piece_count();
+
+    auto info_hash = info_hash_string(m);
+    auto state = tt::verify_state(*options.state);
+    bool loaded = state.load();
+
+    if (loaded && state.info_hash() != info_hash) {
+        throw std::invalid_argument(fmt::format(
+                "State file {} belongs to a different metafile.", options.state->string()));
+    }
+    if (!loaded || !state.matches(verifier.protocol(), piece_count)) {
+        if (options.recheck_failed) {
+            throw std::invalid_argument("No results of a previous run with the same protocol to recheck.");
+        }
+        state.reset(info_hash, verifier.protocol(), piece_count);
+    }
+
+    // Pieces of files that changed since the previous run are verified again,
+    // unless only failed pieces are rechecked after a repair.
+    if (!options.recheck_failed) {
+        for (auto index : state.changed_files(file_storage)) {
+            auto [first, last] = verifier.file_pieces(index);
+            for (auto piece = first; piece < last; ++piece) {
+                state.set_piece(piece, tt::piece_state::unchecked);
+            }
+        }
+    }
+
+    auto target_state = options.recheck_failed ? tt::piece_state::invalid : tt::piece_state::unchecked;
+    std::vector<bool> selection(piece_count);
+    for (std::size_t i = 0; i < piece_count; ++i) {
+        auto piece_state = state.piece(i);
+        selection[i] = piece_state == target_state;
+        verifier.set_piece_state(i, piece_state);
+    }
+    auto selected = static_cast<std::size_t>(std::count(selection.begin(), selection.end(), true));
+    verifier.set_selection(std::move(selection));
+    set_fail_fast(verifier, options);
+
+    state.update_files(file_storage);
+    state.save();
+    verifier.set_state(&state);
+    state.save_periodically(verify_state_interval);
+
+    std::cout << fmt::format("Verifying {} of {} pieces, {} known from {}...\n",
+                             selected, piece_count, piece_count - selected, options.state->filename().string());
+
+    if (simple_progress) {
+        run_with_simple_progress(std::cout, verifier, m);
+    } else {
+        run_with_progress(std::cout, verifier, m);
+    }
+
+    state.stop();
+    state.save();
+    write_resume_data(m, verifier, options);
+    check_fail_fast(m, verifier, options);
+
+    std::cout << fmt::format("Failed pieces:       {} of {}\n",
+                             verifier.count(tt::piece_state::invalid), piece_count);
+    print_verify_file_tree(m, verifier);
+}
+
+} // namespace
+
 
 void run_verify_app(const main_app_options& main_options, const verify_app_options& options)
 {
+    if (options.batch) {
+        if (options.fastresume || options.web_seed) {
+            throw std::invalid_argument("--fastresume and --web-seed cannot be combined with --batch.");
+        }
+        run_verify_batch(options, std::cout);
+        return;
+    }
+    if (options.metafile.empty() || (options.files_root_directory.empty() && !options.web_seed)) {
+        throw std::invalid_argument("A metafile and target are required.");
+    }
+
     verify_metafile(options.metafile);
 
     auto m = dottorrent::load_metafile(options.metafile);
 
     auto& file_storage = m.storage();
     // point the file storage to the target directory
-    file_storage.set_root_directory(options.files_root_directory);
+    if (!options.files_root_directory.empty()) {
+        file_storage.set_root_directory(options.files_root_directory);
+    }
 
 
     dottorrent::storage_verifier_options verifier_options {
@@ -81,6 +876,71 @@ void run_verify_app(const main_app_options& main_options, const verify_app_optio
     }
 #endif
 
+    if (options.recheck_failed && !options.state) {
+        throw std::invalid_argument("--recheck-failed requires --state.");
+    }
+    if (options.quick && (options.state || options.sample)) {
+        throw std::invalid_argument("--quick cannot be combined with --state or --sample.");
+    }
+    if (options.fastresume && (options.quick || options.sample)) {
+        throw std::invalid_argument("--fastresume cannot be combined with --quick or --sample.");
+    }
+    if (options.sample && options.state) {
+        throw std::invalid_argument("--sample cannot be combined with --state.");
+    }
+    if (options.fail_fast && options.fail_fast_per_file) {
+        throw std::invalid_argument("--fail-fast cannot be combined with --fail-fast-per-file.");
+    }
+    bool select = !options.include_patterns.empty() || !options.exclude_patterns.empty();
+    if (select && (options.quick || options.state || options.sample)) {
+        throw std::invalid_argument("--include and --exclude cannot be combined with --quick, --state or --sample.");
+    }
+    if (options.web_seed && (options.quick || options.state || options.fastresume || select ||
+                             options.fail_fast || options.fail_fast_per_file)) {
+        throw std::invalid_argument("--web-seed can only be combined with --sample.");
+    }
+    if (options.web_seed) {
+        verify_web_seeds(m, options, verifier_options.protocol_version, simple_progress);
+        return;
+    }
+    if (options.quick) {
+        verify_quick(m, options);
+        return;
+    }
+    if (options.sample) {
+        verify_sample(m, options, verifier_options.protocol_version, simple_progress);
+        return;
+    }
+    if (options.state) {
+        verify_with_state(m, options, verifier_options.protocol_version, simple_progress);
+        return;
+    }
+    if (select) {
+        verify_selected_files(m, options, verifier_options.protocol_version, simple_progress);
+        return;
+    }
+    if (options.fail_fast || options.fail_fast_per_file) {
+        verify_fail_fast(m, options, verifier_options.protocol_version, simple_progress);
+        return;
+    }
+    // the results of individual pieces are only available from the piece verifier
+    if (options.fastresume) {
+        check_protocol(m, verifier_options.protocol_version);
+        auto verifier = tt::piece_verifier(file_storage, verifier_options.protocol_version, options.threads);
+
+        std::cout << "Verifying files...\n";
+
+        if (simple_progress) {
+            run_with_simple_progress(std::cout, verifier, m);
+        } else {
+            run_with_progress(std::cout, verifier, m);
+        }
+
+        print_verify_file_tree(m, verifier);
+        write_resume_data(m, verifier, options);
+        return;
+    }
+
     auto verifier = dottorrent::storage_verifier(file_storage, verifier_options);
 
     std::cout << "Verifying files...\n";
@@ -91,19 +951,95 @@ void run_verify_app(const main_app_options& main_options, const verify_app_optio
         run_with_progress(std::cout, verifier, m);
     }
 
-    auto terminal_size = termcontrol::get_terminal_size();
-    tree_options tree_options {
-        .show_file_size = false,
-        .show_directory_size = false,
-        .max_entry_size = terminal_size.cols,
+    print_verify_file_tree(m, verifier);
+}
+
+
+std::vector<file_check_result> check_files(const dottorrent::file_storage& storage, std::size_t threads)
+{
+    std::vector<file_check_result> results(storage.file_count());
+    std::atomic_size_t next_index = 0;
+
+    auto check = [&]() {
+        for (auto i = next_index.fetch_add(1); i < storage.file_count(); i = next_index.fetch_add(1)) {
+            const auto& entry = storage.at(i);
+            results[i] = {i, file_status::ok, entry.file_size()};
+            if (entry.is_padding_file()) {
+                continue;
+            }
+            std::error_code ec {};
+            auto size = fs::file_size(storage.root_directory() / entry.path(), ec);
+            if (ec) {
+                results[i] = {i, file_status::missing, 0};
+            } else if (size != entry.file_size()) {
+                results[i] = {i, file_status::wrong_size, size};
+            }
+        }
     };
 
-    auto verify_file_tree = format_verify_file_tree(
-            m, verifier, "  ",
-            tree_options);
+    // metadata lookups are latency bound, especially on network filesystems, so they are done in parallel
+    {
+        std::vector<std::jthread> workers {};
+        for (std::size_t i = 1; i < threads; ++i) {
+            workers.emplace_back(check);
+        }
+        check();
+    }
 
-    std::cout << "\nFiles:\n";
-    std::cout << verify_file_tree;
+    std::erase_if(results, [](const auto& r) { return r.status == file_status::ok; });
+    return results;
+}
+
+
+std::vector<verify_job> read_verify_batch(const fs::path& path)
+{
+    std::ifstream f(path);
+    if (!f) {
+        throw std::invalid_argument(fmt::format("Could not read batch list: {}", path.string()));
+    }
+
+    std::vector<verify_job> jobs {};
+    std::string line {};
+    for (std::size_t line_number = 1; std::getline(f, line); ++line_number) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty() || line.starts_with('#')) {
+            continue;
+        }
+        auto separator = line.find('\t');
+        if (separator == std::string::npos || separator == 0 || separator + 1 == line.size()) {
+            throw std::invalid_argument(fmt::format(
+                    "Invalid batch list {}: line {} is not a metafile and target separated by a tab.",
+                    path.string(), line_number));
+        }
+        jobs.push_back({fs::path(line.substr(0, separator)), fs::path(line.substr(separator + 1))});
+    }
+    return jobs;
+}
+
+
+std::vector<bool> select_files(const dottorrent::file_storage& storage,
+                               const std::vector<std::string>& include_patterns,
+                               const std::vector<std::string>& exclude_patterns)
+{
+    tt::file_matcher matcher {};
+    for (const auto& pattern : include_patterns) {
+        matcher.include_pattern(pattern);
+    }
+    for (const auto& pattern : exclude_patterns) {
+        matcher.exclude_pattern(pattern);
+    }
+    // hidden files are part of the metafile and can only be skipped explicitly
+    matcher.include_hidden_files(true);
+    matcher.compile();
+
+    std::vector<bool> selection(storage.file_count());
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage.at(i);
+        selection[i] = !entry.is_padding_file() && matcher.matches(entry.path());
+    }
+    return selection;
 }
 
 
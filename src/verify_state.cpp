@@ -0,0 +1,229 @@
+#include <condition_variable>
+#include <fstream>
+
+#include <fmt/format.h>
+#include <bencode/bvalue.hpp>
+#include <bencode/encode.hpp>
+
+#include "verify_state.hpp"
+#include "file_stat.hpp"
+#include "hash_encoding.hpp"
+
+namespace bc = bencode;
+
+namespace torrenttools {
+
+namespace {
+
+constexpr std::int64_t verify_state_version = 1;
+
+} // namespace
+
+
+verify_state::verify_state(std::filesystem::path path)
+    : path_(std::move(path))
+{}
+
+verify_state::~verify_state()
+{
+    stop();
+}
+
+bool verify_state::load()
+{
+    if (!std::filesystem::exists(path_)) {
+        return false;
+    }
+    std::ifstream ifs(path_, std::ios::binary);
+    if (!ifs) {
+        throw std::invalid_argument(fmt::format("could not read verify state: {}", path_.string()));
+    }
+
+    std::scoped_lock lock(mutex_);
+    try {
+        auto bv = bc::decode_value(ifs);
+        if (get_integer(bv.at("version")) != verify_state_version) {
+            throw std::invalid_argument("unsupported version");
+        }
+        info_hash_ = get_string(bv.at("info hash"));
+        protocol_ = static_cast<dt::protocol>(get_integer(bv.at("protocol")));
+
+        auto piece_count = static_cast<std::size_t>(get_integer(bv.at("piece count")));
+        auto valid = decode_bitfield(get_string(bv.at("valid")), piece_count);
+        auto invalid = decode_bitfield(get_string(bv.at("invalid")), piece_count);
+
+        pieces_.assign(piece_count, piece_state::unchecked);
+        for (std::size_t i = 0; i < piece_count; ++i) {
+            if (valid[i]) {
+                pieces_[i] = piece_state::valid;
+            } else if (invalid[i]) {
+                pieces_[i] = piece_state::invalid;
+            }
+        }
+
+        files_.clear();
+        for (const auto& value : get_list(bv.at("files"))) {
+            files_.push_back({
+                .file_size = get_integer(value.at("length")),
+                .mtime_ns = get_integer(value.at("mtime")),
+            });
+        }
+    }
+    catch (const std::exception& e) {
+        throw std::invalid_argument(fmt::format("invalid verify state: {}: {}", path_.string(), e.what()));
+    }
+    return true;
+}
+
+void verify_state::reset(std::string info_hash, dt::protocol protocol, std::size_t piece_count)
+{
+    std::scoped_lock lock(mutex_);
+    info_hash_ = std::move(info_hash);
+    protocol_ = protocol;
+    pieces_.assign(piece_count, piece_state::unchecked);
+    files_.clear();
+}
+
+std::string verify_state::info_hash() const
+{
+    std::scoped_lock lock(mutex_);
+    return info_hash_;
+}
+
+bool verify_state::matches(dt::protocol protocol, std::size_t piece_count) const
+{
+    std::scoped_lock lock(mutex_);
+    return protocol == protocol_ && piece_count == pieces_.size();
+}
+
+std::vector<std::size_t> verify_state::changed_files(const dt::file_storage& storage) const
+{
+    auto current = stat_files(storage);
+
+    std::scoped_lock lock(mutex_);
+    std::vector<std::size_t> changed {};
+    for (std::size_t i = 0; i < current.size(); ++i) {
+        if (storage.at(i).is_padding_file()) {
+            continue;
+        }
+        if (i >= files_.size() || files_[i] != current[i] || current[i].file_size < 0) {
+            changed.push_back(i);
+        }
+    }
+    return changed;
+}
+
+void verify_state::update_files(const dt::file_storage& storage)
+{
+    auto current = stat_files(storage);
+    std::scoped_lock lock(mutex_);
+    files_ = std::move(current);
+}
+
+piece_state verify_state::piece(std::size_t index) const
+{
+    std::scoped_lock lock(mutex_);
+    return pieces_.at(index);
+}
+
+void verify_state::set_piece(std::size_t index, piece_state state)
+{
+    std::scoped_lock lock(mutex_);
+    pieces_.at(index) = state;
+}
+
+void verify_state::save() const
+{
+    auto root = bc::bvalue::dict_type {};
+    {
+        std::scoped_lock lock(mutex_);
+
+        std::vector<bool> valid(pieces_.size());
+        std::vector<bool> invalid(pieces_.size());
+        for (std::size_t i = 0; i < pieces_.size(); ++i) {
+            valid[i] = pieces_[i] == piece_state::valid;
+            invalid[i] = pieces_[i] == piece_state::invalid;
+        }
+
+        auto files = bc::bvalue::list_type {};
+        for (const auto& file : files_) {
+            auto dict = bc::bvalue::dict_type {};
+            dict["length"] = file.file_size;
+            dict["mtime"] = file.mtime_ns;
+            files.emplace_back(std::move(dict));
+        }
+
+        root["version"] = verify_state_version;
+        root["info hash"] = info_hash_;
+        root["protocol"] = static_cast<std::int64_t>(protocol_);
+        root["piece count"] = static_cast<std::int64_t>(pieces_.size());
+        root["valid"] = encode_bitfield(valid);
+        root["invalid"] = encode_bitfield(invalid);
+        root["files"] = std::move(files);
+    }
+
+    // write to a temporary file first so an interrupted write never corrupts the state
+    auto tmp_path = std::filesystem::path(path_).concat(".tmp");
+    {
+        std::ofstream ofs(tmp_path, std::ios::binary | std::ios::trunc);
+        if (!ofs) {
+            throw std::invalid_argument(fmt::format("could not write verify state: {}", tmp_path.string()));
+        }
+        bc::encode_to(ofs, bc::bvalue(std::move(root)));
+    }
+    std::filesystem::rename(tmp_path, path_);
+}
+
+void verify_state::save_periodically(std::chrono::seconds interval)
+{
+    stop();
+    saver_ = std::jthread([this, interval](std::stop_token token) {
+        std::mutex mutex {};
+        std::condition_variable_any cv {};
+        std::unique_lock lock(mutex);
+
+        while (!token.stop_requested()) {
+            cv.wait_for(lock, token, interval, [] { return false; });
+            if (token.stop_requested()) {
+                break;
+            }
+            try {
+                save();
+            }
+            catch (const std::exception&) {
+                // keep the previous state, the next attempt may succeed
+            }
+        }
+    });
+}
+
+void verify_state::stop()
+{
+    if (saver_.joinable()) {
+        saver_.request_stop();
+        saver_.join();
+    }
+}
+
+std::vector<verify_state::file_record> verify_state::stat_files(const dt::file_storage& storage)
+{
+    std::vector<file_record> records {};
+    records.reserve(storage.file_count());
+
+    for (const auto& entry : storage) {
+        if (entry.is_padding_file()) {
+            records.push_back({0, 0});
+            continue;
+        }
+        try {
+            auto status = stat_file(storage.root_directory() / entry.path());
+            records.push_back({static_cast<std::int64_t>(status.file_size), status.mtime_ns});
+        }
+        catch (const std::filesystem::filesystem_error&) {
+            records.push_back({-1, 0});
+        }
+    }
+    return records;
+}
+
+} // namespace torrenttools
@@ -0,0 +1,281 @@
+#include <algorithm>
+#include <bit>
+#include <cctype>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <fmt/format.h>
+#include <dottorrent/hasher/factory.hpp>
+
+#include "web_seed_verifier.hpp"
+#include "merkle.hpp"
+#include "zero_data.hpp"
+
+namespace torrenttools {
+
+namespace {
+
+/// Number of pieces requested per connection, so HTTP/2 connections are kept busy between pieces.
+constexpr std::size_t requests_per_connection = 4;
+
+std::string percent_encode(std::string_view s)
+{
+    std::string result {};
+    for (unsigned char c : s) {
+        if (std::isalnum(c) || c == '-' || c == '.' || c == '_' || c == '~') {
+            result.push_back(static_cast<char>(c));
+        } else {
+            result += fmt::format("%{:02X}", c);
+        }
+    }
+    return result;
+}
+
+} // namespace
+
+
+std::string web_seed_file_url(std::string_view url,
+                              std::string_view name,
+                              dt::file_mode mode,
+                              const std::filesystem::path& file_path)
+{
+    std::string result(url);
+    if (mode == dt::file_mode::single && !result.ends_with('/')) {
+        return result;
+    }
+    if (!result.ends_with('/')) {
+        result.push_back('/');
+    }
+    result += percent_encode(name);
+    if (mode == dt::file_mode::multi) {
+        for (const auto& part : file_path) {
+            result.push_back('/');
+            result += percent_encode(part.string());
+        }
+    }
+    return result;
+}
+
+
+web_seed_verifier::web_seed_verifier(const dt::file_storage& storage,
+                                     std::string name,
+                                     std::string url,
+                                     dt::protocol protocol,
+                                     std::size_t connections)
+    : storage_(storage)
+    , layout_(storage)
+    , pieces_(storage, protocol)
+    , connections_(std::max<std::size_t>(connections, 1))
+{
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        const auto& entry = storage.at(i);
+        file_urls_.push_back(web_seed_file_url(url, name, storage.file_mode(), entry.path()));
+
+        if (pieces_.protocol() == dt::protocol::v1) {
+            file_offsets_.push_back(layout_.file_offset(i));
+        } else {
+            // padding files are not part of the v2 pieces
+            file_offsets_.push_back(total_size_);
+            if (!entry.is_padding_file()) {
+                total_size_ += entry.file_size();
+            }
+        }
+    }
+    if (pieces_.protocol() == dt::protocol::v1) {
+        total_size_ = layout_.total_size();
+    }
+    selection_.assign(piece_count(), true);
+}
+
+void web_seed_verifier::set_selection(std::vector<bool> selection)
+{
+    Expects(selection.size() == piece_count());
+    selection_ = std::move(selection);
+}
+
+void web_seed_verifier::start()
+{
+    Expects(!worker_.joinable());
+
+    std::size_t bytes_skipped = 0;
+    for (std::size_t piece = 0; piece < piece_count(); ++piece) {
+        if (!selection_[piece]) {
+            bytes_skipped += pieces_.piece_bytes(piece);
+        }
+    }
+    bytes_done_.store(bytes_skipped, std::memory_order_relaxed);
+    worker_ = std::jthread([this]() { run(); });
+}
+
+void web_seed_verifier::wait()
+{
+    if (worker_.joinable()) {
+        worker_.join();
+    }
+    if (error_) {
+        std::rethrow_exception(error_);
+    }
+}
+
+std::pair<std::size_t, std::size_t> web_seed_verifier::current_file_progress() const noexcept
+{
+    auto offset = next_offset_.load(std::memory_order_relaxed);
+    if (offset >= total_size_) {
+        return {storage_.file_count(), 0};
+    }
+    auto it = std::upper_bound(file_offsets_.begin(), file_offsets_.end(), offset);
+    auto index = static_cast<std::size_t>(std::distance(file_offsets_.begin(), it)) - 1;
+    return {index, offset - file_offsets_[index]};
+}
+
+void web_seed_verifier::run()
+{
+    try {
+        range_fetcher fetcher(connections_ * requests_per_connection, connections_);
+        for (std::size_t i = 0; i < connections_ * requests_per_connection; ++i) {
+            start_next_piece(fetcher);
+        }
+        fetcher.run();
+    }
+    catch (...) {
+        error_ = std::current_exception();
+    }
+    // let progress reporting terminate
+    next_offset_.store(total_size_, std::memory_order_relaxed);
+    bytes_done_.store(total_size_, std::memory_order_relaxed);
+}
+
+void web_seed_verifier::start_next_piece(range_fetcher& fetcher)
+{
+    while (next_piece_ < piece_count() && !selection_[next_piece_]) {
+        ++next_piece_;
+    }
+    if (next_piece_ == piece_count()) {
+        next_offset_.store(total_size_, std::memory_order_relaxed);
+        return;
+    }
+
+    auto piece = next_piece_++;
+    auto& job = jobs_.emplace_back();
+    job.position = std::prev(jobs_.end());
+    job.piece = piece;
+    job.segments = piece_segments(piece);
+
+    const auto& first = job.segments.front();
+    next_offset_.store(file_offsets_[first.file] + first.offset, std::memory_order_relaxed);
+
+    if (pieces_.protocol() == dt::protocol::v1) {
+        job.hasher = dt::make_hasher(dt::hash_function::sha1);
+    } else {
+        job.hasher = dt::make_hasher(dt::hash_function::sha256);
+        job.block.reserve(v2_block_size);
+    }
+    fetch_next_segment(fetcher, job);
+}
+
+void web_seed_verifier::fetch_next_segment(range_fetcher& fetcher, piece_job& job)
+{
+    // padding files are not served by web seeds, their data is all zeros
+    while (job.next_segment < job.segments.size() && storage_.at(job.segments[job.next_segment].file).is_padding_file()) {
+        for (auto remaining = job.segments[job.next_segment].length; remaining > 0;) {
+            auto zeros = zero_bytes(remaining);
+            update(job, zeros);
+            remaining -= zeros.size();
+        }
+        ++job.next_segment;
+    }
+    if (job.next_segment == job.segments.size()) {
+        complete_piece(fetcher, job, true);
+        return;
+    }
+
+    const auto& s = job.segments[job.next_segment];
+    fetcher.add(file_urls_[s.file], s.offset, s.length,
+                [this, &job](std::span<const std::byte> data) { update(job, data); },
+                [this, &fetcher, &job](bool received) {
+                    if (!received) {
+                        complete_piece(fetcher, job, false);
+                        return;
+                    }
+                    ++job.next_segment;
+                    fetch_next_segment(fetcher, job);
+                });
+}
+
+void web_seed_verifier::update(piece_job& job, std::span<const std::byte> data)
+{
+    if (pieces_.protocol() == dt::protocol::v1) {
+        job.hasher->update(data);
+        return;
+    }
+    while (!data.empty()) {
+        auto n = std::min(v2_block_size - job.block.size(), data.size());
+        job.block.insert(job.block.end(), data.begin(), data.begin() + n);
+        data = data.subspan(n);
+
+        if (job.block.size() == v2_block_size) {
+            job.hasher->update(job.block);
+            job.hasher->finalize_to(hash_bytes(job.leaves.emplace_back()));
+            job.block.clear();
+        }
+    }
+}
+
+void web_seed_verifier::complete_piece(range_fetcher& fetcher, piece_job& job, bool received)
+{
+    const auto piece_size = storage_.piece_size();
+    bool valid = false;
+
+    if (received && pieces_.protocol() == dt::protocol::v1) {
+        dt::sha1_hash hash {};
+        job.hasher->finalize_to(hash_bytes(hash));
+        valid = hash == storage_.get_piece_hash(job.piece);
+    }
+    else if (received) {
+        if (!job.block.empty()) {
+            job.hasher->update(job.block);
+            job.hasher->finalize_to(hash_bytes(job.leaves.emplace_back()));
+        }
+        // same as piece_verifier: files larger than a piece are checked against their piece layer
+        const auto& s = job.segments.front();
+        const auto& entry = storage_.at(s.file);
+        if (entry.file_size() > piece_size) {
+            auto root = merkle_root(job.leaves, piece_size / v2_block_size);
+            valid = root == entry.piece_layer().at(s.offset / piece_size);
+        } else {
+            valid = merkle_root(job.leaves, std::bit_ceil(job.leaves.size())) == entry.pieces_root();
+        }
+    }
+
+    pieces_.set_piece_state(job.piece, valid ? piece_state::valid : piece_state::invalid);
+    bytes_done_.fetch_add(pieces_.piece_bytes(job.piece), std::memory_order_relaxed);
+
+    jobs_.erase(job.position);
+    start_next_piece(fetcher);
+}
+
+std::vector<web_seed_verifier::segment> web_seed_verifier::piece_segments(std::size_t piece) const
+{
+    const auto piece_size = storage_.piece_size();
+    std::vector<segment> segments {};
+
+    if (pieces_.protocol() == dt::protocol::v2) {
+        auto file = pieces_.piece_file(piece);
+        auto first = pieces_.file_pieces(file).first;
+        segments.push_back({file, (piece - first) * piece_size, pieces_.piece_bytes(piece)});
+        return segments;
+    }
+
+    // v1 pieces span file boundaries
+    const auto begin = piece * piece_size;
+    const auto end = begin + pieces_.piece_bytes(piece);
+    for (auto position = begin; position < end;) {
+        auto file = layout_.file_at(position);
+        auto file_offset = layout_.file_offset(file);
+        auto length = std::min(end, file_offset + storage_.at(file).file_size()) - position;
+        segments.push_back({file, position - file_offset, length});
+        position += length;
+    }
+    return segments;
+}
+
+} // namespace torrenttools
@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <vector>
+
+#include <gsl-lite/gsl-lite.hpp>
+#include <dottorrent/hasher/factory.hpp>
+
+#include "zero_data.hpp"
+#include "merkle.hpp"
+
+namespace torrenttools {
+
+namespace {
+
+constexpr std::size_t zero_buffer_size = 1024 * 1024;
+
+const std::vector<std::byte>& zero_buffer()
+{
+    static const std::vector<std::byte> buffer(zero_buffer_size);
+    return buffer;
+}
+
+} // namespace
+
+
+bool is_zero(std::span<const std::byte> data) noexcept
+{
+    constexpr std::size_t lanes = 8;
+    std::uint64_t words[lanes];
+
+    while (data.size() >= sizeof(words)) {
+        std::memcpy(words, data.data(), sizeof(words));
+        std::uint64_t acc = 0;
+        for (auto w : words) {
+            acc |= w;
+        }
+        if (acc != 0) {
+            return false;
+        }
+        data = data.subspan(sizeof(words));
+    }
+    return std::all_of(data.begin(), data.end(), [](std::byte b) { return b == std::byte {0}; });
+}
+
+std::span<const std::byte> zero_bytes(std::size_t max_size) noexcept
+{
+    return std::span(zero_buffer()).first(std::min(max_size, zero_buffer_size));
+}
+
+const dt::sha1_hash& zero_piece_sha1(std::size_t piece_size)
+{
+    Expects(piece_size > 0);
+
+    // std::map keeps references to existing elements valid when it grows.
+    static std::map<std::size_t, dt::sha1_hash> hashes {};
+    static std::mutex mutex {};
+
+    std::scoped_lock lock(mutex);
+    auto [it, inserted] = hashes.try_emplace(piece_size);
+    if (inserted) {
+        auto hasher = dt::make_hasher(dt::hash_function::sha1);
+        for (std::size_t remaining = piece_size; remaining != 0;) {
+            auto data = zero_bytes(remaining);
+            hasher->update(data);
+            remaining -= data.size();
+        }
+        hasher->finalize_to(hash_bytes(it->second));
+    }
+    return it->second;
+}
+
+const dt::sha256_hash& zero_block_sha256()
+{
+    static const dt::sha256_hash hash = []() {
+        dt::sha256_hash result {};
+        auto hasher = dt::make_hasher(dt::hash_function::sha256);
+        hasher->update(zero_bytes(v2_block_size));
+        hasher->finalize_to(hash_bytes(result));
+        return result;
+    }();
+    return hash;
+}
+
+const dt::sha256_hash& zero_piece_sha256(std::size_t piece_size)
+{
+    Expects(std::has_single_bit(piece_size));
+    Expects(piece_size >= v2_block_size);
+
+    static std::map<std::size_t, dt::sha256_hash> hashes {};
+    static std::mutex mutex {};
+
+    std::scoped_lock lock(mutex);
+    auto [it, inserted] = hashes.try_emplace(piece_size, zero_block_sha256());
+    if (inserted) {
+        // every layer of a subtree of zero blocks consists of identical nodes
+        for (auto width = piece_size / v2_block_size; width > 1; width /= 2) {
+            it->second = merkle_hash_pair(it->second, it->second);
+        }
+    }
+    return it->second;
+}
+
+} // namespace torrenttools
@@ -0,0 +1,179 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/storage_hasher.hpp>
+
+#include "checkpoint.hpp"
+#include "per_file_hasher.hpp"
+#include "piece_hasher.hpp"
+#include "piece_layout.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+TEST_CASE("test create_checkpoint")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    auto checkpoint_file = tmp_dir.path() / "checkpoint";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 4 * 16384, 'b');
+    write_file(root / "c.bin", 5, 'c');
+
+    constexpr std::size_t piece_size = 32768;
+
+    SECTION("v1 pieces round trip") {
+        auto storage = make_storage(root, piece_size);
+        auto checkpoint = tt::create_checkpoint(checkpoint_file);
+        checkpoint.set_inputs(storage, dt::protocol::v1);
+        checkpoint.add_piece(2, dt::sha1_hash {});
+        checkpoint.save();
+
+        auto loaded = tt::create_checkpoint(checkpoint_file);
+        loaded.load();
+        CHECK(loaded.piece_size() == piece_size);
+        CHECK(loaded.completed_pieces() == 1);
+        CHECK(loaded.find_piece(2));
+        CHECK_FALSE(loaded.find_piece(1));
+        CHECK_NOTHROW(loaded.check_inputs(storage, dt::protocol::v1));
+        CHECK_THROWS_AS(loaded.check_inputs(storage, dt::protocol::v2), std::invalid_argument);
+
+        loaded.remove();
+        CHECK_FALSE(fs::exists(checkpoint_file));
+    }
+
+    SECTION("modified files are detected") {
+        auto storage = make_storage(root, piece_size);
+        auto checkpoint = tt::create_checkpoint(checkpoint_file);
+        checkpoint.set_inputs(storage, dt::protocol::v2);
+        checkpoint.save();
+
+        fs::last_write_time(root / "b.bin", fs::last_write_time(root / "b.bin") + std::chrono::hours(1));
+
+        auto loaded = tt::create_checkpoint(checkpoint_file);
+        loaded.load();
+        CHECK_THROWS_AS(loaded.check_inputs(storage, dt::protocol::v2), std::invalid_argument);
+    }
+
+    SECTION("invalid checkpoint file") {
+        std::ofstream(checkpoint_file) << "not a checkpoint";
+        auto checkpoint = tt::create_checkpoint(checkpoint_file);
+        CHECK_THROWS_AS(checkpoint.load(), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test resume from checkpoint matches storage_hasher")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    auto checkpoint_file = tmp_dir.path() / "checkpoint";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 4 * 16384, 'b');
+    write_file(root / "c.bin", 5, 'c');
+
+    constexpr std::size_t piece_size = 32768;
+
+    SECTION("v1 per piece") {
+        auto expected = make_storage(root, piece_size);
+        auto reference = dt::storage_hasher(expected, {.protocol_version = dt::protocol::v1});
+        reference.start();
+        reference.wait();
+
+        // simulate an interrupted run which completed every other piece
+        auto storage = make_storage(root, piece_size);
+        auto checkpoint = tt::create_checkpoint(checkpoint_file);
+        checkpoint.set_inputs(storage, dt::protocol::v1);
+        const auto piece_count = tt::piece_layout(storage).piece_count();
+        for (std::size_t i = 0; i < piece_count; i += 2) {
+            checkpoint.add_piece(i, expected.get_piece_hash(i));
+        }
+        checkpoint.save();
+
+        auto resumed = tt::create_checkpoint(checkpoint_file);
+        resumed.load();
+        resumed.check_inputs(storage, dt::protocol::v1);
+
+        auto hasher = tt::piece_hasher(storage, 2);
+        hasher.set_checkpoint(&resumed);
+        hasher.start();
+        hasher.wait();
+
+        CHECK(hasher.resumed_pieces() == (piece_count + 1) / 2);
+        CHECK(resumed.completed_pieces() == piece_count);
+        for (std::size_t i = 0; i < piece_count; ++i) {
+            CHECK(storage.get_piece_hash(i) == expected.get_piece_hash(i));
+        }
+    }
+
+    SECTION("v2 per file") {
+        auto expected = make_storage(root, piece_size);
+        auto reference = dt::storage_hasher(expected, {.protocol_version = dt::protocol::v2});
+        reference.start();
+        reference.wait();
+
+        auto first = make_storage(root, piece_size);
+        auto checkpoint = tt::create_checkpoint(checkpoint_file);
+        checkpoint.set_inputs(first, dt::protocol::v2);
+        auto hasher = tt::per_file_hasher(first, dt::protocol::v2, 2);
+        hasher.set_checkpoint(&checkpoint);
+        hasher.start();
+        hasher.wait();
+        checkpoint.save();
+
+        auto storage = make_storage(root, piece_size);
+        auto resumed = tt::create_checkpoint(checkpoint_file);
+        resumed.load();
+        auto resumed_hasher = tt::per_file_hasher(storage, dt::protocol::v2, 2);
+        resumed_hasher.set_checkpoint(&resumed);
+        resumed_hasher.start();
+        resumed_hasher.wait();
+
+        CHECK(resumed_hasher.resumed_files() == 3);
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            CHECK(storage.at(i).pieces_root() == expected.at(i).pieces_root());
+        }
+    }
+    SECTION("hybrid ranges of a partially hashed file") {
+        auto expected = make_storage(root, piece_size);
+        tt::align_to_pieces(expected);
+        auto reference = dt::storage_hasher(expected, {.protocol_version = dt::protocol::hybrid});
+        reference.start();
+        reference.wait();
+
+        // simulate an interrupted run which completed the first and third piece sized range of a.bin
+        auto storage = make_storage(root, piece_size);
+        tt::align_to_pieces(storage);
+        auto checkpoint = tt::create_checkpoint(checkpoint_file);
+        checkpoint.set_inputs(storage, dt::protocol::hybrid);
+        for (std::size_t offset : {std::size_t(0), 2 * piece_size}) {
+            auto hashes = tt::hash_file_range(root / "a.bin", dt::protocol::hybrid, piece_size, offset, piece_size);
+            checkpoint.add_file_range(0, offset, hashes);
+        }
+        checkpoint.save();
+
+        auto resumed = tt::create_checkpoint(checkpoint_file);
+        resumed.load();
+        resumed.check_inputs(storage, dt::protocol::hybrid);
+
+        auto hasher = tt::per_file_hasher(storage, dt::protocol::hybrid);
+        hasher.set_split_size(piece_size);
+        hasher.set_checkpoint(&resumed);
+        hasher.start();
+        hasher.wait();
+
+        CHECK(hasher.resumed_ranges() == 2);
+        CHECK(resumed.completed_files() == 3);
+        CHECK_FALSE(resumed.find_file_range(0, 0));
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            if (storage.at(i).is_padding_file()) continue;
+            CHECK(storage.at(i).pieces_root() == expected.at(i).pieces_root());
+        }
+        for (std::size_t i = 0; i < tt::piece_layout(storage).piece_count(); ++i) {
+            CHECK(storage.get_piece_hash(i) == expected.get_piece_hash(i));
+        }
+    }
+}
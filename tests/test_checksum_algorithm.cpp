@@ -0,0 +1,70 @@
+#include <catch2/catch.hpp>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "checksum_algorithm.hpp"
+
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+static std::string checksum_hex(const tt::checksum_algorithm& algorithm, std::string_view data)
+{
+    auto hasher = tt::make_checksum_hasher(algorithm);
+    hasher->update(std::span(reinterpret_cast<const std::byte*>(data.data()), data.size()));
+    std::vector<std::byte> value(hasher->digest_size());
+    hasher->finalize_to(value);
+
+    std::string result {};
+    for (auto b : value) {
+        result += fmt::format("{:02x}", std::to_integer<unsigned>(b));
+    }
+    return result;
+}
+
+TEST_CASE("test checksum algorithm names")
+{
+    for (auto f : tt::fast_checksum_algorithms()) {
+        CHECK(tt::make_fast_checksum(tt::to_string(f)) == f);
+        CHECK(tt::make_checksum_algorithm(tt::to_string(f)) == tt::checksum_algorithm(f));
+    }
+    CHECK(tt::make_checksum_algorithm("sha1") == tt::checksum_algorithm(dt::hash_function::sha1));
+    CHECK_FALSE(tt::make_checksum_algorithm("xxh3"));
+}
+
+TEST_CASE("test fast checksums")
+{
+    SECTION("crc32c") {
+        CHECK(checksum_hex(tt::fast_checksum::crc32c, "") == "00000000");
+        CHECK(checksum_hex(tt::fast_checksum::crc32c, "123456789") == "e3069283");
+    }
+    SECTION("xxh3-128") {
+        CHECK(checksum_hex(tt::fast_checksum::xxh3_128, "") == "99aa06d3014798d86001c324468d497f");
+    }
+    SECTION("blake3") {
+        CHECK(checksum_hex(tt::fast_checksum::blake3, "") ==
+              "af1349b9f5f9a1a6a0404dea36dcc9499bcb25c9adc112b7cc9a93cae41f3262");
+    }
+    SECTION("incremental updates") {
+        std::string data(100'000, 'x');
+        for (std::size_t i = 0; i < data.size(); ++i) {
+            data[i] = static_cast<char>(i % 251);
+        }
+        for (auto f : tt::fast_checksum_algorithms()) {
+            auto hasher = tt::make_checksum_hasher(f);
+            auto bytes = std::span(reinterpret_cast<const std::byte*>(data.data()), data.size());
+            hasher->update(bytes.first(3));
+            hasher->update(bytes.subspan(3));
+            std::vector<std::byte> value(hasher->digest_size());
+            hasher->finalize_to(value);
+            CHECK(value.size() == tt::digest_size(f));
+
+            std::string hex {};
+            for (auto b : value) {
+                hex += fmt::format("{:02x}", std::to_integer<unsigned>(b));
+            }
+            CHECK(hex == checksum_hex(f, data));
+        }
+    }
+}
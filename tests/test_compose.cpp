@@ -0,0 +1,79 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+#include <dottorrent/metafile.hpp>
+
+#include "compose.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+
+static dt::metafile make_metafile(const fs::path& root,
+                                  std::string name,
+                                  const std::vector<fs::path>& files,
+                                  const std::unordered_set<dt::hash_function>& checksums = {})
+{
+    dt::metafile m {};
+    set_storage_files(m.storage(), root, 32768, files);
+    m.set_name(std::move(name));
+    hash_storage(m.storage(), dt::protocol::v2, checksums);
+    return m;
+}
+
+TEST_CASE("test compose metafiles")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "season-1" / "e1.mkv", 100'000, 'a');
+    write_file(root / "season-1" / "e2.mkv", 70'000, 'b');
+    write_file(root / "season-2" / "e1.mkv", 50'000, 'c');
+
+    auto s1 = make_metafile(root / "season-1", "season-1", {"e1.mkv", "e2.mkv"});
+    auto s2 = make_metafile(root / "season-2", "season-2", {"e1.mkv"});
+    auto expected = make_metafile(root, "series", {"season-1/e1.mkv", "season-1/e2.mkv", "season-2/e1.mkv"});
+
+    auto m = compose_metafiles({s1, s2}, "series", dt::protocol::v2);
+
+    CHECK(m.name() == "series");
+    REQUIRE(m.storage().file_count() == 3);
+    for (std::size_t i = 0; i < 3; ++i) {
+        CHECK(m.storage().at(i).path() == expected.storage().at(i).path());
+        CHECK(m.storage().at(i).pieces_root() == expected.storage().at(i).pieces_root());
+    }
+    CHECK(dt::info_hash_v2(m) == dt::info_hash_v2(expected));
+
+    SECTION("duplicate names") {
+        CHECK_THROWS_AS(compose_metafiles({s1, s1}, "series", dt::protocol::v2), std::invalid_argument);
+    }
+    SECTION("v1 metafile") {
+        auto v1 = dt::load_metafile(fedora_torrent);
+        CHECK_THROWS_AS(compose_metafiles({s1, v1}, "series", dt::protocol::v2), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test compose metafiles keeps per-file checksums")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "season-1" / "e1.mkv", 100'000, 'a');
+    write_file(root / "season-2" / "e1.mkv", 50'000, 'c');
+
+    auto s1 = make_metafile(root / "season-1", "season-1", {"e1.mkv"}, {dt::hash_function::sha1});
+    auto s2 = make_metafile(root / "season-2", "season-2", {"e1.mkv"}, {dt::hash_function::sha1});
+
+    auto m = compose_metafiles({s1, s2}, "series", dt::protocol::v2);
+
+    REQUIRE(m.storage().file_count() == 2);
+    for (std::size_t i = 0; i < 2; ++i) {
+        const auto& source = (i == 0 ? s1 : s2).storage().at(0);
+        const auto& entry = m.storage().at(i);
+        REQUIRE(entry.checksums().contains("sha1"));
+        auto expected = source.checksums().at("sha1")->value();
+        auto actual = entry.checksums().at("sha1")->value();
+        CHECK(std::equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+    }
+}
@@ -6,7 +6,12 @@
 #include <CLI/CLI.hpp>
 
 #include <dottorrent/dht_node.hpp>
+#include <dottorrent/hasher/factory.hpp>
 #include "create.hpp"
+#include "file_hasher.hpp"
+#include "hash_index.hpp"
+#include "metafile_extras.hpp"
+#include "piece_layout.hpp"
 #include "tracker_database.hpp"
 #include "test_resources.hpp"
 #include "config_parser.hpp"
@@ -922,6 +927,168 @@ TEST_CASE("test create app: private flag")
     }
 }
 
+TEST_CASE("test create app: fastresume")
+{
+    temporary_directory tmp_dir{};
+    main_app_options main_options{};
+
+    fs::path output = fs::path(tmp_dir)/"test-create-fastresume.torrent";
+
+    create_app_options options{
+            .target = fs::path(TEST_DIR)/"resources",
+            .destination = output,
+            .protocol_version = dt::protocol::hybrid,
+    };
+    options.fastresume = true;
+
+    SECTION("resume data is written next to the metafile") {
+        run_create_app(main_options, options);
+        CHECK(fs::exists(fs::path(tmp_dir)/"test-create-fastresume.fastresume"));
+    }
+    SECTION("not with stdout") {
+        options.write_to_stdout = true;
+        CHECK_THROWS_AS(run_create_app(main_options, options), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test create app: hash-index")
+{
+    temporary_directory tmp_dir{};
+    main_app_options main_options{};
+
+    fs::path output = fs::path(tmp_dir)/"test-create-hash-index.torrent";
+    fs::path index_path = fs::path(tmp_dir)/"test-create-hash-index.idx";
+    auto protocol = GENERATE(dt::protocol::v1, dt::protocol::v2, dt::protocol::hybrid);
+
+    create_app_options options{
+            .target = fs::path(TEST_DIR)/"resources",
+            .destination = output,
+            .protocol_version = protocol,
+    };
+    options.hash_index = index_path;
+
+    SECTION("index matches the metafile") {
+        run_create_app(main_options, options);
+        auto m = dt::load_metafile(output);
+        const auto& storage = m.storage();
+        auto index = tt::hash_index(index_path);
+
+        CHECK(index.protocol() == protocol);
+        CHECK(index.piece_size() == storage.piece_size());
+        REQUIRE(index.file_count() == storage.file_count());
+
+        if (tt::has_v1(protocol)) {
+            CHECK(index.info_hash_v1() == dt::info_hash_v1(m));
+            auto piece_count = tt::piece_layout(storage).piece_count();
+            REQUIRE(index.pieces().size() == piece_count);
+            CHECK(index.pieces().front() == storage.get_piece_hash(0));
+            CHECK(index.pieces().back() == storage.get_piece_hash(piece_count - 1));
+        }
+        if (tt::has_v2(protocol)) {
+            CHECK(index.info_hash_v2() == dt::info_hash_v2(m));
+            for (std::size_t i = 0; i < storage.file_count(); ++i) {
+                const auto& entry = storage.at(i);
+                CHECK(index.file_size(i) == entry.file_size());
+                if (entry.is_padding_file() || entry.file_size() == 0) {
+                    CHECK(index.tree(i).empty());
+                    continue;
+                }
+                CHECK(index.leaf_count(i) == (entry.file_size() + tt::v2_block_size - 1) / tt::v2_block_size);
+                CHECK(index.tree(i).back() == entry.pieces_root());
+            }
+        }
+    }
+    SECTION("not with --based-on") {
+        options.based_on = fs::path(TEST_RESOURCES_DIR) / "resources-hybrid.torrent";
+        CHECK_THROWS_AS(run_create_app(main_options, options), std::invalid_argument);
+        CHECK_FALSE(fs::exists(index_path));
+    }
+}
+
+TEST_CASE("test create app: checksum")
+{
+    temporary_directory tmp_dir{};
+    main_app_options main_options{};
+
+    fs::path output = fs::path(tmp_dir)/"test-create-checksum.torrent";
+    auto protocol = GENERATE(dt::protocol::v1, dt::protocol::v2, dt::protocol::hybrid);
+
+    create_app_options options{
+            .target = fs::path(TEST_DIR)/"resources",
+            .destination = output,
+            .protocol_version = protocol,
+    };
+    options.checksums = {dt::hash_function::sha1};
+    options.threads = 2;
+
+    run_create_app(main_options, options);
+    auto m = dt::load_metafile(output);
+    const auto& storage = m.storage();
+
+    for (const auto& entry : storage) {
+        if (entry.is_padding_file()) {
+            continue;
+        }
+        std::vector<std::byte> content(entry.file_size());
+        std::ifstream ifs(fs::path(TEST_DIR) / "resources" / entry.path(), std::ios::binary);
+        ifs.read(reinterpret_cast<char*>(content.data()), static_cast<std::streamsize>(content.size()));
+
+        auto hasher = dt::make_hasher(dt::hash_function::sha1);
+        dt::sha1_hash expected {};
+        hasher->update(content);
+        hasher->finalize_to(tt::hash_bytes(expected));
+
+        auto value = entry.checksums().at("sha1")->value();
+        CHECK(std::equal(value.begin(), value.end(), tt::hash_bytes(expected).begin(), tt::hash_bytes(expected).end()));
+    }
+}
+
+TEST_CASE("test create app: fast checksum")
+{
+    temporary_directory tmp_dir{};
+    main_app_options main_options{};
+
+    fs::path output = fs::path(tmp_dir)/"test-create-fast-checksum.torrent";
+    auto protocol = GENERATE(dt::protocol::v1, dt::protocol::v2, dt::protocol::hybrid);
+
+    create_app_options options{
+            .target = fs::path(TEST_DIR)/"resources",
+            .destination = output,
+            .protocol_version = protocol,
+    };
+    options.checksums = {tt::fast_checksum::crc32c, dt::hash_function::sha1};
+
+    if (protocol == dt::protocol::v1) {
+        // the files of multi-file v1 torrents do not start on a piece boundary
+        CHECK_THROWS_AS(run_create_app(main_options, options), std::invalid_argument);
+        return;
+    }
+
+    run_create_app(main_options, options);
+    auto m = dt::load_metafile(output);
+    auto table = tt::load_metafile_extras(output).checksums;
+    REQUIRE(table.size() == 1);
+    const auto& values = table.at(tt::fast_checksum::crc32c);
+
+    for (const auto& entry : m.storage()) {
+        if (entry.is_padding_file()) {
+            CHECK_FALSE(values.contains(entry.path().generic_string()));
+            continue;
+        }
+        std::vector<std::byte> content(entry.file_size());
+        std::ifstream ifs(fs::path(TEST_DIR) / "resources" / entry.path(), std::ios::binary);
+        ifs.read(reinterpret_cast<char*>(content.data()), static_cast<std::streamsize>(content.size()));
+
+        auto hasher = tt::make_checksum_hasher(tt::fast_checksum::crc32c);
+        std::vector<std::byte> expected(hasher->digest_size());
+        hasher->update(content);
+        hasher->finalize_to(expected);
+
+        CHECK(values.at(entry.path().generic_string()) == expected);
+        CHECK(entry.checksums().contains("sha1"));
+    }
+}
+
 TEST_CASE("test create app: creation-date")
 {
     std::stringstream buffer{};
@@ -1176,4 +1343,125 @@ TEST_CASE("test create app: cross-seeding")
         auto m = dt::load_metafile(output);
         CHECK_FALSE(m.other_info_fields().contains("cross_seed_entry"));
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("test create app: batch")
+{
+    temporary_directory tmp_dir{};
+    main_app_options main_options{};
+
+    auto root = tmp_dir.path() / "library";
+    for (const auto& name : {"album1/track1.flac", "album1/track2.flac", "album2/track1.flac", "single.flac"}) {
+        fs::create_directories((root / name).parent_path());
+        std::ofstream ofs(root / name);
+        ofs << name << '\n';
+    }
+    fs::create_directories(root / ".hidden");
+    std::ofstream(root / ".hidden" / "file") << "hidden\n";
+
+    auto output = tmp_dir.path() / "output";
+
+    SECTION("per directory") {
+        create_app_options options{
+                .target = root,
+                .destination = output,
+                .protocol_version = dt::protocol::v2,
+                .threads = 2,
+                .batch_per_directory = true,
+        };
+        run_create_app(main_options, options);
+
+        REQUIRE(fs::exists(output / "album1.torrent"));
+        REQUIRE(fs::exists(output / "album2.torrent"));
+        CHECK_FALSE(fs::exists(output / "single.flac.torrent"));
+        CHECK_FALSE(fs::exists(output / ".hidden.torrent"));
+
+        auto m = dt::load_metafile(output / "album1.torrent");
+        CHECK(m.name() == "album1");
+        CHECK(m.storage().file_count() == 2);
+    }
+    SECTION("per file and directory") {
+        create_app_options options{
+                .target = root,
+                .destination = output,
+                .batch_per_directory = true,
+                .batch_per_file = true,
+        };
+        CHECK(list_batch_targets(options).size() == 3);
+
+        run_create_app(main_options, options);
+        REQUIRE(fs::exists(output / "single.flac.torrent"));
+        auto m = dt::load_metafile(output / "single.flac.torrent");
+        CHECK(m.storage().file_mode() == dt::file_mode::single);
+    }
+    SECTION("target must be a directory") {
+        create_app_options options{
+                .target = root / "single.flac",
+                .destination = output,
+                .batch_per_file = true,
+        };
+        CHECK_THROWS_AS(run_create_app(main_options, options), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test create app: based-on")
+{
+    temporary_directory tmp_dir{};
+    main_app_options main_options{};
+    auto data = tmp_dir.path() / "data";
+    write_file(data / "a.bin", 100'000, 'a');
+    write_file(data / "b.bin", 50'000, 'b');
+
+    auto protocol = GENERATE(dt::protocol::v1, dt::protocol::v2, dt::protocol::hybrid);
+    auto base_path = tmp_dir.path() / "base.torrent";
+    create_app_options base_options{
+            .target = data,
+            .destination = base_path,
+            .protocol_version = protocol,
+    };
+
+    SECTION("reuses the hashes of files with the recorded modification time") {
+        base_options.record_mtimes = true;
+        run_create_app(main_options, base_options);
+        CHECK_FALSE(tt::load_metafile_extras(base_path).mtimes.empty());
+
+        write_file(data / "b.bin", 50'000, 'x');
+
+        auto output = tmp_dir.path() / "refreshed.torrent";
+        create_app_options options{
+                .target = data,
+                .destination = output,
+                .protocol_version = protocol,
+        };
+        options.based_on = base_path;
+        run_create_app(main_options, options);
+
+        auto expected_path = tmp_dir.path() / "expected.torrent";
+        create_app_options expected_options{
+                .target = data,
+                .destination = expected_path,
+                .protocol_version = protocol,
+        };
+        run_create_app(main_options, expected_options);
+
+        auto m = dt::load_metafile(output);
+        auto expected = dt::load_metafile(expected_path);
+        if (tt::has_v1(protocol)) {
+            CHECK(dt::info_hash_v1(m) == dt::info_hash_v1(expected));
+        }
+        if (tt::has_v2(protocol)) {
+            CHECK(dt::info_hash_v2(m) == dt::info_hash_v2(expected));
+        }
+    }
+    SECTION("requires recorded modification times") {
+        run_create_app(main_options, base_options);
+
+        create_app_options options{
+                .target = data,
+                .destination = tmp_dir.path() / "refreshed.torrent",
+                .protocol_version = protocol,
+        };
+        options.based_on = base_path;
+        CHECK_THROWS_AS(run_create_app(main_options, options), std::invalid_argument);
+    }
+}
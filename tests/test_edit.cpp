@@ -8,6 +8,7 @@
 #include <CLI/CLI.hpp>
 
 #include <dottorrent/dht_node.hpp>
+#include "create.hpp"
 #include "edit.hpp"
 #include "tracker_database.hpp"
 
@@ -859,4 +860,209 @@ TEST_CASE("test edit app: cross-seeding")
         auto m = dt::load_metafile(output);
         CHECK(m.other_info_fields().contains("cross_seed_entry"));
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("test edit files", "[edit]")
+{
+    temporary_directory tmp_dir {};
+    main_app_options main_options{};
+
+    fs::path output = fs::path(tmp_dir) / "test-edit-files.torrent";
+    edit_app_options options {
+            .metafile = bittorrent_v2,
+            .destination = output,
+    };
+
+    auto original = dt::load_metafile(bittorrent_v2);
+    const auto& first = original.storage().at(0);
+
+    SECTION("remove file") {
+        options.remove_files = {first.path()};
+        run_edit_app(main_options, options);
+        auto m = dt::load_metafile(output);
+
+        CHECK(m.storage().file_count() == original.storage().file_count() - 1);
+        CHECK(rng::none_of(m.storage(), [&](const auto& e) { return e.path() == first.path(); }));
+    }
+
+    SECTION("rename file keeps the merkle root") {
+        options.renames = {{first.path(), fs::path("renamed") / "file.bin"}};
+        run_edit_app(main_options, options);
+        auto m = dt::load_metafile(output);
+
+        CHECK(m.storage().file_count() == original.storage().file_count());
+        auto it = rng::find_if(m.storage(), [&](const auto& e) { return e.path() == fs::path("renamed") / "file.bin"; });
+        REQUIRE(it != m.storage().end());
+        CHECK(it->pieces_root() == first.pieces_root());
+    }
+
+    SECTION("add file") {
+        auto data = fs::path(tmp_dir) / "data";
+        fs::create_directories(data);
+        std::ofstream(data / "added.txt") << "added file content";
+
+        options.data_directory = data;
+        options.add_files = {"added.txt"};
+        run_edit_app(main_options, options);
+        auto m = dt::load_metafile(output);
+
+        CHECK(m.storage().file_count() == original.storage().file_count() + 1);
+        CHECK(rng::any_of(m.storage(), [&](const auto& e) { return e.path() == "added.txt"; }));
+    }
+
+    SECTION("unknown file") {
+        options.remove_files = {"does-not-exist"};
+        CHECK_THROWS_AS(run_edit_app(main_options, options), std::invalid_argument);
+    }
+
+    SECTION("v1 metafile") {
+        options.metafile = fedora_torrent;
+        options.remove_files = {"does-not-exist"};
+        CHECK_THROWS_AS(run_edit_app(main_options, options), std::invalid_argument);
+    }
+}
+
+
+TEST_CASE("test edit files keeps per-file checksums", "[edit]")
+{
+    temporary_directory tmp_dir {};
+    main_app_options main_options{};
+
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 70'000, 'b');
+    write_file(root / "c.bin", 50'000, 'c');
+
+    fs::path original_file = tmp_dir.path() / "original.torrent";
+    create_app_options create_options {
+            .target = root,
+            .destination = original_file,
+            .protocol_version = dt::protocol::v2,
+            .piece_size = 32768,
+            .checksums = {dt::hash_function::sha1},
+    };
+    run_create_app(main_options, create_options);
+    auto original = dt::load_metafile(original_file);
+    const auto& first = original.storage().at(0);
+    REQUIRE(first.checksums().contains("sha1"));
+
+    fs::path output = tmp_dir.path() / "test-edit-checksums.torrent";
+    edit_app_options options {
+            .metafile = original_file,
+            .destination = output,
+    };
+
+    auto check_checksums = [&](const dt::metafile& m) {
+        for (const auto& entry : original.storage()) {
+            auto it = rng::find_if(m.storage(), [&](const auto& e) { return e.pieces_root() == entry.pieces_root(); });
+            if (it == m.storage().end()) {
+                continue;
+            }
+            REQUIRE(it->checksums().contains("sha1"));
+            auto expected = entry.checksums().at("sha1")->value();
+            auto actual = it->checksums().at("sha1")->value();
+            CHECK(rng::equal(actual, expected));
+        }
+    };
+
+    SECTION("remove file") {
+        options.remove_files = {first.path()};
+        run_edit_app(main_options, options);
+        check_checksums(dt::load_metafile(output));
+    }
+
+    SECTION("rename file") {
+        options.renames = {{first.path(), fs::path("renamed.bin")}};
+        run_edit_app(main_options, options);
+        check_checksums(dt::load_metafile(output));
+    }
+}
+
+
+TEST_CASE("test edit piece size", "[edit]")
+{
+    temporary_directory tmp_dir {};
+    main_app_options main_options{};
+
+    fs::path output = fs::path(tmp_dir) / "test-edit-piece-size.torrent";
+    edit_app_options options {
+            .metafile = bittorrent_v2,
+            .destination = output,
+    };
+    auto original = dt::load_metafile(bittorrent_v2);
+
+    SECTION("increase piece size") {
+        options.piece_size = original.storage().piece_size() * 4;
+        run_edit_app(main_options, options);
+        auto m = dt::load_metafile(output);
+
+        CHECK(m.storage().piece_size() == *options.piece_size);
+        REQUIRE(m.storage().file_count() == original.storage().file_count());
+        for (std::size_t i = 0; i < m.storage().file_count(); ++i) {
+            CHECK(m.storage().at(i).pieces_root() == original.storage().at(i).pieces_root());
+        }
+    }
+
+    SECTION("decrease piece size") {
+        options.piece_size = original.storage().piece_size() / 2;
+        CHECK_THROWS_AS(run_edit_app(main_options, options), std::invalid_argument);
+    }
+
+    SECTION("hybrid without data") {
+        options.metafile = bittorrent_hybrid;
+        options.piece_size = dt::load_metafile(bittorrent_hybrid).storage().piece_size() * 2;
+        CHECK_THROWS_AS(run_edit_app(main_options, options), std::invalid_argument);
+    }
+}
+
+
+TEST_CASE("test edit piece size keeps per-file checksums", "[edit]")
+{
+    temporary_directory tmp_dir {};
+    main_app_options main_options{};
+
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 70'000, 'b');
+
+    fs::path original_file = tmp_dir.path() / "original.torrent";
+    create_app_options create_options {
+            .target = root,
+            .destination = original_file,
+            .piece_size = 16384,
+            .checksums = {dt::hash_function::sha1},
+    };
+
+    fs::path output = tmp_dir.path() / "test-edit-piece-size-checksums.torrent";
+    edit_app_options options {
+            .metafile = original_file,
+            .destination = output,
+            .piece_size = 65536,
+    };
+
+    SECTION("v2") {
+        create_options.protocol_version = dt::protocol::v2;
+    }
+    SECTION("hybrid") {
+        create_options.protocol_version = dt::protocol::hybrid;
+        options.data_directory = root;
+    }
+
+    run_create_app(main_options, create_options);
+    auto original = dt::load_metafile(original_file);
+    run_edit_app(main_options, options);
+    auto m = dt::load_metafile(output);
+
+    CHECK(m.storage().piece_size() == 65536);
+    for (const auto& entry : original.storage()) {
+        if (entry.is_padding_file()) {
+            continue;
+        }
+        auto it = rng::find_if(m.storage(), [&](const auto& e) { return e.path() == entry.path(); });
+        REQUIRE(it != m.storage().end());
+        REQUIRE(it->checksums().contains("sha1"));
+        auto expected = entry.checksums().at("sha1")->value();
+        auto actual = it->checksums().at("sha1")->value();
+        CHECK(rng::equal(actual, expected));
+    }
+}
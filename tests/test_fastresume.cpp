@@ -0,0 +1,114 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <bencode/bvalue.hpp>
+#include <dottorrent/metafile.hpp>
+
+#include "fastresume.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace bc = bencode;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+TEST_CASE("test fastresume_path")
+{
+    CHECK(tt::fastresume_path("dir/test.torrent") == fs::path("dir/test.fastresume"));
+    CHECK(tt::fastresume_path("test") == fs::path("test.fastresume"));
+}
+
+TEST_CASE("test fastresume_piece_count")
+{
+    auto m = dt::load_metafile(fs::path(TEST_RESOURCES_DIR) / "resources-hybrid.torrent");
+    const auto& storage = m.storage();
+
+    std::size_t v2_pieces = 0;
+    for (const auto& entry : storage) {
+        if (!entry.is_padding_file()) {
+            v2_pieces += (entry.file_size() + storage.piece_size() - 1) / storage.piece_size();
+        }
+    }
+    CHECK(tt::fastresume_piece_count(storage, dt::protocol::v1) == storage.piece_count());
+    CHECK(tt::fastresume_piece_count(storage, dt::protocol::hybrid) == v2_pieces);
+}
+
+TEST_CASE("test make_fastresume")
+{
+    auto m = dt::load_metafile(fs::path(TEST_RESOURCES_DIR) / "resources.torrent");
+    m.storage().set_root_directory(TEST_RESOURCES_DIR);
+
+    auto piece_count = tt::fastresume_piece_count(m.storage(), dt::protocol::v1);
+    std::vector<bool> have(piece_count, true);
+    have.front() = false;
+
+    auto data = tt::make_fastresume(m, dt::protocol::v1, have);
+    const auto& dict = bc::get_dict(data);
+
+    CHECK(bc::get_string(dict.at("file-format")) == "libtorrent resume file");
+    CHECK(bc::get_string(dict.at("info-hash")).size() == 20);
+    CHECK_FALSE(data.contains("info-hash2"));
+    CHECK(bc::get_string(dict.at("name")) == m.name());
+    CHECK(fs::path(bc::get_string(dict.at("save_path"))).is_absolute());
+
+    const auto& pieces = bc::get_string(dict.at("pieces"));
+    REQUIRE(pieces.size() == piece_count);
+    CHECK(pieces.front() == '\0');
+    CHECK(pieces.back() == '\1');
+
+    CHECK(bc::get_list(dict.at("file sizes")).size() == m.storage().file_count());
+}
+
+TEST_CASE("test make_fastresume with a renamed root directory")
+{
+    temporary_directory tmp_dir {};
+    auto m = dt::load_metafile(fs::path(TEST_RESOURCES_DIR) / "resources.torrent");
+    REQUIRE(m.storage().file_mode() == dt::file_mode::multi);
+    std::vector<bool> have(tt::fastresume_piece_count(m.storage(), dt::protocol::v1), true);
+
+    SECTION("directory named after the torrent") {
+        m.storage().set_root_directory(tmp_dir.path() / m.name());
+        auto data = tt::make_fastresume(m, dt::protocol::v1, have);
+        CHECK(fs::path(bc::get_string(bc::get_dict(data).at("save_path"))) == fs::absolute(tmp_dir.path()).lexically_normal());
+        CHECK_FALSE(data.contains("mapped_files"));
+    }
+
+    SECTION("directory with another name") {
+        m.storage().set_root_directory(tmp_dir.path() / "renamed");
+        auto data = tt::make_fastresume(m, dt::protocol::v1, have);
+        CHECK(fs::path(bc::get_string(bc::get_dict(data).at("save_path"))) == fs::absolute(tmp_dir.path()).lexically_normal());
+
+        const auto& mapped_files = bc::get_list(bc::get_dict(data).at("mapped_files"));
+        REQUIRE(mapped_files.size() == m.storage().file_count());
+        for (std::size_t i = 0; i < mapped_files.size(); ++i) {
+            const auto& entry = m.storage().at(i);
+            if (entry.is_padding_file()) {
+                CHECK(bc::get_string(mapped_files[i]).empty());
+            } else {
+                CHECK(bc::get_string(mapped_files[i]) == (fs::path("renamed") / entry.path()).generic_string());
+            }
+        }
+    }
+}
+
+TEST_CASE("test write_fastresume")
+{
+    temporary_directory tmp_dir {};
+    auto m = dt::load_metafile(fs::path(TEST_RESOURCES_DIR) / "resources-hybrid.torrent");
+    m.storage().set_root_directory(TEST_RESOURCES_DIR);
+
+    auto path = tmp_dir.path() / "resources-hybrid.fastresume";
+    std::vector<bool> have(tt::fastresume_piece_count(m.storage(), dt::protocol::hybrid), true);
+    tt::write_fastresume(path, m, dt::protocol::hybrid, have);
+
+    std::ifstream ifs(path, std::ios::binary);
+    auto data = bc::decode_value(ifs);
+    const auto& dict = bc::get_dict(data);
+    CHECK(bc::get_string(dict.at("info-hash2")).size() == 32);
+    CHECK(bc::get_string(dict.at("pieces")).size() == have.size());
+
+    CHECK_THROWS_AS(tt::write_fastresume(tmp_dir.path() / "missing" / "x.fastresume",
+                                         m, dt::protocol::hybrid, have),
+                    std::runtime_error);
+}
@@ -0,0 +1,133 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "hash_cache.hpp"
+#include "hash_encoding.hpp"
+#include "per_file_hasher.hpp"
+#include "piece_layout.hpp"
+#include "file_stat.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+TEST_CASE("test hash_cache")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    auto cache_file = tmp_dir.path() / "hash-cache";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 4 * 16384, 'b');
+    write_file(root / "c.bin", 5, 'c');
+
+    constexpr std::size_t piece_size = 32768;
+
+    dt::file_storage first = make_storage(root, piece_size);
+    tt::align_to_pieces(first);
+    {
+        tt::hash_cache cache(cache_file);
+        cache.load();
+        auto hasher = tt::per_file_hasher(first, dt::protocol::hybrid);
+        hasher.set_hash_cache(&cache);
+        hasher.start();
+        hasher.wait();
+        cache.save();
+
+        CHECK(hasher.cache_hits() == 0);
+        CHECK(cache.size() == 3);
+    }
+
+    SECTION("unchanged files are reused") {
+        tt::hash_cache cache(cache_file);
+        cache.load();
+        REQUIRE(cache.size() == 3);
+
+        dt::file_storage second = make_storage(root, piece_size);
+        tt::align_to_pieces(second);
+        auto hasher = tt::per_file_hasher(second, dt::protocol::hybrid);
+        hasher.set_hash_cache(&cache);
+        hasher.start();
+        hasher.wait();
+
+        CHECK(hasher.cache_hits() == 3);
+        for (std::size_t i = 0; i < second.file_count(); ++i) {
+            if (second.at(i).is_padding_file()) continue;
+            CHECK(second.at(i).pieces_root() == first.at(i).pieces_root());
+        }
+    }
+
+    SECTION("modified files are hashed again") {
+        write_file(root / "c.bin", 7, 'd');
+
+        tt::hash_cache cache(cache_file);
+        cache.load();
+
+        dt::file_storage second = make_storage(root, piece_size);
+        tt::align_to_pieces(second);
+        auto hasher = tt::per_file_hasher(second, dt::protocol::v2);
+        hasher.set_hash_cache(&cache);
+        hasher.start();
+        hasher.wait();
+
+        CHECK(hasher.cache_hits() == 2);
+        CHECK(second.at(second.file_count() - 1).pieces_root() != first.at(first.file_count() - 1).pieces_root());
+    }
+
+    SECTION("different piece size is not reused") {
+        tt::hash_cache cache(cache_file);
+        cache.load();
+        auto status = tt::stat_file(root / "a.bin");
+        CHECK(cache.find(status, piece_size, dt::protocol::v2));
+        CHECK_FALSE(cache.find(status, 2 * piece_size, dt::protocol::v2));
+    }
+
+    SECTION("files that changed size since the storage was created are not taken from the cache") {
+        dt::file_storage stale = make_storage(root, piece_size);
+        write_file(root / "a.bin", 50'000, 'x');
+
+        tt::hash_cache cache(cache_file);
+        cache.load();
+        dt::file_storage current = make_storage(root, piece_size);
+        auto current_hasher = tt::per_file_hasher(current, dt::protocol::v2);
+        current_hasher.set_hash_cache(&cache);
+        current_hasher.start();
+        current_hasher.wait();
+
+        auto hasher = tt::per_file_hasher(stale, dt::protocol::v2);
+        hasher.set_hash_cache(&cache);
+        hasher.start();
+        CHECK_THROWS_AS(hasher.wait(), fs::filesystem_error);
+        CHECK(hasher.cache_hits() == 2);
+    }
+
+    SECTION("missing cache file results in an empty cache") {
+        tt::hash_cache cache(tmp_dir.path() / "does-not-exist");
+        cache.load();
+        CHECK(cache.size() == 0);
+    }
+}
+
+
+TEST_CASE("test decode_file_hashes checks the hash counts")
+{
+    temporary_directory tmp_dir {};
+    auto path = tmp_dir.path() / "a.bin";
+    write_file(path, 100'000, 'a');
+
+    constexpr std::size_t piece_size = 32768;
+    auto hashes = tt::hash_file(path, dt::protocol::hybrid, piece_size);
+    auto dict = tt::encode_file_hashes(hashes);
+
+    auto decoded = tt::decode_file_hashes(dict, piece_size, 100'000);
+    CHECK(decoded.piece_layer == hashes.piece_layer);
+    CHECK(decoded.pieces == hashes.pieces);
+
+    CHECK_THROWS_AS(tt::decode_file_hashes(dict, piece_size, 200'000), std::invalid_argument);
+    CHECK_THROWS_AS(tt::decode_file_hashes(dict, piece_size, 3 * piece_size), std::invalid_argument);
+    CHECK_THROWS_AS(tt::decode_file_hashes(dict, 2 * piece_size, 100'000), std::invalid_argument);
+    CHECK_THROWS_AS(tt::decode_file_hashes(dict, 0, 100'000), std::invalid_argument);
+}
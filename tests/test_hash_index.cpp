@@ -0,0 +1,75 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <dottorrent/metafile.hpp>
+
+#include "file_hasher.hpp"
+#include "hash_index.hpp"
+#include "merkle.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+TEST_CASE("test hash_index")
+{
+    temporary_directory tmp_dir {};
+    auto data = tmp_dir.path() / "data";
+    auto index_path = tmp_dir.path() / "index.bin";
+    constexpr std::size_t piece_size = 32768;
+
+    // files end on piece boundaries, so the hybrid storage needs no padding
+    write_file(data / "a.bin", 3 * piece_size, 'a');
+    write_file(data / "b.bin", 3 * piece_size, 'a');
+    write_file(data / "c.bin", 5, 'c');
+
+    dt::metafile m {};
+    auto& storage = m.storage();
+    set_storage_files(storage, data, piece_size);
+    hash_storage(storage, dt::protocol::hybrid);
+
+    SECTION("round trip") {
+        {
+            tt::hash_index_writer writer(index_path, storage.file_count());
+            for (std::size_t i : {0, 2}) {
+                auto hashes = tt::hash_file(data / storage.at(i).path(), dt::protocol::v2, piece_size, nullptr, true);
+                writer.add_tree(i, hashes.leaves);
+            }
+            writer.share_tree(1, 0);
+            writer.finish(m, dt::protocol::hybrid);
+        }
+        CHECK_FALSE(fs::exists(fs::path(index_path).concat(".tmp")));
+
+        auto index = tt::hash_index(index_path);
+        CHECK(index.protocol() == dt::protocol::hybrid);
+        CHECK(index.piece_size() == piece_size);
+        REQUIRE(index.file_count() == 3);
+        CHECK(index.file_size(2) == 5);
+        CHECK(index.leaf_count(0) == 6);
+        CHECK(index.leaf_count(2) == 1);
+
+        auto tree = index.tree(0);
+        CHECK(tree.size() == tt::merkle_tree_size(6));
+        CHECK(tree.back() == storage.at(0).pieces_root());
+        CHECK(index.tree(1) == tree);
+        CHECK(index.tree(2).back() == storage.at(2).pieces_root());
+
+        REQUIRE(index.pieces().size() == 7);
+        CHECK(index.pieces().back() == storage.get_piece_hash(6));
+        CHECK(index.info_hash_v1() == dt::info_hash_v1(m));
+        CHECK(index.info_hash_v2() == dt::info_hash_v2(m));
+    }
+    SECTION("unfinished index is removed") {
+        {
+            tt::hash_index_writer writer(index_path, storage.file_count());
+        }
+        CHECK_FALSE(fs::exists(index_path));
+        CHECK_FALSE(fs::exists(fs::path(index_path).concat(".tmp")));
+    }
+    SECTION("invalid index") {
+        std::ofstream(index_path) << "not a hash index";
+        CHECK_THROWS_AS(tt::hash_index(index_path), std::invalid_argument);
+    }
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "io_scheduler.hpp"
+
+namespace tt = torrenttools;
+
+using namespace std::chrono_literals;
+
+TEST_CASE("test io_scheduler")
+{
+    struct device_counters
+    {
+        std::atomic_size_t active = 0;
+        std::atomic_size_t max_active = 0;
+    };
+
+    std::atomic_size_t total_active = 0;
+    std::atomic_size_t max_total_active = 0;
+    std::atomic_size_t done = 0;
+    device_counters hdd {};
+    device_counters ssd {};
+
+    auto make_job = [&](device_counters& device) {
+        return [&]() {
+            auto active = ++device.active;
+            auto total = ++total_active;
+            for (auto m = device.max_active.load(); m < active && !device.max_active.compare_exchange_weak(m, active);) {}
+            for (auto m = max_total_active.load(); m < total && !max_total_active.compare_exchange_weak(m, total);) {}
+            std::this_thread::sleep_for(2ms);
+            --total_active;
+            --device.active;
+            ++done;
+        };
+    };
+
+    auto scheduler = tt::io_scheduler(4);
+    for (std::size_t i = 0; i < 20; ++i) {
+        scheduler.add(1, 1, make_job(hdd));
+        scheduler.add(2, 2, make_job(ssd));
+    }
+    CHECK(scheduler.job_count() == 40);
+
+    scheduler.run();
+
+    CHECK(done == 40);
+    CHECK(hdd.max_active == 1);
+    CHECK(ssd.max_active <= 2);
+    CHECK(max_total_active <= 3);
+}
+
+TEST_CASE("test io_scheduler: no jobs")
+{
+    auto scheduler = tt::io_scheduler(4);
+    scheduler.run();
+    CHECK(scheduler.job_count() == 0);
+}
@@ -0,0 +1,65 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "locate.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+
+TEST_CASE("test locate_files")
+{
+    temporary_directory tmp_dir {};
+    auto data = tmp_dir.path() / "data";
+    auto search = tmp_dir.path() / "search";
+
+    write_file(data / "a.bin", 100'000, 'a');
+    write_file(data / "b.bin", 4 * 16384, 'b');
+    write_file(data / "c.bin", 5, 'c');
+
+    write_file(search / "x" / "renamed.bin", 100'000, 'a');
+    write_file(search / "decoy.bin", 100'000, 'z');
+    write_file(search / "y" / "b.bin", 4 * 16384, 'b');
+    write_file(search / "c.bin", 5, 'q');
+
+    constexpr std::size_t piece_size = 32768;
+    auto index = build_size_index(search, 2);
+    CHECK(index.at(100'000).size() == 2);
+
+    SECTION("v1") {
+        auto storage = make_hashed_storage(data, piece_size, dt::protocol::v1);
+        auto results = locate_files(storage, index, 2);
+        REQUIRE(results.size() == 3);
+        CHECK(results[0].status == locate_status::found);
+        CHECK(results[0].path == search / "x" / "renamed.bin");
+        CHECK(results[1].status == locate_status::found);
+        // c.bin does not contain a complete piece
+        CHECK(results[2].status == locate_status::unconfirmed);
+    }
+    SECTION("v2") {
+        auto storage = make_hashed_storage(data, piece_size, dt::protocol::v2);
+        auto results = locate_files(storage, index, 2);
+        REQUIRE(results.size() == 3);
+        CHECK(results[0].status == locate_status::found);
+        CHECK(results[0].path == search / "x" / "renamed.bin");
+        CHECK(results[1].status == locate_status::found);
+        CHECK(results[2].status == locate_status::missing);
+        CHECK(results[2].candidates == 1);
+    }
+    SECTION("link") {
+        auto storage = make_hashed_storage(data, piece_size, dt::protocol::v2);
+        auto results = locate_files(storage, index, 1);
+        auto links = tmp_dir.path() / "links";
+
+        link_located_files(storage, results, links);
+        CHECK(fs::equivalent(links / "a.bin", search / "x" / "renamed.bin"));
+        CHECK(fs::equivalent(links / "b.bin", search / "y" / "b.bin"));
+        CHECK_FALSE(fs::exists(links / "c.bin"));
+
+        // linking again keeps the existing links
+        CHECK_NOTHROW(link_located_files(storage, results, links));
+    }
+}
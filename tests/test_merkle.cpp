@@ -0,0 +1,103 @@
+#include <catch2/catch.hpp>
+#include <vector>
+
+#include "file_hasher.hpp"
+#include "merkle.hpp"
+
+namespace tt = torrenttools;
+
+static tt::file_hashes hash_data(std::size_t size, std::size_t piece_size)
+{
+    std::vector<std::byte> data(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<std::byte>(i % 251);
+    }
+    tt::file_hasher hasher(dt::protocol::v2, piece_size);
+    hasher.update(data);
+    return hasher.finalize();
+}
+
+TEST_CASE("test merkle root is independent of the piece size")
+{
+    auto size = GENERATE(1u, 16384u, 100'000u, 1'000'000u);
+
+    auto small = hash_data(size, 16384);
+    auto large = hash_data(size, 262144);
+    CHECK(small.pieces_root == large.pieces_root);
+}
+
+TEST_CASE("test merge_piece_layer")
+{
+    auto size = GENERATE(16384u, 100'000u, 300'000u, 1'000'000u, 4'194'304u);
+    auto new_piece_size = GENERATE(32768u, 65536u, 1048576u);
+    constexpr std::size_t piece_size = 16384;
+
+    auto original = hash_data(size, piece_size);
+    auto expected = hash_data(size, new_piece_size);
+
+    auto merged = tt::merge_piece_layer(original.piece_layer, piece_size, new_piece_size, size);
+    CHECK(merged == expected.piece_layer);
+}
+
+TEST_CASE("test merge_file_hashes")
+{
+    auto size = GENERATE(65536u, 100'000u, 300'000u, 1'000'000u);
+    auto part_pieces = GENERATE(1u, 2u, 5u);
+    auto protocol = GENERATE(dt::protocol::v2, dt::protocol::hybrid);
+    constexpr std::size_t piece_size = 32768;
+
+    std::vector<std::byte> data(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<std::byte>(i % 251);
+    }
+
+    tt::file_hasher hasher(protocol, piece_size);
+    hasher.update(data);
+    auto expected = hasher.finalize();
+
+    std::vector<tt::file_hashes> parts {};
+    const auto part_size = part_pieces * piece_size;
+    for (std::size_t offset = 0; offset < size; offset += part_size) {
+        hasher.update(std::span(data).subspan(offset, std::min<std::size_t>(part_size, size - offset)));
+        parts.push_back(hasher.finalize());
+    }
+
+    auto merged = tt::merge_file_hashes(parts);
+    CHECK(merged.file_size == expected.file_size);
+    CHECK(merged.pieces_root == expected.pieces_root);
+    CHECK(merged.piece_layer == expected.piece_layer);
+    CHECK(merged.pieces == expected.pieces);
+    CHECK(merged.tail_piece == expected.tail_piece);
+    CHECK(merged.padded_tail_piece == expected.padded_tail_piece);
+}
+
+TEST_CASE("test merkle_tree")
+{
+    auto size = GENERATE(1u, 16384u, 100'000u, 1'000'000u);
+    constexpr std::size_t piece_size = 65536;
+
+    std::vector<std::byte> data(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        data[i] = static_cast<std::byte>(i % 251);
+    }
+    tt::file_hasher hasher(dt::protocol::v2, piece_size, true);
+    hasher.update(data);
+    auto hashes = hasher.finalize();
+
+    REQUIRE(hashes.leaves.size() == (size + tt::v2_block_size - 1) / tt::v2_block_size);
+    auto tree = tt::merkle_tree(hashes.leaves);
+    CHECK(tree.size() == tt::merkle_tree_size(hashes.leaves.size()));
+    CHECK(tree.back() == hashes.pieces_root);
+
+    // the layer spanning a piece is the piece layer
+    if (size > piece_size) {
+        std::size_t offset = 0;
+        std::size_t layer_size = hashes.leaves.size();
+        for (std::size_t width = 1; width < piece_size / tt::v2_block_size; width *= 2) {
+            offset += layer_size;
+            layer_size = (layer_size + 1) / 2;
+        }
+        auto layer = std::vector(tree.begin() + offset, tree.begin() + offset + layer_size);
+        CHECK(layer == hashes.piece_layer);
+    }
+}
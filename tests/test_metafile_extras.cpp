@@ -0,0 +1,48 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <dottorrent/metafile.hpp>
+
+#include "file_stat.hpp"
+#include "metafile_extras.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+TEST_CASE("test metafile extras")
+{
+    temporary_directory tmp_dir {};
+    auto data = tmp_dir.path() / "data";
+    write_file(data / "a.txt", 1, 'a');
+    write_file(data / "sub" / "b.txt", 1, 'b');
+
+    dt::metafile m {};
+    set_storage_files(m.storage(), data, 16384, {"a.txt", "sub/b.txt"});
+    hash_storage(m.storage(), dt::protocol::v2);
+
+    tt::metafile_extras extras {};
+    extras.checksums[tt::fast_checksum::crc32c]["a.txt"] = {std::byte {1}, std::byte {2}, std::byte {3}, std::byte {4}};
+    extras.checksums[tt::fast_checksum::crc32c]["sub/b.txt"] = {std::byte {5}, std::byte {6}, std::byte {7}, std::byte {8}};
+    extras.mtimes = tt::stat_storage_files(m.storage());
+
+    REQUIRE(extras.mtimes.size() == 2);
+    CHECK(extras.mtimes.at("sub/b.txt").file_size == 1);
+    CHECK(extras.mtimes.at("sub/b.txt").mtime_ns == tt::stat_file(data / "sub" / "b.txt").mtime_ns);
+
+    auto path = tmp_dir.path() / "test.torrent";
+    tt::save_metafile(path, m, dt::protocol::v2, extras);
+
+    auto loaded = tt::load_metafile_extras(path);
+    CHECK(loaded.checksums == extras.checksums);
+    CHECK(loaded.mtimes == extras.mtimes);
+    // the extras are stored outside the info dictionary
+    CHECK(dt::info_hash_v2(dt::load_metafile(path)) == dt::info_hash_v2(m));
+
+    SECTION("metafile without extras") {
+        dt::save_metafile(path, m, dt::protocol::v2);
+        CHECK(tt::load_metafile_extras(path).empty());
+    }
+}
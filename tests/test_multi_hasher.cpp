@@ -0,0 +1,124 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/storage_hasher.hpp>
+
+#include "create.hpp"
+#include "multi_hasher.hpp"
+#include "piece_layout.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+static dt::file_storage make_target_storage(const fs::path& root, std::size_t piece_size, dt::protocol protocol)
+{
+    auto storage = make_storage(root, piece_size, {"a.bin", "b.bin", "c.bin", "d.bin"});
+    if (protocol == dt::protocol::hybrid) {
+        tt::align_to_pieces(storage);
+    }
+    return storage;
+}
+
+TEST_CASE("test multi_hasher matches storage_hasher")
+{
+    auto threads = GENERATE(1, 2, 3, 8);
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 4 * 16384, 'b');
+    write_file(root / "c.bin", 0, 'c');
+    write_file(root / "d.bin", 5'000'000, 'd');
+
+    const std::vector<std::pair<dt::protocol, std::size_t>> outputs {
+            {dt::protocol::v1, 32768},
+            {dt::protocol::v2, 65536},
+            {dt::protocol::hybrid, 16384},
+            {dt::protocol::v1, 1048576},
+    };
+
+    std::vector<dt::file_storage> storages {};
+    std::vector<dt::file_storage> expected {};
+    for (auto [protocol, piece_size] : outputs) {
+        storages.push_back(make_target_storage(root, piece_size, protocol));
+        expected.push_back(make_target_storage(root, piece_size, protocol));
+        auto reference = dt::storage_hasher(expected.back(), {.protocol_version = protocol});
+        reference.start();
+        reference.wait();
+    }
+
+    std::vector<std::pair<dt::file_storage*, dt::protocol>> targets {};
+    for (std::size_t i = 0; i < outputs.size(); ++i) {
+        targets.emplace_back(&storages[i], outputs[i].first);
+    }
+    auto hasher = tt::multi_hasher(targets, threads);
+    hasher.start();
+    hasher.wait();
+
+    CHECK(hasher.bytes_done() == storages.front().total_regular_file_size());
+
+    for (std::size_t i = 0; i < outputs.size(); ++i) {
+        auto protocol = outputs[i].first;
+        auto& storage = storages[i];
+        REQUIRE(storage.file_count() == expected[i].file_count());
+
+        if (tt::has_v1(protocol)) {
+            for (std::size_t p = 0; p < tt::piece_layout(storage).piece_count(); ++p) {
+                CHECK(storage.get_piece_hash(p) == expected[i].get_piece_hash(p));
+            }
+        }
+        if (tt::has_v2(protocol)) {
+            for (std::size_t f = 0; f < storage.file_count(); ++f) {
+                if (storage.at(f).is_padding_file()) continue;
+                CHECK(storage.at(f).pieces_root() == expected[i].at(f).pieces_root());
+                CHECK(storage.at(f).piece_layer() == expected[i].at(f).piece_layer());
+            }
+        }
+    }
+}
+
+TEST_CASE("test multi_hasher missing file")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 100, 'b');
+    write_file(root / "c.bin", 100, 'c');
+    write_file(root / "d.bin", 100, 'd');
+
+    auto storage = make_target_storage(root, 32768, dt::protocol::v1);
+    fs::remove(root / "b.bin");
+
+    auto hasher = tt::multi_hasher({{&storage, dt::protocol::v1}});
+    hasher.start();
+    CHECK_THROWS_AS(hasher.wait(), fs::filesystem_error);
+}
+
+TEST_CASE("test parse_output_spec")
+{
+    SECTION("all keys") {
+        auto spec = parse_output_spec(
+                "protocol=2,piece-size=4M,announce=https://a.example/announce,"
+                "announce=https://b.example/announce,source=EX,output=out.torrent");
+        CHECK(spec.protocol_version == dt::protocol::v2);
+        CHECK(spec.piece_size == 4 * 1024 * 1024);
+        REQUIRE(spec.announce_list.size() == 2);
+        CHECK(spec.announce_list[0] == std::vector<std::string>{"https://a.example/announce"});
+        CHECK(spec.source == "EX");
+        CHECK(spec.destination == fs::path("out.torrent"));
+    }
+    SECTION("unset keys are empty") {
+        auto spec = parse_output_spec("protocol=hybrid");
+        CHECK(spec.protocol_version == dt::protocol::hybrid);
+        CHECK_FALSE(spec.piece_size);
+        CHECK_FALSE(spec.destination);
+    }
+    SECTION("invalid specs") {
+        CHECK_THROWS_AS(parse_output_spec("protocol"), std::invalid_argument);
+        CHECK_THROWS_AS(parse_output_spec("color=red"), std::invalid_argument);
+        CHECK_THROWS_AS(parse_output_spec("protocol=3"), std::invalid_argument);
+    }
+}
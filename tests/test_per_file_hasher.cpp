@@ -0,0 +1,89 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/storage_hasher.hpp>
+
+#include "per_file_hasher.hpp"
+#include "piece_layout.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+TEST_CASE("test per_file_hasher matches storage_hasher")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 4 * 16384, 'b');
+    write_file(root / "c.bin", 5, 'c');
+
+    constexpr std::size_t piece_size = 32768;
+
+    for (auto protocol : {dt::protocol::v2, dt::protocol::hybrid}) {
+        auto expected = make_storage(root, piece_size);
+        tt::align_to_pieces(expected);
+        auto reference = dt::storage_hasher(expected, {.protocol_version = protocol});
+        reference.start();
+        reference.wait();
+
+        auto storage = make_storage(root, piece_size);
+        tt::align_to_pieces(storage);
+        auto hasher = tt::per_file_hasher(storage, protocol, 2);
+        hasher.start();
+        hasher.wait();
+
+        REQUIRE(storage.file_count() == expected.file_count());
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            if (storage.at(i).is_padding_file()) continue;
+            CHECK(storage.at(i).pieces_root() == expected.at(i).pieces_root());
+            CHECK(storage.at(i).piece_layer() == expected.at(i).piece_layer());
+        }
+        if (protocol == dt::protocol::hybrid) {
+            for (std::size_t i = 0; i < tt::piece_layout(storage).piece_count(); ++i) {
+                CHECK(storage.get_piece_hash(i) == expected.get_piece_hash(i));
+            }
+        }
+    }
+}
+
+TEST_CASE("test per_file_hasher splits large files")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 1'000'000, 'a');
+    write_file(root / "b.bin", 70'000, 'b');
+    write_file(root / "c.bin", 5, 'c');
+
+    constexpr std::size_t piece_size = 32768;
+
+    for (auto protocol : {dt::protocol::v2, dt::protocol::hybrid}) {
+        auto expected = make_storage(root, piece_size);
+        tt::align_to_pieces(expected);
+        auto reference = dt::storage_hasher(expected, {.protocol_version = protocol});
+        reference.start();
+        reference.wait();
+
+        auto storage = make_storage(root, piece_size);
+        tt::align_to_pieces(storage);
+        auto hasher = tt::per_file_hasher(storage, protocol, 3);
+        // a.bin is split in ranges of 4 pieces
+        hasher.set_split_size(100'000);
+        hasher.start();
+        hasher.wait();
+        CHECK(hasher.done());
+
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            if (storage.at(i).is_padding_file()) continue;
+            CHECK(storage.at(i).pieces_root() == expected.at(i).pieces_root());
+            CHECK(storage.at(i).piece_layer() == expected.at(i).piece_layer());
+        }
+        if (protocol == dt::protocol::hybrid) {
+            for (std::size_t i = 0; i < tt::piece_layout(storage).piece_count(); ++i) {
+                CHECK(storage.get_piece_hash(i) == expected.get_piece_hash(i));
+            }
+        }
+    }
+}
@@ -0,0 +1,219 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <fmt/format.h>
+
+#include <dottorrent/file_storage.hpp>
+
+#include "piece_verifier.hpp"
+#include "verify_state.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+static void corrupt_file(const fs::path& path, std::size_t offset)
+{
+    std::fstream fs(path, std::ios::binary | std::ios::in | std::ios::out);
+    fs.seekp(static_cast<std::streamoff>(offset));
+    fs.put('x');
+}
+
+TEST_CASE("test piece_verifier")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 4 * 16384, 'b');
+    write_file(root / "c.bin", 5, 'c');
+
+    constexpr std::size_t piece_size = 32768;
+
+    for (auto protocol : {dt::protocol::v1, dt::protocol::v2}) {
+        auto storage = make_hashed_storage(root, piece_size, protocol);
+
+        SECTION(fmt::format("intact data, protocol {}", static_cast<int>(protocol))) {
+            auto verifier = tt::piece_verifier(storage, protocol, 2);
+            verifier.start();
+            verifier.wait();
+            CHECK(verifier.count(tt::piece_state::valid) == verifier.piece_count());
+            CHECK(verifier.percentage(0) == Approx(100.0));
+        }
+
+        SECTION(fmt::format("corrupted and missing data, protocol {}", static_cast<int>(protocol))) {
+            corrupt_file(root / "b.bin", 20'000);
+            fs::remove(root / "c.bin");
+
+            auto verifier = tt::piece_verifier(storage, protocol, 2);
+            verifier.start();
+            verifier.wait();
+
+            CHECK(verifier.percentage(0) > 0.0);
+            CHECK(verifier.percentage(1) < 100.0);
+            CHECK(verifier.percentage(2) == Approx(0.0));
+            auto [first, last] = verifier.file_pieces(2);
+            CHECK(verifier.state(last - 1) == tt::piece_state::invalid);
+        }
+
+        SECTION(fmt::format("selection, protocol {}", static_cast<int>(protocol))) {
+            auto verifier = tt::piece_verifier(storage, protocol, 2);
+            std::vector<bool> selection(verifier.piece_count());
+            selection.front() = true;
+            verifier.set_selection(selection);
+            verifier.start();
+            verifier.wait();
+
+            CHECK(verifier.verified_pieces() == 1);
+            CHECK(verifier.state(0) == tt::piece_state::valid);
+            CHECK(verifier.state(1) == tt::piece_state::unchecked);
+        }
+    }
+}
+
+TEST_CASE("test piece_verifier verifies v2 pieces largest first")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 4 * 16384, 'b');
+    write_file(root / "c.bin", 5, 'c');
+
+    constexpr std::size_t piece_size = 32768;
+    auto storage = make_hashed_storage(root, piece_size, dt::protocol::v2);
+    // the tail piece of a.bin comes before b.bin in the torrent but is smaller than its pieces
+    corrupt_file(root / "a.bin", 99'000);
+    corrupt_file(root / "b.bin", 0);
+
+    auto verifier = tt::piece_verifier(storage, dt::protocol::v2, 1);
+    auto a_tail = verifier.file_pieces(0).second - 1;
+    auto b_first = verifier.file_pieces(1).first;
+
+    SECTION("files are verified as a whole") {
+        verifier.start();
+        verifier.wait();
+        CHECK(verifier.first_failure() == a_tail);
+    }
+
+    SECTION("large files are split") {
+        verifier.set_split_size(piece_size);
+        verifier.start();
+        verifier.wait();
+        CHECK(verifier.first_failure() == b_first);
+    }
+
+    CHECK(verifier.state(a_tail) == tt::piece_state::invalid);
+    CHECK(verifier.state(b_first) == tt::piece_state::invalid);
+    CHECK(verifier.count(tt::piece_state::invalid) == 2);
+}
+
+TEST_CASE("test piece_verifier with sparse files")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    // b.bin is mostly a hole
+    write_file(root / "b.bin", 5'000, 'b');
+    fs::resize_file(root / "b.bin", 1'000'000);
+    write_file(root / "c.bin", 5, 'c');
+
+    constexpr std::size_t piece_size = 32768;
+
+    for (auto protocol : {dt::protocol::v1, dt::protocol::v2}) {
+        auto storage = make_hashed_storage(root, piece_size, protocol);
+
+        auto verifier = tt::piece_verifier(storage, protocol, 2);
+        verifier.start();
+        verifier.wait();
+        CHECK(verifier.count(tt::piece_state::valid) == verifier.piece_count());
+    }
+
+    SECTION("data written into a hole") {
+        auto storage = make_hashed_storage(root, piece_size, dt::protocol::v2);
+        corrupt_file(root / "b.bin", 500'000);
+
+        auto verifier = tt::piece_verifier(storage, dt::protocol::v2, 2);
+        verifier.start();
+        verifier.wait();
+        CHECK(verifier.count(tt::piece_state::invalid) == 1);
+        CHECK(verifier.state(verifier.file_pieces(1).first + 500'000 / piece_size) == tt::piece_state::invalid);
+    }
+}
+
+TEST_CASE("test verify_state")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    auto state_file = tmp_dir.path() / "verify.state";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 4 * 16384, 'b');
+    write_file(root / "c.bin", 5, 'c');
+
+    auto storage = make_hashed_storage(root, 32768, dt::protocol::v1);
+
+    auto state = tt::verify_state(state_file);
+    CHECK_FALSE(state.load());
+    state.reset("0123", dt::protocol::v1, 6);
+    state.set_piece(1, tt::piece_state::valid);
+    state.set_piece(4, tt::piece_state::invalid);
+    state.update_files(storage);
+    state.save();
+
+    auto loaded = tt::verify_state(state_file);
+    REQUIRE(loaded.load());
+    CHECK(loaded.info_hash() == "0123");
+    CHECK(loaded.matches(dt::protocol::v1, 6));
+    CHECK_FALSE(loaded.matches(dt::protocol::v2, 6));
+    CHECK(loaded.piece(0) == tt::piece_state::unchecked);
+    CHECK(loaded.piece(1) == tt::piece_state::valid);
+    CHECK(loaded.piece(4) == tt::piece_state::invalid);
+    CHECK(loaded.changed_files(storage).empty());
+
+    fs::last_write_time(root / "b.bin", fs::last_write_time(root / "b.bin") + std::chrono::hours(1));
+    CHECK(loaded.changed_files(storage) == std::vector<std::size_t>{1});
+}
+
+TEST_CASE("test piece_verifier fail fast")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 4 * 16384, 'b');
+    write_file(root / "c.bin", 5, 'c');
+
+    constexpr std::size_t piece_size = 32768;
+
+    SECTION("stop at the first failed piece") {
+        auto storage = make_hashed_storage(root, piece_size, dt::protocol::v1);
+        corrupt_file(root / "a.bin", 0);
+
+        auto verifier = tt::piece_verifier(storage, dt::protocol::v1, 1);
+        verifier.set_fail_fast(tt::fail_fast_mode::all);
+        verifier.start();
+        verifier.wait();
+
+        CHECK(verifier.first_failure() == 0);
+        CHECK(verifier.piece_file(0) == 0);
+        CHECK(verifier.count(tt::piece_state::invalid) == 1);
+        CHECK(verifier.count(tt::piece_state::unchecked) == verifier.piece_count() - 1);
+    }
+
+    SECTION("skip the rest of a failed file") {
+        auto storage = make_hashed_storage(root, piece_size, dt::protocol::v2);
+        corrupt_file(root / "a.bin", 0);
+
+        auto verifier = tt::piece_verifier(storage, dt::protocol::v2, 1);
+        verifier.set_fail_fast(tt::fail_fast_mode::file);
+        verifier.start();
+        verifier.wait();
+
+        auto [first, last] = verifier.file_pieces(0);
+        CHECK(verifier.state(first) == tt::piece_state::invalid);
+        for (auto piece = first + 1; piece < last; ++piece) {
+            CHECK(verifier.state(piece) == tt::piece_state::unchecked);
+        }
+        CHECK(verifier.percentage(1) == Approx(100.0));
+        CHECK(verifier.percentage(2) == Approx(100.0));
+    }
+}
@@ -0,0 +1,109 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/metafile.hpp>
+
+#include "piece_layout.hpp"
+#include "refresh.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+using namespace std::chrono_literals;
+
+static const std::vector<fs::path> data_files {"a.bin", "b.bin", "c.bin", "d.bin"};
+
+TEST_CASE("test hash_based_on")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    constexpr std::size_t piece_size = 32768;
+
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 50'000, 'b');
+    write_file(root / "c.bin", 70'000, 'c');
+    write_file(root / "d.bin", 5, 'd');
+
+    auto past = fs::file_time_type::clock::now() - 1h;
+    for (const auto& name : {"a.bin", "b.bin", "c.bin", "d.bin"}) {
+        fs::last_write_time(root / name, past);
+    }
+
+    auto protocol = GENERATE(dt::protocol::v1, dt::protocol::v2, dt::protocol::hybrid);
+
+    dt::metafile base {};
+    set_storage_files(base.storage(), root, piece_size, data_files);
+    if (protocol == dt::protocol::hybrid) {
+        tt::align_to_pieces(base.storage());
+    }
+    hash_storage(base.storage(), protocol);
+    auto base_mtimes = tt::stat_storage_files(base.storage());
+
+    // replace the content of c.bin, keeping the same size and an old modification time, as rsync -t does
+    write_file(root / "c.bin", 70'000, 'x');
+    fs::last_write_time(root / "c.bin", past - 1h);
+
+    dt::file_storage expected {};
+    set_storage_files(expected, root, piece_size, data_files);
+    if (protocol == dt::protocol::hybrid) {
+        tt::align_to_pieces(expected);
+    }
+    hash_storage(expected, protocol);
+
+    dt::file_storage storage {};
+    set_storage_files(storage, root, piece_size, data_files);
+    if (protocol == dt::protocol::hybrid) {
+        tt::align_to_pieces(storage);
+    }
+    auto hasher = tt::based_on_hasher(storage, base, base_mtimes, protocol, 2);
+    hasher.start();
+    hasher.wait();
+    const auto& statistics = hasher.statistics();
+
+    // progress reporting waits until all data is counted, including the data of which the hashes were reused
+    auto total_size = protocol == dt::protocol::v1 ? storage.total_file_size() : storage.total_regular_file_size();
+    CHECK(hasher.bytes_done() == total_size);
+    CHECK(hasher.current_file_progress().first == storage.file_count());
+
+    if (tt::has_v1(protocol)) {
+        tt::piece_layout layout(storage);
+        CHECK(statistics.pieces_reused > 0);
+        CHECK(statistics.pieces_hashed < layout.piece_count());
+        for (std::size_t i = 0; i < layout.piece_count(); ++i) {
+            CHECK(storage.get_piece_hash(i) == expected.get_piece_hash(i));
+        }
+    }
+    if (tt::has_v2(protocol)) {
+        CHECK(statistics.files_reused == 3);
+        CHECK(statistics.files_hashed == 1);
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            CHECK(storage.at(i).pieces_root() == expected.at(i).pieces_root());
+        }
+    }
+}
+
+TEST_CASE("test hash_based_on without recorded mtimes rehashes everything")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    constexpr std::size_t piece_size = 32768;
+
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 50'000, 'b');
+    write_file(root / "c.bin", 70'000, 'c');
+    write_file(root / "d.bin", 5, 'd');
+
+    dt::metafile base {};
+    set_storage_files(base.storage(), root, piece_size, data_files);
+    hash_storage(base.storage(), dt::protocol::v2);
+
+    dt::file_storage storage {};
+    set_storage_files(storage, root, piece_size, data_files);
+    auto statistics = tt::hash_based_on(storage, base, {}, dt::protocol::v2);
+
+    CHECK(statistics.files_reused == 0);
+    CHECK(statistics.files_hashed == 4);
+}
@@ -1,9 +1,15 @@
+#pragma once
 #include <filesystem>
 #include <exception>
 #include <fstream>
 #include <iostream>
 #include <random>
 #include <sstream>
+#include <unordered_set>
+#include <vector>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/storage_hasher.hpp>
 
 namespace fs = std::filesystem;
 
@@ -80,4 +86,57 @@ private:
     }
 
     std::filesystem::path path_;
-};
\ No newline at end of file
+};
+
+
+/// Write a file of given size, filled with a pattern that depends on seed.
+inline void write_file(const fs::path& path, std::size_t size, char seed)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream ofs(path, std::ios::binary);
+    for (std::size_t i = 0; i < size; ++i) {
+        ofs.put(static_cast<char>(seed + i % 251));
+    }
+}
+
+/// Set the root directory, the files relative to root and the piece size of storage.
+inline void set_storage_files(dottorrent::file_storage& storage,
+                              const fs::path& root,
+                              std::size_t piece_size,
+                              const std::vector<fs::path>& files = {"a.bin", "b.bin", "c.bin"})
+{
+    storage.set_root_directory(root);
+    for (const auto& f : files) {
+        storage.add_file(root / f);
+    }
+    storage.set_piece_size(piece_size);
+}
+
+inline dottorrent::file_storage make_storage(const fs::path& root,
+                                             std::size_t piece_size,
+                                             const std::vector<fs::path>& files = {"a.bin", "b.bin", "c.bin"})
+{
+    dottorrent::file_storage storage {};
+    set_storage_files(storage, root, piece_size, files);
+    return storage;
+}
+
+/// Hash storage with the storage_hasher of dottorrent.
+inline void hash_storage(dottorrent::file_storage& storage,
+                         dottorrent::protocol protocol,
+                         const std::unordered_set<dottorrent::hash_function>& checksums = {})
+{
+    auto hasher = dottorrent::storage_hasher(storage, {.protocol_version = protocol, .checksums = checksums});
+    hasher.start();
+    hasher.wait();
+}
+
+inline dottorrent::file_storage make_hashed_storage(const fs::path& root,
+                                                    std::size_t piece_size,
+                                                    dottorrent::protocol protocol,
+                                                    const std::vector<fs::path>& files = {"a.bin", "b.bin", "c.bin"})
+{
+    auto storage = make_storage(root, piece_size, files);
+    hash_storage(storage, protocol);
+    return storage;
+}
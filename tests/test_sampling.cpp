@@ -0,0 +1,43 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+
+#include "sampling.hpp"
+
+namespace tt = torrenttools;
+
+TEST_CASE("test sample_size")
+{
+    CHECK(tt::sample_size{.count = 10}.resolve(100) == 10);
+    CHECK(tt::sample_size{.count = 1000}.resolve(100) == 100);
+    CHECK(tt::sample_size{.fraction = 0.01}.resolve(1000) == 10);
+    CHECK(tt::sample_size{.fraction = 0.0001}.resolve(1000) == 1);
+    CHECK(tt::sample_size{.fraction = 1}.resolve(0) == 0);
+}
+
+TEST_CASE("test sample_pieces")
+{
+    auto selection = tt::sample_pieces(1000, 10, 42);
+    REQUIRE(selection.size() == 1000);
+    CHECK(std::count(selection.begin(), selection.end(), true) == 10);
+
+    // one piece in every stratum
+    for (std::size_t i = 0; i < 10; ++i) {
+        CHECK(std::count(selection.begin() + i * 100, selection.begin() + (i + 1) * 100, true) == 1);
+    }
+
+    CHECK(tt::sample_pieces(1000, 10, 42) == selection);
+    CHECK(tt::sample_pieces(1000, 10, 43) != selection);
+
+    auto all = tt::sample_pieces(7, 7, 1);
+    CHECK(std::count(all.begin(), all.end(), true) == 7);
+}
+
+TEST_CASE("test wilson_upper_bound")
+{
+    CHECK(tt::wilson_upper_bound(0, 0) == 1.0);
+    // close to the rule of three for zero failures
+    CHECK(tt::wilson_upper_bound(0, 1000) == Approx(0.00383).epsilon(0.01));
+    CHECK(tt::wilson_upper_bound(50, 1000) > 0.05);
+    CHECK(tt::wilson_upper_bound(50, 1000) == Approx(0.0652).epsilon(0.01));
+    CHECK(tt::wilson_upper_bound(1000, 1000) == Approx(1.0));
+}
@@ -0,0 +1,107 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include "file_matcher.hpp"
+#include "scan_cache.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace tt = torrenttools;
+
+static void write_file(const fs::path& path, std::string_view content)
+{
+    fs::create_directories(path.parent_path());
+    std::ofstream(path, std::ios::binary) << content;
+}
+
+static std::vector<fs::path> scan(const fs::path& root, tt::scan_cache& cache)
+{
+    tt::file_matcher matcher {};
+    matcher.set_scan_cache(&cache);
+    matcher.set_search_root(root);
+    matcher.start();
+    matcher.wait();
+    auto files = matcher.results();
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+TEST_CASE("test scan_cache")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "library";
+    auto cache_file = tmp_dir.path() / "scan-cache";
+
+    write_file(root / "a" / "file1", "data1");
+    write_file(root / "a" / "file2", "data2");
+    write_file(root / "b" / "c" / "file3", "data3");
+
+    std::vector<fs::path> first_scan;
+    {
+        tt::scan_cache cache(cache_file);
+        cache.load();
+        first_scan = scan(root, cache);
+        cache.save();
+
+        CHECK(first_scan.size() == 3);
+        CHECK(cache.hits() == 0);
+        CHECK(cache.misses() == 4);
+    }
+
+    SECTION("unchanged directories are reused") {
+        tt::scan_cache cache(cache_file);
+        cache.load();
+        auto files = scan(root, cache);
+
+        CHECK(files == first_scan);
+        CHECK(cache.hits() == 4);
+        CHECK(cache.misses() == 0);
+    }
+
+    SECTION("changed directories are read again") {
+        write_file(root / "b" / "c" / "file4", "data4");
+
+        tt::scan_cache cache(cache_file);
+        cache.load();
+        auto files = scan(root, cache);
+
+        CHECK(files.size() == 4);
+        CHECK(std::find(files.begin(), files.end(), root / "b" / "c" / "file4") != files.end());
+        CHECK(cache.misses() == 1);
+    }
+
+    SECTION("corrupt cache file is ignored") {
+        write_file(cache_file, "not bencode");
+
+        tt::scan_cache cache(cache_file);
+        cache.load();
+        auto files = scan(root, cache);
+
+        CHECK(files == first_scan);
+        CHECK(cache.hits() == 0);
+    }
+
+    SECTION("records of sibling directories are kept") {
+        auto sibling = tmp_dir.path() / "library2";
+        write_file(sibling / "file5", "data5");
+        {
+            tt::scan_cache cache(cache_file);
+            cache.load();
+            scan(sibling, cache);
+            cache.save();
+        }
+        {
+            tt::scan_cache cache(cache_file);
+            cache.load();
+            scan(root, cache);
+            cache.save();
+        }
+        tt::scan_cache cache(cache_file);
+        cache.load();
+        scan(sibling, cache);
+
+        CHECK(cache.hits() == 1);
+        CHECK(cache.misses() == 0);
+    }
+}
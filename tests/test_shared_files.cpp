@@ -0,0 +1,101 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+
+#include <dottorrent/file_storage.hpp>
+#include <dottorrent/storage_hasher.hpp>
+
+#include "per_file_hasher.hpp"
+#include "piece_layout.hpp"
+#include "shared_files.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+static dt::file_storage make_aligned_storage(const fs::path& root, std::size_t piece_size)
+{
+    auto storage = make_storage(root, piece_size, {"a.bin", "b.bin", "c.bin", "d.bin"});
+    tt::align_to_pieces(storage);
+    return storage;
+}
+
+TEST_CASE("test find_shared_files")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 50'000, 'b');
+    fs::create_hard_link(root / "a.bin", root / "c.bin");
+    // same content, but a different file
+    write_file(root / "d.bin", 100'000, 'a');
+
+    auto storage = make_aligned_storage(root, 32768);
+    auto shared = tt::find_shared_files(storage);
+    REQUIRE(shared.size() == storage.file_count());
+
+    std::size_t shared_count = 0;
+    for (std::size_t i = 0; i < storage.file_count(); ++i) {
+        if (!shared[i]) continue;
+        ++shared_count;
+        CHECK(storage.at(i).path().filename() == "c.bin");
+        CHECK(storage.at(*shared[i]).path().filename() == "a.bin");
+    }
+    CHECK(shared_count == 1);
+}
+
+TEST_CASE("test align_shared_files")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 50'000, 'b');
+    fs::create_hard_link(root / "a.bin", root / "c.bin");
+    fs::create_hard_link(root / "b.bin", root / "d.bin");
+
+    auto storage = make_storage(root, 32768, {"a.bin", "b.bin", "c.bin", "d.bin"});
+    auto shared = tt::align_shared_files(storage, tt::find_shared_files(storage));
+
+    CHECK(tt::piece_layout(storage).is_aligned());
+    CHECK(shared == tt::find_shared_files(storage));
+}
+
+TEST_CASE("test per_file_hasher with shared files")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b.bin", 50'000, 'b');
+    fs::create_hard_link(root / "a.bin", root / "c.bin");
+    fs::create_hard_link(root / "b.bin", root / "d.bin");
+
+    constexpr std::size_t piece_size = 32768;
+
+    for (auto protocol : {dt::protocol::v2, dt::protocol::hybrid}) {
+        auto expected = make_aligned_storage(root, piece_size);
+        auto reference = dt::storage_hasher(expected, {.protocol_version = protocol});
+        reference.start();
+        reference.wait();
+
+        auto storage = make_aligned_storage(root, piece_size);
+        auto hasher = tt::per_file_hasher(storage, protocol, 2);
+        hasher.set_shared_files(tt::find_shared_files(storage));
+        hasher.start();
+        hasher.wait();
+
+        CHECK(hasher.shared_file_count() == 2);
+        CHECK(hasher.shared_bytes() == 150'000);
+
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            if (storage.at(i).is_padding_file()) continue;
+            CHECK(storage.at(i).pieces_root() == expected.at(i).pieces_root());
+            CHECK(storage.at(i).piece_layer() == expected.at(i).piece_layer());
+        }
+        if (protocol == dt::protocol::hybrid) {
+            for (std::size_t i = 0; i < tt::piece_layout(storage).piece_count(); ++i) {
+                CHECK(storage.get_piece_hash(i) == expected.get_piece_hash(i));
+            }
+        }
+    }
+}
@@ -0,0 +1,34 @@
+#include <catch2/catch.hpp>
+#include <thread>
+#include <vector>
+
+#include "shared_results.hpp"
+
+namespace tt = torrenttools;
+
+TEST_CASE("test shared_results")
+{
+    tt::shared_results results {};
+
+    auto [first, first_owner] = results.claim("a");
+    auto [second, second_owner] = results.claim("a");
+    auto [other, other_owner] = results.claim("b");
+
+    CHECK(first_owner);
+    CHECK_FALSE(second_owner);
+    CHECK(other_owner);
+    CHECK(first == second);
+    CHECK(first != other);
+    CHECK(results.reused() == 1);
+
+    const std::vector<tt::piece_state> states {
+            tt::piece_state::valid, tt::piece_state::invalid, tt::piece_state::unchecked};
+
+    std::jthread waiter([&, result = second]() {
+        CHECK(result->wait() == states);
+    });
+    first->publish(states);
+    waiter.join();
+
+    CHECK(second->wait() == states);
+}
@@ -0,0 +1,70 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+#include <dottorrent/metafile.hpp>
+
+#include "split.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+
+TEST_CASE("test split metafile by directory")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "pack";
+    write_file(root / "a" / "1.bin", 100'000, 'a');
+    write_file(root / "a" / "sub" / "2.bin", 70'000, 'b');
+    write_file(root / "b" / "3.bin", 50'000, 'c');
+    write_file(root / "readme.txt", 100, 'd');
+
+    dt::metafile m {};
+    auto& storage = m.storage();
+    set_storage_files(storage, root, 32768, {"a/1.bin", "a/sub/2.bin", "b/3.bin", "readme.txt"});
+    m.set_name("pack");
+    hash_storage(storage, dt::protocol::v2);
+
+    auto results = split_metafile_by_directory(m, dt::protocol::v2);
+    REQUIRE(results.size() == 3);
+
+    CHECK(results[0].name() == "a");
+    REQUIRE(results[0].storage().file_count() == 2);
+    CHECK(results[0].storage().at(0).path() == "1.bin");
+    CHECK(results[0].storage().at(0).pieces_root() == storage.at(0).pieces_root());
+    CHECK(results[0].storage().at(1).path() == fs::path("sub") / "2.bin");
+
+    CHECK(results[1].name() == "b");
+    CHECK(results[1].storage().file_count() == 1);
+    CHECK(results[1].storage().file_mode() == dt::file_mode::multi);
+
+    CHECK(results[2].name() == "readme.txt");
+    CHECK(results[2].storage().file_mode() == dt::file_mode::single);
+    CHECK(results[2].storage().at(0).pieces_root() == storage.at(3).pieces_root());
+}
+
+TEST_CASE("test split metafile keeps per-file checksums")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "pack";
+    write_file(root / "a" / "1.bin", 100'000, 'a');
+    write_file(root / "b" / "3.bin", 50'000, 'c');
+
+    dt::metafile m {};
+    auto& storage = m.storage();
+    set_storage_files(storage, root, 32768, {"a/1.bin", "b/3.bin"});
+    m.set_name("pack");
+    hash_storage(storage, dt::protocol::v2, {dt::hash_function::sha1});
+
+    auto results = split_metafile_by_directory(m, dt::protocol::v2);
+    REQUIRE(results.size() == 2);
+
+    for (std::size_t i = 0; i < 2; ++i) {
+        const auto& entry = results[i].storage().at(0);
+        REQUIRE(entry.checksums().contains("sha1"));
+        auto expected = storage.at(i).checksums().at("sha1")->value();
+        auto actual = entry.checksums().at("sha1")->value();
+        CHECK(std::equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+    }
+}
@@ -0,0 +1,83 @@
+#include <catch2/catch.hpp>
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <unordered_set>
+
+#include <dottorrent/metafile.hpp>
+
+#include "piece_layout.hpp"
+#include "upgrade.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+static dt::metafile make_metafile(const fs::path& root,
+                                  dt::protocol protocol,
+                                  const std::unordered_set<dt::hash_function>& checksums = {})
+{
+    dt::metafile m {};
+    set_storage_files(m.storage(), root, 32768, {"a.bin", fs::path("b") / "c.bin", "d.bin"});
+    m.set_name("data");
+    if (protocol == dt::protocol::hybrid) {
+        tt::align_to_pieces(m.storage());
+    }
+    hash_storage(m.storage(), protocol, checksums);
+    return m;
+}
+
+TEST_CASE("test upgrade metafile")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path() / "data";
+    write_file(root / "a.bin", 100'000, 'a');
+    write_file(root / "b" / "c.bin", 70'000, 'b');
+    write_file(root / "d.bin", 5'000, 'c');
+
+    auto v1 = make_metafile(root, dt::protocol::v1);
+
+    SECTION("matching data") {
+        auto expected = make_metafile(root, dt::protocol::hybrid);
+        auto result = tt::upgrade_metafile(v1, root);
+
+        REQUIRE(result.failed_pieces.empty());
+        const auto& storage = result.metafile.storage();
+        REQUIRE(storage.file_count() == expected.storage().file_count());
+        for (std::size_t i = 0; i < storage.file_count(); ++i) {
+            CHECK(storage.at(i).path() == expected.storage().at(i).path());
+            CHECK(storage.at(i).pieces_root() == expected.storage().at(i).pieces_root());
+        }
+        for (std::size_t i = 0; i < tt::piece_layout(storage).piece_count(); ++i) {
+            CHECK(storage.get_piece_hash(i) == expected.storage().get_piece_hash(i));
+        }
+    }
+
+    SECTION("corrupted data") {
+        write_file(root / "b" / "c.bin", 70'000, 'x');
+        auto result = tt::upgrade_metafile(v1, root);
+        CHECK_FALSE(result.failed_pieces.empty());
+    }
+
+    SECTION("v2 metafile") {
+        auto v2 = make_metafile(root, dt::protocol::v2);
+        CHECK_THROWS_AS(tt::upgrade_metafile(v2, root), std::invalid_argument);
+    }
+
+    SECTION("per-file checksums") {
+        auto v1_md5 = make_metafile(root, dt::protocol::v1, {dt::hash_function::md5});
+        auto result = tt::upgrade_metafile(v1_md5, root);
+
+        REQUIRE(result.failed_pieces.empty());
+        for (const auto& entry : v1_md5.storage()) {
+            auto it = std::find_if(result.metafile.storage().begin(), result.metafile.storage().end(),
+                                   [&](const auto& e) { return e.path() == entry.path(); });
+            REQUIRE(it != result.metafile.storage().end());
+            REQUIRE(it->checksums().contains("md5"));
+            auto expected = entry.checksums().at("md5")->value();
+            auto actual = it->checksums().at("md5")->value();
+            CHECK(std::equal(actual.begin(), actual.end(), expected.begin(), expected.end()));
+        }
+    }
+}
@@ -1,5 +1,6 @@
 
 #include <experimental/source_location>
+#include <fstream>
 
 #include <catch2/catch.hpp>
 #include <fmt/format.h>
@@ -84,6 +85,77 @@ TEST_CASE("Test verify app argument parsing")
             CHECK(verify_options.threads == 4);
         }
     }
+
+    SECTION("state") {
+        auto state_file = fs::path(TEST_RESOURCES_DIR) / "verify.state";
+        auto cmd = fmt::format("verify {} {} --state {} --recheck-failed",
+                               test_torrent.string(), test_target.string(), state_file.string());
+        PARSE_ARGS(cmd);
+        CHECK(verify_options.state == state_file);
+        CHECK(verify_options.recheck_failed);
+    }
+
+    SECTION("fail fast") {
+        auto cmd = fmt::format("verify {} {} --fail-fast", test_torrent.string(), test_target.string());
+        PARSE_ARGS(cmd);
+        CHECK(verify_options.fail_fast);
+        CHECK_FALSE(verify_options.fail_fast_per_file);
+    }
+
+    SECTION("quick") {
+        auto cmd = fmt::format("verify {} {} --quick", test_torrent.string(), test_target.string());
+        PARSE_ARGS(cmd);
+        CHECK(verify_options.quick);
+    }
+
+    SECTION("sample") {
+        SECTION("count") {
+            auto cmd = fmt::format("verify {} {} --sample 100 --seed 7", test_torrent.string(), test_target.string());
+            PARSE_ARGS(cmd);
+            REQUIRE(verify_options.sample);
+            CHECK(verify_options.sample->count == 100);
+            CHECK(verify_options.seed == 7);
+        }
+        SECTION("fraction") {
+            auto cmd = fmt::format("verify {} {} --sample 0.05", test_torrent.string(), test_target.string());
+            PARSE_ARGS(cmd);
+            REQUIRE(verify_options.sample);
+            CHECK(verify_options.sample->fraction == Approx(0.05));
+        }
+        SECTION("percentage") {
+            auto cmd = fmt::format("verify {} {} --sample 1%", test_torrent.string(), test_target.string());
+            PARSE_ARGS(cmd);
+            REQUIRE(verify_options.sample);
+            CHECK(verify_options.sample->fraction == Approx(0.01));
+        }
+        SECTION("invalid") {
+            auto cmd = fmt::format("verify {} {} --sample 1.5", test_torrent.string(), test_target.string());
+            CHECK_THROWS(PARSE_ARGS_THROWING(cmd));
+        }
+    }
+
+    SECTION("include and exclude") {
+        auto cmd = fmt::format("verify {} {} --include .*\\.torrent$ .*\\.txt$ --exclude .*hybrid.*",
+                               test_torrent.string(), test_target.string());
+        PARSE_ARGS(cmd);
+        CHECK(verify_options.include_patterns == std::vector<std::string>{".*\\.torrent$", ".*\\.txt$"});
+        CHECK(verify_options.exclude_patterns == std::vector<std::string>{".*hybrid.*"});
+    }
+
+    SECTION("fastresume") {
+        auto cmd = fmt::format("verify {} {} --fastresume", test_torrent.string(), test_target.string());
+        PARSE_ARGS(cmd);
+        CHECK(verify_options.fastresume);
+    }
+
+    SECTION("batch") {
+        auto batch_file = fs::path(TEST_RESOURCES_DIR) / "lorem_ipsum.txt";
+        auto cmd = fmt::format("verify --batch {} --queue-depth 8", batch_file.string());
+        PARSE_ARGS(cmd);
+        CHECK(verify_options.batch == batch_file);
+        CHECK(verify_options.queue_depth == 8);
+        CHECK(verify_options.metafile.empty());
+    }
 }
 
 TEST_CASE("test verify app: v1 torrent")
@@ -116,4 +188,238 @@ TEST_CASE("test verify app: v2 torrent")
 
         run_verify_app(main_options, verify_options);
     }
-}
\ No newline at end of file
+}
+
+TEST_CASE("test verify app: state")
+{
+    temporary_directory tmp_dir {};
+    main_app_options main_options {};
+
+    verify_app_options verify_options {};
+    verify_options.metafile = fs::path(TEST_RESOURCES_DIR) / "resources-hybrid.torrent";
+    verify_options.files_root_directory = fs::path(TEST_RESOURCES_DIR);
+    verify_options.threads = 2;
+    verify_options.protocol_version = dt::protocol::none;
+    verify_options.state = tmp_dir.path() / "verify.state";
+
+    SECTION("recheck failed requires a previous run") {
+        verify_options.recheck_failed = true;
+        CHECK_THROWS_AS(run_verify_app(main_options, verify_options), std::invalid_argument);
+    }
+
+    SECTION("second run reuses the state") {
+        run_verify_app(main_options, verify_options);
+        CHECK(fs::exists(*verify_options.state));
+        run_verify_app(main_options, verify_options);
+
+        verify_options.recheck_failed = true;
+        run_verify_app(main_options, verify_options);
+    }
+
+    SECTION("state of a different metafile") {
+        run_verify_app(main_options, verify_options);
+        verify_options.metafile = fs::path(TEST_RESOURCES_DIR) / "resources.torrent";
+        CHECK_THROWS_AS(run_verify_app(main_options, verify_options), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test verify app: sample")
+{
+    main_app_options main_options {};
+
+    verify_app_options verify_options {};
+    verify_options.metafile = fs::path(TEST_RESOURCES_DIR) / "resources-hybrid.torrent";
+    verify_options.files_root_directory = fs::path(TEST_RESOURCES_DIR);
+    verify_options.threads = 2;
+    verify_options.protocol_version = dt::protocol::none;
+    verify_options.sample = tt::sample_size {.fraction = 0.5};
+
+    run_verify_app(main_options, verify_options);
+
+    verify_options.state = fs::path(TEST_RESOURCES_DIR) / "verify.state";
+    CHECK_THROWS_AS(run_verify_app(main_options, verify_options), std::invalid_argument);
+}
+
+TEST_CASE("test verify app: include and exclude")
+{
+    main_app_options main_options {};
+
+    verify_app_options verify_options {};
+    verify_options.files_root_directory = fs::path(TEST_RESOURCES_DIR);
+    verify_options.threads = 2;
+    verify_options.protocol_version = dt::protocol::none;
+    verify_options.include_patterns = {".*\\.torrent$"};
+    verify_options.exclude_patterns = {".*hybrid.*"};
+
+    SECTION("v1") {
+        verify_options.metafile = fs::path(TEST_RESOURCES_DIR) / "resources.torrent";
+        run_verify_app(main_options, verify_options);
+    }
+    SECTION("hybrid") {
+        verify_options.metafile = fs::path(TEST_RESOURCES_DIR) / "resources-hybrid.torrent";
+        run_verify_app(main_options, verify_options);
+    }
+    SECTION("combined with --quick") {
+        verify_options.metafile = fs::path(TEST_RESOURCES_DIR) / "resources.torrent";
+        verify_options.quick = true;
+        CHECK_THROWS_AS(run_verify_app(main_options, verify_options), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test verify app: fastresume")
+{
+    temporary_directory tmp_dir {};
+    main_app_options main_options {};
+
+    auto metafile = tmp_dir.path() / "resources-hybrid.torrent";
+    fs::copy_file(fs::path(TEST_RESOURCES_DIR) / "resources-hybrid.torrent", metafile);
+
+    verify_app_options verify_options {};
+    verify_options.metafile = metafile;
+    verify_options.files_root_directory = fs::path(TEST_RESOURCES_DIR);
+    verify_options.threads = 2;
+    verify_options.protocol_version = dt::protocol::none;
+    verify_options.fastresume = true;
+
+    SECTION("resume data is written next to the metafile") {
+        run_verify_app(main_options, verify_options);
+        CHECK(fs::exists(tmp_dir.path() / "resources-hybrid.fastresume"));
+    }
+    SECTION("combined with --quick") {
+        verify_options.quick = true;
+        CHECK_THROWS_AS(run_verify_app(main_options, verify_options), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test verify app: batch")
+{
+    temporary_directory tmp_dir {};
+    main_app_options main_options {};
+    auto resources = fs::path(TEST_RESOURCES_DIR);
+    auto batch_file = tmp_dir.path() / "batch.txt";
+
+    verify_app_options verify_options {};
+    verify_options.threads = 2;
+    verify_options.protocol_version = dt::protocol::none;
+    verify_options.batch = batch_file;
+
+    SECTION("valid data") {
+        std::ofstream(batch_file)
+                << "# metafile\ttarget\n"
+                << (resources / "resources.torrent").string() << '\t' << resources.string() << '\n'
+                << '\n'
+                << (resources / "resources-hybrid.torrent").string() << '\t' << resources.string() << '\n';
+        run_verify_app(main_options, verify_options);
+    }
+
+    SECTION("shared files are verified once") {
+        std::ofstream(batch_file)
+                << (resources / "resources.torrent").string() << '\t' << resources.string() << '\n'
+                << (resources / "resources.torrent").string() << '\t' << resources.string() << '\n'
+                << (resources / "resources-hybrid.torrent").string() << '\t' << resources.string() << '\n'
+                << (resources / "resources-hybrid.torrent").string() << '\t' << resources.string() << '\n';
+        run_verify_app(main_options, verify_options);
+    }
+
+    SECTION("missing data") {
+        std::ofstream(batch_file)
+                << (resources / "resources.torrent").string() << '\t' << resources.string() << '\n'
+                << (resources / "resources.torrent").string() << '\t' << tmp_dir.path().string() << '\n';
+        CHECK_THROWS_AS(run_verify_app(main_options, verify_options), std::runtime_error);
+    }
+
+    SECTION("combined with --state") {
+        std::ofstream(batch_file) << "";
+        verify_options.state = tmp_dir.path() / "verify.state";
+        CHECK_THROWS_AS(run_verify_app(main_options, verify_options), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test read_verify_batch")
+{
+    temporary_directory tmp_dir {};
+    auto batch_file = tmp_dir.path() / "batch.txt";
+
+    SECTION("valid list") {
+        std::ofstream(batch_file) << "# comment\na.torrent\t/data/a\r\n\nb c.torrent\t/data/b c\n";
+        auto jobs = read_verify_batch(batch_file);
+        REQUIRE(jobs.size() == 2);
+        CHECK(jobs[0] == verify_job{"a.torrent", "/data/a"});
+        CHECK(jobs[1] == verify_job{"b c.torrent", "/data/b c"});
+    }
+    SECTION("line without target") {
+        std::ofstream(batch_file) << "a.torrent\n";
+        CHECK_THROWS_AS(read_verify_batch(batch_file), std::invalid_argument);
+    }
+    SECTION("missing list") {
+        CHECK_THROWS_AS(read_verify_batch(tmp_dir.path() / "missing.txt"), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test select_files")
+{
+    dt::file_storage storage {};
+    storage.add_file(dt::file_entry("dir/a.mkv", 100));
+    storage.add_file(dt::file_entry("dir/b.txt", 100));
+    storage.add_file(dt::file_entry("dir/sample/c.mkv", 100));
+
+    SECTION("no patterns selects all files") {
+        CHECK(select_files(storage, {}, {}) == std::vector<bool>{true, true, true});
+    }
+    SECTION("include") {
+        CHECK(select_files(storage, {".*\\.mkv$"}, {}) == std::vector<bool>{true, false, true});
+    }
+    SECTION("include and exclude") {
+        CHECK(select_files(storage, {".*\\.mkv$"}, {".*/sample/.*"}) == std::vector<bool>{true, false, false});
+    }
+    SECTION("invalid pattern") {
+        CHECK_THROWS_AS(select_files(storage, {"("}, {}), std::invalid_argument);
+    }
+}
+
+TEST_CASE("test check_files")
+{
+    temporary_directory tmp_dir {};
+    auto root = tmp_dir.path();
+    for (auto name : {"a.bin", "b.bin", "c.bin"}) {
+        std::ofstream(root / name) << "some data";
+    }
+
+    dt::file_storage storage {};
+    storage.set_root_directory(root);
+    storage.add_file(root / "a.bin");
+    storage.add_file(root / "b.bin");
+    storage.add_file(root / "c.bin");
+
+    CHECK(check_files(storage, 2).empty());
+
+    fs::remove(root / "a.bin");
+    std::ofstream(root / "c.bin", std::ios::app) << "more data";
+
+    auto problems = check_files(storage, 2);
+    REQUIRE(problems.size() == 2);
+    CHECK(problems[0].index == 0);
+    CHECK(problems[0].status == file_status::missing);
+    CHECK(problems[1].index == 2);
+    CHECK(problems[1].status == file_status::wrong_size);
+    CHECK(problems[1].file_size == 18);
+}
+
+TEST_CASE("test verify app: web seed")
+{
+    main_app_options main_options {};
+
+    verify_app_options verify_options {};
+    verify_options.metafile = fs::path(TEST_RESOURCES_DIR) / "resources.torrent";
+    verify_options.threads = 2;
+    verify_options.protocol_version = dt::protocol::none;
+    verify_options.web_seed = true;
+
+    SECTION("metafile without web seeds") {
+        CHECK_THROWS_AS(run_verify_app(main_options, verify_options), std::invalid_argument);
+    }
+    SECTION("combined with --quick") {
+        verify_options.quick = true;
+        CHECK_THROWS_AS(run_verify_app(main_options, verify_options), std::invalid_argument);
+    }
+}
@@ -0,0 +1,168 @@
+#include <catch2/catch.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+#include <fmt/format.h>
+#include <dottorrent/file_storage.hpp>
+
+#if defined(TORRENTTOOLS_USE_CURL) && defined(__unix__)
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "web_seed_verifier.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+TEST_CASE("test web_seed_file_url")
+{
+    SECTION("single file, url of the file") {
+        CHECK(tt::web_seed_file_url("http://example.com/a.iso", "a.iso", dt::file_mode::single, "a.iso")
+              == "http://example.com/a.iso");
+    }
+    SECTION("single file, url of the directory") {
+        CHECK(tt::web_seed_file_url("http://example.com/", "a b.iso", dt::file_mode::single, "a b.iso")
+              == "http://example.com/a%20b.iso");
+    }
+    SECTION("multi file") {
+        CHECK(tt::web_seed_file_url("http://example.com", "name", dt::file_mode::multi, fs::path("dir") / "é.txt")
+              == "http://example.com/name/dir/%C3%A9.txt");
+    }
+}
+
+#if defined(TORRENTTOOLS_USE_CURL) && defined(__unix__)
+
+namespace {
+
+/// Minimal HTTP server on the loopback interface serving byte ranges of the files in a directory.
+class range_server
+{
+public:
+    explicit range_server(fs::path root)
+        : root_(std::move(root))
+    {
+        socket_ = ::socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+        ::listen(socket_, 16);
+
+        socklen_t length = sizeof(address);
+        ::getsockname(socket_, reinterpret_cast<sockaddr*>(&address), &length);
+        port_ = ntohs(address.sin_port);
+
+        thread_ = std::jthread([this]() { serve(); });
+    }
+
+    ~range_server()
+    {
+        ::shutdown(socket_, SHUT_RDWR);
+        ::close(socket_);
+    }
+
+    std::string url() const
+    { return fmt::format("http://127.0.0.1:{}/", port_); }
+
+private:
+    void serve()
+    {
+        for (int client; (client = ::accept(socket_, nullptr, nullptr)) >= 0; ::close(client)) {
+            std::string request {};
+            char buffer[4096];
+            while (request.find("\r\n\r\n") == std::string::npos) {
+                auto n = ::recv(client, buffer, sizeof(buffer), 0);
+                if (n <= 0) break;
+                request.append(buffer, n);
+            }
+            auto path_begin = request.find(' ') + 2;
+            auto target = root_ / request.substr(path_begin, request.find(' ', path_begin) - path_begin);
+            auto range = request.find("Range: bytes=");
+            std::size_t first = 0;
+            std::size_t last = 0;
+            if (!fs::exists(target) || range == std::string::npos ||
+                std::sscanf(request.c_str() + range, "Range: bytes=%zu-%zu", &first, &last) != 2) {
+                send(client, "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\nConnection: close\r\n\r\n");
+                continue;
+            }
+            std::string body(last - first + 1, '\0');
+            std::ifstream(target, std::ios::binary).seekg(first).read(body.data(), body.size());
+            send(client, fmt::format("HTTP/1.1 206 Partial Content\r\nContent-Length: {}\r\n"
+                                     "Connection: close\r\n\r\n{}", body.size(), body));
+        }
+    }
+
+    static void send(int client, std::string_view data)
+    {
+        while (!data.empty()) {
+            auto n = ::send(client, data.data(), data.size(), MSG_NOSIGNAL);
+            if (n <= 0) return;
+            data.remove_prefix(n);
+        }
+    }
+
+    fs::path root_;
+    int socket_;
+    std::uint16_t port_;
+    std::jthread thread_;
+};
+
+} // namespace
+
+TEST_CASE("test web_seed_verifier")
+{
+    temporary_directory tmp_dir {};
+    auto data = tmp_dir.path() / "name";
+    write_file(data / "a.bin", 100'000, 'a');
+    write_file(data / "b.bin", 4 * 16384, 'b');
+    write_file(data / "c.bin", 5, 'c');
+
+    range_server server(tmp_dir.path());
+    constexpr std::size_t piece_size = 32768;
+
+    auto protocol = GENERATE(dt::protocol::v1, dt::protocol::v2);
+    auto storage = make_hashed_storage(data, piece_size, protocol);
+
+    SECTION("valid data") {
+        auto verifier = tt::web_seed_verifier(storage, "name", server.url(), protocol, 2);
+        verifier.start();
+        verifier.wait();
+        CHECK(verifier.results().count(tt::piece_state::valid) == verifier.piece_count());
+    }
+    SECTION("missing data") {
+        auto verifier = tt::web_seed_verifier(storage, "other", server.url(), protocol, 2);
+        verifier.start();
+        verifier.wait();
+        CHECK(verifier.results().count(tt::piece_state::invalid) == verifier.piece_count());
+    }
+    SECTION("selection") {
+        auto verifier = tt::web_seed_verifier(storage, "name", server.url(), protocol, 1);
+        std::vector<bool> selection(verifier.piece_count(), false);
+        selection[1] = true;
+        verifier.set_selection(selection);
+        verifier.start();
+        verifier.wait();
+        CHECK(verifier.results().count(tt::piece_state::valid) == 1);
+        CHECK(verifier.results().state(1) == tt::piece_state::valid);
+    }
+    SECTION("corrupted data") {
+        {
+            std::fstream f(data / "b.bin", std::ios::binary | std::ios::in | std::ios::out);
+            f.seekp(20000);
+            f.put('x');
+        }
+        auto verifier = tt::web_seed_verifier(storage, "name", server.url(), protocol, 3);
+        verifier.start();
+        verifier.wait();
+        CHECK(verifier.results().count(tt::piece_state::invalid) == 1);
+    }
+}
+
+#endif
@@ -0,0 +1,159 @@
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <dottorrent/hasher/factory.hpp>
+
+#include "file_hasher.hpp"
+#include "file_stat.hpp"
+#include "zero_data.hpp"
+#include "test_resources.hpp"
+
+namespace fs = std::filesystem;
+namespace dt = dottorrent;
+namespace tt = torrenttools;
+
+TEST_CASE("test is_zero")
+{
+    std::vector<std::byte> data(1000);
+    CHECK(tt::is_zero(data));
+    CHECK(tt::is_zero(std::span(data).first(0)));
+
+    for (std::size_t i : {0, 63, 64, 500, 999}) {
+        data[i] = std::byte {1};
+        CHECK_FALSE(tt::is_zero(data));
+        data[i] = std::byte {0};
+    }
+}
+
+TEST_CASE("test precomputed zero hashes")
+{
+    constexpr std::size_t piece_size = 64 * 1024;
+    std::vector<std::byte> zeros(piece_size);
+
+    auto sha1 = dt::make_hasher(dt::hash_function::sha1);
+    dt::sha1_hash expected_sha1 {};
+    sha1->update(zeros);
+    sha1->finalize_to(tt::hash_bytes(expected_sha1));
+    CHECK(tt::zero_piece_sha1(piece_size) == expected_sha1);
+
+    auto sha256 = dt::make_hasher(dt::hash_function::sha256);
+    dt::sha256_hash expected_sha256 {};
+    sha256->update(std::span(zeros).first(tt::v2_block_size));
+    sha256->finalize_to(tt::hash_bytes(expected_sha256));
+    CHECK(tt::zero_block_sha256() == expected_sha256);
+
+    std::vector<dt::sha256_hash> leaves(piece_size / tt::v2_block_size, expected_sha256);
+    CHECK(tt::zero_piece_sha256(piece_size) == tt::merkle_root(leaves, leaves.size()));
+}
+
+TEST_CASE("test file_hasher update_zeros")
+{
+    constexpr std::size_t piece_size = 32 * 1024;
+    std::vector<std::byte> data(10'000, std::byte {7});
+
+    // offsets in the middle of blocks and pieces
+    auto zero_count = GENERATE(std::size_t(1000), std::size_t(16384), std::size_t(100'000), std::size_t(3 * 32768));
+
+    tt::file_hasher expected_hasher(dt::protocol::hybrid, piece_size);
+    tt::file_hasher hasher(dt::protocol::hybrid, piece_size);
+
+    std::vector<std::byte> zeros(zero_count);
+    expected_hasher.update(data);
+    expected_hasher.update(zeros);
+    expected_hasher.update(data);
+
+    hasher.update(data);
+    hasher.update_zeros(zero_count);
+    hasher.update(data);
+
+    auto expected = expected_hasher.finalize();
+    auto hashes = hasher.finalize();
+    CHECK(hashes.file_size == expected.file_size);
+    CHECK(hashes.pieces_root == expected.pieces_root);
+    CHECK(hashes.piece_layer == expected.piece_layer);
+    CHECK(hashes.pieces == expected.pieces);
+    CHECK(hashes.tail_piece == expected.tail_piece);
+    CHECK(hashes.padded_tail_piece == expected.padded_tail_piece);
+}
+
+TEST_CASE("test hash_file with sparse file")
+{
+    temporary_directory tmp_dir {};
+    auto path = tmp_dir.path() / "sparse.img";
+    constexpr std::size_t file_size = 8 * 1024 * 1024;
+    constexpr std::size_t piece_size = 64 * 1024;
+
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        ofs << "header";
+        ofs.seekp(5'000'000);
+        ofs << "data";
+    }
+    fs::resize_file(path, file_size);
+
+    // hash the same content without holes
+    std::vector<std::byte> content(file_size);
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        ifs.read(reinterpret_cast<char*>(content.data()), file_size);
+    }
+    tt::file_hasher expected_hasher(dt::protocol::hybrid, piece_size);
+    expected_hasher.update(content);
+    auto expected = expected_hasher.finalize();
+
+    std::atomic_size_t bytes_done = 0;
+    auto hashes = tt::hash_file(path, dt::protocol::hybrid, piece_size, &bytes_done);
+
+    CHECK(bytes_done == file_size);
+    CHECK(hashes.file_size == file_size);
+    CHECK(hashes.pieces_root == expected.pieces_root);
+    CHECK(hashes.piece_layer == expected.piece_layer);
+    CHECK(hashes.pieces == expected.pieces);
+}
+
+TEST_CASE("test hash_file with checksums")
+{
+    temporary_directory tmp_dir {};
+    auto path = tmp_dir.path() / "file.bin";
+    constexpr std::size_t piece_size = 64 * 1024;
+    const std::vector<tt::checksum_algorithm> algorithms {
+            dt::hash_function::sha1, dt::hash_function::sha256, tt::fast_checksum::crc32c};
+
+    // small files are checksummed on the calling thread, large files on separate threads
+    auto file_size = GENERATE(std::size_t(100'000), std::size_t(20 * 1024 * 1024));
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        for (std::size_t i = 0; i < file_size / 2; ++i) {
+            ofs.put(static_cast<char>(i % 251));
+        }
+    }
+    // the second half is a hole
+    fs::resize_file(path, file_size);
+
+    std::vector<std::byte> content(file_size);
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        ifs.read(reinterpret_cast<char*>(content.data()), file_size);
+    }
+
+    auto hashes = tt::hash_file(path, dt::protocol::v2, piece_size, nullptr, false, algorithms);
+    CHECK(hashes.file_size == file_size);
+    REQUIRE(hashes.checksums.size() == algorithms.size());
+
+    for (const auto& algorithm : algorithms) {
+        auto hasher = tt::make_checksum_hasher(algorithm);
+        std::vector<std::byte> expected(hasher->digest_size());
+        hasher->update(content);
+        hasher->finalize_to(expected);
+        CHECK(hashes.checksums.at(algorithm) == expected);
+    }
+
+    SECTION("checksums do not change the piece hashes") {
+        auto expected = tt::hash_file(path, dt::protocol::v2, piece_size);
+        CHECK(expected.checksums.empty());
+        CHECK(hashes.pieces_root == expected.pieces_root);
+        CHECK(hashes.piece_layer == expected.piece_layer);
+    }
+}